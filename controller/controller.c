@@ -58,9 +58,13 @@
 #include "vlog.h"
 #define THIS_MODULE VLM_controller
 
-#define MAX_SWITCHES 16
 #define MAX_LISTENERS 16
 
+/* Maximum number of connections to accept from a single listener per trip
+ * through the main loop, so that a flood of reconnecting switches does not
+ * starve the switches that are already connected. */
+#define ACCEPT_BATCH 64
+
 struct switch_ {
     struct lswitch *lswitch;
     struct rconn *rconn;
@@ -75,6 +79,15 @@ static bool setup_flows = true;
 /* --max-idle: Maximum idle time, in seconds, before flows expire. */
 static int max_idle = 60;
 
+/* --bundle-flows: Send flow setups to switches in bundles? */
+static bool bundle_flows = false;
+
+/* --batch-packets: Send forwarded packets to switches in batches? */
+static bool batch_packets = false;
+
+/* --max-switches: Maximum number of switch connections. */
+static int max_switches = 1024;
+
 static int do_switching(struct switch_ *);
 static void new_switch(struct switch_ *, struct vconn *, const char *name);
 static void parse_options(int argc, char *argv[]);
@@ -83,7 +96,7 @@ static void usage(void) NO_RETURN;
 int
 main(int argc, char *argv[])
 {
-    struct switch_ switches[MAX_SWITCHES];
+    struct switch_ *switches;
     struct pvconn *listeners[MAX_LISTENERS];
     int n_switches, n_listeners;
     int retval;
@@ -101,6 +114,7 @@ main(int argc, char *argv[])
                   "use --help for usage");
     }
 
+    switches = xmalloc(max_switches * sizeof *switches);
     n_switches = n_listeners = 0;
     for (i = optind; i < argc; i++) {
         const char *name = argv[i];
@@ -109,7 +123,7 @@ main(int argc, char *argv[])
 
         retval = vconn_open(name, OFP_VERSION, &vconn);
         if (!retval) {
-            if (n_switches >= MAX_SWITCHES) {
+            if (n_switches >= max_switches) {
                 ofp_fatal(0, "max %d switch connections", n_switches);
             }
             new_switch(&switches[n_switches++], vconn, name);
@@ -144,16 +158,22 @@ main(int argc, char *argv[])
         int iteration;
         int i;
 
-        /* Accept connections on listening vconns. */
-        for (i = 0; i < n_listeners && n_switches < MAX_SWITCHES; ) {
-            struct vconn *new_vconn;
-            int retval;
+        /* Accept connections on listening vconns, draining each backlog up to
+         * ACCEPT_BATCH connections. */
+        for (i = 0; i < n_listeners && n_switches < max_switches; ) {
+            int retval = 0;
+            int j;
 
-            retval = pvconn_accept(listeners[i], OFP_VERSION, &new_vconn);
-            if (!retval || retval == EAGAIN) {
-                if (!retval) {
-                    new_switch(&switches[n_switches++], new_vconn, "tcp");
+            for (j = 0; j < ACCEPT_BATCH && n_switches < max_switches; j++) {
+                struct vconn *new_vconn;
+
+                retval = pvconn_accept(listeners[i], OFP_VERSION, &new_vconn);
+                if (retval) {
+                    break;
                 }
+                new_switch(&switches[n_switches++], new_vconn, "tcp");
+            }
+            if (!retval || retval == EAGAIN) {
                 i++;
             } else {
                 pvconn_close(listeners[i]);
@@ -189,7 +209,7 @@ main(int argc, char *argv[])
         }
 
         /* Wait for something to happen. */
-        if (n_switches < MAX_SWITCHES) {
+        if (n_switches < max_switches) {
             for (i = 0; i < n_listeners; i++) {
                 pvconn_wait(listeners[i]);
             }
@@ -212,6 +232,8 @@ new_switch(struct switch_ *sw, struct vconn *vconn, const char *name)
     sw->rconn = rconn_new_from_vconn(name, vconn);
     sw->lswitch = lswitch_create(sw->rconn, learn_macs,
                                  setup_flows ? max_idle : -1);
+    lswitch_set_bundle_flows(sw->lswitch, bundle_flows);
+    lswitch_set_batch_packets(sw->lswitch, batch_packets);
 }
 
 static int
@@ -239,17 +261,27 @@ parse_options(int argc, char *argv[])
 {
     enum {
         OPT_MAX_IDLE = UCHAR_MAX + 1,
+        OPT_MAX_SWITCHES,
+        OPT_REUSEPORT,
+        OPT_BUNDLE_FLOWS,
+        OPT_BATCH_PACKETS,
         OPT_PEER_CA_CERT,
-        VLOG_OPTION_ENUMS
+        VLOG_OPTION_ENUMS,
+        VCONN_LOG_OPTION_ENUMS
     };
     static struct option long_options[] = {
         {"hub",         no_argument, 0, 'H'},
         {"noflow",      no_argument, 0, 'n'},
         {"max-idle",    required_argument, 0, OPT_MAX_IDLE},
+        {"max-switches", required_argument, 0, OPT_MAX_SWITCHES},
+        {"reuseport",   no_argument, 0, OPT_REUSEPORT},
+        {"bundle-flows", no_argument, 0, OPT_BUNDLE_FLOWS},
+        {"batch-packets", no_argument, 0, OPT_BATCH_PACKETS},
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
         DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
+        VCONN_LOG_LONG_OPTIONS,
 #ifdef HAVE_OPENSSL
         VCONN_SSL_LONG_OPTIONS
         {"peer-ca-cert", required_argument, 0, OPT_PEER_CA_CERT},
@@ -288,6 +320,25 @@ parse_options(int argc, char *argv[])
             }
             break;
 
+        case OPT_MAX_SWITCHES:
+            max_switches = atoi(optarg);
+            if (max_switches < 1) {
+                ofp_fatal(0, "--max-switches argument must be at least 1");
+            }
+            break;
+
+        case OPT_REUSEPORT:
+            pvconn_set_reuseport(true);
+            break;
+
+        case OPT_BUNDLE_FLOWS:
+            bundle_flows = true;
+            break;
+
+        case OPT_BATCH_PACKETS:
+            batch_packets = true;
+            break;
+
         case 'h':
             usage();
 
@@ -296,6 +347,7 @@ parse_options(int argc, char *argv[])
             exit(EXIT_SUCCESS);
 
         VLOG_OPTION_HANDLERS
+        VCONN_LOG_OPTION_HANDLERS
         DAEMON_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -326,10 +378,16 @@ usage(void)
     vconn_usage(true, true, false);
     daemon_usage();
     vlog_usage();
+    vconn_log_usage();
     printf("\nOther options:\n"
            "  -H, --hub               act as hub instead of learning switch\n"
            "  -n, --noflow            pass traffic, but don't add flows\n"
            "  --max-idle=SECS         max idle time for new flows\n"
+           "  --max-switches=N        max number of switch connections\n"
+           "  --reuseport             share listening ports with other\n"
+           "                          controller processes (SO_REUSEPORT)\n"
+           "  --bundle-flows          send flow setups in bundles\n"
+           "  --batch-packets         send forwarded packets in batches\n"
            "  -h, --help              display this help message\n"
            "  -V, --version           display version information\n");
     exit(EXIT_SUCCESS);
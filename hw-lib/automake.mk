@@ -19,7 +19,9 @@ hw_lib_libnf2_a_SOURCES =		\
 	hw-lib/nf2/debug.h	\
 	hw-lib/nf2/reg_defines_openflow_switch.h	\
 	hw-lib/nf2/nf2util.c	\
-	hw-lib/nf2/nf2util.h
+	hw-lib/nf2/nf2util.h	\
+	hw-lib/nf2/nf2_sim.c	\
+	hw-lib/nf2/nf2_sim.h
 
 hw_lib_nf2_a_CPPFLAGS = $(AM_CPPFLAGS) $(OF_CPP_FLAGS) -DHWTABLE_NO_DEBUG
 hw_lib_nf2_a_CPPFLAGS += -I hw-lib/nf2
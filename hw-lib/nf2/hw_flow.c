@@ -199,6 +199,7 @@ nf2_uninstall_flow(struct datapath *dpinst, struct sw_table *flowtab,
 	struct sw_flow *flow, *n;
 	struct nf2_flow *nf2flow;
 	unsigned int count = 0;
+	uint64_t packets, bytes;
 	struct list deleted;
 	list_init(&deleted);
 
@@ -213,11 +214,10 @@ nf2_uninstall_flow(struct datapath *dpinst, struct sw_table *flowtab,
 			nf2flow = flow->private;
 
 			if (nf2flow != NULL) {
-				flow->packet_count
-					+= nf2_get_packet_count(dev,
-								nf2flow);
-				flow->byte_count += nf2_get_byte_count(dev,
-								       nf2flow);
+				nf2_get_flow_counts(dev, nf2flow, NULL,
+						    &packets, &bytes);
+				flow->packet_count += packets;
+				flow->byte_count += bytes;
 			}
 			count += do_uninstall(flow, &deleted);
 			if (keep_flow == KEEP_FLOW) {
@@ -228,8 +228,6 @@ nf2_uninstall_flow(struct datapath *dpinst, struct sw_table *flowtab,
 	}
 	nf2flowtab->num_flows -= count;
 
-	nf2_free_net_device(dev);
-
 	if (keep_flow == DELETE_FLOW) {
 		/* Notify DP of deleted flows and delete the flow */
 		LIST_FOR_EACH_SAFE (flow, n, struct sw_flow, node, &deleted) {
@@ -250,8 +248,11 @@ nf2_flow_timeout(struct sw_table *flowtab, struct list *deleted)
 	struct nf2_flowtable *nf2flowtab = (struct nf2_flowtable *)flowtab;
 	struct sw_flow *flow, *n;
 	struct nf2_flow *nf2flow;
+	struct nf2_wildcard_counts wc;
+	bool harvest;
 	int num_uninst_flows = 0;
 	uint64_t num_forw_packets = 0;
+	uint64_t packets, bytes;
 	uint64_t now = time_msec();
 
 	dev = nf2_get_net_device();
@@ -260,18 +261,28 @@ nf2_flow_timeout(struct sw_table *flowtab, struct list *deleted)
 		return;
 	}
 
+	/* Harvest the whole wildcard table's counters up front, instead of
+	 * reading them row by row for each flow.  If that fails, leave the
+	 * counts for the next sweep: treating the zeroed counters as read
+	 * would look like every wildcard counter wrapped around. */
+	harvest = !nf2_get_wildcard_counts(dev, &wc);
+	if (!harvest) {
+		DBG_ERROR("Could not read wildcard counters\n");
+	}
+
 	/* LOCK; */
 	/* FIXME */
 	LIST_FOR_EACH_SAFE (flow, n, struct sw_flow, node, &nf2flowtab->flows) {
 		nf2flow = flow->private;
-		if (nf2flow != NULL) {
-			num_forw_packets = flow->packet_count
-				+ nf2_get_packet_count(dev, nf2flow);
-			flow->byte_count += nf2_get_byte_count(dev, nf2flow);
-		}
-		if (num_forw_packets > flow->packet_count) {
-			flow->packet_count = num_forw_packets;
-			flow->used = now;
+		if (nf2flow != NULL && harvest) {
+			nf2_get_flow_counts(dev, nf2flow, &wc,
+					    &packets, &bytes);
+			num_forw_packets = flow->packet_count + packets;
+			flow->byte_count += bytes;
+			if (num_forw_packets > flow->packet_count) {
+				flow->packet_count = num_forw_packets;
+				flow->used = now;
+			}
 		}
 
 		if (flow_timeout(flow)) {
@@ -283,7 +294,6 @@ nf2_flow_timeout(struct sw_table *flowtab, struct list *deleted)
 	/* UNLOCK; */
 
 	nf2_clear_watchdog(dev);
-	nf2_free_net_device(dev);
 
 	nf2flowtab->num_flows -= num_uninst_flows;
 }
@@ -318,6 +328,7 @@ nf2_destroy_flowtable(struct sw_table *flowtab)
 
 	nf2_destroy_exact_freelist();
 	nf2_destroy_wildcard_freelist();
+	nf2_close_net_device();
 }
 
 static int
@@ -359,9 +370,7 @@ nf2_get_flowstats(struct sw_table *flowtab, struct sw_table_stats *stats)
 	if (dev == NULL) {
 		DBG_VERBOSE("Could not open NetFPGA device\n");
 	} else {
-		num_matched = nf2_get_matched_count(dev);
-		num_missed = nf2_get_missed_count(dev);
-		nf2_free_net_device(dev);
+		nf2_get_lookup_counts(dev, &num_matched, &num_missed);
 	}
 
 	stats->name = "nf2";
@@ -374,7 +383,7 @@ nf2_get_flowstats(struct sw_table *flowtab, struct sw_table_stats *stats)
 }
 
 static int
-nf2_get_portstats(of_hw_driver_t *hw_drv, int of_port,
+nf2_get_portstats(of_hw_driver_t *hw_drv UNUSED, int of_port,
 			struct ofp_port_stats *stats)
 {
 	int nf2_port;
@@ -398,7 +407,6 @@ nf2_get_portstats(of_hw_driver_t *hw_drv, int of_port,
 	}
 
 	if (nf2_get_port_info(dev, nf2_port, nf2portinfo)) {
-		nf2_free_net_device(dev);
 		free(nf2portinfo);
 		return 1;
 	}
@@ -419,7 +427,6 @@ nf2_get_portstats(of_hw_driver_t *hw_drv, int of_port,
 	stats->rx_crc_err = -1;
 	stats->collisions = -1;
 
-	nf2_free_net_device(dev);
 	free(nf2portinfo);
 	return 0;
 }
@@ -429,7 +436,7 @@ nf2_get_portstats(of_hw_driver_t *hw_drv, int of_port,
  */
 
 of_hw_driver_t *
-new_of_hw_driver(struct datapath *dp)
+new_of_hw_driver(struct datapath *dp UNUSED)
 {
 	struct sw_table *sw_tab;
 	of_hw_driver_t *hw_drv;
@@ -441,7 +448,6 @@ new_of_hw_driver(struct datapath *dp)
 		return NULL;
 	}
 	nf2_reset_card(dev);
-	nf2_free_net_device(dev);
 
 	nf2flowtab = calloc(1, sizeof(*nf2flowtab));
 	if (nf2flowtab == NULL) {
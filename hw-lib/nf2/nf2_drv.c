@@ -57,12 +57,12 @@ static void nf2_get_all_ports_info_addr(struct nf2_all_ports_info_addr *);
 static void
 log_entry(nf2_of_entry_wrap *entry)
 {
+#ifdef HWTABLE_NO_DEBUG
+	(void) entry;
+#else
 	int i;
 
 	DBG_VERBOSE("log entry\n");
-#ifdef HWTABLE_NO_DEBUG
-	return;
-#else
 
 	// Log the physical source port
 	DBG_VERBOSE("E psrc[%i] ", entry->entry.src_port / 2);
@@ -118,7 +118,7 @@ static void
 log_entry_raw(nf2_of_entry_wrap *entry)
 {
 #ifdef HWTABLE_NO_DEBUG
-	return;
+	(void) entry;
 #else
 	int i;
 	unsigned char *c;
@@ -139,7 +139,7 @@ static void
 log_mask(nf2_of_mask_wrap *mask)
 {
 #ifdef HWTABLE_NO_DEBUG
-	return;
+	(void) mask;
 #else
 	int i;
 
@@ -197,7 +197,7 @@ static void
 log_mask_raw(nf2_of_mask_wrap *mask)
 {
 #ifdef HWTABLE_NO_DEBUG
-	return;
+	(void) mask;
 #else
 	int i;
 	unsigned char *c;
@@ -218,7 +218,7 @@ static void
 log_action(nf2_of_action_wrap *action)
 {
 #ifdef HWTABLE_NO_DEBUG
-	return;
+	(void) action;
 #else
 	int i;
 
@@ -315,7 +315,7 @@ static void
 log_action_raw(nf2_of_action_wrap *action)
 {
 #ifdef HWTABLE_NO_DEBUG
-	return;
+	(void) action;
 #else
 	int i;
 	unsigned char *c;
@@ -342,7 +342,10 @@ nf2_reset_card(struct nf2device *dev)
 	val |= 0x100;
 	writeReg(dev, CPCI_REG_CTRL, val);
 	DBG_VERBOSE("Reset the NetFPGA.\n");
-	sleep(2);
+	if (!dev->ops) {
+		/* Give real hardware time to come back up. */
+		sleep(2);
+	}
 }
 
 void
@@ -644,6 +647,49 @@ nf2_get_wildcard_byte_count(struct nf2device *dev, int row)
 	return val;
 }
 
+/* Reads both the packet and the byte count (deltas) of exact match 'row' in a
+ * single access.  Returns 0 on success. */
+int
+nf2_get_exact_counts(struct nf2device *dev, int row, unsigned int *packets,
+		     unsigned int *bytes)
+{
+	nf2_of_exact_counters_wrap counters;
+	unsigned int index = row << 7;
+
+	memset(&counters, 0, sizeof(nf2_of_exact_counters_wrap));
+	if (readRegRange(dev, SRAM_BASE_ADDR + index
+			 + sizeof(nf2_of_entry_wrap),
+			 NF2_OF_EXACT_COUNTERS_WORD_LEN, counters.raw)) {
+		*packets = *bytes = 0;
+		return 1;
+	}
+	*packets = counters.counters.pkt_count;
+	*bytes = counters.counters.byte_count;
+
+	DBG_VERBOSE
+	    ("** Exact match counts(delta) row: %i packets: %u bytes: %u\n",
+	     row, *packets, *bytes);
+
+	return 0;
+}
+
+/* Reads the packet and byte counters (sums) of every wildcard row into
+ * 'counts', using one range read for each kind of counter rather than a pair
+ * of accesses per row.  Returns 0 on success. */
+int
+nf2_get_wildcard_counts(struct nf2device *dev,
+			struct nf2_wildcard_counts *counts)
+{
+	if (readRegRange(dev, OPENFLOW_WILDCARD_LOOKUP_PKTS_HIT_0_REG,
+			 OPENFLOW_WILDCARD_TABLE_SIZE, counts->packets)
+	    || readRegRange(dev, OPENFLOW_WILDCARD_LOOKUP_BYTES_HIT_0_REG,
+			    OPENFLOW_WILDCARD_TABLE_SIZE, counts->bytes)) {
+		memset(counts, 0, sizeof *counts);
+		return 1;
+	}
+	return 0;
+}
+
 unsigned long int
 nf2_get_matched_count(struct nf2device *dev)
 {
@@ -678,11 +724,27 @@ nf2_get_missed_count(struct nf2device *dev)
 	return ((unsigned long int)(val_wild + val_exact));
 }
 
+/* Reads the matched and missed lookup counts of both tables with a single
+ * range read, relying on the four counters being adjacent. */
+void
+nf2_get_lookup_counts(struct nf2device *dev, unsigned long int *matched,
+		      unsigned long int *missed)
+{
+	unsigned int vals[4];
+
+	memset(vals, 0, sizeof vals);
+	readRegRange(dev, OPENFLOW_LOOKUP_WILDCARD_MISSES_REG, 4, vals);
+
+	// Wildcard misses, wildcard hits, exact misses, exact hits.
+	*missed = (unsigned long int)(vals[0] + vals[2]);
+	*matched = (unsigned long int)(vals[1] + vals[3]);
+}
+
 static void
 log_watchdog_info(struct nf2device *dev)
 {
 #ifdef HWTABLE_NO_DEBUG
-        return;
+	(void) dev;
 #else
 #define CLK_CYCLE 8
 	unsigned int nf2wdtinfo;
@@ -130,6 +130,12 @@ struct nf2_port_info {
 
 #pragma pack(pop)		/* XXX: Restore original alignment from stack */
 
+/* Hit counters of every row of the wildcard table, harvested all at once. */
+struct nf2_wildcard_counts {
+	uint32_t packets[OPENFLOW_WILDCARD_TABLE_SIZE];
+	uint32_t bytes[OPENFLOW_WILDCARD_TABLE_SIZE];
+};
+
 void nf2_reset_card(struct nf2device *);
 void nf2_clear_watchdog(struct nf2device *);
 int nf2_write_of_wildcard(struct nf2device *, int, nf2_of_entry_wrap *,
@@ -143,8 +149,13 @@ unsigned int nf2_get_exact_packet_count(struct nf2device *, int);
 unsigned int nf2_get_exact_byte_count(struct nf2device *, int);
 unsigned int nf2_get_wildcard_packet_count(struct nf2device *, int);
 unsigned int nf2_get_wildcard_byte_count(struct nf2device *, int);
+int nf2_get_exact_counts(struct nf2device *, int, unsigned int *,
+			 unsigned int *);
+int nf2_get_wildcard_counts(struct nf2device *, struct nf2_wildcard_counts *);
 unsigned long int nf2_get_matched_count(struct nf2device *);
 unsigned long int nf2_get_missed_count(struct nf2device *);
+void nf2_get_lookup_counts(struct nf2device *, unsigned long int *,
+			   unsigned long int *);
 int nf2_get_port_info(struct nf2device *, int, struct nf2_port_info *);
 
 #endif
@@ -75,43 +75,56 @@ static void populate_action_set_vlan_vid(nf2_of_action_wrap *, uint8_t *);
 static void populate_action_set_vlan_pcp(nf2_of_action_wrap *, uint8_t *);
 static void populate_action_strip_vlan(nf2_of_action_wrap *);
 
-int iface_chk_done = 0;
-int net_iface = 0;
+/* The device that all table operations use.  It is opened on first use and
+ * kept open until the table is destroyed, instead of being opened and closed
+ * around every operation. */
+static struct nf2device *nf2_dev;
 
+/* Returns the NetFPGA device, opening it if it is not already open, or a null
+ * pointer if it cannot be opened.  The caller must not free the device. */
 struct nf2device *
 nf2_get_net_device(void)
 {
 	struct nf2device *dev;
-        dev = calloc(1, sizeof(struct nf2device));
-        dev->device_name = DEFAULT_IFACE;
 
-	if (iface_chk_done) {
-		dev->net_iface = net_iface;
-	} else {
-		if (check_iface(dev)) {
-			iface_chk_done = 0;
-			return NULL;
-		} else {
-			iface_chk_done = 1;
-			net_iface = dev->net_iface;
-		}
+	if (nf2_dev != NULL) {
+		return nf2_dev;
+	}
+
+	dev = calloc(1, sizeof(struct nf2device));
+	if (dev == NULL) {
+		return NULL;
+	}
+	dev->device_name = DEFAULT_IFACE;
+	if (check_iface(dev) || openDescriptor(dev)) {
+		free(dev);
+		return NULL;
 	}
+	nf2_dev = dev;
+	return dev;
+}
 
-        if (openDescriptor(dev)) {
-                return NULL;
-        }
-        return dev;
+/* Makes 'dev', which must have been allocated with malloc(), the device that
+ * nf2_get_net_device() returns, closing any device already open.  Lets the
+ * table run against a simulated register file (see nf2_sim.h). */
+void
+nf2_set_net_device(struct nf2device *dev)
+{
+	nf2_close_net_device();
+	nf2_dev = dev;
 }
 
+/* Closes the device opened by nf2_get_net_device(), if any. */
 void
-nf2_free_net_device(struct nf2device *dev)
+nf2_close_net_device(void)
 {
-	if (dev == NULL){
+	if (nf2_dev == NULL) {
 		return;
 	}
 
-        closeDescriptor(dev);
-	free(dev);
+	closeDescriptor(nf2_dev);
+	free(nf2_dev);
+	nf2_dev = NULL;
 }
 
 /* Checks to see if the actions requested by the flow are capable of being
@@ -198,7 +211,6 @@ nf2_clear_of_exact(uint32_t pos)
 		return;
 	}
 	nf2_write_of_exact(dev, pos, &entry, &action);
-	nf2_free_net_device(dev);
 }
 
 /*
@@ -222,7 +234,6 @@ nf2_clear_of_wildcard(uint32_t pos)
 		return;
 	}
 	nf2_write_of_wildcard(dev, pos, &entry, &mask, &action);
-	nf2_free_net_device(dev);
 }
 
 int
@@ -334,7 +345,6 @@ nf2_write_static_wildcard(void)
 				      + i, &entry, &mask, &action);
 	}
 
-	nf2_free_net_device(dev);
 	return 0;
 }
 
@@ -784,7 +794,6 @@ nf2_build_and_write_flow(struct sw_flow *flow)
 			DBG_VERBOSE
 				("Collision getting free exact match entry\n");
 			// collision
-			nf2_free_net_device(dev);
 			return 1;
 		}
 		// set the active bit on this entry
@@ -802,7 +811,6 @@ nf2_build_and_write_flow(struct sw_flow *flow)
 			if (!(sfw = get_free_wildcard())) {
 				DBG_VERBOSE("No free wildcard entries found.");
 				// no free entries
-				nf2_free_net_device(dev);
 				return 1;
 			}
 			// try to get 3 more positions
@@ -817,7 +825,6 @@ nf2_build_and_write_flow(struct sw_flow *flow)
 			if (num_entries < 3) {
 				// failed to get enough entries, return them and exit
 				nf2_delete_private((void *)sfw);
-				nf2_free_net_device(dev);
 				return 1;
 			}
 
@@ -857,7 +864,6 @@ nf2_build_and_write_flow(struct sw_flow *flow)
 					nf2_add_free_wildcard(sfw);
 					DBG_VERBOSE
 						("Failure writing to hardware\n");
-					nf2_free_net_device(dev);
 					return 1;
 				} else {
 					// success writing to hardware, store the position
@@ -866,14 +872,12 @@ nf2_build_and_write_flow(struct sw_flow *flow)
 			} else {
 				// hardware is full, return 0
 				DBG_VERBOSE("No free wildcard entries found.");
-				nf2_free_net_device(dev);
 				return 1;
 			}
 		}
 		break;
 	}
 
-	nf2_free_net_device(dev);
 	return 0;
 }
 
@@ -882,7 +886,6 @@ nf2_delete_private(void *private)
 {
 	struct nf2_flow *sfw = (struct nf2_flow *)private;
 	struct nf2_flow *sfw_next;
-	struct list *next;
 
 	switch (sfw->type) {
 	default:
@@ -895,7 +898,6 @@ nf2_delete_private(void *private)
 
 	case NF2_TABLE_WILDCARD:
 		while (!list_is_empty(&sfw->node)) {
-			next = sfw->node.next;
 			sfw_next = CONTAINER_OF(list_front(&sfw->node), struct nf2_flow, node);
 			list_remove(&sfw_next->node);
 			list_init(&sfw_next->node);
@@ -942,7 +944,6 @@ nf2_modify_acts(struct sw_flow *flow)
 
 	case NF2_TABLE_WILDCARD:
 		if (flow->key.wildcards & OFPFW_IN_PORT) {
-			nf2_free_net_device(dev);
 			return 0;
 		}
 		nf2_populate_of_entry(&key, flow);
@@ -953,97 +954,74 @@ nf2_modify_acts(struct sw_flow *flow)
 		break;
 	}
 
-	nf2_free_net_device(dev);
 	return 1;
 }
 
-uint64_t
-nf2_get_packet_count(struct nf2device *dev, struct nf2_flow *sfw)
+/* Returns how far a wrapping 32-bit hardware counter has advanced since
+ * '*last', and updates '*last' to 'hw_count'. */
+static uint32_t
+counter_delta(uint32_t *last, uint32_t hw_count)
 {
-	uint32_t count = 0;
-	uint32_t hw_count = 0;
-	uint64_t total = 0;
-	struct nf2_flow *sfw_next = NULL;
-
-	switch (sfw->type) {
-	default:
-		break;
-
-	case NF2_TABLE_EXACT:
-		// Get delta value
-		total = nf2_get_exact_packet_count(dev, sfw->pos);
-		break;
+	uint32_t count;
 
-	case NF2_TABLE_WILDCARD:
-		sfw_next = sfw;
-		do {
-			// Get sum value
-			hw_count = nf2_get_wildcard_packet_count(dev,
-								 sfw_next->pos);
-			if (hw_count >= sfw_next->hw_packet_count) {
-				count = hw_count - sfw_next->hw_packet_count;
-				sfw_next->hw_packet_count = hw_count;
-			} else {
-				// wrapping occurred
-				count = (MAX_INT_32 - sfw_next->hw_packet_count)
-					+ hw_count;
-				sfw_next->hw_packet_count = hw_count;
-			}
-			total += count;
-
-			if(!list_is_empty(&sfw_next->node)){
-				sfw_next = CONTAINER_OF(list_front(&sfw_next->node),
-						      struct nf2_flow, node);
-			}
-		} while (sfw_next != sfw);
-		break;
+	if (hw_count >= *last) {
+		count = hw_count - *last;
+	} else {
+		// wrapping occurred
+		count = (MAX_INT_32 - *last) + hw_count;
 	}
-
-	return total;
+	*last = hw_count;
+	return count;
 }
 
-uint64_t
-nf2_get_byte_count(struct nf2device *dev, struct nf2_flow *sfw)
+/* Stores in '*packets' and '*bytes' the packets and bytes that hit 'sfw'
+ * since the last call.  If 'wc' is nonnull, it holds the wildcard table's
+ * counters as read by nf2_get_wildcard_counts(), so that a sweep over many
+ * flows reads the wildcard counters only once; otherwise the counters of
+ * each wildcard row that 'sfw' occupies are read individually. */
+void
+nf2_get_flow_counts(struct nf2device *dev, struct nf2_flow *sfw,
+		    const struct nf2_wildcard_counts *wc,
+		    uint64_t *packets, uint64_t *bytes)
 {
-	uint32_t count = 0;
-	uint32_t hw_count = 0;
-	uint64_t total = 0;
 	struct nf2_flow *sfw_next = NULL;
+	unsigned int hw_packets, hw_bytes;
 
+	*packets = *bytes = 0;
 	switch (sfw->type) {
 	default:
 		break;
 
 	case NF2_TABLE_EXACT:
-		// Get delta value
-		total = nf2_get_exact_byte_count(dev, sfw->pos);
+		// Get delta values
+		nf2_get_exact_counts(dev, sfw->pos, &hw_packets, &hw_bytes);
+		*packets = hw_packets;
+		*bytes = hw_bytes;
 		break;
 
 	case NF2_TABLE_WILDCARD:
 		sfw_next = sfw;
 		do {
-			// Get sum value
-			hw_count = nf2_get_wildcard_byte_count(dev,
-							       sfw_next->pos);
-			if (hw_count >= sfw_next->hw_byte_count) {
-				count = hw_count - sfw_next->hw_byte_count;
-				sfw_next->hw_byte_count = hw_count;
+			// Get sum values
+			if (wc != NULL) {
+				hw_packets = wc->packets[sfw_next->pos];
+				hw_bytes = wc->bytes[sfw_next->pos];
 			} else {
-				// wrapping occurred
-				count = (MAX_INT_32 - sfw_next->hw_byte_count)
-					+ hw_count;
-				sfw_next->hw_byte_count = hw_count;
+				hw_packets = nf2_get_wildcard_packet_count(
+					dev, sfw_next->pos);
+				hw_bytes = nf2_get_wildcard_byte_count(
+					dev, sfw_next->pos);
 			}
+			*packets += counter_delta(&sfw_next->hw_packet_count,
+						  hw_packets);
+			*bytes += counter_delta(&sfw_next->hw_byte_count,
+						hw_bytes);
 
-			total += count;
-
-			if(!list_is_empty(&sfw_next->node)) {
+			if(!list_is_empty(&sfw_next->node)){
 				sfw_next = CONTAINER_OF(list_front(&sfw_next->node),
 						      struct nf2_flow, node);
 			}
 		} while (sfw_next != sfw);
 		break;
 	}
-
-	return total;
 }
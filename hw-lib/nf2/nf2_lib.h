@@ -34,7 +34,8 @@
 #define HWTABLE_NF2_NF2_LIB_H_
 
 struct nf2device *nf2_get_net_device(void);
-void nf2_free_net_device(struct nf2device *);
+void nf2_set_net_device(struct nf2device *);
+void nf2_close_net_device(void);
 int nf2_are_actions_supported(struct sw_flow *);
 void nf2_clear_of_exact(uint32_t);
 void nf2_clear_of_wildcard(uint32_t);
@@ -53,7 +54,8 @@ int nf2_get_table_type(struct sw_flow *);
 int nf2_build_and_write_flow(struct sw_flow *);
 void nf2_delete_private(void *);
 int nf2_modify_acts(struct sw_flow *);
-uint64_t nf2_get_packet_count(struct nf2device *, struct nf2_flow *);
-uint64_t nf2_get_byte_count(struct nf2device *, struct nf2_flow *);
+void nf2_get_flow_counts(struct nf2device *, struct nf2_flow *,
+			 const struct nf2_wildcard_counts *,
+			 uint64_t *, uint64_t *);
 
 #endif
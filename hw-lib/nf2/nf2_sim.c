@@ -0,0 +1,238 @@
+/*-
+ * Copyright (c) 2008, 2009, 2010
+ *      The Board of Trustees of The Leland Stanford Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation that
+ * others will use, modify and enhance the Software and contribute those
+ * enhancements back to the community. However, since we would like to make the
+ * Software available for broadest use, with as few restrictions as possible
+ * permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this Software to deal in the Software under the copyrights without
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any derivatives
+ * without specific, written prior permission.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hmap.h"
+#include "reg_defines_openflow_switch.h"
+#include "nf2util.h"
+#include "nf2_drv.h"
+#include "nf2_sim.h"
+
+struct nf2_sim {
+	struct hmap regs;		/* Contains "struct nf2_sim_reg"s. */
+	struct nf2_sim_stats stats;
+};
+
+/* A register that has been written. */
+struct nf2_sim_reg {
+	struct hmap_node node;		/* In struct nf2_sim's 'regs'. */
+	unsigned reg;
+	unsigned val;
+};
+
+static struct nf2_sim *
+nf2_sim_cast(struct nf2device *dev)
+{
+	return dev->aux;
+}
+
+static uint32_t
+hash_reg(unsigned reg)
+{
+	uint32_t word = reg;
+	return hash_words(&word, 1, 0);
+}
+
+static struct nf2_sim_reg *
+find_reg(struct nf2_sim *sim, unsigned reg)
+{
+	struct nf2_sim_reg *r;
+
+	HMAP_FOR_EACH_WITH_HASH (r, struct nf2_sim_reg, node, hash_reg(reg),
+				 &sim->regs) {
+		if (r->reg == reg) {
+			return r;
+		}
+	}
+	return NULL;
+}
+
+/* Returns true if 'reg' is one of the counters of an exact match entry, which
+ * follow the entry itself in its 128-byte block of SRAM. */
+static int
+is_exact_counter(unsigned reg)
+{
+	unsigned offset;
+
+	if (reg < SRAM_BASE_ADDR
+	    || reg >= SRAM_BASE_ADDR + (OPENFLOW_NF2_EXACT_TABLE_SIZE << 7)) {
+		return 0;
+	}
+	offset = (reg - SRAM_BASE_ADDR) & 0x7f;
+	return (offset >= sizeof(nf2_of_entry_wrap)
+		&& offset < (sizeof(nf2_of_entry_wrap)
+			     + sizeof(nf2_of_exact_counters_wrap)));
+}
+
+static unsigned
+sim_read(struct nf2_sim *sim, unsigned reg)
+{
+	struct nf2_sim_reg *r = find_reg(sim, reg);
+	unsigned val;
+
+	if (r == NULL) {
+		return 0;
+	}
+	val = r->val;
+	if (is_exact_counter(reg)) {
+		r->val = 0;
+	}
+	return val;
+}
+
+static void
+sim_write(struct nf2_sim *sim, unsigned reg, unsigned val)
+{
+	struct nf2_sim_reg *r = find_reg(sim, reg);
+
+	if (r == NULL) {
+		r = malloc(sizeof *r);
+		r->reg = reg;
+		hmap_insert(&sim->regs, &r->node, hash_reg(reg));
+	}
+	r->val = val;
+}
+
+static int
+nf2_sim_read(struct nf2device *dev, unsigned reg, unsigned *val)
+{
+	struct nf2_sim *sim = nf2_sim_cast(dev);
+
+	sim->stats.n_reads++;
+	*val = sim_read(sim, reg);
+	return 0;
+}
+
+static int
+nf2_sim_write(struct nf2device *dev, unsigned reg, unsigned val)
+{
+	struct nf2_sim *sim = nf2_sim_cast(dev);
+
+	sim->stats.n_writes++;
+	sim_write(sim, reg, val);
+	return 0;
+}
+
+static int
+nf2_sim_read_range(struct nf2device *dev, unsigned reg, unsigned n,
+		   unsigned *vals)
+{
+	struct nf2_sim *sim = nf2_sim_cast(dev);
+	unsigned i;
+
+	sim->stats.n_range_reads++;
+	sim->stats.n_range_regs += n;
+	for (i = 0; i < n; i++) {
+		vals[i] = sim_read(sim, reg + 4 * i);
+	}
+	return 0;
+}
+
+static void
+nf2_sim_close(struct nf2device *dev)
+{
+	struct nf2_sim *sim = nf2_sim_cast(dev);
+	struct nf2_sim_reg *r, *next;
+
+	HMAP_FOR_EACH_SAFE (r, next, struct nf2_sim_reg, node, &sim->regs) {
+		hmap_remove(&sim->regs, &r->node);
+		free(r);
+	}
+	hmap_destroy(&sim->regs);
+	free(sim);
+	dev->aux = NULL;
+}
+
+static const struct nf2_reg_ops nf2_sim_ops = {
+	nf2_sim_read,
+	nf2_sim_write,
+	nf2_sim_read_range,
+	nf2_sim_close,
+};
+
+/* Creates and returns a new simulated device whose registers are all 0.  The
+ * device may be passed to nf2_set_net_device(), which then owns it, or freed
+ * with closeDescriptor() and free(). */
+struct nf2device *
+nf2_sim_create(void)
+{
+	struct nf2device *dev;
+	struct nf2_sim *sim;
+
+	dev = calloc(1, sizeof *dev);
+	sim = calloc(1, sizeof *sim);
+	if (dev == NULL || sim == NULL) {
+		free(dev);
+		free(sim);
+		return NULL;
+	}
+	hmap_init(&sim->regs);
+
+	dev->device_name = "nf2sim";
+	dev->fd = -1;
+	dev->ops = &nf2_sim_ops;
+	dev->aux = sim;
+	return dev;
+}
+
+/* Returns the value of 'reg' in 'dev', without counting an access or
+ * clearing a counter. */
+unsigned
+nf2_sim_peek(struct nf2device *dev, unsigned reg)
+{
+	struct nf2_sim_reg *r = find_reg(nf2_sim_cast(dev), reg);
+	return r ? r->val : 0;
+}
+
+/* Sets 'reg' in 'dev' to 'val' without counting an access, as the hardware
+ * would when, for example, a packet hits a flow. */
+void
+nf2_sim_poke(struct nf2device *dev, unsigned reg, unsigned val)
+{
+	sim_write(nf2_sim_cast(dev), reg, val);
+}
+
+void
+nf2_sim_get_stats(struct nf2device *dev, struct nf2_sim_stats *stats)
+{
+	*stats = nf2_sim_cast(dev)->stats;
+}
+
+void
+nf2_sim_clear_stats(struct nf2device *dev)
+{
+	memset(&nf2_sim_cast(dev)->stats, 0, sizeof(struct nf2_sim_stats));
+}
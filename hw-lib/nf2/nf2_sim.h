@@ -0,0 +1,61 @@
+/*-
+ * Copyright (c) 2008, 2009, 2010
+ *      The Board of Trustees of The Leland Stanford Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation that
+ * others will use, modify and enhance the Software and contribute those
+ * enhancements back to the community. However, since we would like to make the
+ * Software available for broadest use, with as few restrictions as possible
+ * permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this Software to deal in the Software under the copyrights without
+ * restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any derivatives
+ * without specific, written prior permission.
+ */
+
+#ifndef HWTABLE_NF2_NF2_SIM_H_
+#define HWTABLE_NF2_NF2_SIM_H_
+
+/* A NetFPGA register file simulated in memory, so that the nf2 table code can
+ * be tested and benchmarked without a card.
+ *
+ * Registers read back whatever was last written to them, or 0.  The one
+ * exception is the packet and byte counters of exact match entries, which
+ * the hardware clears when they are read and so does the simulation. */
+
+struct nf2device;
+
+/* Counts of the accesses made to a simulated device.  On a real card each
+ * read, write and range read costs an ioctl (a range read costs one per
+ * register, see readRegRange()). */
+struct nf2_sim_stats {
+	unsigned long n_reads;
+	unsigned long n_writes;
+	unsigned long n_range_reads;
+	unsigned long n_range_regs;	/* Registers read by range reads. */
+};
+
+struct nf2device *nf2_sim_create(void);
+unsigned nf2_sim_peek(struct nf2device *, unsigned reg);
+void nf2_sim_poke(struct nf2device *, unsigned reg, unsigned val);
+void nf2_sim_get_stats(struct nf2device *, struct nf2_sim_stats *);
+void nf2_sim_clear_stats(struct nf2device *);
+
+#endif
@@ -50,7 +50,11 @@ char nf2_device_str[DEVICE_STR_LEN] = "";
  */
 int readReg(struct nf2device *nf2, unsigned reg, unsigned *val)
 {
-	if (nf2->net_iface)
+	if (nf2->ops)
+	{
+		return nf2->ops->read(nf2, reg, val);
+	}
+	else if (nf2->net_iface)
 	{
 		return readRegNet(nf2, reg, val);
 	}
@@ -60,6 +64,32 @@ int readReg(struct nf2device *nf2, unsigned reg, unsigned *val)
 	}
 }
 
+/*
+ * readRegRange - read 'n' consecutive registers starting at 'reg'
+ *
+ * The NetFPGA driver only reads one register per ioctl, so for a real device
+ * this is a loop, but other backends may do better.
+ */
+int readRegRange(struct nf2device *nf2, unsigned reg, unsigned n,
+		 unsigned *vals)
+{
+	unsigned i;
+
+	if (nf2->ops && nf2->ops->read_range)
+	{
+		return nf2->ops->read_range(nf2, reg, n, vals);
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (readReg(nf2, reg + 4 * i, &vals[i]))
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
 /*
  * readRegNet - read a register, using a network socket
  */
@@ -122,7 +152,11 @@ static int readRegFile(struct nf2device *nf2, unsigned reg, unsigned *val)
  */
 int writeReg(struct nf2device *nf2, unsigned reg, unsigned val)
 {
-	if (nf2->net_iface)
+	if (nf2->ops)
+	{
+		return nf2->ops->write(nf2, reg, val);
+	}
+	else if (nf2->net_iface)
 	{
 		return writeRegNet(nf2, reg, val);
 	}
@@ -332,7 +366,14 @@ int openDescriptor(struct nf2device *nf2)
  */
 int closeDescriptor(struct nf2device *nf2)
 {
-	if (nf2->net_iface)
+	if (nf2->ops)
+	{
+		if (nf2->ops->close)
+		{
+			nf2->ops->close(nf2);
+		}
+	}
+	else if (nf2->net_iface)
 	{
 		close(nf2->fd);
 	}
@@ -16,6 +16,21 @@
 #define DEVICE_STR_LEN 100
 
 
+struct nf2device;
+
+/*
+ * Register access functions for a device that is not a real NetFPGA, such as
+ * the simulated register file in nf2_sim.c.  'read_range' may be null, in
+ * which case ranges are read one register at a time.
+ */
+struct nf2_reg_ops {
+	int (*read)(struct nf2device *nf2, unsigned reg, unsigned *val);
+	int (*write)(struct nf2device *nf2, unsigned reg, unsigned val);
+	int (*read_range)(struct nf2device *nf2, unsigned reg, unsigned n,
+			  unsigned *vals);
+	void (*close)(struct nf2device *nf2);
+};
+
 /*
  * Structure to represent an nf2 device to a user mode programs
  */
@@ -23,11 +38,15 @@ struct nf2device {
 	char *device_name;
 	int fd;
 	int net_iface;
+	const struct nf2_reg_ops *ops;	/* Null for a real device. */
+	void *aux;			/* Private data for 'ops'. */
 };
 
 /* Function declarations */
 
 int readReg(struct nf2device *nf2, unsigned reg, unsigned *val);
+int readRegRange(struct nf2device *nf2, unsigned reg, unsigned n,
+		 unsigned *vals);
 int writeReg(struct nf2device *nf2, unsigned reg, unsigned val);
 int check_iface(struct nf2device *nf2);
 int openDescriptor(struct nf2device *nf2);
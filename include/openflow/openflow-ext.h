@@ -24,6 +24,20 @@ enum ofp_extension_commands { /* Queue configuration commands */
     OFP_EXT_QUEUE_DELETE,  /* Remove a queue */
     OFP_EXT_SET_DESC,      /* Set ofp_desc_stat->dp_desc */
 
+    /* Flow Commands */
+    OFP_EXT_FLOW_MOD_BUNDLE,       /* Apply many flow-mods at once */
+    OFP_EXT_FLOW_MOD_BUNDLE_REPLY, /* Bundle applied successfully */
+
+    /* Packet Commands */
+    OFP_EXT_PACKET_OUT_MULTI,      /* Send many packets with one action list */
+
+    /* Slow-protocol channel */
+    OFP_EXT_SLOW_PROTO_SUBSCRIBE,  /* Send link-local frames on this conn */
+    OFP_EXT_SLOW_PROTO_IN,         /* Link-local frame received by switch */
+
+    /* Fail-open */
+    OFP_EXT_SET_FAIL_OPEN,         /* Start or stop learning in the switch */
+
     OFP_EXT_COUNT
 };
 
@@ -87,6 +101,346 @@ struct openflow_ext_set_dp_desc {
 };
 OFP_ASSERT(sizeof(struct openflow_ext_set_dp_desc) == 272);
 
+/* Bundle of flow modifications (OFP_EXT_FLOW_MOD_BUNDLE).
+ *
+ * 'body' holds 'n_flow_mods' complete OFPT_FLOW_MOD messages back to back,
+ * each with its own ofp_header.  The switch checks all of them before it
+ * applies any, then applies them in order.  It answers the bundle with
+ * exactly one message that carries the bundle's xid:
+ *
+ *   - An OFP_EXT_FLOW_MOD_BUNDLE_REPLY, with no body and 'n_flow_mods' set to
+ *     the number of flow-mods applied, if the whole bundle was applied.
+ *
+ *   - Otherwise, an OFPT_ERROR whose data is the first 64 bytes of the
+ *     flow-mod that failed (or of the bundle, if it is malformed).  None of
+ *     the bundle's flow-mods take effect: if the flow table or the switch's
+ *     memory fills up partway through, the switch takes back the additions, modifications, and
+ *     deletions already made, and flows that the bundle deleted send their
+ *     OFPT_FLOW_REMOVED messages only once the whole bundle has applied.
+ *
+ * A bundle does not need its own OFPT_BARRIER_REQUEST: the reply already
+ * tells the controller that all of its flow-mods are in place. */
+struct openflow_ext_flow_mod_bundle {
+    struct ofp_extension_header header;
+    uint32_t n_flow_mods;       /* Number of flow-mods in 'body'. */
+    uint8_t pad[4];             /* Align to 64-bits. */
+    uint8_t body[0];            /* Sequence of struct ofp_flow_mod. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_flow_mod_bundle) == 24);
+
+/* Packets sent with a single action list (OFP_EXT_PACKET_OUT_MULTI).
+ *
+ * This works like 'n_packets' OFPT_PACKET_OUT messages that all have the same
+ * 'in_port' and actions.  'actions' is followed by 'n_packets' packets, each
+ * in a struct openflow_ext_packet_out_entry.  The switch checks the actions
+ * once and then applies them to each packet in order, skipping any packet
+ * whose buffer no longer exists.  If the actions are invalid, the switch
+ * sends one OFPT_ERROR and drops all of the packets. */
+struct openflow_ext_packet_out_multi {
+    struct ofp_extension_header header;
+    uint16_t in_port;           /* Packets' input port (OFPP_NONE if none). */
+    uint16_t actions_len;       /* Size of 'actions' in bytes. */
+    uint32_t n_packets;         /* Number of packet entries after 'actions'. */
+    struct ofp_action_header actions[0]; /* Actions. */
+    /* Followed by the packet entries. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_packet_out_multi) == 24);
+
+/* One packet in an OFP_EXT_PACKET_OUT_MULTI message. */
+struct openflow_ext_packet_out_entry {
+    uint32_t buffer_id;         /* ID assigned by datapath (-1 if none). */
+    uint16_t len;               /* Length of this entry, including 'data' and
+                                   padding to a multiple of 8 bytes. */
+    uint16_t data_len;          /* Length of 'data' (0 unless 'buffer_id' is
+                                   -1). */
+    uint8_t data[0];            /* Packet data. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_packet_out_entry) == 8);
+
+/* Link-local control frame (OFP_EXT_SLOW_PROTO_IN).
+ *
+ * A connection that sends OFP_EXT_SLOW_PROTO_SUBSCRIBE, which has no body
+ * past the header, becomes a slow-protocol channel.  From then on the switch
+ * sends it, and only it, each frame that misses the flow table, is addressed
+ * to a reserved multicast address 01:80:c2:00:00:0x (such as an STP BPDU) and
+ * arrives on a port without OFPPC_NO_STP, instead of an OFPT_PACKET_IN to
+ * every connection.  The channel receives no other asynchronous messages.
+ * The frame is never buffered or truncated, and the switch gives these
+ * messages their own transmit queue ahead of all others, so that they are
+ * not lost in a flood of packet-ins. */
+struct openflow_ext_slow_proto_in {
+    struct ofp_extension_header header;
+    uint16_t in_port;           /* Port on which frame was received. */
+    uint8_t pad[6];             /* Align to 64-bits. */
+    uint8_t data[0];            /* Ethernet frame. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_slow_proto_in) == 24);
+
+/* Standalone learning while failing open (OFP_EXT_SET_FAIL_OPEN).
+ *
+ * When 'enable' is nonzero, the switch itself acts as a MAC-learning switch
+ * for each packet that misses the flow table, instead of sending it to the
+ * controller: it forwards the packet and, once the destination is learned,
+ * adds an exact-match flow that expires after 'max_idle' seconds idle (or
+ * never, if 'max_idle' is OFP_FLOW_PERMANENT).  Flows it adds carry the
+ * cookie OFP_EXT_FAIL_OPEN_COOKIE and send no flow-removed messages.  Frames
+ * addressed to 01:80:c2:00:00:0x still miss to the controller as usual.
+ *
+ * When 'enable' is zero, the switch forgets what it learned, deletes the
+ * flows that it added, and goes back to sending misses to the controller.
+ *
+ * A switch that does not support learning, or that has not been configured to
+ * allow it, replies with an OFPET_BAD_REQUEST error. */
+struct openflow_ext_set_fail_open {
+    struct ofp_extension_header header;
+    uint16_t max_idle;          /* Idle timeout for learned flows. */
+    uint8_t enable;             /* Nonzero to learn, zero to stop. */
+    uint8_t pad[5];             /* Align to 64-bits. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_set_fail_open) == 24);
+
+/* Cookie of the flows that a switch adds while learning on its own. */
+#define OFP_EXT_FAIL_OPEN_COOKIE 0xfa11fa11fa11fa11ULL
+
+/* Vendor statistics (OFPST_VENDOR with vendor OPENFLOW_VENDOR_ID).  The body
+ * of both the request and the reply starts with this header. */
+struct openflow_ext_stats_header {
+    uint32_t vendor;            /* OPENFLOW_VENDOR_ID. */
+    uint32_t subtype;           /* One of ofp_extension_stats_types. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_stats_header) == 8);
+
+enum ofp_extension_stats_types {
+    /* Controller transmit queues.  The request has no body past the header.
+     * The reply body is an array of struct openflow_ext_txq_stats, one per
+     * class, in order of class. */
+    OFP_EXT_STATS_TXQ,
+
+    /* Receive servicing of each port.  The request has no body past the
+     * header.  The reply body is an array of struct
+     * openflow_ext_port_rx_stats, one per port. */
+    OFP_EXT_STATS_PORT_RX,
+
+    /* Policers.  The request body is a struct ofp_flow_stats_request that
+     * selects flows as for OFPST_FLOW.  The reply body is an array of struct
+     * openflow_ext_meter_stats, one per OFP_EXT_ACTION_POLICE action in the
+     * actions of each selected flow. */
+    OFP_EXT_STATS_METER,
+
+    /* Flow tables, including the emergency table.  The request has no body
+     * past the header.  The reply body is an array of struct
+     * openflow_ext_table_stats, one per table, in lookup order. */
+    OFP_EXT_STATS_TABLE,
+
+    /* Flow table diagnostics, for sizing tables and choosing hash functions.
+     * The request has no body past the header.  The reply body is an array
+     * of struct openflow_ext_table_diag, one per table, as for
+     * OFP_EXT_STATS_TABLE. */
+    OFP_EXT_STATS_TABLE_DIAG
+};
+
+/* Classes of messages that the switch queues separately on each controller
+ * connection, in decreasing order of priority.  A class is only sent when all
+ * of the classes before it are empty, and each class has its own byte budget,
+ * so that a flood of packet-ins cannot crowd out replies to requests. */
+enum ofp_extension_txq_class {
+    OFP_EXT_TXQ_SLOW_PROTO,     /* OFP_EXT_SLOW_PROTO_IN. */
+    OFP_EXT_TXQ_REPLY,          /* Replies, errors, barriers, echoes. */
+    OFP_EXT_TXQ_PORT_STATUS,    /* OFPT_PORT_STATUS. */
+    OFP_EXT_TXQ_FLOW_REMOVED,   /* OFPT_FLOW_REMOVED. */
+    OFP_EXT_TXQ_PACKET_IN,      /* OFPT_PACKET_IN. */
+    OFP_EXT_TXQ_N_CLASSES
+};
+
+/* Statistics for one class of controller transmit queue. */
+struct openflow_ext_txq_stats {
+    uint32_t txq_class;         /* One of ofp_extension_txq_class. */
+    uint32_t max_bytes;         /* Byte budget of each connection's queue. */
+    uint32_t n_queued;          /* Messages now queued, on all connections. */
+    uint32_t n_bytes;           /* Bytes now queued, on all connections. */
+    uint64_t n_sent;            /* Messages passed to connections. */
+    uint64_t n_dropped;         /* Messages dropped because a queue was
+                                   over its byte budget. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_txq_stats) == 32);
+
+/* Statistics for how the switch has serviced one port's receive queue.  The
+ * switch only receives on ports that have become readable, and then only up
+ * to a per-port budget at a time, so that one busy port can't starve the
+ * others. */
+struct openflow_ext_port_rx_stats {
+    uint16_t port_no;
+    uint8_t ready;              /* Nonzero if packets may be waiting. */
+    uint8_t pad[5];
+    uint64_t n_wakeups;         /* Times the port became readable. */
+    uint64_t n_services;        /* Times the switch received on the port. */
+    uint64_t n_empty;           /* Services that found no packets. */
+    uint64_t n_exhausted;       /* Services that spent the port's budget
+                                   with packets still waiting. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_port_rx_stats) == 40);
+
+/* Which flows the switch places in a flow table. */
+enum ofp_extension_table_placement {
+    OFP_EXT_TABLE_ANY,          /* Any flow that the table supports. */
+    OFP_EXT_TABLE_EXACT,        /* Only flows without wildcards. */
+    OFP_EXT_TABLE_WILD,         /* Only flows with wildcards. */
+    OFP_EXT_TABLE_EMERG         /* Emergency flows. */
+};
+
+/* Usage of one flow table.  Unlike struct ofp_table_stats, this includes the
+ * emergency table and the memory that each table uses. */
+struct openflow_ext_table_stats {
+    uint8_t table_id;           /* As in OFPST_TABLE, or 0xfe for the
+                                   emergency table. */
+    uint8_t placement;          /* One of OFP_EXT_TABLE_*. */
+    uint8_t pad[6];
+    char name[OFP_MAX_TABLE_NAME_LEN];
+    uint32_t max_entries;       /* Max number of entries supported. */
+    uint32_t active_count;      /* Number of active entries. */
+    uint64_t lookup_count;      /* Packets looked up in table. */
+    uint64_t matched_count;     /* Packets that hit table. */
+    uint64_t n_bytes;           /* Approximate memory in use, in bytes. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_table_stats) == 72);
+
+/* Number of bins in each histogram in struct openflow_ext_table_diag.  Bin 0
+ * counts the value 0, bin i counts values from 2**(i-1) to 2**i - 1, and the
+ * last bin also counts all bigger values. */
+#define OFP_EXT_HIST_BINS 16
+
+/* Diagnostics for one hash function of a hash table, which holds at most one
+ * flow per bucket. */
+struct openflow_ext_hash_diag {
+    uint32_t polynomial;        /* CRC-32 polynomial. */
+    uint32_t n_buckets;         /* Number of buckets, a power of 2. */
+    uint32_t n_flows;           /* Number of occupied buckets. */
+    uint8_t pad[4];
+    uint64_t n_collisions;      /* Inserts rejected because the bucket held a
+                                   different flow. */
+    uint32_t occupancy[OFP_EXT_HIST_BINS]; /* Occupied buckets in each
+                                              sixteenth of the buckets. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_hash_diag) == 88);
+
+/* Diagnostics for one flow table. */
+struct openflow_ext_table_diag {
+    uint8_t table_id;           /* As in struct openflow_ext_table_stats. */
+    uint8_t n_hashes;           /* Number of elements of 'hashes' in use. */
+    uint8_t pad[6];
+    char name[OFP_MAX_TABLE_NAME_LEN];
+    uint32_t max_entries;       /* Max number of entries supported. */
+    uint32_t active_count;      /* Number of active entries. */
+    uint64_t lookup_count;      /* Packets looked up in table. */
+    uint64_t matched_count;     /* Packets that hit table. */
+    uint64_t depth[OFP_EXT_HIST_BINS]; /* Lookups by number of flows examined,
+                                          for tables that search flows one by
+                                          one; otherwise all zero. */
+    struct openflow_ext_hash_diag hashes[2];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_table_diag) == 368);
+
+/* Vendor actions (OFPAT_VENDOR with vendor OPENFLOW_VENDOR_ID). */
+enum ofp_extension_action_subtype {
+    OFP_EXT_ACTION_POLICE,      /* struct openflow_ext_action_police. */
+    OFP_EXT_ACTION_MULTIPATH    /* struct openflow_ext_action_multipath. */
+};
+
+/* What a policer does with packets that exceed its rate. */
+enum ofp_extension_police_policy {
+    OFP_EXT_POLICE_DROP,        /* Drop the packet. */
+    OFP_EXT_POLICE_REMARK       /* Set the packet's IP DSCP to 'dscp'. */
+};
+
+/* Token-bucket policer.  Each flow with this action gets its own bucket,
+ * which holds up to 'burst' kilobits and fills at 'rate' kilobits per second.
+ * A packet that finds enough tokens in the bucket conforms: it takes its size
+ * in tokens and continues through the remaining actions.  A packet that does
+ * not exceeds the rate, and is dropped or remarked according to 'policy'.
+ * Actions before this one apply to every packet. */
+struct openflow_ext_action_police {
+    uint16_t type;              /* OFPAT_VENDOR. */
+    uint16_t len;               /* Length is 24. */
+    uint32_t vendor;            /* OPENFLOW_VENDOR_ID. */
+    uint16_t subtype;           /* OFP_EXT_ACTION_POLICE. */
+    uint8_t policy;             /* One of OFP_EXT_POLICE_*. */
+    uint8_t dscp;               /* DSCP for OFP_EXT_POLICE_REMARK, 0...63. */
+    uint32_t rate;              /* Rate in kbit/s, nonzero. */
+    uint32_t burst;             /* Bucket size in kbit, nonzero. */
+    uint8_t pad[4];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_action_police) == 24);
+
+/* Statistics for the policer of one OFP_EXT_ACTION_POLICE action. */
+struct openflow_ext_meter_stats {
+    struct ofp_match match;     /* Flow with the action. */
+    uint64_t cookie;            /* Flow's cookie. */
+    uint16_t priority;          /* Flow's priority. */
+    uint8_t table_id;           /* Table that holds the flow. */
+    uint8_t meter_idx;          /* Which OFP_EXT_ACTION_POLICE action in the
+                                   flow's actions, counting from 0. */
+    uint32_t rate;              /* Rate in kbit/s. */
+    uint32_t burst;             /* Bucket size in kbit. */
+    uint8_t policy;             /* One of OFP_EXT_POLICE_*. */
+    uint8_t dscp;               /* DSCP for OFP_EXT_POLICE_REMARK. */
+    uint8_t pad[2];
+    uint64_t conform_packets;   /* Packets within the rate. */
+    uint64_t conform_bytes;
+    uint64_t exceed_packets;    /* Packets dropped or remarked. */
+    uint64_t exceed_bytes;
+};
+OFP_ASSERT(sizeof(struct openflow_ext_meter_stats) == 96);
+
+/* How a multipath action chooses among its ports. */
+enum ofp_extension_mp_algorithm {
+    /* The hash modulo the number of live ports.  Cheap, but when a port goes
+     * down or comes back up most flows move to a different port. */
+    OFP_EXT_MP_MODULO,
+
+    /* Highest random weight: the live port for which the hash of the flow
+     * hash and the port number is greatest.  When a port goes down only its
+     * own flows move, and they move back when it comes back up. */
+    OFP_EXT_MP_HRW
+};
+
+/* Packet fields that a multipath action hashes. */
+enum ofp_extension_mp_fields {
+    OFP_EXT_MP_IN_PORT  = 1 << 0,
+    OFP_EXT_MP_DL_SRC   = 1 << 1,
+    OFP_EXT_MP_DL_DST   = 1 << 2,
+    OFP_EXT_MP_DL_VLAN  = 1 << 3,
+    OFP_EXT_MP_DL_TYPE  = 1 << 4,
+    OFP_EXT_MP_NW_SRC   = 1 << 5,
+    OFP_EXT_MP_NW_DST   = 1 << 6,
+    OFP_EXT_MP_NW_PROTO = 1 << 7,
+    OFP_EXT_MP_TP_SRC   = 1 << 8,
+    OFP_EXT_MP_TP_DST   = 1 << 9,
+    OFP_EXT_MP_ALL      = (1 << 10) - 1
+};
+
+/* Outputs the packet to one of 'n_ports' physical ports, chosen by hashing
+ * the packet's 'fields' with 'basis', so that all the packets in a flow take
+ * the same port.  A port is a candidate only while it is live, that is, while
+ * its OFPPS_LINK_DOWN state and OFPPC_PORT_DOWN and OFPPC_NO_FWD configuration
+ * bits are clear, and it is not the packet's input port.  If no port is
+ * live, the action does nothing.
+ *
+ * Like OFPAT_OUTPUT, this outputs the packet as modified by the actions
+ * before it. */
+struct openflow_ext_action_multipath {
+    uint16_t type;              /* OFPAT_VENDOR. */
+    uint16_t len;               /* 16 + 'n_ports' * 2, rounded up to a
+                                   multiple of 8. */
+    uint32_t vendor;            /* OPENFLOW_VENDOR_ID. */
+    uint16_t subtype;           /* OFP_EXT_ACTION_MULTIPATH. */
+    uint8_t algorithm;          /* One of OFP_EXT_MP_*. */
+    uint8_t n_ports;            /* Number of ports, at least 1. */
+    uint16_t fields;            /* Nonzero bitmap of OFP_EXT_MP_* fields. */
+    uint16_t basis;             /* Hash basis. */
+    uint16_t ports[0];          /* Candidate output ports. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_action_multipath) == 16);
+
 #define ofq_error_string(rv) (((rv) < OFQ_ERR_COUNT) && ((rv) >= 0) ? \
     openflow_queue_error_strings[rv] : "Unknown error code")
 
@@ -80,6 +80,7 @@ lib_libopenflow_a_SOURCES = \
 	lib/type-props.h \
 	lib/util.c \
 	lib/util.h \
+	lib/vconn-mem.c \
 	lib/vconn-provider.h \
 	lib/vconn-ssl.h \
 	lib/vconn-stream.c \
@@ -42,5 +42,6 @@
 #define MALLOC_LIKE __attribute__((__malloc__))
 #define likely(x) __builtin_expect((x),1)
 #define unlikely(x) __builtin_expect((x),0)
+#define prefetch(x) __builtin_prefetch(x)
 
 #endif /* compiler.h */
@@ -242,6 +242,73 @@ flow_fill_match(struct ofp_match *to, const struct flow *from,
     to->dl_vlan_pcp = from->dl_vlan_pcp;
 }
 
+/* Converts 'from' into a flow in 'to' and OFPFW_* wildcards in '*wildcards'.
+ * Fields that 'from' cannot sensibly match, given its Ethernet type and IP
+ * protocol, are wildcarded if the fields they depend on are wildcarded, and
+ * otherwise set to exact-match zeros, so that 'to' can be hashed or compared
+ * bytewise. */
+void
+flow_from_match(struct flow *to, uint32_t *wildcards,
+                const struct ofp_match *from)
+{
+    uint32_t w = ntohl(from->wildcards) & OFPFW_ALL;
+
+    to->dl_vlan_pcp = from->dl_vlan_pcp;
+    to->in_port = from->in_port;
+    to->dl_vlan = from->dl_vlan;
+    memcpy(to->dl_src, from->dl_src, ETH_ADDR_LEN);
+    memcpy(to->dl_dst, from->dl_dst, ETH_ADDR_LEN);
+    to->dl_type = from->dl_type;
+
+    to->nw_tos = to->nw_proto = to->nw_src = to->nw_dst = 0;
+    to->tp_src = to->tp_dst = 0;
+    memset(to->pad, 0, sizeof(to->pad));
+
+#define OFPFW_TP (OFPFW_TP_SRC | OFPFW_TP_DST)
+#define OFPFW_NW (OFPFW_NW_TOS | OFPFW_NW_PROTO | OFPFW_NW_SRC_MASK | OFPFW_NW_DST_MASK)
+    if (w & OFPFW_DL_TYPE) {
+        /* Can't sensibly match on network or transport headers if the
+         * data link type is unknown. */
+        w |= OFPFW_NW | OFPFW_TP;
+    } else if (from->dl_type == htons(ETH_TYPE_IP)) {
+        to->nw_tos   = from->nw_tos & 0xfc;
+        to->nw_proto = from->nw_proto;
+        to->nw_src   = from->nw_src;
+        to->nw_dst   = from->nw_dst;
+
+        if (w & OFPFW_NW_PROTO) {
+            /* Can't sensibly match on transport headers if the network
+             * protocol is unknown. */
+            w |= OFPFW_TP;
+        } else if (from->nw_proto == IPPROTO_TCP
+                || from->nw_proto == IPPROTO_UDP
+                || from->nw_proto == IPPROTO_ICMP) {
+            to->tp_src = from->tp_src;
+            to->tp_dst = from->tp_dst;
+        } else {
+            /* Transport layer fields are undefined.  Mark them as
+             * exact-match to allow such flows to reside in table-hash,
+             * instead of falling into table-linear. */
+            w &= ~OFPFW_TP;
+        }
+    } else if (from->dl_type == htons(ETH_TYPE_ARP)) {
+        to->nw_src   = from->nw_src;
+        to->nw_dst   = from->nw_dst;
+        to->nw_proto = from->nw_proto;
+
+        /* Transport layer fields are undefined.  Mark them as
+         * exact-match to allow such flows to reside in table-hash,
+         * instead of falling into table-linear. */
+        w &= ~OFPFW_TP;
+    } else {
+        /* Network and transport layer fields are undefined.  Mark them
+         * as exact-match to allow such flows to reside in table-hash,
+         * instead of falling into table-linear. */
+        w &= ~(OFPFW_NW | OFPFW_TP);
+    }
+    *wildcards = w;
+}
+
 void
 flow_print(FILE *stream, const struct flow *flow) 
 {
@@ -66,6 +66,8 @@ BUILD_ASSERT_DECL(sizeof(struct flow) == 36);
 int flow_extract(struct ofpbuf *, uint16_t in_port, struct flow *);
 void flow_fill_match(struct ofp_match *, const struct flow *,
                      uint32_t wildcards);
+void flow_from_match(struct flow *, uint32_t *wildcards,
+                     const struct ofp_match *);
 void flow_print(FILE *, const struct flow *);
 static inline int flow_compare(const struct flow *, const struct flow *);
 static inline bool flow_equal(const struct flow *, const struct flow *);
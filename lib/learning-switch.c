@@ -41,10 +41,13 @@
 #include <time.h>
 
 #include "flow.h"
+#include "hmap.h"
+#include "list.h"
 #include "mac-learning.h"
 #include "ofpbuf.h"
 #include "ofp-print.h"
 #include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
 #include "poll-loop.h"
 #include "queue.h"
 #include "rconn.h"
@@ -64,6 +67,30 @@ enum port_state {
     P_BLOCKING = 1 << 4
 };
 
+/* Packets waiting to be sent between a particular pair of ports. */
+struct packet_batch {
+    uint16_t in_port, out_port;
+    struct ofpbuf *msg;         /* OFP_EXT_PACKET_OUT_MULTI message. */
+};
+
+/* A flow that the learning switch set up on the switch.  We remember these
+ * so that we can find the flows that a port's new STP state forbids without
+ * asking the switch for all of its flows. */
+struct lswitch_flow {
+    struct hmap_node node;      /* In struct lswitch's 'flows'. */
+    struct list in_node;        /* In 'in_flows[in_port]', if applicable. */
+    struct list out_node;       /* In 'out_flows[out_port]', if applicable. */
+    struct flow flow;           /* Exact-match flow. */
+    uint16_t in_port;           /* Input port. */
+    uint16_t out_port;          /* Output port, or OFPP_NONE to drop. */
+};
+
+/* Maximum number of port pairs with packets waiting to be sent. */
+#define LSWITCH_MAX_BATCHES 16
+
+/* Maximum number of messages that may be queued on the rconn. */
+#define LSWITCH_MAX_QUEUED 10
+
 struct lswitch {
     /* If nonnegative, the switch sets up flows that expire after the given
      * number of seconds (or never expire, if the value is OFP_FLOW_PERMANENT).
@@ -78,26 +105,58 @@ struct lswitch {
     /* Number of outgoing queued packets on the rconn. */
     int n_queued;
 
+    /* The rconn's connection sequence number when lswitch_run() last ran. */
+    unsigned int conn_seqno;
+
+    /* If true, flow-mods are collected into 'bundle' and sent to the switch
+     * as OFP_EXT_FLOW_MOD_BUNDLE messages, instead of one message apiece. */
+    bool bundle_flows;
+    struct ofpbuf *bundle;      /* Flow-mods not yet sent, or NULL. */
+
+    /* If true, packets to send are collected into OFP_EXT_PACKET_OUT_MULTI
+     * messages, one per input and output port pair, instead of one
+     * OFPT_PACKET_OUT apiece.  Like 'bundle', they are sent from
+     * lswitch_run(). */
+    bool batch_packets;
+    struct packet_batch batches[LSWITCH_MAX_BATCHES];
+    int n_batches;
+
     /* Spanning tree protocol implementation.
      *
      * We implement STP states by, whenever a port's STP state changes,
-     * querying all the flows on the switch and then deleting any of them that
-     * are inappropriate for a port's STP state. */
-    long long int next_query;   /* Next time at which to query all flows. */
-    long long int last_query;   /* Last time we sent a query. */
-    long long int last_reply;   /* Last time we received a query reply. */
+     * deleting the flows that are inappropriate for the port's new state.
+     * Non-strict deletes keyed on the port as input port and as output port
+     * take care of most cases with two messages, however many flows the switch
+     * has.  'flows' remembers the flows that we set up, which we need to pick
+     * out the flows that only drop packets when a port starts learning. */
     unsigned int port_states[STP_MAX_PORTS];
-    uint32_t query_xid;         /* XID used for query. */
-    int n_flows, n_no_recv, n_no_send;
+    bool stp_changed;           /* Some port's STP state changed? */
+    bool stp_deferred;          /* Waiting for 'rconn' to reconnect? */
+    bool stp_changed_ports[STP_MAX_PORTS];
+    struct hmap flows;          /* Contains "struct lswitch_flow"s. */
+    struct list in_flows[STP_MAX_PORTS];  /* Flows by input port. */
+    struct list out_flows[STP_MAX_PORTS]; /* Flows by output port. */
 };
 
 /* The log messages here could actually be useful in debugging, so keep the
  * rate limit relatively high. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(30, 300);
 
-static void queue_tx(struct lswitch *, struct rconn *, struct ofpbuf *);
+static int queue_tx(struct lswitch *, struct rconn *, struct ofpbuf *);
+static int try_queue_tx(struct lswitch *, struct rconn *, struct ofpbuf *);
+static int queue_flow_mod(struct lswitch *, struct rconn *, struct ofpbuf *);
+static void flush_flow_mods(struct lswitch *, struct rconn *);
+static void queue_packet_out(struct lswitch *, struct rconn *,
+                             uint16_t in_port, uint16_t out_port,
+                             uint32_t buffer_id, const struct ofpbuf *);
+static void flush_packet_outs(struct lswitch *, struct rconn *);
 static void send_features_request(struct lswitch *, struct rconn *);
-static void schedule_query(struct lswitch *, long long int delay);
+static void add_flow(struct lswitch *, struct rconn *, struct ofpbuf *,
+                     uint16_t out_port);
+static void forget_flow(struct lswitch *, struct lswitch_flow *);
+static void forget_all_flows(struct lswitch *);
+static void forget_bundled_flows(struct lswitch *, const struct ofpbuf *);
+static void invalidate_stp_flows(struct lswitch *, struct rconn *);
 static bool may_learn(const struct lswitch *, uint16_t port_no);
 static bool may_recv(const struct lswitch *, uint16_t port_no,
                      bool any_actions);
@@ -109,7 +168,7 @@ static packet_handler_func process_packet_in;
 static packet_handler_func process_echo_request;
 static packet_handler_func process_port_status;
 static packet_handler_func process_phy_port;
-static packet_handler_func process_stats_reply;
+static packet_handler_func process_flow_removed;
 
 /* Creates and returns a new learning switch.
  *
@@ -132,11 +191,12 @@ lswitch_create(struct rconn *rconn, bool learn_macs, int max_idle)
     sw->datapath_id = 0;
     sw->last_features_request = time_now() - 1;
     sw->ml = learn_macs ? mac_learning_create() : NULL;
-    sw->next_query = LLONG_MIN;
-    sw->last_query = LLONG_MIN;
-    sw->last_reply = LLONG_MIN;
+    sw->conn_seqno = rconn_get_connection_seqno(rconn);
+    hmap_init(&sw->flows);
     for (i = 0; i < STP_MAX_PORTS; i++) {
         sw->port_states[i] = P_DISABLED;
+        list_init(&sw->in_flows[i]);
+        list_init(&sw->out_flows[i]);
     }
     send_features_request(sw, rconn);
     return sw;
@@ -146,96 +206,69 @@ lswitch_create(struct rconn *rconn, bool learn_macs, int max_idle)
 void
 lswitch_destroy(struct lswitch *sw)
 {
+    int i;
+
     if (sw) {
+        forget_all_flows(sw);
+        hmap_destroy(&sw->flows);
         mac_learning_destroy(sw->ml);
+        ofpbuf_delete(sw->bundle);
+        for (i = 0; i < sw->n_batches; i++) {
+            ofpbuf_delete(sw->batches[i].msg);
+        }
         free(sw);
     }
 }
 
+/* Enables or disables sending flow-mods in bundles, according to 'enable'.
+ *
+ * When bundling is enabled, the flow-mods that 'sw' generates while processing
+ * a batch of messages go to the switch together in OFP_EXT_FLOW_MOD_BUNDLE
+ * messages when lswitch_run() is next called.  Only switches that implement
+ * this extension, such as the userspace datapath, understand bundles. */
+void
+lswitch_set_bundle_flows(struct lswitch *sw, bool enable)
+{
+    sw->bundle_flows = enable;
+}
+
+/* Enables or disables sending packets in batches, according to 'enable'.
+ *
+ * When batching is enabled, the packets that 'sw' forwards while processing
+ * a batch of messages go to the switch in OFP_EXT_PACKET_OUT_MULTI messages,
+ * one for each pair of input and output ports, when lswitch_run() is next
+ * called.  Only switches that implement this extension, such as the userspace
+ * datapath, understand these messages. */
+void
+lswitch_set_batch_packets(struct lswitch *sw, bool enable)
+{
+    sw->batch_packets = enable;
+}
+
 /* Takes care of necessary 'sw' activity, except for receiving packets (which
  * the caller must do). */
 void
 lswitch_run(struct lswitch *sw, struct rconn *rconn)
 {
-    long long int now = time_msec();
+    unsigned int conn_seqno = rconn_get_connection_seqno(rconn);
 
-    if (sw->ml) {
-        mac_learning_run(sw->ml, NULL);
+    /* The switch's flows may have come and gone while we were disconnected,
+     * without a flow removed message that reached us, so start over. */
+    if (conn_seqno != sw->conn_seqno) {
+        sw->conn_seqno = conn_seqno;
+        forget_all_flows(sw);
     }
 
-    /* If we're waiting for more replies, keeping waiting for up to 10 s. */
-    if (sw->last_reply != LLONG_MIN) {
-        if (now - sw->last_reply > 10000) {
-            VLOG_ERR_RL(&rl, "%012llx: No more flow stat replies last 10 s",
-                        sw->datapath_id);
-            sw->last_reply = LLONG_MIN;
-            sw->last_query = LLONG_MIN;
-            schedule_query(sw, 0);
-        } else {
-            return;
-        }
-    }
+    flush_flow_mods(sw, rconn);
+    flush_packet_outs(sw, rconn);
 
-    /* If we're waiting for any reply at all, keep waiting for up to 10 s. */
-    if (sw->last_query != LLONG_MIN) {
-        if (now - sw->last_query > 10000) {
-            VLOG_ERR_RL(&rl, "%012llx: No flow stat replies in last 10 s",
-                        sw->datapath_id);
-            sw->last_query = LLONG_MIN;
-            schedule_query(sw, 0);
-        } else {
-            return;
-        }
+    if (sw->ml) {
+        mac_learning_run(sw->ml, NULL);
     }
 
-    /* If it's time to send another query, do so. */
-    if (sw->next_query != LLONG_MIN && now >= sw->next_query) {
-        sw->next_query = LLONG_MIN;
-        if (!rconn_is_connected(rconn)) {
-            schedule_query(sw, 1000);
-        } else {
-            struct ofp_stats_request *osr;
-            struct ofp_flow_stats_request *ofsr;
-            struct ofpbuf *b;
-            int error;
-
-            VLOG_DBG("%012llx: Sending flow stats request to implement STP",
-                     sw->datapath_id);
-
-            sw->last_query = now;
-            sw->query_xid = random_uint32();
-            sw->n_flows = 0;
-            sw->n_no_recv = 0;
-            sw->n_no_send = 0;
-            osr = make_openflow_xid(sizeof *osr + sizeof *ofsr,
-                                    OFPT_STATS_REQUEST, sw->query_xid, &b);
-            osr->type = htons(OFPST_FLOW);
-            osr->flags = htons(0);
-            ofsr = (struct ofp_flow_stats_request *) osr->body;
-            ofsr->match.wildcards = htonl(OFPFW_ALL);
-            ofsr->table_id = 0xff;
-            ofsr->out_port = htons(OFPP_NONE);
-
-            error = rconn_send(rconn, b, NULL);
-            if (error) {
-                VLOG_WARN_RL(&rl, "%012llx: sending flow stats request "
-                             "failed: %s", sw->datapath_id, strerror(error));
-                ofpbuf_delete(b);
-                schedule_query(sw, 1000);
-            }
-        }
-    }
-}
-
-static void
-wait_timeout(long long int started)
-{
-    long long int now = time_msec();
-    long long int timeout = 10000 - (now - started);
-    if (timeout <= 0) {
-        poll_immediate_wake();
-    } else {
-        poll_timer_wait(timeout);
+    sw->stp_deferred = !rconn_is_connected(rconn);
+    if (sw->stp_changed && !sw->stp_deferred) {
+        invalidate_stp_flows(sw, rconn);
     }
 }
 
@@ -246,10 +279,9 @@ lswitch_wait(struct lswitch *sw)
         mac_learning_wait(sw->ml);
     }
 
-    if (sw->last_reply != LLONG_MIN) {
-        wait_timeout(sw->last_reply);
-    } else if (sw->last_query != LLONG_MIN) {
-        wait_timeout(sw->last_query);
+    if (sw->bundle || sw->n_batches
+        || (sw->stp_changed && !sw->stp_deferred)) {
+        poll_immediate_wake();
     }
 }
 
@@ -287,15 +319,10 @@ lswitch_process_packet(struct lswitch *sw, struct rconn *rconn,
             sizeof(struct ofp_port_status),
             process_port_status
         },
-        {
-            OFPT_STATS_REPLY,
-            offsetof(struct ofp_stats_reply, body),
-            process_stats_reply
-        },
         {
             OFPT_FLOW_REMOVED,
             sizeof(struct ofp_flow_removed),
-            NULL
+            process_flow_removed
         },
     };
     const size_t n_processors = ARRAY_SIZE(processors);
@@ -355,10 +382,26 @@ send_features_request(struct lswitch *sw, struct rconn *rconn)
     }
 }
 
-static void
+/* Sends 'b' on 'rconn', unless too many messages are already queued there.
+ * Returns 0 if successful, otherwise a positive errno value.  Either way, 'b'
+ * is destroyed. */
+static int
 queue_tx(struct lswitch *sw, struct rconn *rconn, struct ofpbuf *b)
 {
-    int retval = rconn_send_with_limit(rconn, b, &sw->n_queued, 10);
+    int retval = try_queue_tx(sw, rconn, b);
+    if (retval) {
+        ofpbuf_delete(b);
+    }
+    return retval;
+}
+
+/* Like queue_tx(), except that if 'b' cannot be sent it still belongs to the
+ * caller. */
+static int
+try_queue_tx(struct lswitch *sw, struct rconn *rconn, struct ofpbuf *b)
+{
+    int retval = (sw->n_queued >= LSWITCH_MAX_QUEUED ? EAGAIN
+                  : rconn_send(rconn, b, &sw->n_queued));
     if (retval && retval != ENOTCONN) {
         if (retval == EAGAIN) {
             VLOG_INFO_RL(&rl, "%012llx: %s: tx queue overflow",
@@ -369,15 +412,97 @@ queue_tx(struct lswitch *sw, struct rconn *rconn, struct ofpbuf *b)
                          strerror(retval));
         }
     }
+    return retval;
+}
+
+/* Sends flow-mod 'b' to the switch, or adds it to the current bundle if
+ * bundling is enabled.  Returns 0 if successful, otherwise a positive errno
+ * value if 'b' could not be sent.  (A bundle that cannot be sent later is
+ * dealt with by flush_flow_mods().) */
+static int
+queue_flow_mod(struct lswitch *sw, struct rconn *rconn, struct ofpbuf *b)
+{
+    if (!sw->bundle_flows) {
+        return queue_tx(sw, rconn, b);
+    }
+
+    if (sw->bundle && !flow_mod_bundle_append(sw->bundle, b->data)) {
+        flush_flow_mods(sw, rconn);
+    }
+    if (!sw->bundle) {
+        sw->bundle = make_flow_mod_bundle();
+        flow_mod_bundle_append(sw->bundle, b->data);
+    }
+    ofpbuf_delete(b);
+    return 0;
+}
+
+/* Sends the flow-mods bundled so far, if any.  If the bundle cannot be sent,
+ * forgets the flows that it would have set up. */
+static void
+flush_flow_mods(struct lswitch *sw, struct rconn *rconn)
+{
+    if (sw->bundle) {
+        if (try_queue_tx(sw, rconn, sw->bundle)) {
+            forget_bundled_flows(sw, sw->bundle);
+            ofpbuf_delete(sw->bundle);
+        }
+        sw->bundle = NULL;
+    }
+}
+
+/* Sends the packet buffered under 'buffer_id' or, if it is UINT32_MAX,
+ * 'packet', which was received on 'in_port', out 'out_port', or adds it to the
+ * current batch for those ports if batching is enabled. */
+static void
+queue_packet_out(struct lswitch *sw, struct rconn *rconn,
+                 uint16_t in_port, uint16_t out_port,
+                 uint32_t buffer_id, const struct ofpbuf *packet)
+{
+    struct packet_batch *batch;
+    int i;
+
+    if (!sw->batch_packets) {
+        queue_tx(sw, rconn,
+                 (buffer_id == UINT32_MAX
+                  ? make_unbuffered_packet_out(packet, in_port, out_port)
+                  : make_buffered_packet_out(buffer_id, in_port, out_port)));
+        return;
+    }
+
+    for (i = 0; i < sw->n_batches; i++) {
+        batch = &sw->batches[i];
+        if (batch->in_port == in_port && batch->out_port == out_port) {
+            if (packet_out_multi_append(batch->msg, buffer_id, packet)) {
+                return;
+            }
+            queue_tx(sw, rconn, batch->msg);
+            batch->msg = make_packet_out_multi(in_port, out_port);
+            packet_out_multi_append(batch->msg, buffer_id, packet);
+            return;
+        }
+    }
+
+    if (sw->n_batches >= LSWITCH_MAX_BATCHES) {
+        flush_packet_outs(sw, rconn);
+    }
+    batch = &sw->batches[sw->n_batches++];
+    batch->in_port = in_port;
+    batch->out_port = out_port;
+    batch->msg = make_packet_out_multi(in_port, out_port);
+    packet_out_multi_append(batch->msg, buffer_id, packet);
 }
 
+/* Sends the packets batched so far, if any. */
 static void
-schedule_query(struct lswitch *sw, long long int delay)
+flush_packet_outs(struct lswitch *sw, struct rconn *rconn)
 {
-    long long int now = time_msec();
-    if (sw->next_query == LLONG_MIN || sw->next_query > now + delay) {
-        sw->next_query = now + delay;
+    int i;
+
+    for (i = 0; i < sw->n_batches; i++) {
+        queue_tx(sw, rconn, sw->batches[i].msg);
     }
+    sw->n_batches = 0;
 }
 
 static void
@@ -394,9 +519,6 @@ process_switch_features(struct lswitch *sw, struct rconn *rconn, void *osf_)
     for (i = 0; i < n_ports; i++) {
         process_phy_port(sw, rconn, &osf->ports[i]);
     }
-    if (sw->capabilities & OFPC_STP) {
-        schedule_query(sw, 1000);
-    }
 }
 
 static void
@@ -447,33 +569,29 @@ process_packet_in(struct lswitch *sw, struct rconn *rconn, void *opi_)
     } else if (sw->max_idle >= 0 && (!sw->ml || out_port != OFPP_FLOOD)) {
         /* The output port is known, or we always flood everything, so add a
          * new flow. */
-        queue_tx(sw, rconn, make_add_simple_flow(&flow, ntohl(opi->buffer_id),
-                                                 out_port, sw->max_idle));
+        add_flow(sw, rconn,
+                 make_add_simple_flow(&flow, ntohl(opi->buffer_id),
+                                      out_port, sw->max_idle),
+                 out_port);
 
         /* If the switch didn't buffer the packet, we need to send a copy. */
         if (ntohl(opi->buffer_id) == UINT32_MAX) {
-            queue_tx(sw, rconn,
-                     make_unbuffered_packet_out(&pkt, in_port, out_port));
+            queue_packet_out(sw, rconn, in_port, out_port, UINT32_MAX, &pkt);
         }
     } else {
         /* We don't know that MAC, or we don't set up flows.  Send along the
          * packet without setting up a flow. */
-        struct ofpbuf *b;
-        if (ntohl(opi->buffer_id) == UINT32_MAX) {
-            b = make_unbuffered_packet_out(&pkt, in_port, out_port);
-        } else {
-            b = make_buffered_packet_out(ntohl(opi->buffer_id),
-                                         in_port, out_port);
-        }
-        queue_tx(sw, rconn, b);
+        queue_packet_out(sw, rconn, in_port, out_port,
+                         ntohl(opi->buffer_id), &pkt);
     }
     return;
 
 drop_it:
     if (sw->max_idle >= 0) {
         /* Set up a flow to drop packets. */
-        queue_tx(sw, rconn, make_add_flow(&flow, ntohl(opi->buffer_id),
-                                          sw->max_idle, 0));
+        add_flow(sw, rconn, make_add_flow(&flow, ntohl(opi->buffer_id),
+                                          sw->max_idle, 0),
+                 OFPP_NONE);
     } else {
         /* Just drop the packet, since we don't set up flows at all.
          * XXX we should send a packet_out with no actions if buffer_id !=
@@ -531,8 +649,9 @@ process_phy_port(struct lswitch *sw, struct rconn *rconn UNUSED, void *opp_)
             new_port_state = P_FORWARDING;
         }
         if (*port_state != new_port_state) {
+            sw->stp_changed_ports[port_no] = true;
+            sw->stp_changed = true;
             *port_state = new_port_state;
-            schedule_query(sw, 1000);
         }
     }
 }
@@ -566,94 +685,254 @@ may_send(const struct lswitch *sw, uint16_t port_no)
     return get_port_state(sw, port_no) & P_FORWARDING;
 }
 
+/* Converts 'match' into an exact-match flow the way that make_flow_mod() did
+ * when we set up the flow, so that flows that the switch reports back to us
+ * compare equal to the ones that we remember. */
 static void
-process_flow_stats(struct lswitch *sw, struct rconn *rconn,
-                   const struct ofp_flow_stats *ofs)
-{
-    const char *end = (char *) ofs + ntohs(ofs->length);
-    bool delete = false;
-
-    /* Decide to delete the flow if it matches on an STP-disabled physical
-     * port.  But don't delete it if the flow just drops all received packets,
-     * because that's a perfectly reasonable thing to do for disabled physical
-     * ports. */
-    if (!(ofs->match.wildcards & htonl(OFPFW_IN_PORT))) {
-        if (!may_recv(sw, ntohs(ofs->match.in_port),
-                      end > (char *) ofs->actions)) {
-            delete = true;
-            sw->n_no_recv++;
+match_to_flow(const struct ofp_match *match, struct flow *flow)
+{
+    memset(flow, 0, sizeof *flow);
+    flow->nw_src = match->nw_src;
+    flow->nw_dst = match->nw_dst;
+    flow->in_port = match->in_port;
+    flow->dl_vlan = match->dl_vlan;
+    flow->dl_type = match->dl_type;
+    flow->tp_src = match->tp_src;
+    flow->tp_dst = match->tp_dst;
+    memcpy(flow->dl_src, match->dl_src, ETH_ADDR_LEN);
+    memcpy(flow->dl_dst, match->dl_dst, ETH_ADDR_LEN);
+    flow->dl_vlan_pcp = match->dl_vlan_pcp;
+    flow->nw_proto = match->nw_proto;
+}
+
+static struct lswitch_flow *
+lookup_flow(const struct lswitch *sw, const struct flow *flow)
+{
+    struct lswitch_flow *f;
+
+    HMAP_FOR_EACH_WITH_HASH (f, struct lswitch_flow, node,
+                             flow_hash(flow, 0), &sw->flows) {
+        if (flow_equal(&f->flow, flow)) {
+            return f;
         }
     }
+    return NULL;
+}
 
-    /* Decide to delete the flow if it forwards to an STP-disabled physical
-     * port. */
-    if (!delete) {
-        const struct ofp_action_header *a;
-        size_t len;
+static void
+forget_flow(struct lswitch *sw, struct lswitch_flow *f)
+{
+    hmap_remove(&sw->flows, &f->node);
+    list_remove(&f->in_node);
+    list_remove(&f->out_node);
+    free(f);
+}
 
-        for (a = ofs->actions; (char *) a < end; a += len / 8) {
-            len = ntohs(a->len);
-            if (len > end - (char *) a) {
-                VLOG_DBG_RL(&rl, "%012llx: action exceeds available space "
-                            "(%zu > %td)",
-                            sw->datapath_id, len, end - (char *) a);
-                break;
-            } else if (len % 8) {
-                VLOG_DBG_RL(&rl, "%012llx: action length (%zu) not multiple "
-                            "of 8 bytes", sw->datapath_id, len);
-                break;
-            }
+static void
+forget_all_flows(struct lswitch *sw)
+{
+    struct lswitch_flow *f, *next;
 
-            if (a->type == htons(OFPAT_OUTPUT)) {
-                struct ofp_action_output *oao = (struct ofp_action_output *) a;
-                if (!may_send(sw, ntohs(oao->port))) {
-                    delete = true;
-                    sw->n_no_send++;
-                    break;
-                }
-            }
+    HMAP_FOR_EACH_SAFE (f, next, struct lswitch_flow, node, &sw->flows) {
+        forget_flow(sw, f);
+    }
+}
+
+/* Forgets the flows that the flow-mods in 'bundle', an
+ * OFP_EXT_FLOW_MOD_BUNDLE message, would have set up. */
+static void
+forget_bundled_flows(struct lswitch *sw, const struct ofpbuf *bundle)
+{
+    const struct openflow_ext_flow_mod_bundle *obm = bundle->data;
+    const uint8_t *p = obm->body;
+    uint32_t i;
+
+    for (i = 0; i < ntohl(obm->n_flow_mods); i++) {
+        const struct ofp_flow_mod *ofm = (const struct ofp_flow_mod *) p;
+        struct lswitch_flow *f;
+        struct flow flow;
+
+        match_to_flow(&ofm->match, &flow);
+        f = lookup_flow(sw, &flow);
+        if (f) {
+            forget_flow(sw, f);
         }
+        p += ntohs(ofm->header.length);
     }
+}
 
-    /* Delete the flow. */
-    if (delete) {
-        struct ofp_flow_mod *ofm;
-        struct ofpbuf *b;
+/* Sends flow-mod 'b', which adds an exact-match flow that outputs to
+ * 'out_port' (or drops, if 'out_port' is OFPP_NONE), to the switch.  If the
+ * switch implements STP, also remembers the flow for invalidate_stp_flows()
+ * and asks the switch to tell us when the flow goes away, forgetting it
+ * again if the flow-mod cannot be sent. */
+static void
+add_flow(struct lswitch *sw, struct rconn *rconn, struct ofpbuf *b,
+         uint16_t out_port)
+{
+    struct ofp_flow_mod *ofm = b->data;
+    struct lswitch_flow *f = NULL;
 
-        ofm = make_openflow(offsetof(struct ofp_flow_mod, actions),
-                            OFPT_FLOW_MOD, &b);
-        ofm->match = ofs->match;
-        ofm->command = OFPFC_DELETE_STRICT;
-        rconn_send(rconn, b, NULL);
+    if (sw->capabilities & OFPC_STP) {
+        uint16_t in_port = ntohs(ofm->match.in_port);
+        struct flow flow;
+
+        match_to_flow(&ofm->match, &flow);
+        f = lookup_flow(sw, &flow);
+        if (f) {
+            list_remove(&f->in_node);
+            list_remove(&f->out_node);
+        } else {
+            f = xmalloc(sizeof *f);
+            f->flow = flow;
+            hmap_insert(&sw->flows, &f->node, flow_hash(&flow, 0));
+        }
+        f->in_port = in_port;
+        f->out_port = out_port;
+        if (in_port < STP_MAX_PORTS) {
+            list_push_back(&sw->in_flows[in_port], &f->in_node);
+        } else {
+            list_init(&f->in_node);
+        }
+        if (out_port < STP_MAX_PORTS) {
+            list_push_back(&sw->out_flows[out_port], &f->out_node);
+        } else {
+            list_init(&f->out_node);
+        }
+        ofm->flags |= htons(OFPFF_SEND_FLOW_REM);
+    }
+    if (queue_flow_mod(sw, rconn, b) && f) {
+        forget_flow(sw, f);
     }
 }
 
 static void
-process_stats_reply(struct lswitch *sw, struct rconn *rconn, void *osr_)
+process_flow_removed(struct lswitch *sw, struct rconn *rconn UNUSED,
+                     void *ofr_)
 {
-    struct ofp_stats_reply *osr = osr_;
-    struct flow_stats_iterator i;
-    const struct ofp_flow_stats *fs;
+    struct ofp_flow_removed *ofr = ofr_;
+    struct lswitch_flow *f;
+    struct flow flow;
 
-    if (sw->last_query == LLONG_MIN
-        || osr->type != htons(OFPST_FLOW)
-        || osr->header.xid != sw->query_xid) {
+    if (ofr->match.wildcards != htonl(0)) {
         return;
     }
-    for (fs = flow_stats_first(&i, osr); fs; fs = flow_stats_next(&i)) {
-        sw->n_flows++;
-        process_flow_stats(sw, rconn, fs);
-    }
-    if (!(osr->flags & htons(OFPSF_REPLY_MORE))) {
-        VLOG_DBG("%012llx: Deleted %d of %d received flows to "
-                 "implement STP, %d because of no-recv, %d because of "
-                 "no-send", sw->datapath_id,
-                 sw->n_no_recv + sw->n_no_send, sw->n_flows,
-                 sw->n_no_recv, sw->n_no_send);
-        sw->last_query = LLONG_MIN;
-        sw->last_reply = LLONG_MIN;
-    } else {
-        sw->last_reply = time_msec();
+    match_to_flow(&ofr->match, &flow);
+    f = lookup_flow(sw, &flow);
+    if (f) {
+        forget_flow(sw, f);
     }
 }
 
+/* Sends a flow-mod that deletes the flows that 'match' and 'out_port' select,
+ * strictly if 'strict' is true.  Returns 0 if successful, otherwise a positive
+ * errno value.
+ *
+ * These must not be held back by the limit on queued messages, or bundled,
+ * because losing one would leave flows in place that violate STP. */
+static int
+send_flow_delete(struct lswitch *sw, struct rconn *rconn,
+                 const struct ofp_match *match, uint16_t out_port,
+                 bool strict)
+{
+    struct ofp_flow_mod *ofm;
+    struct ofpbuf *b;
+    int error;
+
+    ofm = make_openflow(offsetof(struct ofp_flow_mod, actions),
+                        OFPT_FLOW_MOD, &b);
+    ofm->match = *match;
+    ofm->command = htons(strict ? OFPFC_DELETE_STRICT : OFPFC_DELETE);
+    ofm->out_port = htons(out_port);
+    error = rconn_send(rconn, b, NULL);
+    if (error) {
+        VLOG_WARN_RL(&rl, "%012llx: %s: sending STP flow deletion: %s",
+                     sw->datapath_id, rconn_get_name(rconn), strerror(error));
+        ofpbuf_delete(b);
+    }
+    return error;
+}
+
+/* Deletes the flows that the STP state of the ports whose state has changed
+ * since the last call no longer allows: those that receive on a port that
+ * may not receive, except that flows that just drop packets are fine on a
+ * learning port, and those that output to a port that may not send.
+ *
+ * A port whose deletions could not all be sent stays marked as changed, and
+ * the flows that were not deleted stay remembered, so that the next call
+ * tries again. */
+static void
+invalidate_stp_flows(struct lswitch *sw, struct rconn *rconn)
+{
+    int n_ports = 0, n_deletes = 0;
+    uint16_t port_no;
+
+    sw->stp_changed = false;
+    for (port_no = 0; port_no < STP_MAX_PORTS; port_no++) {
+        struct lswitch_flow *f, *next;
+        struct ofp_match match;
+        int error = 0;
+
+        if (!sw->stp_changed_ports[port_no]) {
+            continue;
+        }
+        n_ports++;
+
+        memset(&match, 0, sizeof match);
+        match.wildcards = htonl(OFPFW_ALL & ~OFPFW_IN_PORT);
+        match.in_port = htons(port_no);
+        if (!may_recv(sw, port_no, true)) {
+            error = send_flow_delete(sw, rconn, &match, OFPP_NONE, false);
+            if (!error) {
+                n_deletes++;
+                LIST_FOR_EACH_SAFE (f, next, struct lswitch_flow, in_node,
+                                    &sw->in_flows[port_no]) {
+                    forget_flow(sw, f);
+                }
+            }
+        } else if (!may_recv(sw, port_no, false)) {
+            LIST_FOR_EACH_SAFE (f, next, struct lswitch_flow, in_node,
+                                &sw->in_flows[port_no]) {
+                if (f->out_port == OFPP_NONE) {
+                    int retval;
+
+                    flow_fill_match(&match, &f->flow, 0);
+                    retval = send_flow_delete(sw, rconn, &match, OFPP_NONE,
+                                              true);
+                    if (retval) {
+                        error = retval;
+                    } else {
+                        n_deletes++;
+                        forget_flow(sw, f);
+                    }
+                }
+            }
+        }
+
+        if (!may_send(sw, port_no)) {
+            int retval;
+
+            memset(&match, 0, sizeof match);
+            match.wildcards = htonl(OFPFW_ALL);
+            retval = send_flow_delete(sw, rconn, &match, port_no, false);
+            if (retval) {
+                error = retval;
+            } else {
+                n_deletes++;
+                LIST_FOR_EACH_SAFE (f, next, struct lswitch_flow, out_node,
+                                    &sw->out_flows[port_no]) {
+                    forget_flow(sw, f);
+                }
+            }
+        }
+
+        if (error) {
+            sw->stp_changed = true;
+        } else {
+            sw->stp_changed_ports[port_no] = false;
+        }
+    }
+
+    VLOG_DBG("%012llx: sent %d flow deletions to implement STP state changes "
+             "on %d ports", sw->datapath_id, n_deletes, n_ports);
+}
@@ -40,6 +40,8 @@ struct ofpbuf;
 struct rconn;
 
 struct lswitch *lswitch_create(struct rconn *, bool learn_macs, int max_idle);
+void lswitch_set_bundle_flows(struct lswitch *, bool enable);
+void lswitch_set_batch_packets(struct lswitch *, bool enable);
 void lswitch_run(struct lswitch *, struct rconn *);
 void lswitch_wait(struct lswitch *);
 void lswitch_destroy(struct lswitch *);
@@ -76,12 +76,15 @@
 #include <unistd.h>
 
 #include "fatal-signal.h"
+#include "hash.h"
+#include "hmap.h"
 #include "list.h"
 #include "netlink.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
 #include "packets.h"
 #include "poll-loop.h"
+#include "shash.h"
 #include "socket-util.h"
 #include "svec.h"
 
@@ -142,10 +145,35 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 static void init_netdev(void);
 static int do_open_netdev(const char *name, int ethertype, int tap_fd,
                           struct netdev **netdev_);
+static int finish_open_netdev(const char *name, int netdev_fd, int tap_fd,
+                              unsigned int ifindex, struct netdev **netdev_);
 static int restore_flags(struct netdev *netdev);
 static int get_flags(const char *netdev_name, int *flagsp);
 static int set_flags(const char *netdev_name, int flags);
 
+/* Network device information obtained in bulk from the kernel by
+ * netdev_cache_links().  While the cache is populated, opening a network
+ * device and querying its flags and addresses take their answers from here
+ * instead of issuing one ioctl per item and re-reading /proc/net/if_inet6 for
+ * every device. */
+struct link_info {
+    struct hmap_node index_node; /* In 'link_index'. */
+    int ifindex;
+    int hwaddr_family;          /* ARPHRD_* hardware type. */
+    uint8_t etheraddr[ETH_ADDR_LEN];
+    int mtu;
+    int txqlen;
+    int flags;                  /* IFF_* flags. */
+    struct in_addr in4;         /* First IPv4 address, or INADDR_ANY. */
+    struct in6_addr in6;        /* First IPv6 address, or in6addr_any. */
+};
+
+/* Cached 'struct link_info's, indexed by name and by ifindex. */
+static struct shash link_cache = SHASH_INITIALIZER(&link_cache);
+static struct hmap link_index = HMAP_INITIALIZER(&link_index);
+
+static struct link_info *lookup_link(const char *name);
+
 /* Obtains the IPv6 address for 'name' into 'in6'. */
 static void
 get_ipv6_address(const char *name, struct in6_addr *in6)
@@ -184,6 +212,201 @@ get_ipv6_address(const char *name, struct in6_addr *in6)
     fclose(file);
 }
 
+static const struct nl_policy link_policy[] = {
+    [IFLA_ADDRESS] = { .type = NL_A_UNSPEC, .optional = true },
+    [IFLA_IFNAME] = { .type = NL_A_STRING, .optional = false },
+    [IFLA_MTU] = { .type = NL_A_U32, .optional = true },
+    [IFLA_TXQLEN] = { .type = NL_A_U32, .optional = true },
+};
+
+static const struct nl_policy addr_policy[] = {
+    [IFA_ADDRESS] = { .type = NL_A_UNSPEC, .optional = true },
+    [IFA_LOCAL] = { .type = NL_A_UNSPEC, .optional = true },
+};
+
+static struct link_info *
+lookup_link_by_index(int ifindex)
+{
+    struct link_info *link;
+
+    HMAP_FOR_EACH_WITH_HASH (link, struct link_info, index_node,
+                             hash_words((uint32_t *) &ifindex, 1, 0),
+                             &link_index) {
+        if (link->ifindex == ifindex) {
+            return link;
+        }
+    }
+    return NULL;
+}
+
+static struct link_info *
+lookup_link(const char *name)
+{
+    return shash_find_data(&link_cache, name);
+}
+
+static void
+parse_link_msg(const struct ofpbuf *msg, void *aux UNUSED)
+{
+    struct nlattr *attrs[ARRAY_SIZE(link_policy)];
+    const struct ifinfomsg *ifi;
+    struct link_info *link;
+    const char *name;
+
+    ifi = ofpbuf_at(msg, NLMSG_HDRLEN, sizeof *ifi);
+    if (!ifi
+        || nl_msg_nlmsghdr(msg)->nlmsg_type != RTM_NEWLINK
+        || !nl_policy_parse(msg, NLMSG_HDRLEN + sizeof *ifi, link_policy,
+                            attrs, ARRAY_SIZE(link_policy))) {
+        VLOG_WARN_RL(&rl, "received bad rtnl link message");
+        return;
+    }
+    name = nl_attr_get_string(attrs[IFLA_IFNAME]);
+    if (lookup_link(name)) {
+        return;
+    }
+
+    link = xcalloc(1, sizeof *link);
+    link->ifindex = ifi->ifi_index;
+    link->hwaddr_family = ifi->ifi_type;
+    if (attrs[IFLA_ADDRESS]
+        && nl_attr_get_size(attrs[IFLA_ADDRESS]) == ETH_ADDR_LEN) {
+        memcpy(link->etheraddr, nl_attr_get(attrs[IFLA_ADDRESS]),
+               ETH_ADDR_LEN);
+    }
+    link->mtu = attrs[IFLA_MTU] ? nl_attr_get_u32(attrs[IFLA_MTU]) : 0;
+    link->txqlen = (attrs[IFLA_TXQLEN]
+                    ? nl_attr_get_u32(attrs[IFLA_TXQLEN]) : 0);
+    link->flags = ifi->ifi_flags;
+    link->in4.s_addr = INADDR_ANY;
+    link->in6 = in6addr_any;
+    shash_add(&link_cache, name, link);
+    hmap_insert(&link_index, &link->index_node,
+                hash_words((uint32_t *) &link->ifindex, 1, 0));
+}
+
+static void
+parse_addr_msg(const struct ofpbuf *msg, void *aux UNUSED)
+{
+    struct nlattr *attrs[ARRAY_SIZE(addr_policy)];
+    const struct ifaddrmsg *ifa;
+    const struct nlattr *addr;
+    struct link_info *link;
+
+    ifa = ofpbuf_at(msg, NLMSG_HDRLEN, sizeof *ifa);
+    if (!ifa
+        || nl_msg_nlmsghdr(msg)->nlmsg_type != RTM_NEWADDR
+        || !nl_policy_parse(msg, NLMSG_HDRLEN + sizeof *ifa, addr_policy,
+                            attrs, ARRAY_SIZE(addr_policy))) {
+        VLOG_WARN_RL(&rl, "received bad rtnl address message");
+        return;
+    }
+    link = lookup_link_by_index(ifa->ifa_index);
+    if (!link) {
+        return;
+    }
+
+    /* IFA_LOCAL is the local address on point-to-point links, where
+     * IFA_ADDRESS is the peer's address. */
+    addr = attrs[IFA_LOCAL] ? attrs[IFA_LOCAL] : attrs[IFA_ADDRESS];
+    if (!addr) {
+        return;
+    }
+    if (ifa->ifa_family == AF_INET
+        && nl_attr_get_size(addr) == sizeof link->in4
+        && link->in4.s_addr == INADDR_ANY) {
+        memcpy(&link->in4, nl_attr_get(addr), sizeof link->in4);
+    } else if (ifa->ifa_family == AF_INET6
+               && nl_attr_get_size(addr) == sizeof link->in6
+               && !memcmp(&link->in6, &in6addr_any, sizeof link->in6)) {
+        memcpy(&link->in6, nl_attr_get(addr), sizeof link->in6);
+    }
+}
+
+static int
+dump_rtnl(struct nl_sock *sock, uint16_t type, size_t hdr_size,
+          void (*cb)(const struct ofpbuf *, void *))
+{
+    struct ofpbuf request;
+    int error;
+
+    /* ifinfomsg and ifaddrmsg both start with the address family, so an
+     * all-zeros header requests every device or every address. */
+    ofpbuf_init(&request, 0);
+    nl_msg_put_nlmsghdr(&request, sock, hdr_size, type, NLM_F_REQUEST);
+    memset(nl_msg_put_uninit(&request, hdr_size), 0, hdr_size);
+    error = nl_sock_dump(sock, &request, cb, NULL);
+    ofpbuf_uninit(&request);
+    return error;
+}
+
+/* Fetches the name, index, hardware address, MTU, transmit queue length,
+ * flags, and IPv4 and IPv6 addresses of every network device on the system
+ * with a pair of rtnetlink dumps, and keeps them in a cache that
+ * netdev_open() and the functions that query device flags consult in place of
+ * issuing ioctls one device at a time.  This makes opening hundreds of
+ * network devices much faster.  Returns 0 if successful, otherwise a positive
+ * errno value, in which case the cache is empty and everything falls back to
+ * ioctls.
+ *
+ * The cache is not kept up to date as devices change, so the caller should
+ * only keep it across a batch of netdev_open() calls and then drop it with
+ * netdev_uncache_links(). */
+int
+netdev_cache_links(void)
+{
+    struct nl_sock *sock;
+    int tries;
+    int error;
+
+    init_netdev();
+    netdev_uncache_links();
+
+    error = nl_sock_create(NETLINK_ROUTE, 0, 0, 0, &sock);
+    if (error) {
+        VLOG_WARN("could not create rtnetlink socket: %s", strerror(error));
+        return error;
+    }
+    for (tries = 0; tries < 3; tries++) {
+        error = dump_rtnl(sock, RTM_GETLINK, sizeof(struct ifinfomsg),
+                          parse_link_msg);
+        if (!error) {
+            error = dump_rtnl(sock, RTM_GETADDR, sizeof(struct ifaddrmsg),
+                              parse_addr_msg);
+        }
+        if (error != ENOBUFS) {
+            break;
+        }
+        /* A reply overflowed our receive buffer.  Start over. */
+        netdev_uncache_links();
+    }
+    nl_sock_destroy(sock);
+
+    if (error) {
+        VLOG_WARN("rtnetlink dump of network devices failed: %s",
+                  strerror(error));
+        netdev_uncache_links();
+    } else {
+        VLOG_DBG("cached information for %zu network devices",
+                 hmap_count(&link_index));
+    }
+    return error;
+}
+
+/* Drops the information cached by netdev_cache_links(), if any. */
+void
+netdev_uncache_links(void)
+{
+    struct shash_node *node;
+
+    HMAP_FOR_EACH (node, struct shash_node, node, &link_cache.map) {
+        free(node->data);
+    }
+    shash_clear(&link_cache);
+    hmap_destroy(&link_index);
+    hmap_init(&link_index);
+}
+
 /* All queues in a port, lie beneath a qdisc */
 #define TC_QDISC 0x0001
 /* This is a root class. In order to efficiently share excess bandwidth
@@ -688,23 +911,23 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     struct sockaddr_ll sll;
     struct ifreq ifr;
     unsigned int ifindex;
-    uint8_t etheraddr[ETH_ADDR_LEN];
-    struct in6_addr in6;
-    int mtu;
-    int txqlen;
-    int hwaddr_family;
     int error;
-    struct netdev *netdev;
+    struct link_info *link;
+    int protocol;
 
     init_netdev();
     *netdev_ = NULL;
 
-    /* Create raw socket. */
-    netdev_fd = socket(PF_PACKET, SOCK_RAW,
-                       htons(ethertype == NETDEV_ETH_TYPE_NONE ? 0
-                             : ethertype == NETDEV_ETH_TYPE_ANY ? ETH_P_ALL
-                             : ethertype == NETDEV_ETH_TYPE_802_2 ? ETH_P_802_2
-                             : ethertype));
+    /* Create raw socket.  The socket is created with protocol 0, so that it
+     * receives nothing at all until bind() below attaches it to the device
+     * and the requested protocol together.  (Creating it with the requested
+     * protocol would make it receive packets of that type from every device
+     * on the system until bind(), which then have to be drained.) */
+    protocol = htons(ethertype == NETDEV_ETH_TYPE_NONE ? 0
+                     : ethertype == NETDEV_ETH_TYPE_ANY ? ETH_P_ALL
+                     : ethertype == NETDEV_ETH_TYPE_802_2 ? ETH_P_802_2
+                     : ethertype);
+    netdev_fd = socket(PF_PACKET, SOCK_RAW, 0);
     if (netdev_fd < 0) {
         return errno;
     }
@@ -716,64 +939,98 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     }
 
     /* Get ethernet device index. */
+    link = lookup_link(name);
     strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
-    if (ioctl(netdev_fd, SIOCGIFINDEX, &ifr) < 0) {
+    if (link) {
+        ifindex = link->ifindex;
+    } else if (ioctl(netdev_fd, SIOCGIFINDEX, &ifr) < 0) {
         VLOG_ERR("ioctl(SIOCGIFINDEX) on %s device failed: %s",
                  name, strerror(errno));
         goto error;
+    } else {
+        ifindex = ifr.ifr_ifindex;
     }
-    ifindex = ifr.ifr_ifindex;
 
-    /* Bind to specific ethernet device. */
+    /* Bind to specific ethernet device and protocol. */
     memset(&sll, 0, sizeof sll);
     sll.sll_family = AF_PACKET;
+    sll.sll_protocol = protocol;
     sll.sll_ifindex = ifindex;
     if (bind(netdev_fd, (struct sockaddr *) &sll, sizeof sll) < 0) {
         VLOG_ERR("bind to %s failed: %s", name, strerror(errno));
         goto error;
     }
 
-    if (ethertype != NETDEV_ETH_TYPE_NONE) {
-        /* Between the socket() and bind() calls above, the socket receives all
-         * packets of the requested type on all system interfaces.  We do not
-         * want to receive that data, but there is no way to avoid it.  So we
-         * must now drain out the receive queue. */
-        error = drain_rcvbuf(netdev_fd);
-        if (error) {
+    return finish_open_netdev(name, netdev_fd, tap_fd, ifindex, netdev_);
+
+error:
+    error = errno;
+error_already_set:
+    close(netdev_fd);
+    if (tap_fd >= 0) {
+        close(tap_fd);
+    }
+    return error;
+}
+
+/* Completes opening network device 'name', with index 'ifindex', whose raw
+ * socket 'netdev_fd' is already bound to the device.  'tap_fd' is the TAP
+ * character device for a TAP device, otherwise -1.  On failure, closes
+ * 'netdev_fd' and 'tap_fd'. */
+static int
+finish_open_netdev(const char *name, int netdev_fd, int tap_fd,
+                   unsigned int ifindex, struct netdev **netdev_)
+{
+    struct ifreq ifr;
+    uint8_t etheraddr[ETH_ADDR_LEN];
+    struct in6_addr in6;
+    int mtu;
+    int txqlen;
+    int hwaddr_family;
+    int error;
+    struct netdev *netdev;
+    struct link_info *link;
+
+    link = lookup_link(name);
+    strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
+    if (link) {
+        hwaddr_family = link->hwaddr_family;
+        memcpy(etheraddr, link->etheraddr, sizeof etheraddr);
+        mtu = link->mtu;
+        txqlen = link->txqlen;
+        in6 = link->in6;
+    } else {
+        /* Get MAC address. */
+        if (ioctl(netdev_fd, SIOCGIFHWADDR, &ifr) < 0) {
+            VLOG_ERR("ioctl(SIOCGIFHWADDR) on %s device failed: %s",
+                     name, strerror(errno));
             goto error;
         }
-    }
+        hwaddr_family = ifr.ifr_hwaddr.sa_family;
+        memcpy(etheraddr, ifr.ifr_hwaddr.sa_data, sizeof etheraddr);
 
-    /* Get MAC address. */
-    if (ioctl(netdev_fd, SIOCGIFHWADDR, &ifr) < 0) {
-        VLOG_ERR("ioctl(SIOCGIFHWADDR) on %s device failed: %s",
-                 name, strerror(errno));
-        goto error;
+        /* Get MTU. */
+        if (ioctl(netdev_fd, SIOCGIFMTU, &ifr) < 0) {
+            VLOG_ERR("ioctl(SIOCGIFMTU) on %s device failed: %s",
+                     name, strerror(errno));
+            goto error;
+        }
+        mtu = ifr.ifr_mtu;
+
+        /* Get TX queue length. */
+        if (ioctl(netdev_fd, SIOCGIFTXQLEN, &ifr) < 0) {
+            VLOG_ERR("ioctl(SIOCGIFTXQLEN) on %s device failed: %s",
+                     name, strerror(errno));
+            goto error;
+        }
+        txqlen = ifr.ifr_qlen;
+
+        get_ipv6_address(name, &in6);
     }
-    hwaddr_family = ifr.ifr_hwaddr.sa_family;
     if (hwaddr_family != AF_UNSPEC && hwaddr_family != ARPHRD_ETHER) {
         VLOG_WARN("%s device has unknown hardware address family %d",
                   name, hwaddr_family);
     }
-    memcpy(etheraddr, ifr.ifr_hwaddr.sa_data, sizeof etheraddr);
-
-    /* Get MTU. */
-    if (ioctl(netdev_fd, SIOCGIFMTU, &ifr) < 0) {
-        VLOG_ERR("ioctl(SIOCGIFMTU) on %s device failed: %s",
-                 name, strerror(errno));
-        goto error;
-    }
-    mtu = ifr.ifr_mtu;
-
-    /* Get TX queue length. */
-    if (ioctl(netdev_fd, SIOCGIFTXQLEN, &ifr) < 0) {
-        VLOG_ERR("ioctl(SIOCGIFTXQLEN) on %s device failed: %s",
-                 name, strerror(errno));
-        goto error;
-    }
-    txqlen = ifr.ifr_qlen;
-
-    get_ipv6_address(name, &in6);
 
     /* Allocate network device. */
     netdev = xmalloc(sizeof *netdev);
@@ -795,6 +1052,8 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     /* Save flags to restore at close or exit. */
     error = get_flags(netdev->name, &netdev->save_flags);
     if (error) {
+        free(netdev->name);
+        free(netdev);
         goto error_already_set;
     }
     netdev->changed_flags = 0;
@@ -816,6 +1075,71 @@ error_already_set:
     return error;
 }
 
+/* Describes 'netdev' in 'h' so that another process can take it over with
+ * netdev_take_over(), given the file descriptors in 'h'.  'netdev' remains
+ * open and usable. */
+void
+netdev_get_handoff(const struct netdev *netdev, struct netdev_handoff *h)
+{
+    int i;
+
+    h->netdev_fd = netdev->netdev_fd;
+    h->tap_fd = netdev->tap_fd != netdev->netdev_fd ? netdev->tap_fd : -1;
+    h->num_queues = netdev->num_queues;
+    for (i = 0; i < netdev->num_queues; i++) {
+        h->queue_fds[i] = netdev->queue_fd[i + 1];
+    }
+    h->save_flags = netdev->save_flags;
+    h->changed_flags = netdev->changed_flags;
+}
+
+/* Makes 'netdev' leave the device's flags alone when it is closed or the
+ * process exits, because another process has taken over the device. */
+void
+netdev_release(struct netdev *netdev)
+{
+    netdev->changed_flags = 0;
+}
+
+/* Opens network device 'name' using the file descriptors that another
+ * process described in 'h' with netdev_get_handoff(), instead of opening the
+ * device afresh.  The new netdev restores the device's flags, when it is
+ * closed, to what they were before the other process first opened it.
+ * Returns 0 if successful, otherwise a positive errno value. */
+int
+netdev_take_over(const char *name, const struct netdev_handoff *h,
+                 struct netdev **netdevp)
+{
+    struct netdev *netdev;
+    struct ifreq ifr;
+    int error;
+    int i;
+
+    init_netdev();
+    *netdevp = NULL;
+
+    strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
+    if (ioctl(af_inet_sock, SIOCGIFINDEX, &ifr) < 0) {
+        VLOG_ERR("ioctl(SIOCGIFINDEX) on %s device failed: %s",
+                 name, strerror(errno));
+        return errno;
+    }
+    error = finish_open_netdev(name, h->netdev_fd, h->tap_fd,
+                               ifr.ifr_ifindex, &netdev);
+    if (error) {
+        return error;
+    }
+
+    netdev->num_queues = h->num_queues;
+    for (i = 0; i < h->num_queues; i++) {
+        netdev->queue_fd[i + 1] = h->queue_fds[i];
+    }
+    netdev->save_flags = h->save_flags;
+    netdev->changed_flags = h->changed_flags;
+    *netdevp = netdev;
+    return 0;
+}
+
 /* Closes and destroys 'netdev'. */
 void
 netdev_close(struct netdev *netdev)
@@ -934,6 +1258,17 @@ netdev_recv_wait(struct netdev *netdev)
     poll_fd_wait(netdev->tap_fd, POLLIN);
 }
 
+/* Arranges for poll_block() to call 'function', passing 'aux' along, when a
+ * packet is ready to be received with netdev_recv() on 'netdev'.  Like any
+ * poll_fd_callback(), the callback is called only once; call this function
+ * again to be notified again.  Returns the poll_waiter, which the caller may
+ * pass to poll_cancel() if it loses interest. */
+struct poll_waiter *
+netdev_recv_callback(struct netdev *netdev, poll_fd_func *function, void *aux)
+{
+    return poll_fd_callback(netdev->tap_fd, POLLIN, function, aux);
+}
+
 /* Discards all packets waiting to be received from 'netdev'. */
 int
 netdev_drain(struct netdev *netdev)
@@ -1015,6 +1350,7 @@ netdev_send_wait(struct netdev *netdev)
 int
 netdev_set_etheraddr(struct netdev *netdev, const uint8_t mac[ETH_ADDR_LEN])
 {
+    struct link_info *link;
     struct ifreq ifr;
 
     memset(&ifr, 0, sizeof ifr);
@@ -1027,6 +1363,10 @@ netdev_set_etheraddr(struct netdev *netdev, const uint8_t mac[ETH_ADDR_LEN])
         return errno;
     }
     memcpy(netdev->etheraddr, mac, ETH_ADDR_LEN);
+    link = lookup_link(netdev->name);
+    if (link) {
+        memcpy(link->etheraddr, mac, ETH_ADDR_LEN);
+    }
     return 0;
 }
 
@@ -1081,12 +1421,15 @@ netdev_get_features(struct netdev *netdev, int type)
 bool
 netdev_get_in4(const struct netdev *netdev, struct in_addr *in4)
 {
+    struct link_info *link = lookup_link(netdev->name);
     struct ifreq ifr;
     struct in_addr ip = { INADDR_ANY };
 
     strncpy(ifr.ifr_name, netdev->name, sizeof ifr.ifr_name);
     ifr.ifr_addr.sa_family = AF_INET;
-    if (ioctl(af_inet_sock, SIOCGIFADDR, &ifr) == 0) {
+    if (link) {
+        ip = link->in4;
+    } else if (ioctl(af_inet_sock, SIOCGIFADDR, &ifr) == 0) {
         struct sockaddr_in *sin = (struct sockaddr_in *) &ifr.ifr_addr;
         ip = sin->sin_addr;
     } else {
@@ -1134,10 +1477,15 @@ do_set_addr(struct netdev *netdev, int sock,
 int
 netdev_set_in4(struct netdev *netdev, struct in_addr addr, struct in_addr mask)
 {
+    struct link_info *link;
     int error;
 
     error = do_set_addr(netdev, af_inet_sock,
                         SIOCSIFADDR, "SIOCSIFADDR", addr);
+    link = lookup_link(netdev->name);
+    if (!error && link) {
+        link->in4 = addr;
+    }
     if (!error && addr.s_addr != INADDR_ANY) {
         error = do_set_addr(netdev, af_inet_sock,
                             SIOCSIFNETMASK, "SIOCSIFNETMASK", mask);
@@ -1332,7 +1680,9 @@ netdev_nodev_get_flags(const char *netdev_name, enum netdev_flags *flagsp)
     if (flags & IFF_PROMISC) {
         *flagsp |= NETDEV_PROMISC;
     }
-    if (flags & IFF_LOWER_UP) {
+    /* SIOCGIFFLAGS reports only the low 16 bits of the flags, which do not
+     * include IFF_LOWER_UP, but IFF_RUNNING also requires carrier. */
+    if (flags & (IFF_LOWER_UP | IFF_RUNNING)) {
         *flagsp |= NETDEV_CARRIER;
     }
     return 0;
@@ -1565,7 +1915,14 @@ restore_all_flags(void *aux UNUSED)
 static int
 get_flags(const char *netdev_name, int *flags)
 {
+    struct link_info *link = lookup_link(netdev_name);
     struct ifreq ifr;
+
+    if (link) {
+        *flags = link->flags;
+        return 0;
+    }
+
     strncpy(ifr.ifr_name, netdev_name, sizeof ifr.ifr_name);
     if (ioctl(af_inet_sock, SIOCGIFFLAGS, &ifr) < 0) {
         VLOG_ERR("ioctl(SIOCGIFFLAGS) on %s device failed: %s",
@@ -1579,7 +1936,9 @@ get_flags(const char *netdev_name, int *flags)
 static int
 set_flags(const char *netdev_name, int flags)
 {
+    struct link_info *link;
     struct ifreq ifr;
+
     strncpy(ifr.ifr_name, netdev_name, sizeof ifr.ifr_name);
     ifr.ifr_flags = flags;
     if (ioctl(af_inet_sock, SIOCSIFFLAGS, &ifr) < 0) {
@@ -1587,5 +1946,10 @@ set_flags(const char *netdev_name, int flags)
                  netdev_name, strerror(errno));
         return errno;
     }
+
+    link = lookup_link(netdev_name);
+    if (link) {
+        link->flags = (link->flags & ~0xffff) | (ifr.ifr_flags & 0xffff);
+    }
     return 0;
 }
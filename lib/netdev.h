@@ -37,6 +37,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "poll-loop.h"
 
 /* Generic interface to network devices.
  *
@@ -76,8 +77,26 @@ int netdev_open(const char *name, int ethertype, struct netdev **);
 int netdev_open_tap(const char *name, struct netdev **);
 void netdev_close(struct netdev *);
 
+/* State of a network device, for handing it off to another process.  The
+ * file descriptors must be passed along with SCM_RIGHTS. */
+struct netdev_handoff {
+    int netdev_fd;              /* Raw socket bound to the device. */
+    int tap_fd;                 /* TAP character device, or -1 if none. */
+    int queue_fds[NETDEV_MAX_QUEUES]; /* Sockets for queues 1...num_queues. */
+    uint16_t num_queues;
+    int save_flags;             /* Device flags before it was first opened. */
+    int changed_flags;          /* Flags changed since then. */
+};
+
+void netdev_get_handoff(const struct netdev *, struct netdev_handoff *);
+void netdev_release(struct netdev *);
+int netdev_take_over(const char *name, const struct netdev_handoff *,
+                     struct netdev **);
+
 int netdev_recv(struct netdev *, struct ofpbuf *);
 void netdev_recv_wait(struct netdev *);
+struct poll_waiter *netdev_recv_callback(struct netdev *, poll_fd_func *,
+                                         void *aux);
 int netdev_drain(struct netdev *);
 int netdev_send(struct netdev *, const struct ofpbuf *, uint16_t class_id);
 void netdev_send_wait(struct netdev *);
@@ -100,6 +119,9 @@ int netdev_setup_class(const struct netdev *, uint16_t , uint16_t);
 int netdev_change_class(const struct netdev *, uint16_t , uint16_t);
 int netdev_delete_class(const struct netdev *, uint16_t);
 
+int netdev_cache_links(void);
+void netdev_uncache_links(void);
+
 void netdev_enumerate(struct svec *);
 int netdev_nodev_get_flags(const char *netdev_name, enum netdev_flags *);
 
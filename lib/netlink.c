@@ -293,20 +293,23 @@ nl_sock_recv(struct nl_sock *sock, struct ofpbuf **bufp, bool wait)
 try_again:
     /* Attempt to read the message.  We don't know the size of the data
      * yet, so we take a guess at 2048.  If we're wrong, we keep trying
-     * and doubling the buffer size each time. 
+     * and doubling the buffer size each time, or jump straight to the
+     * message's actual size if the kernel reports it (MSG_TRUNC makes
+     * recvmsg() return the full length of a Netlink message).
      */
     nlmsghdr = ofpbuf_put_uninit(buf, bufsize);
     iov.iov_base = nlmsghdr;
     iov.iov_len = bufsize;
     do {
-        nbytes = recvmsg(sock->fd, &msg, (wait ? 0 : MSG_DONTWAIT) | MSG_PEEK); 
+        nbytes = recvmsg(sock->fd, &msg,
+                         (wait ? 0 : MSG_DONTWAIT) | MSG_PEEK | MSG_TRUNC);
     } while (nbytes < 0 && errno == EINTR);
     if (nbytes < 0) {
         ofpbuf_delete(buf);
         return errno;
     }
     if (msg.msg_flags & MSG_TRUNC) {
-        bufsize *= 2;
+        bufsize = MAX(bufsize * 2, nbytes);
         ofpbuf_reinit(buf, bufsize);
         goto try_again;
     }
@@ -426,6 +429,71 @@ recv:
     return 0;
 }
 
+/* Sends 'request', a dump request, to the kernel via 'sock' and calls 'cb' once
+ * for each message in the multipart reply, passing along 'aux'.  Each message
+ * is presented to 'cb' as an ofpbuf that covers just that one message, so
+ * that it may be parsed with nl_policy_parse().  'cb' must not retain the
+ * ofpbuf or any pointer into it.  Returns 0 if the entire dump was received,
+ * otherwise a positive errno value.
+ *
+ * A single receive buffer from the kernel usually carries many dump
+ * messages, which is what makes a dump much cheaper than issuing one request
+ * per object.  If the reply overflows the socket's receive buffer, returns
+ * ENOBUFS; the caller may then retry the whole dump. */
+int
+nl_sock_dump(struct nl_sock *sock, const struct ofpbuf *request,
+             void (*cb)(const struct ofpbuf *msg, void *aux), void *aux)
+{
+    uint32_t seq = nl_msg_nlmsghdr(request)->nlmsg_seq;
+    int retval;
+
+    nl_msg_nlmsghdr(request)->nlmsg_flags |= NLM_F_DUMP;
+    retval = nl_sock_send(sock, request, true);
+    if (retval) {
+        return retval;
+    }
+
+    for (;;) {
+        struct ofpbuf *reply;
+        size_t ofs;
+
+        retval = nl_sock_recv(sock, &reply, true);
+        if (retval) {
+            return retval;
+        }
+
+        for (ofs = 0; ofs < reply->size; ) {
+            struct nlmsghdr *nlmsghdr = ofpbuf_at(reply, ofs, NLMSG_HDRLEN);
+            struct ofpbuf msg;
+
+            if (!nlmsghdr
+                || nlmsghdr->nlmsg_len < NLMSG_HDRLEN
+                || nlmsghdr->nlmsg_len > reply->size - ofs) {
+                VLOG_ERR_RL(&rl, "received invalid nlmsg in dump reply");
+                ofpbuf_delete(reply);
+                return EPROTO;
+            }
+            ofpbuf_use(&msg, nlmsghdr, nlmsghdr->nlmsg_len);
+            msg.size = nlmsghdr->nlmsg_len;
+            ofs += NLMSG_ALIGN(nlmsghdr->nlmsg_len);
+
+            if (nlmsghdr->nlmsg_seq != seq) {
+                VLOG_DBG_RL(&rl, "ignoring seq %"PRIu32" != expected %"PRIu32,
+                            nlmsghdr->nlmsg_seq, seq);
+            } else if (nlmsghdr->nlmsg_type == NLMSG_DONE) {
+                ofpbuf_delete(reply);
+                return 0;
+            } else if (nl_msg_nlmsgerr(&msg, &retval)) {
+                ofpbuf_delete(reply);
+                return retval ? retval : EPROTO;
+            } else {
+                cb(&msg, aux);
+            }
+        }
+        ofpbuf_delete(reply);
+    }
+}
+
 /* Causes poll_block() to wake up when any of the specified 'events' (which is
  * a OR'd combination of POLLIN, POLLOUT, etc.) occur on 'sock'. */
 void
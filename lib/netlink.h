@@ -64,7 +64,8 @@ int nl_sock_sendv(struct nl_sock *sock, const struct iovec iov[], size_t n_iov,
 int nl_sock_recv(struct nl_sock *, struct ofpbuf **, bool wait);
 int nl_sock_transact(struct nl_sock *, const struct ofpbuf *request,
                      struct ofpbuf **reply);
-
+int nl_sock_dump(struct nl_sock *, const struct ofpbuf *request,
+                 void (*cb)(const struct ofpbuf *msg, void *aux), void *aux);
 void nl_sock_wait(const struct nl_sock *, short int events);
 
 /* Netlink messages. */
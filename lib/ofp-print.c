@@ -35,12 +35,12 @@
 #include "ofp-print.h"
 #include "xtoxll.h"
 
-#include <errno.h>
 #include <inttypes.h>
 #include <netinet/in.h>
-#include <sys/wait.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <ctype.h>
 
 #include "compiler.h"
@@ -49,70 +49,360 @@
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
 #include "openflow/nicira-ext.h"
+#include "openflow/openflow-ext.h"
 #include "packets.h"
-#include "pcap.h"
+#include "stp.h"
 #include "util.h"
 
 static void ofp_print_port_name(struct ds *string, uint16_t port);
 static void ofp_print_match(struct ds *, const struct ofp_match *,
                             int verbosity);
 
+/* Returns the number of bytes in 'packet' from 'p' to its end. */
+static size_t
+bytes_after(const struct ofpbuf *packet, const void *p)
+{
+    return (const uint8_t *) packet->data + packet->size - (const uint8_t *) p;
+}
+
+static const char *
+ethertype_name(uint16_t dl_type)
+{
+    switch (dl_type) {
+    case ETH_TYPE_IP:
+        return "IPv4";
+    case ETH_TYPE_ARP:
+        return "ARP";
+    case ETH_TYPE_VLAN:
+        return "802.1Q";
+    case 0x86dd:
+        return "IPv6";
+    case 0x88cc:
+        return "LLDP";
+    default:
+        return "Unknown";
+    }
+}
+
+static void
+put_tcp_flags(struct ds *string, uint8_t flags)
+{
+    ds_put_cstr(string, "Flags [");
+    if (!(flags & (TCP_FIN | TCP_SYN | TCP_RST | TCP_PSH | TCP_ACK
+                   | TCP_URG))) {
+        ds_put_cstr(string, "none");
+    }
+    if (flags & TCP_FIN) {
+        ds_put_char(string, 'F');
+    }
+    if (flags & TCP_SYN) {
+        ds_put_char(string, 'S');
+    }
+    if (flags & TCP_RST) {
+        ds_put_char(string, 'R');
+    }
+    if (flags & TCP_PSH) {
+        ds_put_char(string, 'P');
+    }
+    if (flags & TCP_ACK) {
+        ds_put_char(string, '.');
+    }
+    if (flags & TCP_URG) {
+        ds_put_char(string, 'U');
+    }
+    ds_put_char(string, ']');
+}
+
+static void
+put_icmp(struct ds *string, const struct icmp_header *icmp)
+{
+    switch (icmp->icmp_type) {
+    case 0:
+        ds_put_cstr(string, "ICMP echo reply");
+        break;
+    case 3:
+        ds_put_format(string, "ICMP unreachable, code %"PRIu8,
+                      icmp->icmp_code);
+        break;
+    case 8:
+        ds_put_cstr(string, "ICMP echo request");
+        break;
+    case 11:
+        ds_put_cstr(string, "ICMP time exceeded in-transit");
+        break;
+    default:
+        ds_put_format(string, "ICMP type %"PRIu8", code %"PRIu8,
+                      icmp->icmp_type, icmp->icmp_code);
+        break;
+    }
+}
+
+/* Appends to 'string' a description of the IPv4 packet in 'packet', whose
+ * headers have been located by flow_extract() into 'flow'. */
+static void
+put_ip(struct ds *string, const struct ofpbuf *packet, const struct flow *flow)
+{
+    const struct ip_header *ip = packet->l3;
+    int ip_len, payload_len;
+
+    if (!packet->l4) {
+        ds_put_cstr(string, "[|ip]");
+        return;
+    }
+    ip_len = IP_IHL(ip->ip_ihl_ver) * 4;
+    payload_len = (int) ntohs(ip->ip_tot_len) - ip_len;
+
+    if (IP_IS_FRAGMENT(ip->ip_frag_off)) {
+        uint16_t frag_off = ntohs(ip->ip_frag_off);
+        ds_put_format(string, IP_FMT" > "IP_FMT": ip-proto-%"PRIu8" "
+                      "(frag %"PRIu16":%d@%d%s)",
+                      IP_ARGS(&ip->ip_src), IP_ARGS(&ip->ip_dst),
+                      ip->ip_proto, ntohs(ip->ip_id), payload_len,
+                      (frag_off & IP_FRAG_OFF_MASK) * 8,
+                      frag_off & IP_MORE_FRAGMENTS ? "+" : "");
+        return;
+    }
+
+    if ((ip->ip_proto == IP_TYPE_TCP || ip->ip_proto == IP_TYPE_UDP)
+        && packet->l7) {
+        ds_put_format(string, IP_FMT".%"PRIu16" > "IP_FMT".%"PRIu16": ",
+                      IP_ARGS(&ip->ip_src), ntohs(flow->tp_src),
+                      IP_ARGS(&ip->ip_dst), ntohs(flow->tp_dst));
+    } else {
+        ds_put_format(string, IP_FMT" > "IP_FMT": ",
+                      IP_ARGS(&ip->ip_src), IP_ARGS(&ip->ip_dst));
+    }
+
+    if (ip->ip_proto == IP_TYPE_TCP) {
+        const struct tcp_header *tcp = packet->l4;
+        if (!packet->l7) {
+            ds_put_cstr(string, "[|tcp]");
+            return;
+        }
+        put_tcp_flags(string, TCP_FLAGS(tcp->tcp_ctl));
+        ds_put_format(string, ", seq %"PRIu32, ntohl(tcp->tcp_seq));
+        if (TCP_FLAGS(tcp->tcp_ctl) & TCP_ACK) {
+            ds_put_format(string, ", ack %"PRIu32, ntohl(tcp->tcp_ack));
+        }
+        ds_put_format(string, ", win %"PRIu16", length %d",
+                      ntohs(tcp->tcp_winsz),
+                      payload_len - TCP_OFFSET(tcp->tcp_ctl) * 4);
+    } else if (ip->ip_proto == IP_TYPE_UDP) {
+        const struct udp_header *udp = packet->l4;
+        if (!packet->l7) {
+            ds_put_cstr(string, "[|udp]");
+            return;
+        }
+        ds_put_format(string, "UDP, length %d",
+                      (int) ntohs(udp->udp_len) - UDP_HEADER_LEN);
+    } else if (ip->ip_proto == IP_TYPE_ICMP) {
+        if (!packet->l7) {
+            ds_put_cstr(string, "[|icmp]");
+            return;
+        }
+        put_icmp(string, packet->l4);
+        ds_put_format(string, ", length %d", payload_len);
+    } else {
+        ds_put_format(string, "ip-proto-%"PRIu8" %d",
+                      ip->ip_proto, payload_len);
+    }
+}
+
+static void
+put_arp(struct ds *string, const struct ofpbuf *packet)
+{
+    const struct arp_eth_header *arp = packet->l3;
+    size_t arp_len = bytes_after(packet, arp);
+
+    if (arp_len < ARP_ETH_HEADER_LEN) {
+        ds_put_cstr(string, "[|arp]");
+        return;
+    }
+    if (arp->ar_hrd != htons(ARP_HRD_ETHERNET)
+        || arp->ar_pro != htons(ARP_PRO_IP)
+        || arp->ar_hln != ETH_ADDR_LEN || arp->ar_pln != IP_ADDR_LEN) {
+        ds_put_format(string, "ARP, hardware type %"PRIu16", "
+                      "protocol type 0x%04"PRIx16", length %zu",
+                      ntohs(arp->ar_hrd), ntohs(arp->ar_pro), arp_len);
+        return;
+    }
+
+    switch (ntohs(arp->ar_op)) {
+    case ARP_OP_REQUEST:
+        ds_put_format(string, "Request who-has "IP_FMT" tell "IP_FMT,
+                      IP_ARGS(&arp->ar_tpa), IP_ARGS(&arp->ar_spa));
+        break;
+    case ARP_OP_REPLY:
+        ds_put_format(string, "Reply "IP_FMT" is-at "ETH_ADDR_FMT,
+                      IP_ARGS(&arp->ar_spa), ETH_ADDR_ARGS(arp->ar_sha));
+        break;
+    default:
+        ds_put_format(string, "ARP, opcode %"PRIu16, ntohs(arp->ar_op));
+        break;
+    }
+    ds_put_format(string, ", length %zu", arp_len);
+}
+
+/* Appends to 'string' the bridge or root ID at 'id' in a BPDU. */
+static void
+put_bridge_id(struct ds *string, const uint8_t *id)
+{
+    ds_put_format(string, "%02"PRIx8"%02"PRIx8"."ETH_ADDR_FMT,
+                  id[0], id[1], ETH_ADDR_ARGS(id + 2));
+}
+
+/* Appends to 'string' a description of the 'len'-byte spanning tree BPDU at
+ * 'bpdu'.  See lib/stp.c for the BPDU formats. */
+static void
+put_bpdu(struct ds *string, const uint8_t *bpdu, size_t len)
+{
+    /* Offsets of fields in a configuration BPDU. */
+    enum {
+        BPDU_VERSION = 2,
+        BPDU_TYPE = 3,
+        BPDU_FLAGS = 4,
+        BPDU_ROOT_ID = 5,
+        BPDU_BRIDGE_ID = 17,
+        BPDU_PORT_ID = 25,
+        BPDU_CONFIG_LEN = 35
+    };
+    uint8_t flags;
+
+    if (len < 4 || bpdu[0] || bpdu[1]) {
+        ds_put_format(string, "[|stp %zu]", len);
+        return;
+    }
+    ds_put_format(string, "STP %s, ", bpdu[BPDU_VERSION] ? "802.1w" : "802.1d");
+    if (bpdu[BPDU_TYPE] == 0x80) {
+        ds_put_format(string, "Topology Change, length %zu", len);
+        return;
+    } else if (bpdu[BPDU_TYPE] != 0x00 && bpdu[BPDU_TYPE] != 0x02) {
+        ds_put_format(string, "BPDU type 0x%02"PRIx8", length %zu",
+                      bpdu[BPDU_TYPE], len);
+        return;
+    } else if (len < BPDU_CONFIG_LEN) {
+        ds_put_cstr(string, "[|stp]");
+        return;
+    }
+
+    flags = bpdu[BPDU_FLAGS];
+    ds_put_format(string, "%s, Flags [",
+                  bpdu[BPDU_TYPE] ? "Rapid STP" : "Config");
+    if (!flags) {
+        ds_put_cstr(string, "none");
+    } else {
+        static const struct {
+            uint8_t bit;
+            const char *name;
+        } bits[] = {
+            { 0x01, "Topology change" },
+            { 0x02, "Proposal" },
+            { 0x10, "Learn" },
+            { 0x20, "Forward" },
+            { 0x40, "Agreement" },
+            { 0x80, "Topology change ACK" },
+        };
+        const char *sep = "";
+        size_t i;
+
+        for (i = 0; i < ARRAY_SIZE(bits); i++) {
+            if (flags & bits[i].bit) {
+                ds_put_format(string, "%s%s", sep, bits[i].name);
+                sep = ", ";
+            }
+        }
+        if (bpdu[BPDU_TYPE] && flags & 0x0c) {
+            static const char *roles[] = { "", "Alternate", "Root",
+                                           "Designated" };
+            ds_put_format(string, "%sRole %s", sep, roles[(flags >> 2) & 3]);
+        }
+    }
+    ds_put_cstr(string, "], bridge-id ");
+    put_bridge_id(string, bpdu + BPDU_BRIDGE_ID);
+    ds_put_format(string, ".%02"PRIx8"%02"PRIx8", root-id ",
+                  bpdu[BPDU_PORT_ID], bpdu[BPDU_PORT_ID + 1]);
+    put_bridge_id(string, bpdu + BPDU_ROOT_ID);
+    ds_put_format(string, ", length %zu", len);
+}
+
 /* Returns a string that represents the contents of the Ethernet frame in the
- * 'len' bytes starting at 'data' to 'stream' as output by tcpdump.
+ * 'len' bytes starting at 'data', in the style of "tcpdump -e -n".
  * 'total_len' specifies the full length of the Ethernet frame (of which 'len'
  * bytes were captured).
  *
  * The caller must free the returned string.
  *
- * This starts and kills a tcpdump subprocess so it's quite expensive. */
+ * This decodes Ethernet, 802.1Q, 802.2 LLC and SNAP, spanning tree BPDUs,
+ * ARP, IPv4, TCP, UDP and ICMP headers itself, so it is cheap enough to call
+ * for every packet. */
 char *
-ofp_packet_to_string(const void *data, size_t len, size_t total_len UNUSED)
+ofp_packet_to_string(const void *data, size_t len, size_t total_len)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
-    struct ofpbuf buf;
-
-    char command[128];
-    FILE *pcap;
-    FILE *tcpdump;
-    int status;
-    int c;
-
-    buf.data = (void *) data;
-    buf.size = len;
-
-    pcap = tmpfile();
-    if (!pcap) {
-        ofp_error(errno, "tmpfile");
-        return xstrdup("<error>");
-    }
-    pcap_write_header(pcap);
-    pcap_write(pcap, &buf);
-    fflush(pcap);
-    if (ferror(pcap)) {
-        ofp_error(errno, "error writing temporary file");
-    }
-    rewind(pcap);
-
-    snprintf(command, sizeof command, "/usr/sbin/tcpdump -e -n -r /dev/fd/%d 2>/dev/null",
-             fileno(pcap));
-    tcpdump = popen(command, "r");
-    fclose(pcap);
-    if (!tcpdump) {
-        ofp_error(errno, "exec(\"%s\")", command);
-        return xstrdup("<error>");
+    const struct eth_header *eth;
+    struct ofpbuf packet;
+    struct flow flow;
+
+    ofpbuf_use(&packet, (void *) data, len);
+    packet.size = len;
+    flow_extract(&packet, 0, &flow);
+
+    eth = packet.l2;
+    if (len < ETH_HEADER_LEN) {
+        ds_put_format(&ds, "[|ether] length %zu\n", total_len);
+        return ds_cstr(&ds);
+    }
+
+    ds_put_format(&ds, ETH_ADDR_FMT" > "ETH_ADDR_FMT", ",
+                  ETH_ADDR_ARGS(eth->eth_src), ETH_ADDR_ARGS(eth->eth_dst));
+    if (ntohs(eth->eth_type) >= OFP_DL_TYPE_ETH2_CUTOFF) {
+        ds_put_format(&ds, "ethertype %s (0x%04"PRIx16"), length %zu: ",
+                      ethertype_name(ntohs(eth->eth_type)),
+                      ntohs(eth->eth_type), total_len);
+    } else {
+        const struct llc_header *llc = (const void *) (eth + 1);
+
+        ds_put_format(&ds, "802.3, length %zu: ", total_len);
+        if (len < ETH_HEADER_LEN + LLC_HEADER_LEN) {
+            ds_put_cstr(&ds, "[|llc]\n");
+            return ds_cstr(&ds);
+        } else if (flow.dl_type == htons(OFP_DL_TYPE_NOT_ETH_TYPE)) {
+            ds_put_format(&ds, "LLC, dsap 0x%02"PRIx8", ssap 0x%02"PRIx8", "
+                          "ctrl 0x%02"PRIx8": ",
+                          llc->llc_dsap, llc->llc_ssap, llc->llc_cntl);
+            if (llc->llc_dsap == STP_LLC_DSAP && llc->llc_ssap == STP_LLC_SSAP
+                && llc->llc_cntl == STP_LLC_CNTL) {
+                put_bpdu(&ds, packet.l3, bytes_after(&packet, packet.l3));
+            } else {
+                ds_put_format(&ds, "length %zu",
+                              bytes_after(&packet, packet.l3));
+            }
+            ds_put_char(&ds, '\n');
+            return ds_cstr(&ds);
+        }
+        ds_put_cstr(&ds, "LLC/SNAP, ");
+        if (flow.dl_type != htons(ETH_TYPE_VLAN)) {
+            ds_put_format(&ds, "ethertype %s, ",
+                          ethertype_name(ntohs(flow.dl_type)));
+        }
     }
 
-    while ((c = getc(tcpdump)) != EOF) {
-        ds_put_char(&ds, c);
+    if (flow.dl_vlan != htons(OFP_VLAN_NONE)) {
+        ds_put_format(&ds, "vlan %"PRIu16", p %"PRIu8", ethertype %s, ",
+                      ntohs(flow.dl_vlan), flow.dl_vlan_pcp,
+                      ethertype_name(ntohs(flow.dl_type)));
     }
 
-    status = pclose(tcpdump);
-    if (WIFEXITED(status)) {
-        if (WEXITSTATUS(status))
-            ofp_error(0, "tcpdump exited with status %d", WEXITSTATUS(status));
-    } else if (WIFSIGNALED(status)) {
-        ofp_error(0, "tcpdump exited with signal %d", WTERMSIG(status)); 
+    if (flow.dl_type == htons(ETH_TYPE_IP)) {
+        put_ip(&ds, &packet, &flow);
+    } else if (flow.dl_type == htons(ETH_TYPE_ARP)) {
+        put_arp(&ds, &packet);
+    } else if (flow.dl_type == htons(ETH_TYPE_VLAN)) {
+        ds_put_cstr(&ds, "[|vlan]");
+    } else {
+        ds_put_format(&ds, "length %zu", bytes_after(&packet, packet.l3));
     }
+    ds_put_char(&ds, '\n');
     return ds_cstr(&ds);
 }
 
@@ -212,6 +502,40 @@ static void ofp_print_port_name(struct ds *string, uint16_t port)
     ds_put_cstr(string, name);
 }
 
+static void
+ofp_print_multipath(struct ds *string,
+                    const struct openflow_ext_action_multipath *am, size_t len)
+{
+    static const char *fields[] = {
+        "in_port", "dl_src", "dl_dst", "dl_vlan", "dl_type",
+        "nw_src", "nw_dst", "nw_proto", "tp_src", "tp_dst"
+    };
+    uint16_t field_bits = ntohs(am->fields);
+    size_t n_ports = MIN(am->n_ports,
+                         (len - sizeof *am) / sizeof am->ports[0]);
+    const char *sep;
+    size_t i;
+
+    ds_put_format(string, "multipath:%s:",
+                  am->algorithm == OFP_EXT_MP_MODULO ? "modulo"
+                  : am->algorithm == OFP_EXT_MP_HRW ? "hrw" : "unknown");
+    sep = "";
+    for (i = 0; i < ARRAY_SIZE(fields); i++) {
+        if (field_bits & (1u << i)) {
+            ds_put_format(string, "%s%s", sep, fields[i]);
+            sep = "+";
+        }
+    }
+    sep = ":";
+    for (i = 0; i < n_ports; i++) {
+        ds_put_format(string, "%s%"PRIu16, sep, ntohs(am->ports[i]));
+        sep = "+";
+    }
+    if (am->basis) {
+        ds_put_format(string, ":%"PRIu16, ntohs(am->basis));
+    }
+}
+
 static int
 ofp_print_action(struct ds *string, const struct ofp_action_header *ah, 
         size_t actions_len) 
@@ -400,8 +724,24 @@ ofp_print_action(struct ds *string, const struct ofp_action_header *ah,
             return -1;
         }
         /* Identify individual vendor actions */
-        if (1 == 0) {
-            /* Code to output vendor action */
+        if (avh->vendor == htonl(OPENFLOW_VENDOR_ID)
+            && len >= sizeof(struct openflow_ext_action_multipath)
+            && ((struct openflow_ext_action_multipath *) ah)->subtype
+               == htons(OFP_EXT_ACTION_MULTIPATH)) {
+            ofp_print_multipath(string,
+                                (struct openflow_ext_action_multipath *) ah,
+                                len);
+        } else if (avh->vendor == htonl(OPENFLOW_VENDOR_ID)
+            && len == sizeof(struct openflow_ext_action_police)
+            && ((struct openflow_ext_action_police *) ah)->subtype
+               == htons(OFP_EXT_ACTION_POLICE)) {
+            struct openflow_ext_action_police *ap
+                = (struct openflow_ext_action_police *) ah;
+            ds_put_format(string, "police:%"PRIu32":%"PRIu32,
+                          ntohl(ap->rate), ntohl(ap->burst));
+            if (ap->policy == OFP_EXT_POLICE_REMARK) {
+                ds_put_format(string, ":%"PRIu8, ap->dscp);
+            }
         } else {
             ds_put_format(string, "vendor action:0x%x", ntohl(avh->vendor));
         }
@@ -1611,6 +1951,32 @@ ofp_message_type_to_string(uint8_t type)
     }
     return ds_cstr(&s);
 }
+
+/* Returns the OpenFlow message type named 'name', which may be given in any
+ * case with or without an "OFPT_" prefix, e.g. "packet_in" or
+ * "OFPT_PACKET_IN", or as a number.  Returns -1 if 'name' is not recognized. */
+int
+ofp_message_type_from_name(const char *name)
+{
+    const struct openflow_packet *pkt;
+    char *tail;
+    long type;
+
+    type = strtol(name, &tail, 0);
+    if (*name && !*tail) {
+        return type >= 0 && type <= UINT8_MAX ? type : -1;
+    }
+
+    if (!strncasecmp(name, "OFPT_", 5)) {
+        name += 5;
+    }
+    for (pkt = packets; pkt < &packets[ARRAY_SIZE(packets)]; pkt++) {
+        if (!strcasecmp(name, pkt->name)) {
+            return pkt->type;
+        }
+    }
+    return -1;
+}
 
 static void
 print_and_free(FILE *stream, char *string) 
@@ -1629,10 +1995,9 @@ ofp_print(FILE *stream, const void *oh, size_t len, int verbosity)
 }
 
 /* Dumps the contents of the Ethernet frame in the 'len' bytes starting at
- * 'data' to 'stream' using tcpdump.  'total_len' specifies the full length of
- * the Ethernet frame (of which 'len' bytes were captured).
- *
- * This starts and kills a tcpdump subprocess so it's quite expensive. */
+ * 'data' to 'stream', as ofp_packet_to_string() does.  'total_len' specifies
+ * the full length of the Ethernet frame (of which 'len' bytes were
+ * captured). */
 void
 ofp_print_packet(FILE *stream, const void *data, size_t len, size_t total_len)
 {
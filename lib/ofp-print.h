@@ -53,6 +53,7 @@ char *ofp_to_string(const void *, size_t, int verbosity);
 char *ofp_match_to_string(const struct ofp_match *, int verbosity);
 char *ofp_packet_to_string(const void *data, size_t len, size_t total_len);
 char *ofp_message_type_to_string(uint8_t type);
+int ofp_message_type_from_name(const char *);
 
 #ifdef  __cplusplus
 }
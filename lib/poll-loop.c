@@ -162,6 +162,10 @@ poll_block(void)
     int retval;
 
     assert(!running_cb);
+
+    /* Log deferred messages now that the caller's work is done. */
+    vlog_run();
+
     if (max_pollfds < n_waiters) {
         max_pollfds = n_waiters;
         pollfds = xrealloc(pollfds, max_pollfds * sizeof *pollfds);
@@ -40,10 +40,11 @@
 
 #include "util.h"
 
+static bool inited = false;
+
 void
 random_init(void)
 {
-    static bool inited = false;
     if (!inited) {
         struct timeval tv;
         inited = true;
@@ -54,6 +55,15 @@ random_init(void)
     }
 }
 
+/* Seeds the random number generator with 'seed' instead of the time of day,
+ * so that a test can repeat a run exactly. */
+void
+random_set_seed(uint32_t seed)
+{
+    inited = true;
+    srand(seed);
+}
+
 void
 random_bytes(void *p_, size_t n)
 {
@@ -38,6 +38,7 @@
 #include <stdint.h>
 
 void random_init(void);
+void random_set_seed(uint32_t);
 void random_bytes(void *, size_t);
 uint8_t random_uint8(void);
 uint16_t random_uint16(void);
@@ -645,6 +645,16 @@ rconn_get_ip(const struct rconn *rconn)
     return rconn->vconn ? vconn_get_ip(rconn->vconn) : 0;
 }
 
+/* Returns the vconn that 'rconn' is connected over, if 'rconn' is connected
+ * and has no messages queued for sending, otherwise a null pointer.  The
+ * caller must not close the vconn. */
+struct vconn *
+rconn_get_vconn(const struct rconn *rconn)
+{
+    return (is_connected_state(rconn->state) && !rconn->txq.n
+            ? rconn->vconn : NULL);
+}
+
 /* If 'rconn' can't connect to the peer, it could be for any number of reasons.
  * Usually, one would assume it is because the peer is not running or because
  * the network is partitioned.  But it could also be because the network
@@ -78,6 +78,25 @@ set_socket_priority(int fd, int priority)
     return setsockopt(fd, SOL_SOCKET, SO_PRIORITY, (char *)&prio, sizeof(prio));
 }
 
+/* Allows other sockets to bind the same address and port as 'fd', which must
+ * not yet be bound, with the kernel spreading incoming connections among
+ * them.  Returns 0 if successful, otherwise a positive errno value. */
+int
+set_reuseport(int fd)
+{
+#ifdef SO_REUSEPORT
+    int yes = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof yes) < 0) {
+        VLOG_ERR("setsockopt(SO_REUSEPORT) failed: %s", strerror(errno));
+        return errno;
+    }
+    return 0;
+#else
+    VLOG_ERR("SO_REUSEPORT is not supported on this platform");
+    return EOPNOTSUPP;
+#endif
+}
+
 /* Returns the maximum valid FD value, plus 1. */
 int
 get_max_fds(void)
@@ -40,6 +40,7 @@
 
 int set_nonblocking(int fd);
 int set_socket_priority(int fd, int priority);
+int set_reuseport(int fd);
 int get_max_fds(void);
 int lookup_ip(const char *host_name, struct in_addr *address);
 int get_socket_error(int sock);
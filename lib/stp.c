@@ -53,7 +53,9 @@ const uint8_t stp_eth_addr[ETH_ADDR_LEN]
 
 #define STP_PROTOCOL_ID 0x0000
 #define STP_PROTOCOL_VERSION 0x00
+#define RSTP_PROTOCOL_VERSION 0x02
 #define STP_TYPE_CONFIG 0x00
+#define STP_TYPE_RST 0x02
 #define STP_TYPE_TCN 0x80
 
 struct stp_bpdu_header {
@@ -65,9 +67,20 @@ BUILD_ASSERT_DECL(sizeof(struct stp_bpdu_header) == 4);
 
 enum stp_config_bpdu_flags {
     STP_CONFIG_TOPOLOGY_CHANGE_ACK = 0x80,
+    STP_CONFIG_AGREEMENT = 0x40,        /* RSTP only. */
+    STP_CONFIG_FORWARDING = 0x20,       /* RSTP only. */
+    STP_CONFIG_LEARNING = 0x10,         /* RSTP only. */
+    STP_CONFIG_ROLE_MASK = 0x0c,        /* RSTP only: one of STP_BPDU_ROLE_*. */
+    STP_CONFIG_PROPOSAL = 0x02,         /* RSTP only. */
     STP_CONFIG_TOPOLOGY_CHANGE = 0x01
 };
 
+/* Port roles encoded in STP_CONFIG_ROLE_MASK (802.1D-2004 9.3.3). */
+#define STP_BPDU_ROLE_UNKNOWN   (0 << 2)
+#define STP_BPDU_ROLE_ALTERNATE (1 << 2) /* Alternate or backup. */
+#define STP_BPDU_ROLE_ROOT      (2 << 2)
+#define STP_BPDU_ROLE_DESIGNATED (3 << 2)
+
 struct stp_config_bpdu {
     struct stp_bpdu_header header; /* Type STP_TYPE_CONFIG. */
     uint8_t flags;                 /* STP_CONFIG_* flags. */
@@ -82,6 +95,12 @@ struct stp_config_bpdu {
 } __attribute__((packed));
 BUILD_ASSERT_DECL(sizeof(struct stp_config_bpdu) == 35);
 
+struct stp_rst_bpdu {
+    struct stp_config_bpdu config; /* Type STP_TYPE_RST. */
+    uint8_t version1_length;       /* Always 0. */
+} __attribute__((packed));
+BUILD_ASSERT_DECL(sizeof(struct stp_rst_bpdu) == 36);
+
 struct stp_tcn_bpdu {
     struct stp_bpdu_header header; /* Type STP_TYPE_TCN. */
 } __attribute__((packed));
@@ -109,6 +128,19 @@ struct stp_port {
     struct stp_timer forward_delay_timer; /* 8.5.6.2: State change timer. */
     struct stp_timer hold_timer;        /* 8.5.6.3: BPDU rate limit timer. */
 
+    /* RSTP only (802.1D-2004 17.19). */
+    bool admin_edge;                /* Configured as an edge port? */
+    bool oper_edge;                 /* Currently acting as an edge port? */
+    bool point_to_point;            /* Connected to at most one bridge? */
+    bool legacy;                    /* Peer only speaks 802.1D-1998 STP? */
+    bool rcvd_bpdu;                 /* Received any BPDU since enabled? */
+    bool proposing;                 /* Asking peer for rapid forwarding? */
+    bool agreed;                    /* Peer agreed to our proposal? */
+    bool agree;                     /* Send an agreement in next BPDU? */
+    int tx_count;                   /* BPDUs sent since hold timer started. */
+    int message_age;                /* Message age of last recorded BPDU. */
+    struct stp_timer edge_delay_timer; /* Time to wait for BPDUs from peer. */
+
     bool state_changed;
 };
 
@@ -126,6 +158,7 @@ struct stp {
     int rq_hello_time;              /* User-requested hello time, in ms. */
     int rq_forward_delay;           /* User-requested forward delay, in ms. */
     int elapsed_remainder;          /* Left-over msecs from last stp_tick(). */
+    bool rstp;                      /* Run RSTP instead of STP? */
 
     /* Dynamic bridge data. */
     stp_identifier designated_root; /* 8.5.3.1: Bridge believed to be root. */
@@ -165,6 +198,13 @@ stp_next_enabled_port(const struct stp *stp, const struct stp_port *port)
 
 #define MESSAGE_AGE_INCREMENT 1
 
+/* Maximum number of BPDUs that an RSTP port sends per second (17.13.12). */
+#define RSTP_TX_HOLD_COUNT 6
+
+/* Time, in ms, that an RSTP port waits for a BPDU from its peer before
+ * concluding that it is an edge port (17.13.9). */
+#define RSTP_MIGRATE_TIME 3000
+
 static void stp_transmit_config(struct stp_port *);
 static bool stp_supersedes_port_info(const struct stp_port *,
                                      const struct stp_config_bpdu *);
@@ -189,7 +229,8 @@ static void stp_topology_change_detection(struct stp *);
 static void stp_topology_change_acknowledged(struct stp *);
 static void stp_acknowledge_topology_change(struct stp_port *);
 static void stp_received_config_bpdu(struct stp *, struct stp_port *,
-                                     const struct stp_config_bpdu *);
+                                     const struct stp_config_bpdu *,
+                                     bool rst);
 static void stp_received_tcn_bpdu(struct stp *, struct stp_port *);
 static void stp_hello_timer_expiry(struct stp *);
 static void stp_message_age_timer_expiry(struct stp_port *);
@@ -198,6 +239,12 @@ static void stp_forward_delay_timer_expiry(struct stp_port *);
 static void stp_tcn_timer_expiry(struct stp *);
 static void stp_topology_change_timer_expiry(struct stp *);
 static void stp_hold_timer_expiry(struct stp_port *);
+static void stp_edge_delay_timer_expiry(struct stp_port *);
+static bool stp_port_is_rapid(const struct stp_port *);
+static int stp_port_max_age(const struct stp_port *);
+static int stp_topology_change_time(const struct stp *);
+static void stp_sync(struct stp *);
+static void stp_rapid_forwarding(struct stp_port *);
 static void stp_initialize_port(struct stp_port *, enum stp_state);
 static void stp_become_root_bridge(struct stp *);
 static void stp_update_bridge_timers(struct stp *);
@@ -264,6 +311,7 @@ stp_create(const char *name, stp_identifier bridge_id,
         p->stp = stp;
         p->port_id = (stp_port_no(p) + 1) | (STP_DEFAULT_PORT_PRIORITY << 8);
         p->path_cost = 19;      /* Recommended default for 100 Mb/s link. */
+        p->point_to_point = true;
         stp_initialize_port(p, STP_DISABLED);
     }
     return stp;
@@ -300,11 +348,12 @@ stp_tick(struct stp *stp, int ms)
         stp_tcn_timer_expiry(stp);
     }
     if (stp_timer_expired(&stp->topology_change_timer, elapsed,
-                          stp->max_age + stp->forward_delay)) {
+                          stp_topology_change_time(stp))) {
         stp_topology_change_timer_expiry(stp);
     }
     FOR_EACH_ENABLED_PORT (p, stp) {
-        if (stp_timer_expired(&p->message_age_timer, elapsed, stp->max_age)) {
+        if (stp_timer_expired(&p->message_age_timer, elapsed,
+                              stp_port_max_age(p))) {
             stp_message_age_timer_expiry(p);
         }
     }
@@ -316,6 +365,10 @@ stp_tick(struct stp *stp, int ms)
         if (stp_timer_expired(&p->hold_timer, elapsed, ms_to_timer(1000))) {
             stp_hold_timer_expiry(p);
         }
+        if (stp_timer_expired(&p->edge_delay_timer, elapsed,
+                              ms_to_timer(RSTP_MIGRATE_TIME))) {
+            stp_edge_delay_timer_expiry(p);
+        }
     }
 }
 
@@ -391,6 +444,33 @@ stp_set_forward_delay(struct stp *stp, int ms)
     stp_update_bridge_timers(stp);
 }
 
+/* Enables RSTP on 'stp' if 'rstp' is true, otherwise reverts it to plain
+ * 802.1D-1998 STP.  Changing the protocol reinitializes every enabled port
+ * (to the blocking state), as if it had been disabled and enabled again.
+ *
+ * An RSTP bridge falls back to STP on any port where it receives an STP
+ * BPDU, so it interoperates with STP-only neighbors. */
+void
+stp_set_rstp(struct stp *stp, bool rstp)
+{
+    struct stp_port *p;
+
+    if (stp->rstp == rstp) {
+        return;
+    }
+    stp->rstp = rstp;
+    FOR_EACH_ENABLED_PORT (p, stp) {
+        stp_initialize_port(p, STP_BLOCKING);
+    }
+    stp_configuration_update(stp);
+    stp_port_state_selection(stp);
+    if (rstp || stp_is_root_bridge(stp)) {
+        stp_start_timer(&stp->hello_timer, 0);
+    } else {
+        stp_stop_timer(&stp->hello_timer);
+    }
+}
+
 /* Returns the name given to 'stp' in the call to stp_create(). */
 const char *
 stp_get_name(const struct stp *stp)
@@ -456,6 +536,13 @@ stp_get_forward_delay(const struct stp *stp)
     return timer_to_ms(stp->bridge_forward_delay);
 }
 
+/* Returns true if 'stp' runs RSTP, false if it runs plain STP. */
+bool
+stp_is_rstp(const struct stp *stp)
+{
+    return stp->rstp;
+}
+
 /* Returns the port in 'stp' with index 'port_no', which must be between 0 and
  * STP_MAX_PORTS. */
 struct stp_port *
@@ -538,6 +625,27 @@ stp_learn_in_state(enum stp_state state)
     return (state & (STP_DISABLED | STP_LEARNING | STP_FORWARDING)) != 0;
 }
 
+/* Returns the name for the given 'role' (for use in debugging and log
+ * messages). */
+const char *
+stp_role_name(enum stp_role role)
+{
+    switch (role) {
+    case STP_ROLE_DISABLED:
+        return "disabled";
+    case STP_ROLE_ROOT:
+        return "root";
+    case STP_ROLE_DESIGNATED:
+        return "designated";
+    case STP_ROLE_ALTERNATE:
+        return "alternate";
+    case STP_ROLE_BACKUP:
+        return "backup";
+    default:
+        NOT_REACHED();
+    }
+}
+
 /* Notifies the STP entity that bridge protocol data unit 'bpdu', which is
  * 'bpdu_size' bytes in length, was received on port 'p'.
  *
@@ -563,11 +671,18 @@ stp_received_bpdu(struct stp_port *p, const void *bpdu, size_t bpdu_size)
                   stp->name, ntohs(header->protocol_id));
         return;
     }
-    if (header->protocol_version != STP_PROTOCOL_VERSION) {
+    if (header->protocol_version != STP_PROTOCOL_VERSION
+        && header->bpdu_type != STP_TYPE_RST) {
         VLOG_DBG("%s: received BPDU with unexpected protocol version %"PRIu8,
                  stp->name, header->protocol_version);
     }
 
+    /* Any BPDU shows that there is a bridge on the other end of the link, so
+     * the port cannot be an edge port (17.13.2). */
+    p->rcvd_bpdu = true;
+    p->oper_edge = false;
+    stp_stop_timer(&p->edge_delay_timer);
+
     switch (header->bpdu_type) {
     case STP_TYPE_CONFIG:
         if (bpdu_size < sizeof(struct stp_config_bpdu)) {
@@ -575,7 +690,23 @@ stp_received_bpdu(struct stp_port *p, const void *bpdu, size_t bpdu_size)
                       stp->name, bpdu_size);
             return;
         }
-        stp_received_config_bpdu(stp, p, bpdu);
+        if (stp->rstp && !p->legacy) {
+            VLOG_INFO("%s: port %d: STP bridge detected, falling back to STP",
+                      stp->name, stp_port_no(p));
+            p->legacy = true;
+            p->proposing = false;
+        }
+        stp_received_config_bpdu(stp, p, bpdu, false);
+        break;
+
+    case STP_TYPE_RST:
+        /* An STP bridge treats an RST BPDU as a config BPDU (17.4). */
+        if (bpdu_size < sizeof(struct stp_rst_bpdu)) {
+            VLOG_WARN("%s: received RST BPDU with invalid size %zu",
+                      stp->name, bpdu_size);
+            return;
+        }
+        stp_received_config_bpdu(stp, p, bpdu, stp->rstp);
         break;
 
     case STP_TYPE_TCN:
@@ -584,6 +715,10 @@ stp_received_bpdu(struct stp_port *p, const void *bpdu, size_t bpdu_size)
                       stp->name, bpdu_size);
             return;
         }
+        if (stp->rstp) {
+            p->legacy = true;
+            p->proposing = false;
+        }
         stp_received_tcn_bpdu(stp, p);
         break;
 
@@ -617,6 +752,25 @@ stp_port_get_state(const struct stp_port *p)
     return p->state;
 }
 
+/* Returns the role of port 'p'. */
+enum stp_role
+stp_port_get_role(const struct stp_port *p)
+{
+    const struct stp *stp = p->stp;
+
+    if (p->state == STP_DISABLED) {
+        return STP_ROLE_DISABLED;
+    } else if (p == stp->root_port) {
+        return STP_ROLE_ROOT;
+    } else if (stp_is_designated_port(p)) {
+        return STP_ROLE_DESIGNATED;
+    } else if (p->designated_bridge == stp->bridge_id) {
+        return STP_ROLE_BACKUP;
+    } else {
+        return STP_ROLE_ALTERNATE;
+    }
+}
+
 /* Disables STP on port 'p'. */
 void
 stp_port_disable(struct stp_port *p)
@@ -708,48 +862,160 @@ stp_port_disable_change_detection(struct stp_port *p)
 {
     p->change_detection_enabled = false;
 }
+
+/* Configures whether port 'p' is an edge port, that is, one that connects
+ * only to end hosts.  Under RSTP, an edge port goes directly to the
+ * forwarding state when it is enabled.  It loses its edge status if it
+ * receives a BPDU.
+ *
+ * An RSTP port that is not configured as an edge port still becomes one if it
+ * receives no BPDU within a few seconds of being enabled. */
+void
+stp_port_set_edge(struct stp_port *p, bool edge)
+{
+    p->admin_edge = p->oper_edge = edge;
+    if (p->state != STP_DISABLED) {
+        stp_port_state_selection(p->stp);
+    }
+}
+
+/* Returns true if port 'p' is currently acting as an edge port. */
+bool
+stp_port_is_edge(const struct stp_port *p)
+{
+    return p->oper_edge;
+}
+
+/* Configures whether port 'p' connects to at most one other bridge (e.g. a
+ * full-duplex link).  RSTP uses the proposal/agreement handshake only on
+ * point-to-point links; shared media fall back to the forward delay timer.
+ * Ports are assumed to be point-to-point by default. */
+void
+stp_port_set_point_to_point(struct stp_port *p, bool point_to_point)
+{
+    p->point_to_point = point_to_point;
+    if (!point_to_point) {
+        p->proposing = false;
+    }
+}
+
+/* Returns true if 'p' uses RSTP, that is, if its bridge runs RSTP and no STP
+ * bridge has been detected on the other end. */
+static bool
+stp_port_is_rapid(const struct stp_port *p)
+{
+    return p->stp->rstp && !p->legacy;
+}
+
+/* Returns the age at which information received on 'p' expires.  RSTP ages
+ * out information after missing three hellos (17.21.23), instead of waiting
+ * for max age. */
+static int
+stp_port_max_age(const struct stp_port *p)
+{
+    const struct stp *stp = p->stp;
+    return (stp_port_is_rapid(p)
+            ? MIN(stp->max_age, p->message_age + 3 * stp->hello_time)
+            : stp->max_age);
+}
+
+/* Returns the time for which a topology change is signaled in BPDUs. */
+static int
+stp_topology_change_time(const struct stp *stp)
+{
+    return (stp->rstp
+            ? 2 * stp->hello_time
+            : stp->max_age + stp->forward_delay);
+}
+
+/* Returns the RSTP-specific flags to include in an RST BPDU sent on 'p'. */
+static uint8_t
+stp_rst_flags(const struct stp_port *p)
+{
+    uint8_t flags = 0;
+
+    switch (stp_port_get_role(p)) {
+    case STP_ROLE_ROOT:
+        flags |= STP_BPDU_ROLE_ROOT;
+        break;
+    case STP_ROLE_DESIGNATED:
+        flags |= STP_BPDU_ROLE_DESIGNATED;
+        break;
+    case STP_ROLE_ALTERNATE:
+    case STP_ROLE_BACKUP:
+        flags |= STP_BPDU_ROLE_ALTERNATE;
+        break;
+    case STP_ROLE_DISABLED:
+        break;
+    }
+    if (p->proposing) {
+        flags |= STP_CONFIG_PROPOSAL;
+    }
+    if (p->agree) {
+        flags |= STP_CONFIG_AGREEMENT;
+    }
+    if (p->state & (STP_LEARNING | STP_FORWARDING)) {
+        flags |= STP_CONFIG_LEARNING;
+    }
+    if (p->state & STP_FORWARDING) {
+        flags |= STP_CONFIG_FORWARDING;
+    }
+    return flags;
+}
 
 static void
 stp_transmit_config(struct stp_port *p)
 {
     struct stp *stp = p->stp;
     bool root = stp_is_root_bridge(stp);
+    bool rapid = stp_port_is_rapid(p);
     if (!root && !stp->root_port) {
         return;
     }
-    if (p->hold_timer.active) {
+    if (rapid ? p->tx_count >= RSTP_TX_HOLD_COUNT : p->hold_timer.active) {
         p->config_pending = true;
     } else {
-        struct stp_config_bpdu config;
-        memset(&config, 0, sizeof config);
-        config.header.protocol_id = htons(STP_PROTOCOL_ID);
-        config.header.protocol_version = STP_PROTOCOL_VERSION;
-        config.header.bpdu_type = STP_TYPE_CONFIG;
-        config.flags = 0;
+        struct stp_rst_bpdu bpdu;
+        struct stp_config_bpdu *config = &bpdu.config;
+        memset(&bpdu, 0, sizeof bpdu);
+        config->header.protocol_id = htons(STP_PROTOCOL_ID);
+        config->header.protocol_version = STP_PROTOCOL_VERSION;
+        config->header.bpdu_type = STP_TYPE_CONFIG;
+        config->flags = 0;
         if (p->topology_change_ack) {
-            config.flags |= htons(STP_CONFIG_TOPOLOGY_CHANGE_ACK);
+            config->flags |= STP_CONFIG_TOPOLOGY_CHANGE_ACK;
         }
         if (stp->topology_change) {
-            config.flags |= htons(STP_CONFIG_TOPOLOGY_CHANGE);
+            config->flags |= STP_CONFIG_TOPOLOGY_CHANGE;
+        }
+        if (rapid) {
+            config->header.protocol_version = RSTP_PROTOCOL_VERSION;
+            config->header.bpdu_type = STP_TYPE_RST;
+            config->flags |= stp_rst_flags(p);
         }
-        config.root_id = htonll(stp->designated_root);
-        config.root_path_cost = htonl(stp->root_path_cost);
-        config.bridge_id = htonll(stp->bridge_id);
-        config.port_id = htons(p->port_id);
+        config->root_id = htonll(stp->designated_root);
+        config->root_path_cost = htonl(stp->root_path_cost);
+        config->bridge_id = htonll(stp->bridge_id);
+        config->port_id = htons(p->port_id);
         if (root) {
-            config.message_age = htons(0);
+            config->message_age = htons(0);
         } else {
-            config.message_age = htons(stp->root_port->message_age_timer.value
-                                       + MESSAGE_AGE_INCREMENT);
+            config->message_age = htons(stp->root_port->message_age_timer.value
+                                        + MESSAGE_AGE_INCREMENT);
         }
-        config.max_age = htons(stp->max_age);
-        config.hello_time = htons(stp->hello_time);
-        config.forward_delay = htons(stp->forward_delay);
-        if (ntohs(config.message_age) < stp->max_age) {
+        config->max_age = htons(stp->max_age);
+        config->hello_time = htons(stp->hello_time);
+        config->forward_delay = htons(stp->forward_delay);
+        if (ntohs(config->message_age) < stp->max_age) {
             p->topology_change_ack = false;
             p->config_pending = false;
-            stp_send_bpdu(p, &config, sizeof config);
-            stp_start_timer(&p->hold_timer, 0);
+            p->agree = false;
+            stp_send_bpdu(p, &bpdu, rapid ? sizeof bpdu : sizeof *config);
+            if (!rapid) {
+                stp_start_timer(&p->hold_timer, 0);
+            } else if (!p->tx_count++) {
+                stp_start_timer(&p->hold_timer, 0);
+            }
         }
     }
 }
@@ -758,7 +1024,16 @@ static bool
 stp_supersedes_port_info(const struct stp_port *p,
                          const struct stp_config_bpdu *config)
 {
-    if (ntohll(config->root_id) != p->designated_root) {
+    if (p->stp->rstp
+        && p->designated_bridge != p->stp->bridge_id
+        && ntohll(config->bridge_id) == p->designated_bridge
+        && ntohs(config->port_id) == p->designated_port) {
+        /* RSTP accepts even inferior information from the designated bridge
+         * and port already recorded, so that the loss of a path to the root
+         * propagates at once instead of waiting for it to age out
+         * (17.21.8). */
+        return true;
+    } else if (ntohll(config->root_id) != p->designated_root) {
         return ntohll(config->root_id) < p->designated_root;
     } else if (ntohl(config->root_path_cost) != p->designated_cost) {
         return ntohl(config->root_path_cost) < p->designated_cost;
@@ -778,6 +1053,7 @@ stp_record_config_information(struct stp_port *p,
     p->designated_cost = ntohl(config->root_path_cost);
     p->designated_bridge = ntohll(config->bridge_id);
     p->designated_port = ntohs(config->port_id);
+    p->message_age = ntohs(config->message_age);
     stp_start_timer(&p->message_age_timer, ntohs(config->message_age));
 }
 
@@ -788,7 +1064,7 @@ stp_record_config_timeout_values(struct stp *stp,
     stp->max_age = ntohs(config->max_age);
     stp->hello_time = ntohs(config->hello_time);
     stp->forward_delay = ntohs(config->forward_delay);
-    stp->topology_change = config->flags & htons(STP_CONFIG_TOPOLOGY_CHANGE);
+    stp->topology_change = (config->flags & STP_CONFIG_TOPOLOGY_CHANGE) != 0;
 }
 
 static bool
@@ -899,6 +1175,11 @@ static void
 stp_become_designated_port(struct stp_port *p)
 {
     struct stp *stp = p->stp;
+    if (p->designated_root != stp->designated_root
+        || p->designated_cost != stp->root_path_cost) {
+        /* The peer agreed to different information. */
+        p->agreed = false;
+    }
     p->designated_root = stp->designated_root;
     p->designated_cost = stp->root_path_cost;
     p->designated_bridge = stp->bridge_id;
@@ -929,18 +1210,39 @@ stp_port_state_selection(struct stp *stp)
 static void
 stp_make_forwarding(struct stp_port *p)
 {
-    if (p->state == STP_BLOCKING) {
-        stp_set_port_state(p, STP_LISTENING);
+    struct stp *stp = p->stp;
+
+    if (!stp->rstp) {
+        if (p->state == STP_BLOCKING) {
+            stp_set_port_state(p, STP_LISTENING);
+            stp_start_timer(&p->forward_delay_timer, 0);
+        }
+    } else if (p->oper_edge || p == stp->root_port) {
+        /* Edge ports cannot form loops, and the other ports have been synced
+         * before a new root port is selected (17.29.2, 17.29.3). */
+        stp_rapid_forwarding(p);
+    } else if (p->state == STP_BLOCKING && !p->forward_delay_timer.active) {
+        /* RSTP has no listening state.  A discarding designated port asks its
+         * peer for permission to forward, falling back to the forward delay
+         * timer if the peer does not agree (17.29.3). */
         stp_start_timer(&p->forward_delay_timer, 0);
+        p->proposing = stp_port_is_rapid(p) && p->point_to_point;
+        if (p->proposing) {
+            stp_transmit_config(p);
+        }
     }
 }
 
 static void
 stp_make_blocking(struct stp_port *p)
 {
+    p->proposing = false;
+    p->agreed = false;
     if (!(p->state & (STP_DISABLED | STP_BLOCKING))) {
         if (p->state & (STP_FORWARDING | STP_LEARNING)) {
-            if (p->change_detection_enabled) {
+            /* RSTP only signals topology changes when ports start
+             * forwarding (17.29.5). */
+            if (p->change_detection_enabled && !p->stp->rstp) {
                 stp_topology_change_detection(p->stp);
             }
         }
@@ -949,6 +1251,42 @@ stp_make_blocking(struct stp_port *p)
     }
 }
 
+/* Puts 'p' into the forwarding state at once, as RSTP allows for edge ports,
+ * root ports, and designated ports whose peer agreed to our proposal. */
+static void
+stp_rapid_forwarding(struct stp_port *p)
+{
+    stp_stop_timer(&p->forward_delay_timer);
+    p->proposing = false;
+    if (p->state != STP_FORWARDING) {
+        stp_set_port_state(p, STP_FORWARDING);
+        if (!p->oper_edge && p->change_detection_enabled) {
+            stp_topology_change_detection(p->stp);
+        }
+    }
+}
+
+/* Puts every designated port that might form a loop with a new root port into
+ * the discarding state, so that the root port may start forwarding at once.
+ * Edge ports and ports whose peer has agreed to the current information are
+ * already in sync (17.29.2). */
+static void
+stp_sync(struct stp *stp)
+{
+    struct stp_port *p;
+
+    FOR_EACH_ENABLED_PORT (p, stp) {
+        if (p != stp->root_port
+            && stp_is_designated_port(p)
+            && !p->oper_edge
+            && !p->agreed
+            && p->state & (STP_LEARNING | STP_FORWARDING)) {
+            stp_set_port_state(p, STP_BLOCKING);
+            stp_stop_timer(&p->forward_delay_timer);
+        }
+    }
+}
+
 static void
 stp_set_port_state(struct stp_port *p, enum stp_state state)
 {
@@ -964,7 +1302,18 @@ stp_set_port_state(struct stp_port *p, enum stp_state state)
 static void
 stp_topology_change_detection(struct stp *stp)
 {
-    if (stp_is_root_bridge(stp)) {
+    if (stp->rstp && (stp_is_root_bridge(stp) || !stp->root_port->legacy)) {
+        /* RSTP floods the change toward the root and away from it at once,
+         * using the topology change flag in ordinary BPDUs (17.29.6). */
+        if (!stp->topology_change) {
+            stp->topology_change = true;
+            stp_start_timer(&stp->topology_change_timer, 0);
+            if (stp->root_port) {
+                stp_transmit_config(stp->root_port);
+            }
+            stp_config_bpdu_generation(stp);
+        }
+    } else if (stp_is_root_bridge(stp)) {
         stp->topology_change = true;
         stp_start_timer(&stp->topology_change_timer, 0);
     } else if (!stp->topology_change_detected) {
@@ -988,9 +1337,11 @@ stp_acknowledge_topology_change(struct stp_port *p)
     stp_transmit_config(p);
 }
 
+/* Processes 'config', received on 'p'.  If 'rst' is true, 'config' is the
+ * beginning of an RST BPDU from an RSTP peer, so its RSTP flags are valid. */
 void
 stp_received_config_bpdu(struct stp *stp, struct stp_port *p,
-                         const struct stp_config_bpdu *config)
+                         const struct stp_config_bpdu *config, bool rst)
 {
     if (ntohs(config->message_age) >= ntohs(config->max_age)) {
         VLOG_WARN("%s: received config BPDU with message age (%u) greater "
@@ -1001,11 +1352,21 @@ stp_received_config_bpdu(struct stp *stp, struct stp_port *p,
     }
     if (p->state != STP_DISABLED) {
         bool root = stp_is_root_bridge(stp);
+        uint8_t role = config->flags & STP_CONFIG_ROLE_MASK;
+        bool tc = rst && config->flags & STP_CONFIG_TOPOLOGY_CHANGE;
+        bool proposal = (rst && config->flags & STP_CONFIG_PROPOSAL
+                         && p->point_to_point);
+
         if (stp_supersedes_port_info(p, config)) {
             stp_record_config_information(p, config);
             stp_configuration_update(stp);
+            if (proposal && p == stp->root_port) {
+                /* Our root port may forward as soon as no other port can form
+                 * a loop, and then the peer may forward too. */
+                stp_sync(stp);
+            }
             stp_port_state_selection(stp);
-            if (!stp_is_root_bridge(stp) && root) {
+            if (!stp_is_root_bridge(stp) && root && !stp->rstp) {
                 stp_stop_timer(&stp->hello_timer);
                 if (stp->topology_change_detected) {
                     stp_stop_timer(&stp->topology_change_timer);
@@ -1016,12 +1377,38 @@ stp_received_config_bpdu(struct stp *stp, struct stp_port *p,
             if (p == stp->root_port) {
                 stp_record_config_timeout_values(stp, config);
                 stp_config_bpdu_generation(stp);
-                if (config->flags & htons(STP_CONFIG_TOPOLOGY_CHANGE_ACK)) {
+                if (config->flags & STP_CONFIG_TOPOLOGY_CHANGE_ACK) {
                     stp_topology_change_acknowledged(stp);
                 }
+            } else if (stp->rstp) {
+                /* Tell our neighbors about new information at once, instead
+                 * of waiting for the next hello from the root. */
+                stp_config_bpdu_generation(stp);
+            }
+            if (proposal && !stp_is_designated_port(p)) {
+                /* A root port is in sync now, and an alternate or backup port
+                 * is always in sync because it is discarding. */
+                p->agree = true;
+                stp_transmit_config(p);
             }
         } else if (stp_is_designated_port(p)) {
-            stp_transmit_config(p);
+            if (rst && (role == STP_BPDU_ROLE_ROOT
+                        || role == STP_BPDU_ROLE_ALTERNATE)) {
+                /* The peer is not competing to be designated, so there is no
+                 * need to reply.  It may be agreeing to our proposal. */
+                if (config->flags & STP_CONFIG_AGREEMENT
+                    && p->proposing
+                    && ntohll(config->root_id) == stp->designated_root) {
+                    p->agreed = true;
+                    stp_rapid_forwarding(p);
+                }
+            } else {
+                stp_transmit_config(p);
+            }
+        }
+
+        if (tc && !stp->topology_change) {
+            stp_topology_change_detection(stp);
         }
     }
 }
@@ -1079,12 +1466,16 @@ stp_is_designated_for_some_port(const struct stp *stp)
 static void
 stp_forward_delay_timer_expiry(struct stp_port *p)
 {
-    if (p->state == STP_LISTENING) {
+    if (p->state == STP_LISTENING
+        || (p->state == STP_BLOCKING && p->stp->rstp)) {
         stp_set_port_state(p, STP_LEARNING);
         stp_start_timer(&p->forward_delay_timer, 0);
     } else if (p->state == STP_LEARNING) {
+        p->proposing = false;
         stp_set_port_state(p, STP_FORWARDING);
-        if (stp_is_designated_for_some_port(p->stp)) {
+        if (p->stp->rstp
+            ? !p->oper_edge
+            : stp_is_designated_for_some_port(p->stp)) {
             if (p->change_detection_enabled) {
                 stp_topology_change_detection(p->stp);
             }
@@ -1109,11 +1500,23 @@ stp_topology_change_timer_expiry(struct stp *stp)
 static void
 stp_hold_timer_expiry(struct stp_port *p)
 {
+    p->tx_count = 0;
     if (p->config_pending) {
         stp_transmit_config(p);
     }
 }
 
+/* Makes 'p' an edge port if it has heard nothing from a bridge since it was
+ * enabled (17.25). */
+static void
+stp_edge_delay_timer_expiry(struct stp_port *p)
+{
+    if (p->stp->rstp && !p->rcvd_bpdu && stp_is_designated_port(p)) {
+        p->oper_edge = true;
+        stp_rapid_forwarding(p);
+    }
+}
+
 static void
 stp_initialize_port(struct stp_port *p, enum stp_state state)
 {
@@ -1123,9 +1526,22 @@ stp_initialize_port(struct stp_port *p, enum stp_state state)
     p->topology_change_ack = false;
     p->config_pending = false;
     p->change_detection_enabled = true;
+    p->oper_edge = p->admin_edge;
+    p->legacy = false;
+    p->rcvd_bpdu = false;
+    p->proposing = false;
+    p->agreed = false;
+    p->agree = false;
+    p->tx_count = 0;
+    p->message_age = 0;
     stp_stop_timer(&p->message_age_timer);
     stp_stop_timer(&p->forward_delay_timer);
     stp_stop_timer(&p->hold_timer);
+    if (state == STP_BLOCKING) {
+        stp_start_timer(&p->edge_delay_timer, 0);
+    } else {
+        stp_stop_timer(&p->edge_delay_timer);
+    }
 }
 
 static void
@@ -1179,7 +1595,7 @@ ms_to_timer(int ms)
 static int
 ms_to_timer_remainder(int ms)
 {
-    return ms * 0x100 % 1000;
+    return ms * 0x100 % 1000 / 0x100;
 }
 
 /* Returns the number of whole milliseconds in 'timer' STP timer ticks.  There
@@ -35,7 +35,13 @@
 #define STP_H 1
 
 /* This is an implementation of Spanning Tree Protocol as described in IEEE
- * 802.1D-1998, clauses 8 and 9.  Section numbers refer to this standard.  */
+ * 802.1D-1998, clauses 8 and 9.  Section numbers refer to this standard.
+ *
+ * A bridge may optionally run Rapid Spanning Tree Protocol, as described in
+ * IEEE 802.1w (now 802.1D-2004, clause 17), by calling stp_set_rstp().  RSTP
+ * uses the same port states as STP, but ports reach the forwarding state
+ * through a proposal/agreement handshake with the neighboring bridge instead
+ * of waiting for the forward delay timer to expire twice. */
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -73,6 +79,7 @@ void stp_set_bridge_priority(struct stp *, uint16_t new_priority);
 void stp_set_hello_time(struct stp *, int ms);
 void stp_set_max_age(struct stp *, int ms);
 void stp_set_forward_delay(struct stp *, int ms);
+void stp_set_rstp(struct stp *, bool rstp);
 
 /* STP properties. */
 const char *stp_get_name(const struct stp *);
@@ -83,6 +90,7 @@ int stp_get_root_path_cost(const struct stp *);
 int stp_get_hello_time(const struct stp *);
 int stp_get_max_age(const struct stp *);
 int stp_get_forward_delay(const struct stp *);
+bool stp_is_rstp(const struct stp *);
 
 /* Obtaining STP ports. */
 struct stp_port *stp_get_port(struct stp *, int port_no);
@@ -104,11 +112,24 @@ const char *stp_state_name(enum stp_state);
 bool stp_forward_in_state(enum stp_state);
 bool stp_learn_in_state(enum stp_state);
 
+/* Role of an STP port, as defined by RSTP (802.1D-2004 17.7).  Roles are
+ * derived from the spanning tree computation, so they are meaningful for
+ * plain STP bridges too. */
+enum stp_role {
+    STP_ROLE_DISABLED,          /* Port is disabled. */
+    STP_ROLE_ROOT,              /* Best path toward the root bridge. */
+    STP_ROLE_DESIGNATED,        /* Best path from a LAN toward the root. */
+    STP_ROLE_ALTERNATE,         /* Blocked, alternate path toward the root. */
+    STP_ROLE_BACKUP             /* Blocked, redundant path to a LAN. */
+};
+const char *stp_role_name(enum stp_role);
+
 void stp_received_bpdu(struct stp_port *, const void *bpdu, size_t bpdu_size);
 
 struct stp *stp_port_get_stp(struct stp_port *);
 int stp_port_no(const struct stp_port *);
 enum stp_state stp_port_get_state(const struct stp_port *);
+enum stp_role stp_port_get_role(const struct stp_port *);
 void stp_port_enable(struct stp_port *);
 void stp_port_disable(struct stp_port *);
 void stp_port_set_priority(struct stp_port *, uint8_t new_priority);
@@ -116,5 +137,8 @@ void stp_port_set_path_cost(struct stp_port *, uint16_t path_cost);
 void stp_port_set_speed(struct stp_port *, unsigned int speed);
 void stp_port_enable_change_detection(struct stp_port *);
 void stp_port_disable_change_detection(struct stp_port *);
+void stp_port_set_edge(struct stp_port *, bool edge);
+bool stp_port_is_edge(const struct stp_port *);
+void stp_port_set_point_to_point(struct stp_port *, bool point_to_point);
 
 #endif /* stp.h */
@@ -119,6 +119,18 @@ time_msec(void)
     return (long long int) now.tv_sec * 1000 + now.tv_usec / 1000;
 }
 
+/* Returns the current time, in microseconds.  Unlike time_now() and
+ * time_msec(), this always reads the time from the kernel, so it is suitable
+ * for measuring short intervals. */
+long long int
+time_usec(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (long long int) tv.tv_sec * 1000 * 1000 + tv.tv_usec;
+}
+
 /* Configures the program to die with SIGALRM 'secs' seconds from now, if
  * 'secs' is nonzero, or disables the feature if 'secs' is zero. */
 void
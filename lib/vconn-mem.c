@@ -0,0 +1,285 @@
+/* Copyright (c) 2008, 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "vconn.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+#include "ofpbuf.h"
+#include "poll-loop.h"
+#include "queue.h"
+#include "util.h"
+#include "vconn-provider.h"
+
+#include "vlog.h"
+#define THIS_MODULE VLM_vconn_mem
+
+/* In-process vconns.
+ *
+ * "pmem:NAME" listens for connections from within the same process and
+ * "mem:NAME" connects to it.  A message sent on one end of a connection is
+ * handed to the other end as the same ofpbuf, without being copied or passing
+ * through the kernel.  Both ends must be driven by the same poll loop. */
+
+/* Maximum number of messages waiting to be received on one end.  Sending on
+ * the other end fails with EAGAIN beyond this. */
+#define MEM_RXQ_MAX 256
+
+struct mem_vconn {
+    struct vconn vconn;
+    struct mem_vconn *peer;     /* Other end, or null if it has been closed. */
+    struct ofp_queue rxq;       /* Messages sent by 'peer', not yet received. */
+    struct list node;           /* In a mem_pvconn's 'pending' list, until
+                                 * accepted. */
+};
+
+struct mem_pvconn {
+    struct pvconn pvconn;
+    struct list node;           /* In 'mem_pvconns'. */
+    char *suffix;               /* NAME in "pmem:NAME". */
+    struct list pending;        /* Contains "struct mem_vconn"s. */
+};
+
+/* All open mem_pvconns. */
+static struct list mem_pvconns = LIST_INITIALIZER(&mem_pvconns);
+
+static struct mem_vconn *
+mem_vconn_cast(struct vconn *vconn)
+{
+    vconn_assert_class(vconn, &mem_vconn_class);
+    return CONTAINER_OF(vconn, struct mem_vconn, vconn);
+}
+
+static struct mem_vconn *
+mem_vconn_create(const char *name)
+{
+    struct mem_vconn *m = xmalloc(sizeof *m);
+    vconn_init(&m->vconn, &mem_vconn_class, 0, 0, name, false);
+    m->peer = NULL;
+    queue_init(&m->rxq);
+    list_init(&m->node);
+    return m;
+}
+
+/* Disconnects 'm' from its peer and frees its queued messages, but does not
+ * free 'm' itself. */
+static void
+mem_vconn_disconnect(struct mem_vconn *m)
+{
+    if (m->peer) {
+        m->peer->peer = NULL;
+        m->peer = NULL;
+    }
+    queue_destroy(&m->rxq);
+}
+
+static int
+mem_open(const char *name, char *suffix, struct vconn **vconnp)
+{
+    struct mem_pvconn *mp;
+
+    LIST_FOR_EACH (mp, struct mem_pvconn, node, &mem_pvconns) {
+        if (!strcmp(mp->suffix, suffix)) {
+            struct mem_vconn *client = mem_vconn_create(name);
+            struct mem_vconn *server = mem_vconn_create(name);
+
+            client->peer = server;
+            server->peer = client;
+            list_push_back(&mp->pending, &server->node);
+            *vconnp = &client->vconn;
+            return 0;
+        }
+    }
+    return ECONNREFUSED;
+}
+
+static void
+mem_close(struct vconn *vconn)
+{
+    struct mem_vconn *m = mem_vconn_cast(vconn);
+    mem_vconn_disconnect(m);
+    free(m);
+}
+
+static int
+mem_connect(struct vconn *vconn UNUSED)
+{
+    return 0;
+}
+
+static int
+mem_recv(struct vconn *vconn, struct ofpbuf **bufferp)
+{
+    struct mem_vconn *m = mem_vconn_cast(vconn);
+
+    if (m->rxq.n) {
+        *bufferp = queue_pop_head(&m->rxq);
+        return 0;
+    }
+    return m->peer ? EAGAIN : EOF;
+}
+
+static int
+mem_send(struct vconn *vconn, struct ofpbuf *buffer)
+{
+    struct mem_vconn *m = mem_vconn_cast(vconn);
+
+    if (!m->peer) {
+        return EPIPE;
+    } else if (m->peer->rxq.n >= MEM_RXQ_MAX) {
+        return EAGAIN;
+    }
+    queue_push_tail(&m->peer->rxq, buffer);
+    return 0;
+}
+
+static void
+mem_wait(struct vconn *vconn, enum vconn_wait_type wait)
+{
+    struct mem_vconn *m = mem_vconn_cast(vconn);
+
+    switch (wait) {
+    case WAIT_CONNECT:
+        poll_immediate_wake();
+        break;
+
+    case WAIT_SEND:
+        if (!m->peer || m->peer->rxq.n < MEM_RXQ_MAX) {
+            poll_immediate_wake();
+        } else {
+            /* The peer will wake up to receive, and then we can retry. */
+        }
+        break;
+
+    case WAIT_RECV:
+        if (m->rxq.n || !m->peer) {
+            poll_immediate_wake();
+        }
+        break;
+
+    default:
+        NOT_REACHED();
+    }
+}
+
+struct vconn_class mem_vconn_class = {
+    "mem",                      /* name */
+    mem_open,                   /* open */
+    mem_close,                  /* close */
+    mem_connect,                /* connect */
+    mem_recv,                   /* recv */
+    mem_send,                   /* send */
+    mem_wait,                   /* wait */
+};
+
+/* Passive in-process vconn. */
+
+static struct mem_pvconn *
+mem_pvconn_cast(struct pvconn *pvconn)
+{
+    pvconn_assert_class(pvconn, &pmem_pvconn_class);
+    return CONTAINER_OF(pvconn, struct mem_pvconn, pvconn);
+}
+
+static int
+pmem_listen(const char *name, char *suffix, struct pvconn **pvconnp)
+{
+    struct mem_pvconn *mp;
+
+    LIST_FOR_EACH (mp, struct mem_pvconn, node, &mem_pvconns) {
+        if (!strcmp(mp->suffix, suffix)) {
+            VLOG_ERR("%s: already listening", name);
+            return EADDRINUSE;
+        }
+    }
+
+    mp = xmalloc(sizeof *mp);
+    pvconn_init(&mp->pvconn, &pmem_pvconn_class, name);
+    mp->suffix = xstrdup(suffix);
+    list_init(&mp->pending);
+    list_push_back(&mem_pvconns, &mp->node);
+    *pvconnp = &mp->pvconn;
+    return 0;
+}
+
+static void
+pmem_close(struct pvconn *pvconn)
+{
+    struct mem_pvconn *mp = mem_pvconn_cast(pvconn);
+    struct mem_vconn *m, *next;
+
+    LIST_FOR_EACH_SAFE (m, next, struct mem_vconn, node, &mp->pending) {
+        mem_vconn_disconnect(m);
+        free(m->vconn.name);
+        free(m);
+    }
+    list_remove(&mp->node);
+    free(mp->suffix);
+    free(mp);
+}
+
+static int
+pmem_accept(struct pvconn *pvconn, struct vconn **new_vconnp)
+{
+    struct mem_pvconn *mp = mem_pvconn_cast(pvconn);
+    struct mem_vconn *m;
+
+    if (list_is_empty(&mp->pending)) {
+        return EAGAIN;
+    }
+    m = CONTAINER_OF(list_pop_front(&mp->pending), struct mem_vconn, node);
+    list_init(&m->node);
+    *new_vconnp = &m->vconn;
+    return 0;
+}
+
+static void
+pmem_wait(struct pvconn *pvconn)
+{
+    struct mem_pvconn *mp = mem_pvconn_cast(pvconn);
+    if (!list_is_empty(&mp->pending)) {
+        poll_immediate_wake();
+    }
+}
+
+struct pvconn_class pmem_pvconn_class = {
+    "pmem",                     /* name */
+    pmem_listen,                /* listen */
+    pmem_close,                 /* close */
+    pmem_accept,                /* accept */
+    pmem_wait,                  /* wait */
+    NULL,                       /* take_over */
+};
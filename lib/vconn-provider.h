@@ -137,6 +137,7 @@ struct pvconn {
 };
 
 void pvconn_init(struct pvconn *, struct pvconn_class *, const char *name);
+bool pvconn_get_reuseport(void);
 static inline void pvconn_assert_class(const struct pvconn *pvconn,
                                        const struct pvconn_class *class)
 {
@@ -176,6 +177,16 @@ struct pvconn_class {
     /* Arranges for the poll loop to wake up when a connection is ready to be
      * accepted on 'pvconn'. */
     void (*wait)(struct pvconn *pvconn);
+
+    /* Creates a passive vconn named 'name' (with 'suffix' as for listen) for
+     * 'fd', a listening socket handed off by another process that had opened
+     * a passive vconn with the same name.  Returns 0 if successful, otherwise
+     * a positive errno value.
+     *
+     * This function may be null if this kind of passive vconn cannot be
+     * handed off. */
+    int (*take_over)(const char *name, char *suffix, int fd,
+                     struct pvconn **pvconnp);
 };
 
 /* Active and passive vconn classes. */
@@ -183,6 +194,8 @@ extern struct vconn_class tcp_vconn_class;
 extern struct pvconn_class ptcp_pvconn_class;
 extern struct vconn_class unix_vconn_class;
 extern struct pvconn_class punix_pvconn_class;
+extern struct vconn_class mem_vconn_class;
+extern struct pvconn_class pmem_pvconn_class;
 #ifdef HAVE_OPENSSL
 extern struct vconn_class ssl_vconn_class;
 extern struct pvconn_class pssl_pvconn_class;
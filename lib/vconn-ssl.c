@@ -53,8 +53,10 @@
 #include "openflow/openflow.h"
 #include "packets.h"
 #include "poll-loop.h"
+#include "shash.h"
 #include "socket-util.h"
 #include "socket-util.h"
+#include "timeval.h"
 #include "util.h"
 #include "vconn-provider.h"
 #include "vconn.h"
@@ -82,7 +84,8 @@ struct ssl_vconn
     enum session_type type;
     int fd;
     SSL *ssl;
-    struct ofpbuf *rxbuf;
+    long long int handshake_start; /* time_msec() when handshake began. */
+    struct ofpbuf *rxbuf;       /* Plaintext received but not yet returned. */
     struct ofpbuf *txbuf;
     struct poll_waiter *tx_waiter;
 
@@ -148,6 +151,25 @@ struct ssl_vconn
 /* SSL context created by ssl_init(). */
 static SSL_CTX *ctx;
 
+/* Session identifier context.  A server only resumes sessions that were
+ * established under the same context. */
+static const unsigned char session_id_context[] = "openflow";
+
+/* Client-side session cache, indexed by vconn name.  Each value is an
+ * SSL_SESSION to which we hold a reference.  Offering the session from the
+ * last successful connection to a peer lets the peer resume it with an
+ * abbreviated handshake, skipping the expensive public key operations. */
+static struct shash client_sessions = SHASH_INITIALIZER(&client_sessions);
+
+/* Statistics on completed handshakes. */
+static struct vconn_ssl_stats handshake_stats;
+
+/* ssl_recv() reads plaintext into a buffer of this size, which is large
+ * enough for the payload of the largest TLS record, so that a single
+ * SSL_read() drains a whole record regardless of how many OpenFlow messages
+ * it contains. */
+#define SSL_RX_BUFFER_SIZE 16384
+
 /* Required configuration. */
 static bool has_private_key, has_certificate, has_ca_cert;
 
@@ -246,6 +268,12 @@ new_ssl_vconn(const char *name, int fd, enum session_type type,
     }
     if (bootstrap_ca_cert && type == CLIENT) {
         SSL_set_verify(ssl, SSL_VERIFY_NONE, NULL);
+    } else if (type == CLIENT) {
+        SSL_SESSION *session = shash_find_data(&client_sessions, name);
+        if (session && SSL_set_session(ssl, session) != 1) {
+            VLOG_WARN_RL(&rl, "%s: SSL_set_session: %s", name,
+                         ERR_error_string(ERR_get_error(), NULL));
+        }
     }
 
     /* Create and return the ssl_vconn. */
@@ -256,6 +284,7 @@ new_ssl_vconn(const char *name, int fd, enum session_type type,
     sslv->type = type;
     sslv->fd = fd;
     sslv->ssl = ssl;
+    sslv->handshake_start = time_msec();
     sslv->rxbuf = NULL;
     sslv->txbuf = NULL;
     sslv->tx_waiter = NULL;
@@ -427,6 +456,46 @@ do_ca_cert_bootstrap(struct vconn *vconn)
     return EPROTO;
 }
 
+/* Drops the cached session for 'name', if any, so that the next connection
+ * to that peer performs a full handshake. */
+static void
+forget_client_session(const char *name)
+{
+    struct shash_node *node = shash_find(&client_sessions, name);
+    if (node) {
+        SSL_SESSION_free(node->data);
+        shash_delete(&client_sessions, node);
+    }
+}
+
+/* Accounts for the handshake that 'sslv' just completed and, on the client
+ * side, remembers its session for resumption on the next connection. */
+static void
+ssl_handshake_done(struct ssl_vconn *sslv)
+{
+    const char *name = vconn_get_name(&sslv->vconn);
+    long long int elapsed = time_msec() - sslv->handshake_start;
+    bool resumed = SSL_session_reused(sslv->ssl);
+
+    if (resumed) {
+        handshake_stats.n_resumed++;
+        handshake_stats.resumed_msec += elapsed;
+    } else {
+        handshake_stats.n_full++;
+        handshake_stats.full_msec += elapsed;
+    }
+    VLOG_DBG("%s: %s handshake completed in %lld ms",
+             name, resumed ? "abbreviated" : "full", elapsed);
+
+    if (sslv->type == CLIENT && !resumed) {
+        SSL_SESSION *session = SSL_get1_session(sslv->ssl);
+        if (session) {
+            forget_client_session(name);
+            shash_add(&client_sessions, name, session);
+        }
+    }
+}
+
 static int
 ssl_connect(struct vconn *vconn)
 {
@@ -440,6 +509,7 @@ ssl_connect(struct vconn *vconn)
             return retval;
         }
         sslv->state = STATE_SSL_CONNECTING;
+        sslv->handshake_start = time_msec();
         /* Fall through. */
 
     case STATE_SSL_CONNECTING:
@@ -453,6 +523,9 @@ ssl_connect(struct vconn *vconn)
                 int unused;
                 interpret_ssl_error((sslv->type == CLIENT ? "SSL_connect"
                                      : "SSL_accept"), retval, error, &unused);
+                if (sslv->type == CLIENT) {
+                    forget_client_session(vconn_get_name(vconn));
+                }
                 shutdown(sslv->fd, SHUT_RDWR);
                 return EPROTO;
             }
@@ -472,6 +545,7 @@ ssl_connect(struct vconn *vconn)
             VLOG_ERR("rejecting SSL connection during bootstrap race window");
             return EPROTO;
         } else {
+            ssl_handshake_done(sslv);
             return 0;
         }
     }
@@ -486,6 +560,14 @@ ssl_close(struct vconn *vconn)
     poll_cancel(sslv->tx_waiter);
     ssl_clear_txbuf(sslv);
     ofpbuf_delete(sslv->rxbuf);
+
+    /* Send a close_notify alert, without waiting for the peer's.  Freeing a
+     * connection that was not shut down this way makes OpenSSL mark its
+     * session as not resumable. */
+    if (SSL_is_init_finished(sslv->ssl)) {
+        SSL_shutdown(sslv->ssl);
+        ERR_clear_error();
+    }
     SSL_free(sslv->ssl);
     close(sslv->fd);
     free(sslv);
@@ -571,73 +653,76 @@ ssl_recv(struct vconn *vconn, struct ofpbuf **bufferp)
 {
     struct ssl_vconn *sslv = ssl_vconn_cast(vconn);
     struct ofpbuf *rx;
-    size_t want_bytes;
     int old_state;
     ssize_t ret;
 
     if (sslv->rxbuf == NULL) {
-        sslv->rxbuf = ofpbuf_new(1564);
+        sslv->rxbuf = ofpbuf_new(SSL_RX_BUFFER_SIZE);
     }
     rx = sslv->rxbuf;
 
-again:
-    if (sizeof(struct ofp_header) > rx->size) {
-        want_bytes = sizeof(struct ofp_header) - rx->size;
-    } else {
-        struct ofp_header *oh = rx->data;
-        size_t length = ntohs(oh->length);
-        if (length < sizeof(struct ofp_header)) {
-            VLOG_ERR_RL(&rl, "received too-short ofp_header (%zu bytes)",
-                        length);
-            return EPROTO;
+    for (;;) {
+        size_t want_bytes;
+
+        /* Hand out the first message in 'rx' if it is complete. */
+        if (sizeof(struct ofp_header) > rx->size) {
+            want_bytes = sizeof(struct ofp_header) - rx->size;
+        } else {
+            struct ofp_header *oh = rx->data;
+            size_t length = ntohs(oh->length);
+            if (length < sizeof(struct ofp_header)) {
+                VLOG_ERR_RL(&rl, "received too-short ofp_header (%zu bytes)",
+                            length);
+                return EPROTO;
+            }
+            if (rx->size >= length) {
+                *bufferp = ofpbuf_clone_data(rx->data, length);
+                ofpbuf_pull(rx, length);
+                return 0;
+            }
+            want_bytes = length - rx->size;
         }
-        want_bytes = length - rx->size;
-        if (!want_bytes) {
-            *bufferp = rx;
-            sslv->rxbuf = NULL;
-            return 0;
+
+        /* Move the partial message, if any, to the front of 'rx', then read
+         * as much as fits, which is at least the rest of that message. */
+        if (!rx->size) {
+            ofpbuf_clear(rx);
+        } else if (rx->data != rx->base) {
+            memmove(rx->base, rx->data, rx->size);
+            rx->data = rx->base;
         }
-    }
-    ofpbuf_prealloc_tailroom(rx, want_bytes);
+        ofpbuf_prealloc_tailroom(rx, want_bytes);
 
-    /* Behavior of zero-byte SSL_read is poorly defined. */
-    assert(want_bytes > 0);
+        /* Behavior of zero-byte SSL_read is poorly defined. */
+        assert(ofpbuf_tailroom(rx) > 0);
 
-    old_state = SSL_get_state(sslv->ssl);
-    ret = SSL_read(sslv->ssl, ofpbuf_tail(rx), want_bytes);
-    if (old_state != SSL_get_state(sslv->ssl)) {
-        sslv->tx_want = SSL_NOTHING;
-        if (sslv->tx_waiter) {
-            poll_cancel(sslv->tx_waiter);
-            ssl_tx_poll_callback(sslv->fd, POLLIN, vconn);
-        }
-    }
-    sslv->rx_want = SSL_NOTHING;
-
-    if (ret > 0) {
-        rx->size += ret;
-        if (ret == want_bytes) {
-            if (rx->size > sizeof(struct ofp_header)) {
-                *bufferp = rx;
-                sslv->rxbuf = NULL;
-                return 0;
-            } else {
-                goto again;
+        old_state = SSL_get_state(sslv->ssl);
+        ret = SSL_read(sslv->ssl, ofpbuf_tail(rx), ofpbuf_tailroom(rx));
+        if (old_state != SSL_get_state(sslv->ssl)) {
+            sslv->tx_want = SSL_NOTHING;
+            if (sslv->tx_waiter) {
+                poll_cancel(sslv->tx_waiter);
+                ssl_tx_poll_callback(sslv->fd, POLLIN, vconn);
             }
         }
-        return EAGAIN;
-    } else {
-        int error = SSL_get_error(sslv->ssl, ret);
-        if (error == SSL_ERROR_ZERO_RETURN) {
-            /* Connection closed (EOF). */
-            if (rx->size) {
-                VLOG_WARN_RL(&rl, "SSL_read: unexpected connection close");
-                return EPROTO;
+        sslv->rx_want = SSL_NOTHING;
+
+        if (ret > 0) {
+            rx->size += ret;
+        } else {
+            int error = SSL_get_error(sslv->ssl, ret);
+            if (error == SSL_ERROR_ZERO_RETURN) {
+                /* Connection closed (EOF). */
+                if (rx->size) {
+                    VLOG_WARN_RL(&rl, "SSL_read: unexpected connection close");
+                    return EPROTO;
+                } else {
+                    return EOF;
+                }
             } else {
-                return EOF;
+                return interpret_ssl_error("SSL_read", ret, error,
+                                           &sslv->rx_want);
             }
-        } else {
-            return interpret_ssl_error("SSL_read", ret, error, &sslv->rx_want);
         }
     }
 }
@@ -833,6 +918,13 @@ pssl_open(const char *name, char *suffix, struct pvconn **pvconnp)
         VLOG_ERR("%s: setsockopt(SO_REUSEADDR): %s", name, strerror(errno));
         return error;
     }
+    if (pvconn_get_reuseport()) {
+        retval = set_reuseport(fd);
+        if (retval) {
+            close(fd);
+            return retval;
+        }
+    }
 
     memset(&sin, 0, sizeof sin);
     sin.sin_family = AF_INET;
@@ -846,7 +938,7 @@ pssl_open(const char *name, char *suffix, struct pvconn **pvconnp)
         return error;
     }
 
-    retval = listen(fd, 10);
+    retval = listen(fd, SOMAXCONN);
     if (retval < 0) {
         int error = errno;
         VLOG_ERR("%s: listen: %s", name, strerror(error));
@@ -921,6 +1013,7 @@ struct pvconn_class pssl_pvconn_class = {
     pssl_close,
     pssl_accept,
     pssl_wait,
+    NULL,
 };
 
 /*
@@ -972,6 +1065,14 @@ do_ssl_init(void)
     SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT,
                        NULL);
 
+    /* Allow reconnecting peers to resume their sessions, either from the
+     * server-side session cache or from a session ticket, which OpenSSL
+     * issues by default.  Sessions on the client side are cached in
+     * 'client_sessions' instead, keyed by peer name. */
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(ctx, session_id_context,
+                                   sizeof session_id_context - 1);
+
     return 0;
 }
 
@@ -1009,6 +1110,13 @@ tmp_dh_callback(SSL *ssl UNUSED, int is_export UNUSED, int keylength)
     return NULL;
 }
 
+/* Stores statistics on the SSL handshakes completed so far into '*stats'. */
+void
+vconn_ssl_get_stats(struct vconn_ssl_stats *stats)
+{
+    *stats = handshake_stats;
+}
+
 /* Returns true if SSL is at least partially configured. */
 bool
 vconn_ssl_is_configured(void) 
@@ -36,6 +36,16 @@
 #include <stdbool.h>
 
 #ifdef HAVE_OPENSSL
+/* Counts of completed SSL handshakes, with the total time spent in each kind,
+ * measured from the start of the handshake to its completion. */
+struct vconn_ssl_stats {
+    unsigned int n_full;        /* Full handshakes. */
+    unsigned int n_resumed;     /* Abbreviated handshakes (resumed sessions). */
+    long long int full_msec;    /* Total time in full handshakes. */
+    long long int resumed_msec; /* Total time in abbreviated handshakes. */
+};
+
+void vconn_ssl_get_stats(struct vconn_ssl_stats *);
 bool vconn_ssl_is_configured(void);
 void vconn_ssl_set_private_key_file(const char *file_name);
 void vconn_ssl_set_certificate_file(const char *file_name);
@@ -69,6 +69,11 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(10, 25);
 
 static void stream_clear_txbuf(struct stream_vconn *);
 
+/* Size of a stream vconn's receive buffer.  Each read() fills as much of the
+ * buffer as it can, so that a burst of small messages costs one system call
+ * instead of two per message. */
+#define STREAM_RX_SIZE 16384
+
 int
 new_stream_vconn(const char *name, int fd, int connect_status,
                  uint32_t ip, bool reconnectable, struct vconn **vconnp)
@@ -93,6 +98,51 @@ stream_vconn_cast(struct vconn *vconn)
     return CONTAINER_OF(vconn, struct stream_vconn, vconn);
 }
 
+/* If 'vconn' is a stream vconn, stores its socket in '*fdp' and the bytes
+ * already read from the socket but not yet received as messages, if any, in
+ * '*rxbufp' (otherwise a null pointer), so that another process can take the
+ * connection over with stream_vconn_take_over().  'vconn' remains usable.
+ *
+ * Returns 0 if successful, EAGAIN if 'vconn' still has data waiting to be
+ * sent, or EOPNOTSUPP if 'vconn' is not a stream vconn. */
+int
+stream_vconn_hand_off(struct vconn *vconn, int *fdp,
+                      const struct ofpbuf **rxbufp)
+{
+    struct stream_vconn *s;
+
+    if (vconn->class != &stream_vconn_class) {
+        return EOPNOTSUPP;
+    }
+    s = stream_vconn_cast(vconn);
+    if (s->txbuf) {
+        return EAGAIN;
+    }
+    *fdp = s->fd;
+    *rxbufp = s->rxbuf && s->rxbuf->size ? s->rxbuf : NULL;
+    return 0;
+}
+
+/* Creates a stream vconn named 'name' for 'fd', a connected socket that
+ * another process handed off with stream_vconn_hand_off().  The 'rx_len'
+ * bytes in 'rx' are the ones that the other process had already read from
+ * 'fd'. */
+int
+stream_vconn_take_over(const char *name, int fd, uint32_t ip,
+                       const void *rx, size_t rx_len, struct vconn **vconnp)
+{
+    struct stream_vconn *s;
+    int error;
+
+    error = new_stream_vconn(name, fd, 0, ip, false, vconnp);
+    if (!error && rx_len) {
+        s = stream_vconn_cast(*vconnp);
+        s->rxbuf = ofpbuf_new(MAX(rx_len, STREAM_RX_SIZE));
+        ofpbuf_put(s->rxbuf, rx, rx_len);
+    }
+    return error;
+}
+
 static void
 stream_close(struct vconn *vconn)
 {
@@ -111,6 +161,28 @@ stream_connect(struct vconn *vconn)
     return check_connection_completion(s->fd);
 }
 
+/* Returns the length of the complete message at the start of 's''s receive
+ * buffer, 0 if the buffer does not yet hold a complete message, or a negative
+ * errno value if the message is malformed. */
+static int
+stream_rx_msg_len(struct stream_vconn *s)
+{
+    struct ofpbuf *rx = s->rxbuf;
+    struct ofp_header *oh;
+    size_t length;
+
+    if (!rx || rx->size < sizeof *oh) {
+        return 0;
+    }
+    oh = rx->data;
+    length = ntohs(oh->length);
+    if (length < sizeof *oh) {
+        VLOG_ERR_RL(&rl, "received too-short ofp_header (%zu bytes)", length);
+        return -EPROTO;
+    }
+    return rx->size >= length ? length : 0;
+}
+
 static int
 stream_recv(struct vconn *vconn, struct ofpbuf **bufferp)
 {
@@ -118,43 +190,52 @@ stream_recv(struct vconn *vconn, struct ofpbuf **bufferp)
     struct ofpbuf *rx;
     size_t want_bytes;
     ssize_t retval;
+    int length;
 
     if (s->rxbuf == NULL) {
-        s->rxbuf = ofpbuf_new(1564);
+        s->rxbuf = ofpbuf_new(STREAM_RX_SIZE);
     }
     rx = s->rxbuf;
 
 again:
-    if (sizeof(struct ofp_header) > rx->size) {
-        want_bytes = sizeof(struct ofp_header) - rx->size;
-    } else {
-        struct ofp_header *oh = rx->data;
-        size_t length = ntohs(oh->length);
-        if (length < sizeof(struct ofp_header)) {
-            VLOG_ERR_RL(&rl, "received too-short ofp_header (%zu bytes)",
-                        length);
-            return EPROTO;
-        }
-        want_bytes = length - rx->size;
-        if (!want_bytes) {
+    length = stream_rx_msg_len(s);
+    if (length < 0) {
+        return -length;
+    } else if (length) {
+        if (rx->size == length && length >= STREAM_RX_SIZE / 4) {
+            /* Hand over the whole buffer rather than copying a large
+             * message out of it. */
             *bufferp = rx;
             s->rxbuf = NULL;
-            return 0;
+        } else {
+            *bufferp = ofpbuf_clone_data(rx->data, length);
+            ofpbuf_pull(rx, length);
+            if (!rx->size) {
+                ofpbuf_clear(rx);
+            }
         }
+        return 0;
+    }
+
+    /* Make room for at least the rest of the current message, moving any
+     * partial message to the start of the buffer first. */
+    if (rx->size >= sizeof(struct ofp_header)) {
+        struct ofp_header *oh = rx->data;
+        want_bytes = ntohs(oh->length) - rx->size;
+    } else {
+        want_bytes = sizeof(struct ofp_header) - rx->size;
+    }
+    if (ofpbuf_tailroom(rx) < want_bytes && ofpbuf_headroom(rx)) {
+        memmove(rx->base, rx->data, rx->size);
+        rx->data = rx->base;
     }
     ofpbuf_prealloc_tailroom(rx, want_bytes);
 
-    retval = read(s->fd, ofpbuf_tail(rx), want_bytes);
+    retval = read(s->fd, ofpbuf_tail(rx), ofpbuf_tailroom(rx));
     if (retval > 0) {
         rx->size += retval;
-        if (retval == want_bytes) {
-            if (rx->size > sizeof(struct ofp_header)) {
-                *bufferp = rx;
-                s->rxbuf = NULL;
-                return 0;
-            } else {
-                goto again;
-            }
+        if (retval >= want_bytes) {
+            goto again;
         }
         return EAGAIN;
     } else if (retval == 0) {
@@ -244,7 +325,12 @@ stream_wait(struct vconn *vconn, enum vconn_wait_type wait)
         break;
 
     case WAIT_RECV:
-        poll_fd_wait(s->fd, POLLIN);
+        if (stream_rx_msg_len(s)) {
+            /* A complete message is already buffered. */
+            poll_immediate_wake();
+        } else {
+            poll_fd_wait(s->fd, POLLIN);
+        }
         break;
 
     default:
@@ -296,7 +382,7 @@ new_pstream_pvconn(const char *name, int fd,
         return retval;
     }
 
-    if (listen(fd, 10) < 0) {
+    if (listen(fd, SOMAXCONN) < 0) {
         int error = errno;
         VLOG_ERR("%s: listen: %s", name, strerror(error));
         close(fd);
@@ -311,6 +397,19 @@ new_pstream_pvconn(const char *name, int fd,
     return 0;
 }
 
+/* If 'pvconn' is a passive stream vconn, stores its listening socket in
+ * '*fdp' and returns 0, so that another process can take it over.  Otherwise,
+ * returns EOPNOTSUPP. */
+int
+pstream_pvconn_hand_off(struct pvconn *pvconn, int *fdp)
+{
+    if (pvconn->class != &pstream_pvconn_class) {
+        return EOPNOTSUPP;
+    }
+    *fdp = pstream_pvconn_cast(pvconn)->fd;
+    return 0;
+}
+
 static void
 pstream_close(struct pvconn *pvconn)
 {
@@ -359,5 +458,6 @@ static struct pvconn_class pstream_pvconn_class = {
     NULL,
     pstream_close,
     pstream_accept,
-    pstream_wait
+    pstream_wait,
+    NULL
 };
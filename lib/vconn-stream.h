@@ -38,6 +38,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+struct ofpbuf;
 struct vconn;
 struct pvconn;
 struct sockaddr;
@@ -49,4 +50,11 @@ int new_pstream_pvconn(const char *name, int fd,
                                        size_t sa_len, struct vconn **),
                       struct pvconn **pvconnp);
 
+int stream_vconn_hand_off(struct vconn *, int *fdp,
+                          const struct ofpbuf **rxbufp);
+int stream_vconn_take_over(const char *name, int fd, uint32_t ip,
+                           const void *rx, size_t rx_len,
+                           struct vconn **vconnp);
+int pstream_pvconn_hand_off(struct pvconn *, int *fdp);
+
 #endif /* vconn-stream.h */
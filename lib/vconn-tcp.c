@@ -159,6 +159,13 @@ ptcp_open(const char *name, char *suffix, struct pvconn **pvconnp)
         VLOG_ERR("%s: setsockopt(SO_REUSEADDR): %s", name, strerror(errno));
         return errno;
     }
+    if (pvconn_get_reuseport()) {
+        retval = set_reuseport(fd);
+        if (retval) {
+            close(fd);
+            return retval;
+        }
+    }
 
     memset(&sin, 0, sizeof sin);
     sin.sin_family = AF_INET;
@@ -175,6 +182,13 @@ ptcp_open(const char *name, char *suffix, struct pvconn **pvconnp)
     return new_pstream_pvconn("ptcp", fd, ptcp_accept, pvconnp);
 }
 
+static int
+ptcp_take_over(const char *name UNUSED, char *suffix UNUSED, int fd,
+               struct pvconn **pvconnp)
+{
+    return new_pstream_pvconn("ptcp", fd, ptcp_accept, pvconnp);
+}
+
 static int
 ptcp_accept(int fd, const struct sockaddr *sa, size_t sa_len,
             struct vconn **vconnp)
@@ -198,6 +212,7 @@ struct pvconn_class ptcp_pvconn_class = {
     ptcp_open,
     NULL,
     NULL,
-    NULL
+    NULL,
+    ptcp_take_over
 };
 
@@ -43,6 +43,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "fatal-signal.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
 #include "packets.h"
@@ -109,6 +110,15 @@ punix_open(const char *name UNUSED, char *suffix, struct pvconn **pvconnp)
     return new_pstream_pvconn("punix", fd, punix_accept, pvconnp);
 }
 
+static int
+punix_take_over(const char *name UNUSED, char *suffix, int fd,
+                struct pvconn **pvconnp)
+{
+    /* The socket file is now ours to remove when we exit. */
+    fatal_signal_add_file_to_unlink(suffix);
+    return new_pstream_pvconn("punix", fd, punix_accept, pvconnp);
+}
+
 static int
 punix_accept(int fd, const struct sockaddr *sa, size_t sa_len,
              struct vconn **vconnp)
@@ -130,6 +140,7 @@ struct pvconn_class punix_pvconn_class = {
     punix_open,
     NULL,
     NULL,
-    NULL
+    NULL,
+    punix_take_over
 };
 
@@ -36,18 +36,22 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <netinet/in.h>
 #include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include "dynamic-string.h"
 #include "flow.h"
 #include "ofp-print.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
 #include "poll-loop.h"
 #include "random.h"
 #include "util.h"
+#include "vconn-stream.h"
 
 #define THIS_MODULE VLM_vconn
 #include "vlog.h"
@@ -68,6 +72,7 @@ enum vconn_state {
 static struct vconn_class *vconn_classes[] = {
     &tcp_vconn_class,
     &unix_vconn_class,
+    &mem_vconn_class,
 #ifdef HAVE_NETLINK
     &netlink_vconn_class,
 #endif
@@ -79,6 +84,7 @@ static struct vconn_class *vconn_classes[] = {
 static struct pvconn_class *pvconn_classes[] = {
     &ptcp_pvconn_class,
     &punix_pvconn_class,
+    &pmem_pvconn_class,
 #ifdef HAVE_OPENSSL
     &pssl_pvconn_class,
 #endif
@@ -89,6 +95,23 @@ static struct pvconn_class *pvconn_classes[] = {
  * really need to see them. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(600, 600);
 
+/* Set SO_REUSEPORT on listening sockets?  See pvconn_set_reuseport(). */
+static bool reuseport;
+
+/* Debug logging of OpenFlow messages.  Only one message in every
+ * 'log_sample_every[type]' of each type is logged, none if it is
+ * LOG_SAMPLE_NONE; see vconn_set_log_sampling().  Messages are copied and
+ * formatted later by vlog_run(), but no more than LOG_MAX_COPY bytes of each
+ * are kept. */
+#define LOG_MAX_COPY 2048
+#define LOG_SAMPLE_NONE UINT_MAX
+static unsigned int log_sample_every[256];
+static unsigned int log_sample_count[256];
+static void log_msg(enum vlog_level, const struct vconn *, const char *what,
+                    const struct ofpbuf *);
+static bool log_msg_due(uint8_t type);
+static bool log_msg_wanted(uint8_t type);
+
 static int do_recv(struct vconn *, struct ofpbuf **);
 static int do_send(struct vconn *, struct ofpbuf *);
 
@@ -361,8 +384,8 @@ vcs_recv_hello(struct vconn *vconn)
             return;
         } else {
             char *s = ofp_to_string(b->data, b->size, 1);
-            VLOG_WARN_RL(&rl, "%s: received message while expecting hello: %s",
-                         vconn->name, s);
+            VLOG_WARN("%s: received message while expecting hello: %s",
+                      vconn->name, s);
             free(s);
             retval = EPROTO;
             ofpbuf_delete(b);
@@ -476,13 +499,11 @@ again:
     if (!retval) {
         struct ofp_header *oh;
 
-        if (VLOG_IS_DBG_ENABLED()) {
-            char *s = ofp_to_string((*msgp)->data, (*msgp)->size, 1);
-            VLOG_DBG_RL(&rl, "%s: received: %s", vconn->name, s);
-            free(s);
+        oh = ofpbuf_at_assert(*msgp, 0, sizeof *oh);
+        if (log_msg_wanted(oh->type)) {
+            log_msg(VLL_DBG, vconn, "received", *msgp);
         }
 
-        oh = ofpbuf_at_assert(*msgp, 0, sizeof *oh);
         if (oh->version != vconn->version
             && oh->type != OFPT_HELLO
             && oh->type != OFPT_ERROR
@@ -529,6 +550,11 @@ again:
  * ever will be delivered to the peer, only that it has been queued for
  * transmission.
  *
+ * Messages may be sent as soon as our OFPT_HELLO has been sent, without
+ * waiting for the peer's.  This lets a request such as OFPT_FEATURES_REQUEST
+ * follow the hello in the same round trip.  If version negotiation then
+ * fails, the connection is dropped anyway.
+ *
  * Returns a positive errno value on failure, in which case the caller
  * retains ownership of 'msg'.
  *
@@ -538,7 +564,7 @@ int
 vconn_send(struct vconn *vconn, struct ofpbuf *msg)
 {
     int retval = vconn_connect(vconn);
-    if (!retval) {
+    if (!retval || (retval == EAGAIN && vconn->state == VCS_RECV_HELLO)) {
         retval = do_send(vconn, msg);
     }
     return retval;
@@ -547,24 +573,145 @@ vconn_send(struct vconn *vconn, struct ofpbuf *msg)
 static int
 do_send(struct vconn *vconn, struct ofpbuf *msg)
 {
+    const struct ofp_header *oh = msg->data;
+    struct ofpbuf *copy = NULL;
+    uint8_t type;
     int retval;
 
     assert(msg->size >= sizeof(struct ofp_header));
-    assert(((struct ofp_header *) msg->data)->length == htons(msg->size));
-    if (!VLOG_IS_DBG_ENABLED()) {
-        retval = (vconn->class->send)(vconn, msg);
-    } else {
-        char *s = ofp_to_string(msg->data, msg->size, 1);
-        retval = (vconn->class->send)(vconn, msg);
-        if (retval != EAGAIN) {
-            VLOG_DBG_RL(&rl, "%s: sent (%s): %s",
-                        vconn->name, strerror(retval), s);
-        }
-        free(s);
+    assert(oh->length == htons(msg->size));
+    type = oh->type;
+
+    /* 'msg' belongs to the vconn once it is sent, so keep a copy of the part
+     * that will be logged.  The message only counts toward sampling once it
+     * has actually been sent, not each time it is retried after EAGAIN. */
+    if (log_msg_due(type)) {
+        copy = ofpbuf_clone_data(msg->data, MIN(msg->size, LOG_MAX_COPY));
     }
+    retval = (vconn->class->send)(vconn, msg);
+    if (retval != EAGAIN && log_msg_wanted(type)) {
+        char *what = xasprintf("sent (%s)", strerror(retval));
+        log_msg(VLL_DBG, vconn, what, copy);
+        free(what);
+    }
+    ofpbuf_delete(copy);
     return retval;
 }
 
+static char *
+format_msg(const void *data, size_t size)
+{
+    return ofp_to_string(data, size, 1);
+}
+
+/* Returns true if debug logging is enabled for vconn and the per-type
+ * sampling rate would pick the next message of the given 'type', without
+ * counting that message. */
+static bool
+log_msg_due(uint8_t type)
+{
+    unsigned int every;
+
+    if (!vlog_is_enabled(THIS_MODULE, VLL_DBG)) {
+        return false;
+    }
+
+    every = log_sample_every[type];
+    if (every == LOG_SAMPLE_NONE) {
+        return false;
+    }
+    return every <= 1 || (log_sample_count[type] + 1) % every == 0;
+}
+
+/* Counts a message of the given 'type' toward its sampling rate and returns
+ * true if it should be logged at debug level: that is, if log_msg_due() picks
+ * it and the rate limiter allows another message.  Only debug tracing of
+ * messages is sampled; warnings about them are always logged. */
+static bool
+log_msg_wanted(uint8_t type)
+{
+    bool due = log_msg_due(type);
+
+    log_sample_count[type]++;
+    return due && !vlog_should_drop(THIS_MODULE, VLL_DBG, &rl);
+}
+
+/* Logs 'msg', sent or received on 'vconn', at 'level'.  The message is
+ * formatted later, by vlog_run(), from a copy of its first LOG_MAX_COPY
+ * bytes. */
+static void
+log_msg(enum vlog_level level, const struct vconn *vconn, const char *what,
+        const struct ofpbuf *msg)
+{
+    vlog_defer(THIS_MODULE, level, format_msg,
+               xasprintf("%s: %s: ", vconn->name, what),
+               msg->data, msg->size, LOG_MAX_COPY);
+}
+
+/* Configures sampling of debug logging of OpenFlow messages according to
+ * 'spec', a comma-separated list of TYPE:N pairs.  Each pair causes only one
+ * in every N messages of the given TYPE to be logged.  TYPE is a message type
+ * name accepted by ofp_message_type_from_name(), or "all" to apply to every
+ * type.  N of 0 disables logging messages of that type entirely.
+ *
+ * Returns a null pointer if successful, otherwise a malloc()'d error message
+ * that the caller must free. */
+char *
+vconn_set_log_sampling(const char *spec)
+{
+    char *copy = xstrdup(spec);
+    char *error = NULL;
+    char *save_ptr = NULL;
+    char *pair;
+
+    for (pair = strtok_r(copy, ",", &save_ptr); pair;
+         pair = strtok_r(NULL, ",", &save_ptr)) {
+        char *colon = strchr(pair, ':');
+        unsigned int every;
+        char *tail;
+        int type;
+
+        if (!colon) {
+            error = xasprintf("%s: missing \":N\" sampling rate", pair);
+            break;
+        }
+        *colon = '\0';
+        every = strtoul(colon + 1, &tail, 10);
+        if (colon[1] == '\0' || *tail) {
+            error = xasprintf("%s: bad sampling rate \"%s\"",
+                              pair, colon + 1);
+            break;
+        }
+
+        if (!every) {
+            every = LOG_SAMPLE_NONE;
+        }
+        if (!strcasecmp(pair, "all")) {
+            for (type = 0; type < ARRAY_SIZE(log_sample_every); type++) {
+                log_sample_every[type] = every;
+            }
+        } else {
+            type = ofp_message_type_from_name(pair);
+            if (type < 0) {
+                error = xasprintf("%s: unknown OpenFlow message type", pair);
+                break;
+            }
+            log_sample_every[type] = every;
+        }
+    }
+    free(copy);
+    return error;
+}
+
+void
+vconn_log_usage(void)
+{
+    printf("  --log-sample=TYPE:N[,TYPE:N]...  debug log only 1 in N "
+           "OpenFlow\n"
+           "                          messages of TYPE (or \"all\"), "
+           "none if N is 0\n");
+}
+
 /* Same as vconn_send, except that it waits until 'msg' can be transmitted. */
 int
 vconn_send_block(struct vconn *vconn, struct ofpbuf *msg)
@@ -657,7 +804,10 @@ vconn_wait(struct vconn *vconn, enum vconn_wait_type wait)
         break;
 
     case VCS_RECV_HELLO:
-        wait = WAIT_RECV;
+        /* vconn_send() need not wait for the peer's hello. */
+        if (wait != WAIT_SEND) {
+            wait = WAIT_RECV;
+        }
         break;
 
     case VCS_CONNECTED:
@@ -688,6 +838,37 @@ vconn_send_wait(struct vconn *vconn)
     vconn_wait(vconn, WAIT_SEND);
 }
 
+/* Returns the passive vconn class for the passive vconn named 'name', e.g.
+ * the class for "ptcp" given "ptcp:6633", or a null pointer if there is
+ * none. */
+static struct pvconn_class *
+pvconn_lookup_class(const char *name)
+{
+    size_t prefix_len;
+    size_t i;
+
+    prefix_len = strcspn(name, ":");
+    if (prefix_len == strlen(name)) {
+        return NULL;
+    }
+    for (i = 0; i < ARRAY_SIZE(pvconn_classes); i++) {
+        struct pvconn_class *class = pvconn_classes[i];
+        if (strlen(class->name) == prefix_len
+            && !memcmp(class->name, name, prefix_len)) {
+            return class;
+        }
+    }
+    return NULL;
+}
+
+/* Gives 'pvconn' the full name 'name' that it was opened under. */
+static void
+pvconn_set_name(struct pvconn *pvconn, const char *name)
+{
+    free(pvconn->name);
+    pvconn->name = xstrdup(name);
+}
+
 /* Attempts to start listening for OpenFlow connections.  'name' is a
  * connection name in the form "TYPE:ARGS", where TYPE is an passive vconn
  * class's name and ARGS are vconn class-specific.
@@ -698,30 +879,33 @@ vconn_send_wait(struct vconn *vconn)
 int
 pvconn_open(const char *name, struct pvconn **pvconnp)
 {
-    size_t prefix_len;
-    size_t i;
+    struct pvconn_class *class;
+    char *suffix_copy;
+    int retval;
 
     check_vconn_classes();
 
     *pvconnp = NULL;
-    prefix_len = strcspn(name, ":");
-    if (prefix_len == strlen(name)) {
+    class = pvconn_lookup_class(name);
+    if (!class) {
         return EAFNOSUPPORT;
     }
-    for (i = 0; i < ARRAY_SIZE(pvconn_classes); i++) {
-        struct pvconn_class *class = pvconn_classes[i];
-        if (strlen(class->name) == prefix_len
-            && !memcmp(class->name, name, prefix_len)) {
-            char *suffix_copy = xstrdup(name + prefix_len + 1);
-            int retval = class->listen(name, suffix_copy, pvconnp);
-            free(suffix_copy);
-            if (retval) {
-                *pvconnp = NULL;
-            }
-            return retval;
-        }
+    suffix_copy = xstrdup(name + strlen(class->name) + 1);
+    retval = class->listen(name, suffix_copy, pvconnp);
+    free(suffix_copy);
+    if (retval) {
+        *pvconnp = NULL;
+    } else {
+        pvconn_set_name(*pvconnp, name);
     }
-    return EAFNOSUPPORT;
+    return retval;
+}
+
+/* Returns the name that 'pvconn' was opened under, e.g. "ptcp:6633". */
+const char *
+pvconn_get_name(const struct pvconn *pvconn)
+{
+    return pvconn->name;
 }
 
 /* Closes 'pvconn'. */
@@ -735,6 +919,23 @@ pvconn_close(struct pvconn *pvconn)
     }
 }
 
+/* Sets whether listening sockets opened by later calls to pvconn_open() allow
+ * other sockets to bind the same port, so that several processes can share
+ * the connections to one port (SO_REUSEPORT).  Off by default. */
+void
+pvconn_set_reuseport(bool enable)
+{
+    reuseport = enable;
+}
+
+/* Returns true if pvconn providers should set SO_REUSEPORT on their listening
+ * sockets.  See pvconn_set_reuseport(). */
+bool
+pvconn_get_reuseport(void)
+{
+    return reuseport;
+}
+
 /* Tries to accept a new connection on 'pvconn'.  If successful, stores the new
  * connection in '*new_vconn' and returns 0.  Otherwise, returns a positive
  * errno value.
@@ -765,6 +966,92 @@ pvconn_wait(struct pvconn *pvconn)
     (pvconn->class->wait)(pvconn);
 }
 
+/* Prepares to hand 'vconn', which must have completed its connection and
+ * OpenFlow version negotiation, off to another process: stores its socket in
+ * '*fdp', the negotiated OpenFlow version in '*versionp', and the bytes already
+ * read from the socket but not yet received as messages in '*rxbufp' (a null
+ * pointer if there are none).  The other process may then take the connection
+ * over with vconn_take_over().  'vconn' remains usable.
+ *
+ * Returns 0 if successful, EAGAIN if 'vconn' is not yet connected or still has
+ * data waiting to be sent, or EOPNOTSUPP if 'vconn' cannot be handed off
+ * (e.g. because it is an SSL connection). */
+int
+vconn_hand_off(struct vconn *vconn, int *fdp, int *versionp,
+               const struct ofpbuf **rxbufp)
+{
+    if (vconn->state != VCS_CONNECTED) {
+        return EAGAIN;
+    }
+    *versionp = vconn->version;
+    return stream_vconn_hand_off(vconn, fdp, rxbufp);
+}
+
+/* Creates a new vconn named 'name' for 'fd', a connection that another process
+ * handed off with vconn_hand_off() after negotiating OpenFlow version
+ * 'version' with the peer at 'ip'.  The 'rx_len' bytes in 'rx' are the ones
+ * that the other process had already read from 'fd'.  The new vconn is
+ * connected already, so no hello messages are exchanged.
+ *
+ * Returns 0 and stores the new vconn in '*vconnp' if successful, otherwise a
+ * positive errno value. */
+int
+vconn_take_over(const char *name, int fd, int version, uint32_t ip,
+                const void *rx, size_t rx_len, struct vconn **vconnp)
+{
+    int error;
+
+    *vconnp = NULL;
+    error = stream_vconn_take_over(name, fd, ip, rx, rx_len, vconnp);
+    if (!error) {
+        struct vconn *vconn = *vconnp;
+        vconn->state = VCS_CONNECTED;
+        vconn->version = vconn->min_version = version;
+    }
+    return error;
+}
+
+/* Stores the listening socket of 'pvconn' in '*fdp', so that another process
+ * can take it over with pvconn_take_over().  Returns 0 if successful or
+ * EOPNOTSUPP if 'pvconn' cannot be handed off. */
+int
+pvconn_hand_off(struct pvconn *pvconn, int *fdp)
+{
+    return pstream_pvconn_hand_off(pvconn, fdp);
+}
+
+/* Creates a new passive vconn named 'name' (e.g. "ptcp:6633") for 'fd', a
+ * listening socket that another process handed off with pvconn_hand_off().
+ *
+ * Returns 0 and stores the new pvconn in '*pvconnp' if successful, otherwise a
+ * positive errno value. */
+int
+pvconn_take_over(const char *name, int fd, struct pvconn **pvconnp)
+{
+    struct pvconn_class *class;
+    char *suffix_copy;
+    int retval;
+
+    check_vconn_classes();
+
+    *pvconnp = NULL;
+    class = pvconn_lookup_class(name);
+    if (!class) {
+        return EAFNOSUPPORT;
+    } else if (!class->take_over) {
+        return EOPNOTSUPP;
+    }
+    suffix_copy = xstrdup(name + strlen(class->name) + 1);
+    retval = class->take_over(name, suffix_copy, fd, pvconnp);
+    free(suffix_copy);
+    if (retval) {
+        *pvconnp = NULL;
+    } else {
+        pvconn_set_name(*pvconnp, name);
+    }
+    return retval;
+}
+
 /* XXX we should really use consecutive xids to avoid probabilistic
  * failures. */
 static inline uint32_t
@@ -980,6 +1267,95 @@ make_buffered_packet_out(uint32_t buffer_id,
     return out;
 }
 
+/* Creates and returns an empty OFP_EXT_FLOW_MOD_BUNDLE message.  Use
+ * flow_mod_bundle_append() to add flow-mods to it. */
+struct ofpbuf *
+make_flow_mod_bundle(void)
+{
+    struct openflow_ext_flow_mod_bundle *bundle;
+    struct ofpbuf *out;
+
+    bundle = make_openflow(sizeof *bundle, OFPT_VENDOR, &out);
+    bundle->header.vendor = htonl(OPENFLOW_VENDOR_ID);
+    bundle->header.subtype = htonl(OFP_EXT_FLOW_MOD_BUNDLE);
+    return out;
+}
+
+/* Appends a copy of 'ofm', an OFPT_FLOW_MOD message, to 'bundle', which must
+ * have been created with make_flow_mod_bundle().  Returns true if successful,
+ * false if 'bundle' has no room left for 'ofm', in which case the caller
+ * should send 'bundle' and start a new one. */
+bool
+flow_mod_bundle_append(struct ofpbuf *bundle, const struct ofp_flow_mod *ofm)
+{
+    struct openflow_ext_flow_mod_bundle *obm;
+    size_t ofm_len = ntohs(ofm->header.length);
+
+    if (bundle->size + ofm_len > UINT16_MAX) {
+        return false;
+    }
+    ofpbuf_put(bundle, ofm, ofm_len);
+    update_openflow_length(bundle);
+
+    obm = bundle->data;
+    obm->n_flow_mods = htonl(ntohl(obm->n_flow_mods) + 1);
+    return true;
+}
+
+/* Creates and returns an OFP_EXT_PACKET_OUT_MULTI message, with no packets
+ * yet, that outputs packets received on 'in_port' to 'out_port'.  Use
+ * packet_out_multi_append() to add packets to it. */
+struct ofpbuf *
+make_packet_out_multi(uint16_t in_port, uint16_t out_port)
+{
+    struct openflow_ext_packet_out_multi *opom;
+    struct ofp_action_output *oao;
+    struct ofpbuf *out;
+
+    opom = make_openflow(sizeof *opom + sizeof *oao, OFPT_VENDOR, &out);
+    opom->header.vendor = htonl(OPENFLOW_VENDOR_ID);
+    opom->header.subtype = htonl(OFP_EXT_PACKET_OUT_MULTI);
+    opom->in_port = htons(in_port);
+    opom->actions_len = htons(sizeof *oao);
+
+    oao = (struct ofp_action_output *) opom->actions;
+    oao->type = htons(OFPAT_OUTPUT);
+    oao->len = htons(sizeof *oao);
+    oao->port = htons(out_port);
+    return out;
+}
+
+/* Appends a packet to 'opom', which must have been created with
+ * make_packet_out_multi(): the packet buffered under 'buffer_id' or, if
+ * 'buffer_id' is UINT32_MAX, a copy of 'packet'.  Returns true if successful,
+ * false if 'opom' has no room left for the packet, in which case the caller
+ * should send 'opom' and start a new one. */
+bool
+packet_out_multi_append(struct ofpbuf *opom_, uint32_t buffer_id,
+                        const struct ofpbuf *packet)
+{
+    struct openflow_ext_packet_out_entry *e;
+    struct openflow_ext_packet_out_multi *opom;
+    size_t data_len = buffer_id == UINT32_MAX ? packet->size : 0;
+    size_t len = ROUND_UP(sizeof *e + data_len, 8);
+
+    if (opom_->size + len > UINT16_MAX) {
+        return false;
+    }
+    e = ofpbuf_put_zeros(opom_, len);
+    e->buffer_id = htonl(buffer_id);
+    e->len = htons(len);
+    e->data_len = htons(data_len);
+    if (data_len) {
+        memcpy(e->data, packet->data, data_len);
+    }
+    update_openflow_length(opom_);
+
+    opom = opom_->data;
+    opom->n_packets = htonl(ntohl(opom->n_packets) + 1);
+    return true;
+}
+
 /* Creates and returns an OFPT_ECHO_REQUEST message with an empty payload. */
 struct ofpbuf *
 make_echo_request(void)
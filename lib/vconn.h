@@ -40,6 +40,7 @@
 
 struct ofpbuf;
 struct flow;
+struct ofp_flow_mod;
 struct ofp_header;
 struct ofp_stats_reply;
 struct pvconn;
@@ -73,11 +74,37 @@ void vconn_connect_wait(struct vconn *);
 void vconn_recv_wait(struct vconn *);
 void vconn_send_wait(struct vconn *);
 
+/* Sampling of debug logging of OpenFlow messages. */
+char *vconn_set_log_sampling(const char *spec);
+void vconn_log_usage(void);
+
+#define VCONN_LOG_OPTION_ENUMS OPT_LOG_SAMPLE
+#define VCONN_LOG_LONG_OPTIONS                              \
+        {"log-sample",  required_argument, 0, OPT_LOG_SAMPLE}
+#define VCONN_LOG_OPTION_HANDLERS                           \
+        case OPT_LOG_SAMPLE: {                              \
+            char *error = vconn_set_log_sampling(optarg);   \
+            if (error) {                                    \
+                ofp_fatal(0, "--log-sample: %s", error);    \
+            }                                               \
+            break;                                          \
+        }
+
 /* Passive vconns: virtual listeners for incoming OpenFlow connections. */
 int pvconn_open(const char *name, struct pvconn **);
 void pvconn_close(struct pvconn *);
 int pvconn_accept(struct pvconn *, int min_version, struct vconn **);
 void pvconn_wait(struct pvconn *);
+void pvconn_set_reuseport(bool enable);
+const char *pvconn_get_name(const struct pvconn *);
+
+/* Handing connections off to another process. */
+int vconn_hand_off(struct vconn *, int *fdp, int *versionp,
+                   const struct ofpbuf **rxbufp);
+int vconn_take_over(const char *name, int fd, int version, uint32_t ip,
+                    const void *rx, size_t rx_len, struct vconn **);
+int pvconn_hand_off(struct pvconn *, int *fdp);
+int pvconn_take_over(const char *name, int fd, struct pvconn **);
 
 /* OpenFlow protocol utility functions. */
 void *make_openflow(size_t openflow_len, uint8_t type, struct ofpbuf **);
@@ -99,6 +126,11 @@ struct ofpbuf *make_buffered_packet_out(uint32_t buffer_id,
                                         uint16_t in_port, uint16_t out_port);
 struct ofpbuf *make_unbuffered_packet_out(const struct ofpbuf *packet,
                                           uint16_t in_port, uint16_t out_port);
+struct ofpbuf *make_flow_mod_bundle(void);
+bool flow_mod_bundle_append(struct ofpbuf *bundle, const struct ofp_flow_mod *);
+struct ofpbuf *make_packet_out_multi(uint16_t in_port, uint16_t out_port);
+bool packet_out_multi_append(struct ofpbuf *, uint32_t buffer_id,
+                             const struct ofpbuf *packet);
 struct ofpbuf *make_echo_request(void);
 struct ofpbuf *make_echo_reply(const struct ofp_header *rq);
 int check_ofp_message(const struct ofp_header *, uint8_t type, size_t size);
@@ -425,6 +425,7 @@ vlog_init(void)
 void
 vlog_exit(void) 
 {
+    vlog_run();
     closelog(); 
 }
 
@@ -622,14 +623,18 @@ vlog(enum vlog_module module, enum vlog_level level, const char *message, ...)
     va_end(args);
 }
 
-void
-vlog_rate_limit(enum vlog_module module, enum vlog_level level,
-                struct vlog_rate_limit *rl, const char *message, ...)
+/* Returns true if a message at 'level' for 'module' should be dropped, either
+ * because that level is disabled or because 'rl' is out of tokens, otherwise
+ * false.  A caller that is about to format an expensive message can call this
+ * first and skip the formatting if the message would be dropped anyway.  If
+ * the message is to be logged and 'rl' dropped messages earlier, this logs how
+ * many. */
+bool
+vlog_should_drop(enum vlog_module module, enum vlog_level level,
+                 struct vlog_rate_limit *rl)
 {
-    va_list args;
-
     if (!vlog_is_enabled(module, level)) {
-        return;
+        return true;
     }
 
     if (rl->tokens < VLOG_MSG_TOKENS) {
@@ -649,21 +654,113 @@ vlog_rate_limit(enum vlog_module module, enum vlog_level level,
                 rl->first_dropped = now;
             }
             rl->n_dropped++;
-            return;
+            return true;
         }
     }
     rl->tokens -= VLOG_MSG_TOKENS;
 
-    va_start(args, message);
-    vlog_valist(module, level, message, args);
-    va_end(args);
-
     if (rl->n_dropped) {
         vlog(module, level,
              "Dropped %u messages in last %u seconds due to excessive rate",
              rl->n_dropped, (unsigned int) (time_now() - rl->first_dropped));
         rl->n_dropped = 0;
     }
+    return false;
+}
+
+void
+vlog_rate_limit(enum vlog_module module, enum vlog_level level,
+                struct vlog_rate_limit *rl, const char *message, ...)
+{
+    va_list args;
+
+    if (vlog_should_drop(module, level, rl)) {
+        return;
+    }
+
+    va_start(args, message);
+    vlog_valist(module, level, message, args);
+    va_end(args);
+}
+
+/* A message passed to vlog_defer() and not yet logged. */
+struct vlog_deferred {
+    enum vlog_module module;
+    enum vlog_level level;
+    vlog_format_func *format;
+    char *prefix;               /* Logged ahead of the formatted data. */
+    void *data;                 /* Copy of the data to format. */
+    size_t size;                /* Number of bytes in 'data'. */
+};
+
+/* Maximum number of messages awaiting vlog_run().  Messages deferred beyond
+ * this are dropped, which bounds the memory and the formatting time that
+ * deferred logging can take between calls to vlog_run(). */
+#define VLOG_MAX_DEFERRED 64
+
+static struct vlog_deferred deferred[VLOG_MAX_DEFERRED];
+static size_t n_deferred;
+static unsigned int n_deferred_dropped;
+
+/* Arranges for 'format' to be called on a copy of the 'size' bytes at 'data'
+ * the next time vlog_run() runs, and for 'prefix' followed by the string that
+ * it returns to be logged then at 'level' for 'module'.  At most 'max_copy'
+ * bytes of 'data' are copied, so 'format' must accept truncated data.  Takes
+ * ownership of 'prefix', which must have been allocated with malloc().
+ *
+ * The caller should check that the message will be logged, e.g. with
+ * vlog_should_drop(), before copying anything to build 'prefix'. */
+void
+vlog_defer(enum vlog_module module, enum vlog_level level,
+           vlog_format_func *format, char *prefix,
+           const void *data, size_t size, size_t max_copy)
+{
+    static bool registered;
+    struct vlog_deferred *d;
+
+    if (n_deferred >= VLOG_MAX_DEFERRED) {
+        n_deferred_dropped++;
+        free(prefix);
+        return;
+    }
+    if (!registered) {
+        registered = true;
+        atexit(vlog_run);
+    }
+
+    d = &deferred[n_deferred++];
+    d->module = module;
+    d->level = level;
+    d->format = format;
+    d->prefix = prefix;
+    d->size = MIN(size, max_copy);
+    d->data = xmemdup(data, d->size);
+}
+
+/* Formats and logs the messages passed to vlog_defer() since the last call. */
+void
+vlog_run(void)
+{
+    size_t i;
+
+    for (i = 0; i < n_deferred; i++) {
+        struct vlog_deferred *d = &deferred[i];
+
+        if (vlog_is_enabled(d->module, d->level)) {
+            char *s = d->format(d->data, d->size);
+            vlog(d->module, d->level, "%s%s", d->prefix, s);
+            free(s);
+        }
+        free(d->prefix);
+        free(d->data);
+    }
+    n_deferred = 0;
+
+    if (n_deferred_dropped) {
+        VLOG_WARN("Dropped %u deferred messages because too many were "
+                  "pending", n_deferred_dropped);
+        n_deferred_dropped = 0;
+    }
 }
 
 void
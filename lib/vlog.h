@@ -139,6 +139,17 @@ void vlog_valist(enum vlog_module, enum vlog_level, const char *, va_list)
 void vlog_rate_limit(enum vlog_module, enum vlog_level,
                      struct vlog_rate_limit *, const char *, ...)
     __attribute__((format(printf, 4, 5)));
+bool vlog_should_drop(enum vlog_module, enum vlog_level,
+                      struct vlog_rate_limit *);
+
+/* Deferred logging.  Instead of formatting an expensive message on the spot,
+ * a caller may hand vlog_defer() a copy of the raw data and a function that
+ * formats it.  vlog_run(), which poll_block() calls before it sleeps, formats
+ * and logs the deferred messages. */
+typedef char *vlog_format_func(const void *data, size_t size);
+void vlog_defer(enum vlog_module, enum vlog_level, vlog_format_func *,
+                char *prefix, const void *data, size_t size, size_t max_copy);
+void vlog_run(void);
 
 /* Convenience macros.  To use these, define THIS_MODULE as a macro that
  * expands to the module used by the current source file, e.g.
@@ -26,6 +26,15 @@ secchan_ofprotocol_SOURCES = \
 	secchan/stp-secchan.h
 secchan_ofprotocol_LDADD = lib/libopenflow.a $(FAULT_LIBS) $(SSL_LIBS)
 
+#
+# Build secchan as a library, for running it inside ofdatapath
+#
+
+noinst_LIBRARIES += secchan/libsecchan.a
+
+secchan_libsecchan_a_SOURCES = $(secchan_ofprotocol_SOURCES)
+secchan_libsecchan_a_CPPFLAGS = $(AM_CPPFLAGS) -DSECCHAN_AS_LIB
+
 EXTRA_DIST += secchan/ofprotocol.8.in
 DISTCLEANFILES += secchan/ofprotocol.8
 
@@ -38,6 +38,8 @@
 #include <string.h>
 #include "learning-switch.h"
 #include "netdev.h"
+#include "ofpbuf.h"
+#include "openflow/openflow-ext.h"
 #include "packets.h"
 #include "port-watcher.h"
 #include "rconn.h"
@@ -45,10 +47,18 @@
 #include "status.h"
 #include "stp-secchan.h"
 #include "timeval.h"
+#include "vconn.h"
 
 #define THIS_MODULE VLM_fail_open
 #include "vlog.h"
 
+/* Who learns MAC addresses while failing open. */
+enum dp_learning {
+    DP_LEARNING_OFF,            /* Not failing open. */
+    DP_LEARNING_REQUESTED,      /* Asked the datapath to handle misses. */
+    DP_LEARNING_REFUSED         /* Datapath refused, 'lswitch' learns. */
+};
+
 struct fail_open_data {
     const struct settings *s;
     struct rconn *local_rconn;
@@ -56,8 +66,61 @@ struct fail_open_data {
     struct lswitch *lswitch;
     int last_disconn_secs;
     time_t boot_deadline;
+
+    /* Learning in the datapath.  'lswitch' exists even when the datapath
+     * learns, to handle anything that the datapath still sends up. */
+    enum dp_learning dp_learning;
+    unsigned int dp_learning_seqno; /* 'local_rconn' seqno when requested. */
+    uint32_t dp_learning_xid;   /* xid of the request. */
 };
 
+/* Sends the datapath an OFP_EXT_SET_FAIL_OPEN request to start or stop
+ * learning MAC addresses itself, according to 'enable'. */
+static void
+send_set_fail_open(struct fail_open_data *fail_open, bool enable)
+{
+    struct openflow_ext_set_fail_open *sfo;
+    struct ofpbuf *msg;
+
+    sfo = make_openflow(sizeof *sfo, OFPT_VENDOR, &msg);
+    sfo->header.vendor = htonl(OPENFLOW_VENDOR_ID);
+    sfo->header.subtype = htonl(OFP_EXT_SET_FAIL_OPEN);
+    sfo->max_idle = htons(fail_open->s->max_idle);
+    sfo->enable = enable;
+    fail_open->dp_learning_xid = sfo->header.header.xid;
+    rconn_send(fail_open->local_rconn, msg, NULL);
+}
+
+/* Asks the datapath to learn MAC addresses itself, unless it already refused,
+ * each time the connection to it comes up while failing open. */
+static void
+request_dp_learning(struct fail_open_data *fail_open)
+{
+    unsigned int seqno = rconn_get_connection_seqno(fail_open->local_rconn);
+
+    if (fail_open->dp_learning != DP_LEARNING_REFUSED
+        && fail_open->dp_learning_seqno != seqno
+        && rconn_is_connected(fail_open->local_rconn)) {
+        send_set_fail_open(fail_open, true);
+        fail_open->dp_learning = DP_LEARNING_REQUESTED;
+        fail_open->dp_learning_seqno = seqno;
+    }
+}
+
+/* Takes back a request_dp_learning() request, so that the datapath deletes
+ * the flows it learned before the controller takes over. */
+static void
+cancel_dp_learning(struct fail_open_data *fail_open)
+{
+    if (fail_open->dp_learning == DP_LEARNING_REQUESTED
+        && fail_open->dp_learning_seqno
+           == rconn_get_connection_seqno(fail_open->local_rconn)) {
+        send_set_fail_open(fail_open, false);
+    }
+    fail_open->dp_learning = DP_LEARNING_OFF;
+    fail_open->dp_learning_seqno = 0;
+}
+
 /* Causes 'r' to enter or leave fail-open mode, if appropriate. */
 static void
 fail_open_periodic_cb(void *fail_open_)
@@ -74,6 +137,7 @@ fail_open_periodic_cb(void *fail_open_)
     if (open != (fail_open->lswitch != NULL)) {
         if (!open) {
             VLOG_WARN("No longer in fail-open mode");
+            cancel_dp_learning(fail_open);
             lswitch_destroy(fail_open->lswitch);
             fail_open->lswitch = NULL;
         } else {
@@ -89,6 +153,7 @@ fail_open_periodic_cb(void *fail_open_)
         fail_open->last_disconn_secs = disconn_secs;
     }
     if (fail_open->lswitch) {
+        request_dp_learning(fail_open);
         lswitch_run(fail_open->lswitch, fail_open->local_rconn);
     }
 }
@@ -106,8 +171,17 @@ static bool
 fail_open_local_packet_cb(struct relay *r, void *fail_open_)
 {
     struct fail_open_data *fail_open = fail_open_;
+    struct ofp_header *oh = r->halves[HALF_LOCAL].rxbuf->data;
+
     if (rconn_is_connected(fail_open->remote_rconn) || !fail_open->lswitch) {
         return false;
+    } else if (oh->type == OFPT_ERROR
+               && oh->xid == fail_open->dp_learning_xid
+               && fail_open->dp_learning == DP_LEARNING_REQUESTED) {
+        VLOG_WARN("datapath refused to learn MAC addresses, "
+                  "learning in secchan instead");
+        fail_open->dp_learning = DP_LEARNING_REFUSED;
+        return true;
     } else {
         lswitch_process_packet(fail_open->lswitch, fail_open->local_rconn,
                                r->halves[HALF_LOCAL].rxbuf);
@@ -129,6 +203,10 @@ fail_open_status_cb(struct status_reply *sr, void *fail_open_)
     status_reply_put(sr, "triggered=%s",
                      cur_duration >= trigger_duration ? "true" : "false");
     status_reply_put(sr, "max-idle=%d", s->max_idle);
+    status_reply_put(sr, "learning=%s",
+                     (fail_open->dp_learning == DP_LEARNING_OFF ? "off"
+                      : fail_open->dp_learning == DP_LEARNING_REQUESTED
+                      ? "datapath" : "secchan"));
 }
 
 static struct hook_class fail_open_hook_class = {
@@ -137,6 +215,8 @@ static struct hook_class fail_open_hook_class = {
     fail_open_periodic_cb,      /* periodic_cb */
     fail_open_wait_cb,          /* wait_cb */
     NULL,                       /* closing_cb */
+    HOOK_ALL_TYPES,             /* local_types */
+    0,                          /* remote_types */
 };
 
 void
@@ -149,9 +229,14 @@ fail_open_start(struct secchan *secchan, const struct settings *s,
     fail_open->local_rconn = local_rconn;
     fail_open->remote_rconn = remote_rconn;
     fail_open->lswitch = NULL;
+    fail_open->dp_learning = DP_LEARNING_OFF;
+    fail_open->dp_learning_seqno = 0;
+    fail_open->dp_learning_xid = 0;
     fail_open->boot_deadline = time_now() + s->probe_interval * 3;
     if (s->enable_stp) {
-        fail_open->boot_deadline += STP_EXTRA_BOOT_TIME;
+        fail_open->boot_deadline += (s->enable_rstp
+                                     ? RSTP_EXTRA_BOOT_TIME
+                                     : STP_EXTRA_BOOT_TIME);
     }
     switch_status_register_category(ss, "fail-open",
                                     fail_open_status_cb, fail_open);
@@ -123,6 +123,8 @@ failover_start(struct secchan *secchan, const struct settings *settings,
 		failover_periodic_cb,	/* periodic_cb */
 		NULL,		/* wait_cb */
 		NULL,		/* closing_cb */
+		0,	/* local_types */
+		0,	/* remote_types */
 	};
 
 	context = xmalloc(sizeof(*context));
@@ -310,6 +310,8 @@ static struct hook_class in_band_hook_class = {
     in_band_periodic_cb,        /* periodic_cb */
     in_band_wait_cb,            /* wait_cb */
     NULL,                       /* closing_cb */
+    HOOK_TYPE(OFPT_PACKET_IN),  /* local_types */
+    0,                          /* remote_types */
 };
 
 void
@@ -594,6 +594,9 @@ static struct hook_class port_watcher_hook_class = {
     port_watcher_periodic_cb,                            /* periodic_cb */
     port_watcher_wait_cb,                                /* wait_cb */
     NULL,                                                /* closing_cb */
+    (HOOK_TYPE(OFPT_FEATURES_REPLY)
+     | HOOK_TYPE(OFPT_PORT_STATUS)),                     /* local_types */
+    HOOK_TYPE(OFPT_PORT_MOD),                            /* remote_types */
 };
 
 void
@@ -190,6 +190,8 @@ protocol_stat_start(struct secchan *secchan, const struct settings *settings,
 		NULL,		/* periodic_cb */
 		NULL,		/* wait_cb */
 		NULL,		/* closing_cb */
+		0,	/* local_types */
+		HOOK_TYPE(OFPT_VENDOR),	/* remote_types */
 	};
 
 	context = xmalloc(sizeof(*context));
@@ -240,6 +240,8 @@ static struct hook_class rate_limit_hook_class = {
     rate_limit_periodic_cb,     /* periodic_cb */
     rate_limit_wait_cb,         /* wait_cb */
     NULL,                       /* closing_cb */
+    HOOK_TYPE(OFPT_PACKET_IN),  /* local_types */
+    0,                          /* remote_types */
 };
 
 void
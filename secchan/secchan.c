@@ -80,6 +80,21 @@ struct hook {
 struct secchan {
     struct hook *hooks;
     size_t n_hooks, allocated_hooks;
+
+    /* Union of the hooks' local_types and remote_types. */
+    uint32_t local_types, remote_types;
+
+    struct settings s;
+
+    struct list relays;
+
+    struct pvconn *monitor;
+    struct pvconn *listeners[MAX_MGMT];
+    size_t n_listeners;
+
+    struct rconn *local_rconn, *remote_rconn;
+    struct discovery *discovery;
+    struct switch_status *switch_status;
 };
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
@@ -99,49 +114,20 @@ static void relay_run(struct relay *, struct secchan *);
 static void relay_wait(struct relay *);
 static void relay_destroy(struct relay *);
 
+#if !defined(SECCHAN_AS_LIB)
 int
 main(int argc, char *argv[])
 {
-    struct settings s;
-
-    struct list relays = LIST_INITIALIZER(&relays);
-
-    struct secchan secchan;
-
-    struct pvconn *monitor;
-
-    struct pvconn *listeners[MAX_MGMT];
-    size_t n_listeners;
-
-    char *local_rconn_name;
-    struct rconn *async_rconn, *local_rconn, *remote_rconn;
-    struct relay *controller_relay;
-    struct discovery *discovery;
-    struct switch_status *switch_status;
-    struct port_watcher *pw;
-    int i;
+    struct secchan *secchan;
     int retval;
 
     set_program_name(argv[0]);
     register_fault_handlers();
     time_init();
     vlog_init();
-    parse_options(argc, argv, &s);
     signal(SIGPIPE, SIG_IGN);
 
-    secchan.hooks = NULL;
-    secchan.n_hooks = 0;
-    secchan.allocated_hooks = 0;
-
-    /* Start listening for management and monitoring connections. */
-    n_listeners = 0;
-    for (i = 0; i < s.n_listeners; i++) {
-        listeners[n_listeners++] = open_passive_vconn(s.listener_names[i]);
-    }
-    monitor = s.monitor_name ? open_passive_vconn(s.monitor_name) : NULL;
-
-    /* Initialize switch status hook. */
-    switch_status_start(&secchan, &s, &switch_status);
+    secchan = secchan_create(argc, argv);
 
     die_if_already_running();
     daemonize();
@@ -155,21 +141,71 @@ main(int argc, char *argv[])
     VLOG_INFO("OpenFlow reference implementation version %s", VERSION BUILDNR);
     VLOG_INFO("OpenFlow protocol version 0x%02x", OFP_VERSION);
 
+    secchan_start(secchan);
+    while (secchan_run(secchan)) {
+        secchan_wait(secchan);
+        poll_block();
+    }
+
+    return 0;
+}
+#endif
+
+/* Creates a secure channel configured by the command-line options in 'argc'
+ * and 'argv', and starts listening for management and monitoring
+ * connections.  The caller must then call secchan_start() to connect to the
+ * datapath and the controller. */
+struct secchan *
+secchan_create(int argc, char *argv[])
+{
+    struct secchan *secchan = xcalloc(1, sizeof *secchan);
+    struct settings *s = &secchan->s;
+    int i;
+
+    parse_options(argc, argv, s);
+    list_init(&secchan->relays);
+
+    /* Start listening for management and monitoring connections. */
+    for (i = 0; i < s->n_listeners; i++) {
+        secchan->listeners[secchan->n_listeners++]
+            = open_passive_vconn(s->listener_names[i]);
+    }
+    secchan->monitor = (s->monitor_name
+                        ? open_passive_vconn(s->monitor_name) : NULL);
+
+    /* Initialize switch status hook. */
+    switch_status_start(secchan, s, &secchan->switch_status);
+
+    return secchan;
+}
+
+/* Connects 'secchan' to its datapath and controller and sets up its hooks. */
+void
+secchan_start(struct secchan *secchan)
+{
+    const struct settings *s = &secchan->s;
+    struct switch_status *switch_status = secchan->switch_status;
+    struct rconn *async_rconn, *local_rconn, *remote_rconn;
+    struct relay *controller_relay;
+    char *local_rconn_name;
+    struct port_watcher *pw;
+    int retval;
+
     /* Check datapath name, to try to catch command-line invocation errors. */
-    if (strncmp(s.dp_name, "nl:", 3) && strncmp(s.dp_name, "unix:", 5)
-        && !s.controller_names[0]) {
-        VLOG_WARN("Controller not specified and datapath is not nl: or "
-                  "unix:.  (Did you forget to specify the datapath?)");
+    if (strncmp(s->dp_name, "nl:", 3) && strncmp(s->dp_name, "unix:", 5)
+        && strncmp(s->dp_name, "mem:", 4) && !s->controller_names[0]) {
+        VLOG_WARN("Controller not specified and datapath is not nl:, unix: "
+                  "or mem:.  (Did you forget to specify the datapath?)");
     }
 
-    if (!strncmp(s.dp_name, "nl:", 3)) {
+    if (!strncmp(s->dp_name, "nl:", 3)) {
         /* Connect to datapath with a subscription for asynchronous events.  By
          * separating the connection for asynchronous events from that for
          * request and replies we prevent the socket receive buffer from being
          * filled up by received packet data, which in turn would prevent
          * getting replies to any Netlink messages we send to the kernel. */
-        async_rconn = rconn_create(0, s.max_backoff);
-        rconn_connect(async_rconn, s.dp_name);
+        async_rconn = rconn_create(0, s->max_backoff);
+        rconn_connect(async_rconn, s->dp_name);
         switch_status_register_category(switch_status, "async",
                                         rconn_status_cb, async_rconn);
     } else {
@@ -183,121 +219,137 @@ main(int argc, char *argv[])
     }
 
     /* Connect to datapath without a subscription, for requests and replies. */
-    local_rconn_name = vconn_name_without_subscription(s.dp_name);
-    local_rconn = rconn_create(0, s.max_backoff);
+    local_rconn_name = vconn_name_without_subscription(s->dp_name);
+    local_rconn = rconn_create(0, s->max_backoff);
     rconn_connect(local_rconn, local_rconn_name);
     free(local_rconn_name);
     switch_status_register_category(switch_status, "local",
                                     rconn_status_cb, local_rconn);
 
     /* Connect to controller. */
-    remote_rconn = rconn_create(s.probe_interval, s.max_backoff);
-    if (s.controller_names[0]) {
-        retval = rconn_connect(remote_rconn, s.controller_names[0]);
+    remote_rconn = rconn_create(s->probe_interval, s->max_backoff);
+    if (s->controller_names[0]) {
+        retval = rconn_connect(remote_rconn, s->controller_names[0]);
         if (retval == EAFNOSUPPORT) {
-            ofp_fatal(0, "No support for %s vconn", s.controller_names[0]);
+            ofp_fatal(0, "No support for %s vconn", s->controller_names[0]);
         }
     }
     switch_status_register_category(switch_status, "remote",
                                     rconn_status_cb, remote_rconn);
+    secchan->local_rconn = local_rconn;
+    secchan->remote_rconn = remote_rconn;
 
     /* Start relaying. */
     controller_relay = relay_create(async_rconn, local_rconn, remote_rconn,
                                     false);
-    list_push_back(&relays, &controller_relay->node);
+    list_push_back(&secchan->relays, &controller_relay->node);
 
     /* Set up hooks. */
-    port_watcher_start(&secchan, local_rconn, remote_rconn, &pw);
-    discovery = s.discovery ? discovery_init(&s, pw, switch_status) : NULL;
-    if (s.enable_stp) {
-        stp_start(&secchan, pw, local_rconn, remote_rconn);
+    port_watcher_start(secchan, local_rconn, remote_rconn, &pw);
+    secchan->discovery = (s->discovery
+                          ? discovery_init(s, pw, switch_status) : NULL);
+    if (s->enable_stp) {
+        stp_start(secchan, s, switch_status, pw, local_rconn, remote_rconn);
     }
-    if (s.in_band) {
-        in_band_start(&secchan, &s, switch_status, pw, remote_rconn);
+    if (s->in_band) {
+        in_band_start(secchan, s, switch_status, pw, remote_rconn);
     }
-    if (s.fail_mode == FAIL_OPEN) {
-        fail_open_start(&secchan, &s, switch_status,
+    if (s->fail_mode == FAIL_OPEN) {
+        fail_open_start(secchan, s, switch_status,
                         local_rconn, remote_rconn);
     }
-    if (s.num_controllers > 1) {
-        failover_start(&secchan, &s, switch_status, remote_rconn);
+    if (s->num_controllers > 1) {
+        failover_start(secchan, s, switch_status, remote_rconn);
     }
-    if (s.n_listeners > 0) {
-        protocol_stat_start(&secchan, &s, local_rconn, remote_rconn);
+    if (s->n_listeners > 0) {
+        protocol_stat_start(secchan, s, local_rconn, remote_rconn);
     }
-    if (s.rate_limit) {
-        rate_limit_start(&secchan, &s, switch_status, remote_rconn);
+    if (s->rate_limit) {
+        rate_limit_start(secchan, s, switch_status, remote_rconn);
     }
-    if (s.emerg_flow) {
-        emerg_flow_start(&secchan, &s, switch_status, local_rconn, remote_rconn);
+    if (s->emerg_flow) {
+        emerg_flow_start(secchan, s, switch_status, local_rconn, remote_rconn);
     }
+}
 
-    while (s.discovery || rconn_is_alive(remote_rconn)) {
-        struct relay *r, *n;
-        size_t i;
+/* Performs periodic work for 'secchan'.  Returns false once 'secchan' has
+ * lost its controller connection for good and should exit. */
+bool
+secchan_run(struct secchan *secchan)
+{
+    const struct settings *s = &secchan->s;
+    struct relay *r, *n;
+    size_t i;
 
-        /* Do work. */
-        LIST_FOR_EACH_SAFE (r, n, struct relay, node, &relays) {
-            relay_run(r, &secchan);
-        }
-        for (i = 0; i < n_listeners; i++) {
-            for (;;) {
-                struct relay *r = relay_accept(&s, listeners[i]);
-                if (!r) {
-                    break;
-                }
-                list_push_back(&relays, &r->node);
-            }
-        }
-        if (monitor) {
-            struct vconn *new = accept_vconn(monitor);
-            if (new) {
-                /* XXX should monitor async_rconn too but rconn_add_monitor()
-                 * takes ownership of the vconn passed in. */
-                rconn_add_monitor(local_rconn, new);
-            }
-        }
-        for (i = 0; i < secchan.n_hooks; i++) {
-            if (secchan.hooks[i].class->periodic_cb) {
-                secchan.hooks[i].class->periodic_cb(secchan.hooks[i].aux);
-            }
-        }
-        if (s.discovery) {
-            char *controller_name;
-            if (rconn_is_connectivity_questionable(remote_rconn)) {
-                discovery_question_connectivity(discovery);
-            }
-            if (discovery_run(discovery, &controller_name)) {
-                if (controller_name) {
-                    rconn_connect(remote_rconn, controller_name);
-                } else {
-                    rconn_disconnect(remote_rconn);
-                }
+    if (!s->discovery && !rconn_is_alive(secchan->remote_rconn)) {
+        return false;
+    }
+
+    LIST_FOR_EACH_SAFE (r, n, struct relay, node, &secchan->relays) {
+        relay_run(r, secchan);
+    }
+    for (i = 0; i < secchan->n_listeners; i++) {
+        for (;;) {
+            struct relay *r = relay_accept(s, secchan->listeners[i]);
+            if (!r) {
+                break;
             }
+            list_push_back(&secchan->relays, &r->node);
         }
-
-        /* Wait for something to happen. */
-        LIST_FOR_EACH (r, struct relay, node, &relays) {
-            relay_wait(r);
+    }
+    if (secchan->monitor) {
+        struct vconn *new = accept_vconn(secchan->monitor);
+        if (new) {
+            /* XXX should monitor async_rconn too but rconn_add_monitor()
+             * takes ownership of the vconn passed in. */
+            rconn_add_monitor(secchan->local_rconn, new);
         }
-        for (i = 0; i < n_listeners; i++) {
-            pvconn_wait(listeners[i]);
+    }
+    for (i = 0; i < secchan->n_hooks; i++) {
+        if (secchan->hooks[i].class->periodic_cb) {
+            secchan->hooks[i].class->periodic_cb(secchan->hooks[i].aux);
         }
-        if (monitor) {
-            pvconn_wait(monitor);
+    }
+    if (s->discovery) {
+        char *controller_name;
+        if (rconn_is_connectivity_questionable(secchan->remote_rconn)) {
+            discovery_question_connectivity(secchan->discovery);
         }
-        for (i = 0; i < secchan.n_hooks; i++) {
-            if (secchan.hooks[i].class->wait_cb) {
-                secchan.hooks[i].class->wait_cb(secchan.hooks[i].aux);
+        if (discovery_run(secchan->discovery, &controller_name)) {
+            if (controller_name) {
+                rconn_connect(secchan->remote_rconn, controller_name);
+            } else {
+                rconn_disconnect(secchan->remote_rconn);
             }
         }
-        if (discovery) {
-            discovery_wait(discovery);
-        }
-        poll_block();
     }
+    return true;
+}
 
-    return 0;
+/* Arranges for the poll loop to wake up when 'secchan' has work to do. */
+void
+secchan_wait(struct secchan *secchan)
+{
+    struct relay *r;
+    size_t i;
+
+    LIST_FOR_EACH (r, struct relay, node, &secchan->relays) {
+        relay_wait(r);
+    }
+    for (i = 0; i < secchan->n_listeners; i++) {
+        pvconn_wait(secchan->listeners[i]);
+    }
+    if (secchan->monitor) {
+        pvconn_wait(secchan->monitor);
+    }
+    for (i = 0; i < secchan->n_hooks; i++) {
+        if (secchan->hooks[i].class->wait_cb) {
+            secchan->hooks[i].class->wait_cb(secchan->hooks[i].aux);
+        }
+    }
+    if (secchan->discovery) {
+        discovery_wait(secchan->discovery);
+    }
 }
 
 static struct pvconn *
@@ -338,6 +390,9 @@ add_hook(struct secchan *secchan, const struct hook_class *class, void *aux)
     hook = &secchan->hooks[secchan->n_hooks++];
     hook->class = class;
     hook->aux = aux;
+
+    secchan->local_types |= class->local_types;
+    secchan->remote_types |= class->remote_types;
 }
 
 struct ofp_packet_in *
@@ -467,6 +522,82 @@ call_remote_packet_cbs(struct secchan *secchan, struct relay *r)
     return false;
 }
 
+/* Passes the message in half 'i' of 'r' to the hooks, if any hook wants to
+ * see messages of its type.  Returns true if a hook consumed the message, in
+ * which case it has been freed. */
+static bool
+relay_call_hooks(struct relay *r, struct secchan *secchan, int i)
+{
+    struct half *this = &r->halves[i];
+    const struct ofp_header *oh = this->rxbuf->data;
+    uint32_t types;
+
+    if (i == HALF_LOCAL && r->is_mgmt_conn) {
+        return false;
+    }
+
+    types = i == HALF_LOCAL ? secchan->local_types : secchan->remote_types;
+    if (oh->type < 32 && !(types & HOOK_TYPE(oh->type))) {
+        return false;
+    }
+
+    if (i == HALF_LOCAL
+        ? call_local_packet_cbs(secchan, r)
+        : call_remote_packet_cbs(secchan, r)) {
+        ofpbuf_delete(this->rxbuf);
+        this->rxbuf = NULL;
+        return true;
+    }
+    return false;
+}
+
+/* Maximum number of messages relayed in one direction before turning to the
+ * other direction. */
+#define RELAY_BURST 8
+
+/* Relays up to RELAY_BURST messages received on half 'i' of 'r' to the other
+ * half, stopping early when there is nothing to receive or the other half is
+ * backlogged.  Returns true if any progress was made. */
+static bool
+relay_half_run(struct relay *r, struct secchan *secchan, int i)
+{
+    struct half *this = &r->halves[i];
+    struct half *peer = &r->halves[!i];
+    bool progress = false;
+    int n;
+
+    for (n = 0; n < RELAY_BURST; n++) {
+        int retval;
+
+        if (!this->rxbuf) {
+            this->rxbuf = rconn_recv(this->rconn);
+            if (!this->rxbuf && i == HALF_LOCAL && r->async_rconn) {
+                this->rxbuf = rconn_recv(r->async_rconn);
+            }
+            if (!this->rxbuf) {
+                break;
+            } else if (relay_call_hooks(r, secchan, i)) {
+                progress = true;
+                continue;
+            }
+        }
+
+        if (this->n_txq) {
+            break;
+        }
+        retval = rconn_send(peer->rconn, this->rxbuf, &this->n_txq);
+        if (retval == EAGAIN) {
+            break;
+        } else if (!retval) {
+            progress = true;
+        } else {
+            ofpbuf_delete(this->rxbuf);
+        }
+        this->rxbuf = NULL;
+    }
+    return progress;
+}
+
 static void
 relay_run(struct relay *r, struct secchan *secchan)
 {
@@ -484,38 +615,8 @@ relay_run(struct relay *r, struct secchan *secchan)
     for (iteration = 0; iteration < 50; iteration++) {
         bool progress = false;
         for (i = 0; i < 2; i++) {
-            struct half *this = &r->halves[i];
-            struct half *peer = &r->halves[!i];
-
-            if (!this->rxbuf) {
-                this->rxbuf = rconn_recv(this->rconn);
-                if (!this->rxbuf && i == HALF_LOCAL && r->async_rconn) {
-                    this->rxbuf = rconn_recv(r->async_rconn);
-                }
-                if (this->rxbuf && (i == HALF_REMOTE || !r->is_mgmt_conn)) {
-                    if (i == HALF_LOCAL
-                        ? call_local_packet_cbs(secchan, r)
-                        : call_remote_packet_cbs(secchan, r))
-                    {
-                        ofpbuf_delete(this->rxbuf);
-                        this->rxbuf = NULL;
-                        progress = true;
-                        break;
-                    }
-                }
-            }
-
-            if (this->rxbuf && !this->n_txq) {
-                int retval = rconn_send(peer->rconn, this->rxbuf,
-                                        &this->n_txq);
-                if (retval != EAGAIN) {
-                    if (!retval) {
-                        progress = true;
-                    } else {
-                        ofpbuf_delete(this->rxbuf);
-                    }
-                    this->rxbuf = NULL;
-                }
+            if (relay_half_run(r, secchan, i)) {
+                progress = true;
             }
         }
         if (!progress) {
@@ -585,11 +686,13 @@ parse_options(int argc, char *argv[], struct settings *s)
         OPT_BURST_LIMIT,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_STP,
+        OPT_RSTP,
         OPT_NO_STP,
         OPT_OUT_OF_BAND,
         OPT_IN_BAND,
         OPT_EMERG_FLOW,
         VLOG_OPTION_ENUMS,
+        VCONN_LOG_OPTION_ENUMS,
         LEAK_CHECKER_OPTION_ENUMS
     };
     static struct option long_options[] = {
@@ -604,6 +707,7 @@ parse_options(int argc, char *argv[], struct settings *s)
         {"rate-limit",  optional_argument, 0, OPT_RATE_LIMIT},
         {"burst-limit", required_argument, 0, OPT_BURST_LIMIT},
         {"stp",         no_argument, 0, OPT_STP},
+        {"rstp",        no_argument, 0, OPT_RSTP},
         {"no-stp",      no_argument, 0, OPT_NO_STP},
         {"out-of-band", no_argument, 0, OPT_OUT_OF_BAND},
         {"in-band",     no_argument, 0, OPT_IN_BAND},
@@ -613,6 +717,7 @@ parse_options(int argc, char *argv[], struct settings *s)
         {"version",     no_argument, 0, 'V'},
         DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
+        VCONN_LOG_LONG_OPTIONS,
         LEAK_CHECKER_LONG_OPTIONS,
 #ifdef HAVE_OPENSSL
         VCONN_SSL_LONG_OPTIONS
@@ -635,6 +740,7 @@ parse_options(int argc, char *argv[], struct settings *s)
     s->rate_limit = 0;
     s->burst_limit = 0;
     s->enable_stp = false;
+    s->enable_rstp = false;
     s->in_band = true;
     s->emerg_flow = false;
     for (;;) {
@@ -713,10 +819,17 @@ parse_options(int argc, char *argv[], struct settings *s)
 
         case OPT_STP:
             s->enable_stp = true;
+            s->enable_rstp = false;
+            break;
+
+        case OPT_RSTP:
+            s->enable_stp = true;
+            s->enable_rstp = true;
             break;
 
         case OPT_NO_STP:
             s->enable_stp = false;
+            s->enable_rstp = false;
             break;
 
         case OPT_OUT_OF_BAND:
@@ -759,6 +872,8 @@ parse_options(int argc, char *argv[], struct settings *s)
 
         VLOG_OPTION_HANDLERS
 
+        VCONN_LOG_OPTION_HANDLERS
+
         LEAK_CHECKER_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -866,6 +981,7 @@ usage(void)
            "                          (a passive OpenFlow connection method)\n"
            "  --out-of-band           controller connection is out-of-band\n"
            "  --stp                   enable 802.1D Spanning Tree Protocol\n"
+           "  --rstp                  enable 802.1w Rapid Spanning Tree Protocol\n"
            "  --no-stp                disable 802.1D Spanning Tree Protocol\n"
            "  --emerg-flow            enable emergency flow protection/restoration\n"
            "\nRate-limiting of \"packet-in\" messages to the controller:\n"
@@ -874,6 +990,7 @@ usage(void)
            ofp_pkgdatadir);
     daemon_usage();
     vlog_usage();
+    vconn_log_usage();
     printf("\nOther options:\n"
            "  -h, --help              display this help message\n"
            "  -V, --version           display version information\n");
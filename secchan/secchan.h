@@ -37,6 +37,7 @@
 #include <regex.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "list.h"
 #include "packets.h"
 
@@ -84,6 +85,7 @@ struct settings {
 
     /* Spanning tree protocol. */
     bool enable_stp;
+    bool enable_rstp;         /* Use 802.1w Rapid STP?  Implies enable_stp. */
 
     /* Emergency flow protection/restoration behavior. */
     bool emerg_flow;
@@ -116,16 +118,33 @@ struct relay {
     struct rconn *async_rconn;  /* For receiving asynchronous events. */
 };
 
+/* Bit for OpenFlow message type 'TYPE' in a hook's message type set. */
+#define HOOK_TYPE(TYPE) (1u << (TYPE))
+#define HOOK_ALL_TYPES UINT32_MAX
+
 struct hook_class {
     bool (*local_packet_cb)(struct relay *, void *aux);
     bool (*remote_packet_cb)(struct relay *, void *aux);
     void (*periodic_cb)(void *aux);
     void (*wait_cb)(void *aux);
     void (*closing_cb)(struct relay *, void *aux);
+
+    /* Sets of HOOK_TYPE bits for the OpenFlow message types that
+     * local_packet_cb and remote_packet_cb, respectively, need to see.  The
+     * relay forwards messages of other types without calling any hook. */
+    uint32_t local_types;
+    uint32_t remote_types;
 };
 
 void add_hook(struct secchan *, const struct hook_class *, void *);
 
+/* Running a secure channel.  ofprotocol runs one on its own; ofdatapath can
+ * run one in its own process, connected over an in-process "mem:" vconn. */
+struct secchan *secchan_create(int argc, char *argv[]);
+void secchan_start(struct secchan *);
+bool secchan_run(struct secchan *);
+void secchan_wait(struct secchan *);
+
 struct ofp_packet_in *get_ofp_packet_in(struct relay *);
 bool get_ofp_packet_eth_header(struct relay *, struct ofp_packet_in **,
                                struct eth_header **);
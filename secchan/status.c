@@ -44,6 +44,7 @@
 #include "rconn.h"
 #include "timeval.h"
 #include "vconn.h"
+#include "vconn-ssl.h"
 
 #define THIS_MODULE VLM_status
 #include "vlog.h"
@@ -165,12 +166,34 @@ switch_status_cb(struct status_reply *sr, void *ss_)
     status_reply_put(sr, "pid=%ld", (long int) getpid());
 }
 
+#ifdef HAVE_OPENSSL
+static void
+ssl_status_cb(struct status_reply *sr, void *aux UNUSED)
+{
+    struct vconn_ssl_stats stats;
+
+    vconn_ssl_get_stats(&stats);
+    status_reply_put(sr, "full-handshakes=%u", stats.n_full);
+    status_reply_put(sr, "resumed-handshakes=%u", stats.n_resumed);
+    if (stats.n_full) {
+        status_reply_put(sr, "full-handshake-msec=%lld",
+                         stats.full_msec / stats.n_full);
+    }
+    if (stats.n_resumed) {
+        status_reply_put(sr, "resumed-handshake-msec=%lld",
+                         stats.resumed_msec / stats.n_resumed);
+    }
+}
+#endif
+
 static struct hook_class switch_status_hook_class = {
     NULL,                           /* local_packet_cb */
     switch_status_remote_packet_cb, /* remote_packet_cb */
     NULL,                           /* periodic_cb */
     NULL,                           /* wait_cb */
     NULL,                           /* closing_cb */
+    0,                              /* local_types */
+    HOOK_TYPE(OFPT_VENDOR),         /* remote_types */
 };
 
 void
@@ -183,6 +206,11 @@ switch_status_start(struct secchan *secchan, const struct settings *s,
     switch_status_register_category(ss, "config",
                                     config_status_cb, (void *) s);
     switch_status_register_category(ss, "switch", switch_status_cb, ss);
+#ifdef HAVE_OPENSSL
+    if (vconn_ssl_is_configured()) {
+        switch_status_register_category(ss, "ssl", ssl_status_cb, NULL);
+    }
+#endif
     *ssp = ss;
     add_hook(secchan, &switch_status_hook_class, ss);
 }
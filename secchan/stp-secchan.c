@@ -35,13 +35,17 @@
 #include "stp-secchan.h"
 #include <arpa/inet.h>
 #include <inttypes.h>
-#include "flow.h"
+#include <stdlib.h>
+#include <string.h>
 #include "secchan.h"
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "packets.h"
 #include "poll-loop.h"
 #include "port-watcher.h"
 #include "rconn.h"
+#include "status.h"
 #include "stp.h"
 #include "timeval.h"
 #include "vconn.h"
@@ -56,37 +60,46 @@ struct stp_data {
     struct rconn *remote_rconn;
     long long int last_tick;
     int n_txq;
+
+    /* Slow-protocol channel: a connection to the datapath of its own, on
+     * which it sends us link-local control frames instead of passing them
+     * to the controller as packet-ins, and on which we send BPDUs.  This
+     * keeps STP working when the packet-in path is flooded.  Null if the
+     * datapath does not support it. */
+    struct rconn *slow_rconn;
+    unsigned int slow_seqno;    /* Connection seqno when we subscribed. */
+    int n_slow_txq;             /* BPDUs queued on 'slow_rconn'. */
+    int n_fwd_txq;              /* Frames queued on 'remote_rconn'. */
+
+    /* Statistics. */
+    unsigned long long int n_slow_bpdus;    /* BPDUs via 'slow_rconn'. */
+    unsigned long long int n_packet_in_bpdus; /* BPDUs via packet-ins. */
+    unsigned long long int n_forwarded;     /* Other frames passed on. */
+    unsigned long long int n_fwd_dropped;   /* Could not be passed on. */
 };
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
+/* Processes 'frame', an Ethernet frame received on 'port_no'.  Returns true
+ * if it was a BPDU that we consumed, false if it should go to the controller
+ * as usual. */
 static bool
-stp_local_packet_cb(struct relay *r, void *stp_)
+stp_receive_frame(struct stp_data *stp, uint16_t port_no,
+                  const struct ofpbuf *frame)
 {
-    struct ofpbuf *msg = r->halves[HALF_LOCAL].rxbuf;
-    struct ofp_header *oh;
-    struct stp_data *stp = stp_;
-    struct ofp_packet_in *opi;
-    struct eth_header *eth;
-    struct llc_header *llc;
+    const struct eth_header *eth;
+    const struct llc_header *llc;
     struct ofpbuf payload;
-    uint16_t port_no;
-    struct flow flow;
+    uint16_t length;
 
-    oh = msg->data;
-    if (oh->type == OFPT_FEATURES_REPLY
-        && msg->size >= offsetof(struct ofp_switch_features, ports)) {
-        struct ofp_switch_features *osf = msg->data;
-        osf->capabilities |= htonl(OFPC_STP);
+    if (frame->size < ETH_HEADER_LEN + LLC_HEADER_LEN) {
         return false;
     }
-
-    if (!get_ofp_packet_eth_header(r, &opi, &eth)
-        || !eth_addr_equals(eth->eth_dst, stp_eth_addr)) {
+    eth = frame->data;
+    if (!eth_addr_equals(eth->eth_dst, stp_eth_addr)) {
         return false;
     }
 
-    port_no = ntohs(opi->in_port);
     if (port_no >= STP_MAX_PORTS) {
         /* STP only supports 255 ports. */
         return false;
@@ -96,18 +109,14 @@ stp_local_packet_cb(struct relay *r, void *stp_)
         return false;
     }
 
-    if (opi->reason == OFPR_ACTION) {
-        /* The controller set up a flow for this, so we won't intercept it. */
-        return false;
-    }
-
-    get_ofp_packet_payload(opi, &payload);
-    flow_extract(&payload, port_no, &flow);
-    if (flow.dl_type != htons(OFP_DL_TYPE_NOT_ETH_TYPE)) {
+    /* BPDUs are 802.3 frames, with a length instead of an Ethertype, and an
+     * LLC header. */
+    length = ntohs(eth->eth_type);
+    if (length >= OFP_DL_TYPE_ETH2_CUTOFF) {
         VLOG_DBG("non-LLC frame received on STP multicast address");
         return false;
     }
-    llc = ofpbuf_at_assert(&payload, sizeof *eth, sizeof *llc);
+    llc = (const struct llc_header *) (eth + 1);
     if (llc->llc_dsap != STP_LLC_DSAP) {
         VLOG_DBG("bad DSAP 0x%02"PRIx8" received on STP multicast address",
                  llc->llc_dsap);
@@ -115,8 +124,9 @@ stp_local_packet_cb(struct relay *r, void *stp_)
     }
 
     /* Trim off padding on payload. */
-    if (payload.size > ntohs(eth->eth_type) + ETH_HEADER_LEN) {
-        payload.size = ntohs(eth->eth_type) + ETH_HEADER_LEN;
+    payload = *frame;
+    if (payload.size > length + ETH_HEADER_LEN) {
+        payload.size = length + ETH_HEADER_LEN;
     }
     if (ofpbuf_try_pull(&payload, ETH_HEADER_LEN + LLC_HEADER_LEN)) {
         struct stp_port *p = stp_get_port(stp->stp, port_no);
@@ -126,6 +136,142 @@ stp_local_packet_cb(struct relay *r, void *stp_)
     return true;
 }
 
+static bool
+stp_local_packet_cb(struct relay *r, void *stp_)
+{
+    struct ofpbuf *msg = r->halves[HALF_LOCAL].rxbuf;
+    struct ofp_header *oh;
+    struct stp_data *stp = stp_;
+    struct ofp_packet_in *opi;
+    struct eth_header *eth;
+    struct ofpbuf payload;
+
+    oh = msg->data;
+    if (oh->type == OFPT_FEATURES_REPLY
+        && msg->size >= offsetof(struct ofp_switch_features, ports)) {
+        struct ofp_switch_features *osf = msg->data;
+        osf->capabilities |= htonl(OFPC_STP);
+        return false;
+    }
+
+    if (!get_ofp_packet_eth_header(r, &opi, &eth)
+        || !eth_addr_equals(eth->eth_dst, stp_eth_addr)) {
+        return false;
+    }
+
+    if (opi->reason == OFPR_ACTION) {
+        /* The controller set up a flow for this, so we won't intercept it. */
+        return false;
+    }
+
+    get_ofp_packet_payload(opi, &payload);
+    if (stp_receive_frame(stp, ntohs(opi->in_port), &payload)) {
+        stp->n_packet_in_bpdus++;
+        return true;
+    }
+    return false;
+}
+
+/* Passes 'frame', a link-local frame that the datapath sent us on the
+ * slow-protocol channel but that is not a BPDU for us, to the controller as
+ * the packet-in that it would otherwise have received. */
+static void
+stp_forward_frame(struct stp_data *stp, uint16_t port_no,
+                  const struct ofpbuf *frame)
+{
+    struct ofp_packet_in *opi;
+    struct ofpbuf *msg;
+    int retval;
+
+    opi = make_openflow(offsetof(struct ofp_packet_in, data) + frame->size,
+                        OFPT_PACKET_IN, &msg);
+    opi->buffer_id = htonl(UINT32_MAX);
+    opi->total_len = htons(frame->size);
+    opi->in_port = htons(port_no);
+    opi->reason = OFPR_NO_MATCH;
+    memcpy(opi->data, frame->data, frame->size);
+
+    /* These frames bypass the packet-in rate limiter, so keep only a short
+     * queue of them, as the rate limiter itself does. */
+    retval = rconn_send_with_limit(stp->remote_rconn, msg, &stp->n_fwd_txq,
+                                   10);
+    if (retval) {
+        stp->n_fwd_dropped++;
+    } else {
+        stp->n_forwarded++;
+    }
+}
+
+/* Handles 'msg', received on the slow-protocol channel. */
+static void
+stp_slow_msg(struct stp_data *stp, struct ofpbuf *msg)
+{
+    const struct openflow_ext_slow_proto_in *spi = msg->data;
+    const struct ofp_header *oh = msg->data;
+    struct ofpbuf frame;
+    uint16_t port_no;
+
+    if (oh->type == OFPT_ERROR) {
+        /* Most likely the datapath does not support the subscription.  Fall
+         * back to intercepting packet-ins. */
+        VLOG_WARN("%s: datapath rejected slow-protocol channel, receiving "
+                  "BPDUs as packet-ins instead",
+                  rconn_get_name(stp->slow_rconn));
+        rconn_destroy(stp->slow_rconn);
+        stp->slow_rconn = NULL;
+        return;
+    } else if (oh->type != OFPT_VENDOR
+               || msg->size < sizeof *spi
+               || spi->header.vendor != htonl(OPENFLOW_VENDOR_ID)
+               || spi->header.subtype != htonl(OFP_EXT_SLOW_PROTO_IN)) {
+        return;
+    }
+
+    port_no = ntohs(spi->in_port);
+    frame.data = (void *) spi->data;
+    frame.size = msg->size - sizeof *spi;
+    if (stp_receive_frame(stp, port_no, &frame)) {
+        stp->n_slow_bpdus++;
+    } else {
+        stp_forward_frame(stp, port_no, &frame);
+    }
+}
+
+/* Runs the slow-protocol channel: subscribes after each (re)connection and
+ * processes what the datapath sends. */
+static void
+stp_slow_run(struct stp_data *stp)
+{
+    int i;
+
+    rconn_run(stp->slow_rconn);
+    if (!rconn_is_connected(stp->slow_rconn)) {
+        return;
+    }
+
+    if (stp->slow_seqno != rconn_get_connection_seqno(stp->slow_rconn)) {
+        struct ofp_extension_header *eh;
+        struct ofpbuf *msg;
+
+        stp->slow_seqno = rconn_get_connection_seqno(stp->slow_rconn);
+        eh = make_openflow(sizeof *eh, OFPT_VENDOR, &msg);
+        eh->vendor = htonl(OPENFLOW_VENDOR_ID);
+        eh->subtype = htonl(OFP_EXT_SLOW_PROTO_SUBSCRIBE);
+        rconn_send(stp->slow_rconn, msg, NULL);
+    }
+
+    /* BPDUs arrive at most a few per second per port, so this limit only
+     * matters when something else is wrong. */
+    for (i = 0; i < 50 && stp->slow_rconn; i++) {
+        struct ofpbuf *msg = rconn_recv(stp->slow_rconn);
+        if (!msg) {
+            break;
+        }
+        stp_slow_msg(stp, msg);
+        ofpbuf_delete(msg);
+    }
+}
+
 static void
 stp_periodic_cb(void *stp_)
 {
@@ -134,6 +280,10 @@ stp_periodic_cb(void *stp_)
     long long int elapsed = now - stp->last_tick;
     struct stp_port *p;
 
+    if (stp->slow_rconn) {
+        stp_slow_run(stp);
+    }
+
     if (!port_watcher_is_ready(stp->pw)) {
         /* Can't start STP until we know port flags, because port flags can
          * disable STP. */
@@ -190,8 +340,14 @@ stp_periodic_cb(void *stp_)
 }
 
 static void
-stp_wait_cb(void *stp_ UNUSED)
+stp_wait_cb(void *stp_)
 {
+    struct stp_data *stp = stp_;
+
+    if (stp->slow_rconn) {
+        rconn_run_wait(stp->slow_rconn);
+        rconn_recv_wait(stp->slow_rconn);
+    }
     poll_timer_wait(1000);
 }
 
@@ -207,7 +363,15 @@ send_bpdu(struct ofpbuf *pkt, int port_no, void *stp_)
         memcpy(eth->eth_src, port_mac, ETH_ADDR_LEN);
         opo = make_unbuffered_packet_out(pkt, OFPP_NONE, port_no);
 
-        rconn_send_with_limit(stp->local_rconn, opo, &stp->n_txq, OFPP_MAX);
+        /* Prefer the slow-protocol channel, so that BPDUs don't queue behind
+         * the controller's messages to the datapath. */
+        if (stp->slow_rconn && rconn_is_connected(stp->slow_rconn)) {
+            rconn_send_with_limit(stp->slow_rconn, opo, &stp->n_slow_txq,
+                                  OFPP_MAX);
+        } else {
+            rconn_send_with_limit(stp->local_rconn, opo, &stp->n_txq,
+                                  OFPP_MAX);
+        }
     } else {
         VLOG_WARN_RL(&rl, "cannot send BPDU on missing port %d", port_no);
     }
@@ -251,6 +415,9 @@ stp_port_changed_cb(uint16_t port_no,
             speed = 10000;
         }
         stp_port_set_speed(p, speed);
+        stp_port_set_point_to_point(p, !(new->curr & htonl(OFPPF_10MB_HD
+                                                            | OFPPF_100MB_HD
+                                                            | OFPPF_1GB_HD)));
     }
 }
 
@@ -263,16 +430,35 @@ stp_local_port_changed_cb(const struct ofp_phy_port *port, void *stp_)
     }
 }
 
+static void
+stp_status_cb(struct status_reply *sr, void *stp_)
+{
+    struct stp_data *stp = stp_;
+
+    status_reply_put(sr, "slow-proto=%s",
+                     (!stp->slow_rconn ? "unsupported"
+                      : rconn_is_connected(stp->slow_rconn) ? "connected"
+                      : "disconnected"));
+    status_reply_put(sr, "slow-proto-bpdus=%llu", stp->n_slow_bpdus);
+    status_reply_put(sr, "packet-in-bpdus=%llu", stp->n_packet_in_bpdus);
+    status_reply_put(sr, "forwarded=%llu", stp->n_forwarded);
+    status_reply_put(sr, "forward-dropped=%llu", stp->n_fwd_dropped);
+}
+
 static struct hook_class stp_hook_class = {
     stp_local_packet_cb,        /* local_packet_cb */
     NULL,                       /* remote_packet_cb */
     stp_periodic_cb,            /* periodic_cb */
     stp_wait_cb,                /* wait_cb */
     NULL,                       /* closing_cb */
+    (HOOK_TYPE(OFPT_FEATURES_REPLY)
+     | HOOK_TYPE(OFPT_PACKET_IN)), /* local_types */
+    0,                          /* remote_types */
 };
 
 void
-stp_start(struct secchan *secchan, struct port_watcher *pw,
+stp_start(struct secchan *secchan, const struct settings *s,
+          struct switch_status *ss, struct port_watcher *pw,
           struct rconn *local, struct rconn *remote)
 {
     uint8_t dpid[ETH_ADDR_LEN];
@@ -281,11 +467,19 @@ stp_start(struct secchan *secchan, struct port_watcher *pw,
     stp = xcalloc(1, sizeof *stp);
     eth_addr_random(dpid);
     stp->stp = stp_create("stp", eth_addr_to_uint64(dpid), send_bpdu, stp);
+    stp_set_rstp(stp->stp, s->enable_rstp);
     stp->pw = pw;
     stp->local_rconn = local;
     stp->remote_rconn = remote;
     stp->last_tick = time_msec();
 
+    /* The kernel datapath does not implement the slow-protocol channel. */
+    if (strncmp(s->dp_name, "nl:", 3)) {
+        stp->slow_rconn = rconn_create(0, s->max_backoff);
+        rconn_connect(stp->slow_rconn, s->dp_name);
+    }
+    switch_status_register_category(ss, "stp", stp_status_cb, stp);
+
     port_watcher_register_callback(pw, stp_port_changed_cb, stp);
     port_watcher_register_local_port_callback(pw, stp_local_port_changed_cb,
                                               stp);
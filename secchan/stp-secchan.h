@@ -37,12 +37,16 @@
 /* Extra time, in seconds, at boot before going into fail-open, to give the
  * spanning tree protocol time to figure out the network layout. */
 #define STP_EXTRA_BOOT_TIME 30
+#define RSTP_EXTRA_BOOT_TIME 5
 
 struct port_watcher;
 struct rconn;
 struct secchan;
+struct settings;
+struct switch_status;
 
-void stp_start(struct secchan *, struct port_watcher *,
+void stp_start(struct secchan *, const struct settings *,
+               struct switch_status *, struct port_watcher *,
                struct rconn *local, struct rconn *remote);
 
 #endif /* stp-secchan.h */
@@ -22,6 +22,10 @@ noinst_PROGRAMS += tests/test-dhcp-client
 tests_test_dhcp_client_SOURCES = tests/test-dhcp-client.c
 tests_test_dhcp_client_LDADD = lib/libopenflow.a $(FAULT_LIBS)
 
+noinst_PROGRAMS += tests/test-vconn-storm
+tests_test_vconn_storm_SOURCES = tests/test-vconn-storm.c
+tests_test_vconn_storm_LDADD = lib/libopenflow.a $(SSL_LIBS)
+
 TESTS += tests/test-stp.sh
 EXTRA_DIST += tests/test-stp.sh
 noinst_PROGRAMS += tests/test-stp
@@ -40,7 +44,77 @@ stp_files = \
 	tests/test-stp-iol-io-1.1 \
 	tests/test-stp-iol-io-1.2 \
 	tests/test-stp-iol-io-1.4 \
-	tests/test-stp-iol-io-1.5
+	tests/test-stp-iol-io-1.5 \
+	tests/test-stp-rstp-ieee802.1d-1998 \
+	tests/test-stp-rstp-legacy \
+	tests/test-stp-rstp-ring
 TESTS_ENVIRONMENT += stp_files='$(stp_files)'
 
 EXTRA_DIST += $(stp_files)
+
+TESTS += tests/test-dtree
+noinst_PROGRAMS += tests/test-dtree
+tests_test_dtree_SOURCES = \
+	tests/test-dtree.c \
+	tests/flow-end-stub.c \
+	tests/table-test.c \
+	tests/table-test.h \
+	udatapath/switch-flow.c \
+	udatapath/table-dtree.c \
+	udatapath/table-linear.c
+tests_test_dtree_CPPFLAGS = $(AM_CPPFLAGS) -I $(top_srcdir)/udatapath
+tests_test_dtree_LDADD = lib/libopenflow.a
+
+TESTS += tests/test-packet-print
+noinst_PROGRAMS += tests/test-packet-print
+tests_test_packet_print_SOURCES = tests/test-packet-print.c
+tests_test_packet_print_LDADD = lib/libopenflow.a
+
+TESTS += tests/test-nf2
+noinst_PROGRAMS += tests/test-nf2
+tests_test_nf2_SOURCES = \
+	tests/test-nf2.c \
+	tests/flow-end-stub.c \
+	tests/table-test.c \
+	tests/table-test.h \
+	hw-lib/nf2/hw_flow.c \
+	hw-lib/nf2/nf2_drv.c \
+	hw-lib/nf2/nf2_lib.c \
+	hw-lib/nf2/nf2_sim.c \
+	hw-lib/nf2/nf2util.c \
+	udatapath/crc32.c \
+	udatapath/switch-flow.c
+tests_test_nf2_CPPFLAGS = $(AM_CPPFLAGS) -I $(top_srcdir)/udatapath \
+	-I $(top_srcdir)/hw-lib/nf2 -DHWTABLE_NO_DEBUG
+tests_test_nf2_LDADD = lib/libopenflow.a
+
+TESTS += tests/test-standalone
+noinst_PROGRAMS += tests/test-standalone
+tests_test_standalone_SOURCES = \
+	tests/test-standalone.c \
+	tests/flow-end-stub.c \
+	udatapath/chain.c \
+	udatapath/crc32.c \
+	udatapath/standalone.c \
+	udatapath/switch-flow.c \
+	udatapath/table-dtree.c \
+	udatapath/table-hash.c \
+	udatapath/table-linear.c
+tests_test_standalone_CPPFLAGS = $(AM_CPPFLAGS) -I $(top_srcdir)/udatapath
+tests_test_standalone_LDADD = lib/libopenflow.a
+
+TESTS += tests/test-snapshot
+noinst_PROGRAMS += tests/test-snapshot
+tests_test_snapshot_SOURCES = \
+	tests/test-snapshot.c \
+	tests/flow-end-stub.c \
+	udatapath/chain.c \
+	udatapath/crc32.c \
+	udatapath/dp_act.c \
+	udatapath/snapshot.c \
+	udatapath/switch-flow.c \
+	udatapath/table-dtree.c \
+	udatapath/table-hash.c \
+	udatapath/table-linear.c
+tests_test_snapshot_CPPFLAGS = $(AM_CPPFLAGS) -I $(top_srcdir)/udatapath
+tests_test_snapshot_LDADD = lib/libopenflow.a
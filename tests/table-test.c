@@ -0,0 +1,78 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "table-test.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "list.h"
+#include "random.h"
+#include "table.h"
+#include "timeval.h"
+#include "util.h"
+
+/* Sets the program name to 'argv0' and seeds the random number generator.
+ * The seed is taken from the TEST_SEED environment variable if it is set,
+ * otherwise from the time of day, and is printed either way so that a
+ * failing run can be repeated. */
+void
+table_test_init(const char *argv0)
+{
+    const char *seed_string = getenv("TEST_SEED");
+    uint32_t seed;
+
+    set_program_name(argv0);
+    time_init();
+    if (seed_string && *seed_string) {
+        seed = strtoul(seed_string, NULL, 0);
+    } else {
+        seed = time_usec();
+    }
+    random_set_seed(seed);
+    printf("random seed %"PRIu32" (set TEST_SEED to repeat)\n", seed);
+}
+
+/* Runs a timeout sweep over 'table'.  The tests install only permanent
+ * flows, so the sweep must not remove any. */
+void
+table_test_timeout(struct sw_table *table)
+{
+    struct list deleted;
+
+    list_init(&deleted);
+    table->timeout(table, &deleted);
+    if (!list_is_empty(&deleted)) {
+        ofp_fatal(0, "permanent flows timed out");
+    }
+}
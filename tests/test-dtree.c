@@ -0,0 +1,264 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Checks that table-dtree finds the same flow as table-linear for random
+ * packets against a random access control list, then compares how long each
+ * table takes to look up the packets.  Usage: test-dtree [N_FLOWS
+ * [N_PACKETS]]. */
+
+#include <config.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "openflow/openflow.h"
+#include "packets.h"
+#include "random.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "table-test.h"
+#include "timeval.h"
+#include "util.h"
+
+/* Address prefixes that rules and packets are drawn from, so that packets
+ * often match some rule. */
+static const uint32_t subnets[] = {
+    0x0a000000, 0x0a010000, 0x0a010100, 0xc0a80000, 0xc0a80100, 0xac100000,
+};
+static const uint16_t services[] = { 22, 25, 53, 80, 123, 443, 8080 };
+
+static uint32_t
+random_addr(void)
+{
+    return subnets[random_range(ARRAY_SIZE(subnets))] | random_range(512);
+}
+
+/* Fills in 'm' with a rule typical of an access control list: traffic to a
+ * particular subnet, often from another one, often to a particular
+ * service. */
+static void
+random_match(struct ofp_match *m)
+{
+    uint32_t wildcards = OFPFW_ALL;
+    int bits;
+
+    memset(m, 0, sizeof *m);
+    wildcards &= ~OFPFW_DL_TYPE;
+    m->dl_type = htons(ETH_TYPE_IP);
+
+    bits = 16 + random_range(17);
+    wildcards &= ~OFPFW_NW_DST_MASK;
+    wildcards |= (32 - bits) << OFPFW_NW_DST_SHIFT;
+    m->nw_dst = htonl(random_addr());
+    if (random_range(2)) {
+        bits = 8 + random_range(25);
+        wildcards &= ~OFPFW_NW_SRC_MASK;
+        wildcards |= (32 - bits) << OFPFW_NW_SRC_SHIFT;
+        m->nw_src = htonl(random_addr());
+    }
+
+    if (random_range(4)) {
+        wildcards &= ~OFPFW_NW_PROTO;
+        m->nw_proto = random_range(2) ? IPPROTO_TCP : IPPROTO_UDP;
+        if (random_range(4)) {
+            int service = random_range(ARRAY_SIZE(services));
+            wildcards &= ~OFPFW_TP_DST;
+            m->tp_dst = htons(services[service]);
+        }
+        if (!random_range(8)) {
+            wildcards &= ~OFPFW_TP_SRC;
+            m->tp_src = htons(1024 + random_range(16));
+        }
+    }
+    if (!random_range(8)) {
+        wildcards &= ~OFPFW_IN_PORT;
+        m->in_port = htons(1 + random_range(8));
+    }
+    m->wildcards = htonl(wildcards);
+}
+
+static struct sw_flow *
+make_flow(const struct ofp_match *m, uint16_t priority)
+{
+    struct sw_flow *flow = flow_alloc(0);
+    flow_extract_match(&flow->key, m);
+    flow->priority = priority;
+    return flow;
+}
+
+static void
+random_packet(struct sw_flow_key *key)
+{
+    memset(key, 0, sizeof *key);
+    key->flow.in_port = htons(1 + random_range(8));
+    key->flow.dl_type = htons(random_range(8) ? ETH_TYPE_IP : ETH_TYPE_ARP);
+    key->flow.nw_src = htonl(random_addr());
+    key->flow.nw_dst = htonl(random_addr());
+    key->flow.nw_proto = random_range(2) ? IPPROTO_TCP : IPPROTO_UDP;
+    key->flow.tp_src = htons(1024 + random_range(16));
+    key->flow.tp_dst = htons(services[random_range(ARRAY_SIZE(services))]);
+}
+
+/* Looks up each of the 'n' packets in 'keys' in 'table', storing the results
+ * in 'results', and returns the elapsed time in microseconds. */
+static long long int
+time_lookups(struct sw_table *table, const struct sw_flow_key *keys,
+             struct sw_flow **results, int n)
+{
+    long long int start = time_usec();
+    int i;
+
+    for (i = 0; i < n; i++) {
+        results[i] = table->lookup(table, &keys[i]);
+    }
+    return time_usec() - start;
+}
+
+/* Looks up the 'n' packets in 'keys' in both 'linear' and 'dtree', using
+ * 'linear_results' and 'dtree_results' as scratch space, and reports the
+ * results and timings under 'name'.  Returns true if the tables found the
+ * same flows. */
+static bool
+compare_tables(const char *name, struct sw_table *linear,
+               struct sw_table *dtree, const struct sw_flow_key *keys,
+               struct sw_flow **linear_results,
+               struct sw_flow **dtree_results, int n)
+{
+    struct sw_table_stats stats;
+    long long int linear_usec, dtree_usec;
+    int n_matched, n_errors;
+    int i;
+
+    linear_usec = time_lookups(linear, keys, linear_results, n);
+    dtree_usec = time_lookups(dtree, keys, dtree_results, n);
+
+    n_matched = n_errors = 0;
+    for (i = 0; i < n; i++) {
+        struct sw_flow *a = linear_results[i];
+        struct sw_flow *b = dtree_results[i];
+        if (a) {
+            n_matched++;
+        }
+        if (a ? !b || a->serial != b->serial : b != NULL) {
+            n_errors++;
+        }
+    }
+
+    dtree->stats(dtree, &stats);
+    printf("%s: %u flows, %d of %d packets matched, %d mismatches\n",
+           name, stats.n_flows, n_matched, n, n_errors);
+    printf("  linear: %lld us, dtree: %lld us\n", linear_usec, dtree_usec);
+    return !n_errors;
+}
+
+/* Adds 'n' random flows to 'linear' and 'dtree', storing their matches and
+ * priorities in 'matches' and 'priorities'. */
+static void
+add_flows(struct sw_table *linear, struct sw_table *dtree,
+          struct ofp_match *matches, uint16_t *priorities, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        random_match(&matches[i]);
+        priorities[i] = random_range(1024);
+        linear->insert(linear, make_flow(&matches[i], priorities[i]));
+        dtree->insert(dtree, make_flow(&matches[i], priorities[i]));
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_flows = argc > 1 ? atoi(argv[1]) : 1000;
+    int n_packets = argc > 2 ? atoi(argv[2]) : 100000;
+    struct sw_table *linear, *dtree;
+    struct sw_flow **linear_results, **dtree_results;
+    struct sw_flow_key *keys;
+    struct ofp_match *matches;
+    uint16_t *priorities;
+    int n_failed;
+    int i;
+
+    table_test_init(argv[0]);
+    if (n_flows < 1 || n_packets < 1) {
+        ofp_fatal(0, "usage: %s [N_FLOWS [N_PACKETS]]", argv[0]);
+    }
+
+    keys = xmalloc(n_packets * sizeof *keys);
+    for (i = 0; i < n_packets; i++) {
+        random_packet(&keys[i]);
+    }
+    linear_results = xmalloc(n_packets * sizeof *linear_results);
+    dtree_results = xmalloc(n_packets * sizeof *dtree_results);
+    matches = xmalloc(n_flows * sizeof *matches);
+    priorities = xmalloc(n_flows * sizeof *priorities);
+
+    linear = table_linear_create(n_flows * 2);
+    dtree = table_dtree_create(n_flows * 2);
+
+#define COMPARE(NAME) \
+    compare_tables(NAME, linear, dtree, keys, \
+                   linear_results, dtree_results, n_packets)
+
+    /* Check lookups with flows pending, with flows in the tree, with flows
+     * deleted from the tree, and with pending flows on top of a tree. */
+    add_flows(linear, dtree, matches, priorities, n_flows);
+    n_failed = !COMPARE("pending");
+    table_test_timeout(dtree);
+    n_failed += !COMPARE("rebuilt");
+
+    for (i = 0; i < n_flows; i += 3) {
+        struct sw_flow_key key;
+
+        flow_extract_match(&key, &matches[i]);
+        linear->delete(NULL, linear, &key, OFPP_NONE, priorities[i], 1);
+        dtree->delete(NULL, dtree, &key, OFPP_NONE, priorities[i], 1);
+    }
+    n_failed += !COMPARE("deleted");
+
+    add_flows(linear, dtree, matches, priorities, n_flows / 8);
+    n_failed += !COMPARE("added");
+    table_test_timeout(dtree);
+    n_failed += !COMPARE("rebuilt");
+
+    linear->destroy(linear);
+    dtree->destroy(dtree);
+    free(keys);
+    free(linear_results);
+    free(dtree_results);
+    free(matches);
+    free(priorities);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Runs the NetFPGA flow table against a simulated register file: installs
+ * exact match and wildcard flows, makes the simulated hardware count packets
+ * for them, and checks that timeout sweeps, deletions and table statistics
+ * pick up the counts.  Then reports how many register accesses and how much
+ * time a timeout sweep over the installed flows takes.  Usage: test-nf2
+ * [N_FLOWS]. */
+
+#include <config.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "openflow/of_hw_api.h"
+#include "openflow/openflow.h"
+#include "packets.h"
+#include "random.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "table-test.h"
+#include "timeval.h"
+#include "util.h"
+#include "hw-lib/nf2/reg_defines_openflow_switch.h"
+#include "hw-lib/nf2/nf2util.h"
+#include "hw-lib/nf2/hw_flow.h"
+#include "hw-lib/nf2/nf2_drv.h"
+#include "hw-lib/nf2/nf2_lib.h"
+#include "hw-lib/nf2/nf2_sim.h"
+
+/* Number of wildcard flows to install.  The hardware has room for only a few
+ * dozen. */
+#define N_WILDCARD 8
+
+/* Fills in 'm' with a random TCP flow from 'in_port'.  If 'wildcard' is true,
+ * the transport ports are wildcarded, otherwise every field is exact. */
+static void
+random_match(struct ofp_match *m, uint16_t in_port, bool wildcard)
+{
+    memset(m, 0, sizeof *m);
+    m->wildcards = htonl(wildcard ? OFPFW_TP_SRC | OFPFW_TP_DST : 0);
+    m->in_port = htons(in_port);
+    random_bytes(m->dl_src, sizeof m->dl_src);
+    random_bytes(m->dl_dst, sizeof m->dl_dst);
+    m->dl_vlan = htons(OFP_VLAN_NONE);
+    m->dl_type = htons(ETH_TYPE_IP);
+    m->nw_src = htonl(random_uint32());
+    m->nw_dst = htonl(random_uint32());
+    m->nw_proto = IPPROTO_TCP;
+    m->tp_src = htons(random_uint16());
+    m->tp_dst = htons(random_uint16());
+}
+
+/* Returns a new flow matching 'm' that outputs to 'out_port'. */
+static struct sw_flow *
+make_flow(const struct ofp_match *m, uint16_t out_port)
+{
+    struct sw_flow *flow = flow_alloc(sizeof(struct ofp_action_output));
+    struct ofp_action_output *oa = (void *) flow->sf_acts->actions;
+
+    flow_extract_match(&flow->key, m);
+    flow->priority = flow->key.wildcards ? 1000 : OFP_DEFAULT_PRIORITY;
+    flow->created = flow->used = time_msec();
+    oa->type = htons(OFPAT_OUTPUT);
+    oa->len = htons(sizeof *oa);
+    oa->port = htons(out_port);
+    return flow;
+}
+
+static unsigned int
+exact_counter_reg(const struct nf2_flow *nf2flow, int word)
+{
+    return (SRAM_BASE_ADDR + (nf2flow->pos << 7) + sizeof(nf2_of_entry_wrap)
+            + 4 * word);
+}
+
+/* Makes the simulated hardware count 'packets' packets and 'bytes' bytes as
+ * having hit 'flow'. */
+static void
+hit_flow(struct nf2device *dev, struct sw_flow *flow,
+         uint32_t packets, uint32_t bytes)
+{
+    struct nf2_flow *nf2flow = flow->private;
+
+    if (nf2flow->type == NF2_TABLE_EXACT) {
+        nf2_of_exact_counters_wrap counters;
+
+        /* Exact match counters hold the count since they were last read. */
+        memset(&counters, 0, sizeof counters);
+        counters.raw[0] = nf2_sim_peek(dev, exact_counter_reg(nf2flow, 0));
+        counters.raw[1] = nf2_sim_peek(dev, exact_counter_reg(nf2flow, 1));
+        counters.counters.pkt_count += packets;
+        counters.counters.byte_count += bytes;
+        nf2_sim_poke(dev, exact_counter_reg(nf2flow, 0), counters.raw[0]);
+        nf2_sim_poke(dev, exact_counter_reg(nf2flow, 1), counters.raw[1]);
+    } else {
+        /* Wildcard counters hold the count since the row was written. */
+        unsigned int pkts_reg = (OPENFLOW_WILDCARD_LOOKUP_PKTS_HIT_0_REG
+                                 + 4 * nf2flow->pos);
+        unsigned int bytes_reg = (OPENFLOW_WILDCARD_LOOKUP_BYTES_HIT_0_REG
+                                  + 4 * nf2flow->pos);
+        nf2_sim_poke(dev, pkts_reg, nf2_sim_peek(dev, pkts_reg) + packets);
+        nf2_sim_poke(dev, bytes_reg, nf2_sim_peek(dev, bytes_reg) + bytes);
+    }
+}
+
+/* Returns true if the exact match entry at 'pos' in the simulated hardware
+ * is all zeros, that is, not in use. */
+static bool
+exact_entry_is_clear(struct nf2device *dev, uint32_t pos)
+{
+    int i;
+
+    for (i = 0; i < NF2_OF_ENTRY_WORD_LEN; i++) {
+        if (nf2_sim_peek(dev, SRAM_BASE_ADDR + (pos << 7) + 4 * i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Checks that the packet and byte counts of each of the 'n' flows in 'flows'
+ * are the multiples of 'scale' that hit_flows() gave them, and returns the
+ * number of flows whose counts are wrong. */
+static int
+check_counts(struct sw_flow **flows, int n, int scale)
+{
+    int n_errors = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        struct sw_flow *flow = flows[i];
+        uint64_t packets = (uint64_t) (i + 1) * scale;
+
+        if (flow->packet_count != packets
+            || flow->byte_count != packets * 64) {
+            n_errors++;
+        }
+    }
+    return n_errors;
+}
+
+static void
+hit_flows(struct nf2device *dev, struct sw_flow **flows, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        hit_flow(dev, flows[i], i + 1, (i + 1) * 64);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    int n_flows = argc > 1 ? atoi(argv[1]) : 2000;
+    struct nf2_sim_stats sim_stats;
+    struct sw_table_stats stats;
+    struct nf2device *dev;
+    of_hw_driver_t *hw_drv;
+    struct sw_table *table;
+    struct sw_flow **flows;
+    struct sw_flow_key key;
+    struct ofp_match m;
+    long long int start;
+    int n_installed, n_errors;
+    uint32_t pos;
+    int i;
+
+    table_test_init(argv[0]);
+    if (n_flows < 1) {
+        ofp_fatal(0, "usage: %s [N_FLOWS]", argv[0]);
+    }
+
+    dev = nf2_sim_create();
+    nf2_set_net_device(dev);
+    hw_drv = new_of_hw_driver(NULL);
+    if (!hw_drv) {
+        ofp_fatal(0, "could not create simulated nf2 table");
+    }
+    table = &hw_drv->sw_table;
+
+    /* Install wildcard flows first, then exact match flows.  Exact match
+     * flows whose hash buckets are both taken do not fit in hardware. */
+    flows = xmalloc((N_WILDCARD + n_flows) * sizeof *flows);
+    n_installed = 0;
+    for (i = 0; i < N_WILDCARD + n_flows; i++) {
+        struct sw_flow *flow;
+
+        random_match(&m, 1 + i % 4, i < N_WILDCARD);
+        flow = make_flow(&m, 1 + (i + 1) % 4);
+        if (table->insert(table, flow)) {
+            flows[n_installed++] = flow;
+        } else {
+            flow_free(flow);
+        }
+    }
+    table->stats(table, &stats);
+    printf("%d flows installed, %u in table\n", n_installed, stats.n_flows);
+    if (stats.n_flows != n_installed || n_installed < N_WILDCARD) {
+        ofp_fatal(0, "table lost flows");
+    }
+
+    /* The counts that the hardware collects should reach the flows on each
+     * timeout sweep, and only once. */
+    hit_flows(dev, flows, n_installed);
+    table_test_timeout(table);
+    n_errors = check_counts(flows, n_installed, 1);
+    table_test_timeout(table);
+    n_errors += check_counts(flows, n_installed, 1);
+    hit_flows(dev, flows, n_installed);
+    table_test_timeout(table);
+    n_errors += check_counts(flows, n_installed, 2);
+    printf("%d flows with wrong counts after timeout sweeps\n", n_errors);
+
+    /* Table statistics come from the hardware's lookup counters. */
+    nf2_sim_poke(dev, OPENFLOW_LOOKUP_EXACT_HITS_REG, 100);
+    nf2_sim_poke(dev, OPENFLOW_LOOKUP_WILDCARD_HITS_REG, 20);
+    nf2_sim_poke(dev, OPENFLOW_LOOKUP_EXACT_MISSES_REG, 3);
+    nf2_sim_poke(dev, OPENFLOW_LOOKUP_WILDCARD_MISSES_REG, 4);
+    memset(&stats, 0, sizeof stats);
+    table->stats(table, &stats);
+    if (stats.n_lookup != 127 || stats.n_matched != 120) {
+        printf("stats report %llu lookups and %llu matches\n",
+               (unsigned long long int) stats.n_lookup,
+               (unsigned long long int) stats.n_matched);
+        n_errors++;
+    }
+
+    /* Time a sweep with the table full. */
+    nf2_sim_clear_stats(dev);
+    start = time_usec();
+    table_test_timeout(table);
+    nf2_sim_get_stats(dev, &sim_stats);
+    printf("timeout sweep over %d flows: %lld us, %lu reads, %lu writes, "
+           "%lu range reads of %lu registers\n",
+           n_installed, time_usec() - start, sim_stats.n_reads,
+           sim_stats.n_writes, sim_stats.n_range_reads,
+           sim_stats.n_range_regs);
+
+    /* Deleting an exact match flow clears its hardware entry. */
+    pos = ((struct nf2_flow *) flows[N_WILDCARD]->private)->pos;
+    memcpy(&key, &flows[N_WILDCARD]->key, sizeof key);
+    if (exact_entry_is_clear(dev, pos)
+        || table->delete(NULL, table, &key, OFPP_NONE,
+                         OFP_DEFAULT_PRIORITY, 1) != 1
+        || !exact_entry_is_clear(dev, pos)) {
+        printf("deleting exact match flow did not clear its entry\n");
+        n_errors++;
+    }
+
+    table->destroy(table);
+    free(flows);
+    return n_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
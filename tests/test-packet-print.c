@@ -0,0 +1,252 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Checks ofp_packet_to_string() against hand-built packets, then reports how
+ * long it takes per packet. */
+
+#include <config.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ofp-print.h"
+#include "ofpbuf.h"
+#include "packets.h"
+#include "timeval.h"
+#include "util.h"
+
+static const uint8_t mac_a[ETH_ADDR_LEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static const uint8_t mac_b[ETH_ADDR_LEN] = { 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+
+static void
+put_eth(struct ofpbuf *b, uint16_t eth_type)
+{
+    struct eth_header *eth = ofpbuf_put_zeros(b, sizeof *eth);
+    memcpy(eth->eth_src, mac_a, ETH_ADDR_LEN);
+    memcpy(eth->eth_dst, mac_b, ETH_ADDR_LEN);
+    eth->eth_type = htons(eth_type);
+}
+
+static void
+put_ip(struct ofpbuf *b, uint8_t proto, size_t payload_len)
+{
+    struct ip_header *ip = ofpbuf_put_zeros(b, sizeof *ip);
+    ip->ip_ihl_ver = IP_IHL_VER(5, IP_VERSION);
+    ip->ip_tot_len = htons(IP_HEADER_LEN + payload_len);
+    ip->ip_id = htons(77);
+    ip->ip_ttl = 64;
+    ip->ip_proto = proto;
+    ip->ip_src = htonl(0x0a000001);
+    ip->ip_dst = htonl(0x0a000002);
+}
+
+static void
+build_tcp(struct ofpbuf *b)
+{
+    struct tcp_header *tcp;
+
+    put_eth(b, ETH_TYPE_IP);
+    put_ip(b, IP_TYPE_TCP, TCP_HEADER_LEN + 10);
+    tcp = ofpbuf_put_zeros(b, sizeof *tcp);
+    tcp->tcp_src = htons(1234);
+    tcp->tcp_dst = htons(80);
+    tcp->tcp_seq = htonl(1000);
+    tcp->tcp_ack = htonl(2000);
+    tcp->tcp_ctl = htons((5 << 12) | TCP_PSH | TCP_ACK);
+    tcp->tcp_winsz = htons(512);
+    ofpbuf_put_zeros(b, 10);
+}
+
+static void
+build_vlan_udp(struct ofpbuf *b)
+{
+    struct vlan_header *vh;
+    struct udp_header *udp;
+
+    put_eth(b, ETH_TYPE_VLAN);
+    vh = ofpbuf_put_zeros(b, sizeof *vh);
+    vh->vlan_tci = htons((3 << VLAN_PCP_SHIFT) | 10);
+    vh->vlan_next_type = htons(ETH_TYPE_IP);
+    put_ip(b, IP_TYPE_UDP, UDP_HEADER_LEN + 20);
+    udp = ofpbuf_put_zeros(b, sizeof *udp);
+    udp->udp_src = htons(53);
+    udp->udp_dst = htons(4000);
+    udp->udp_len = htons(UDP_HEADER_LEN + 20);
+    ofpbuf_put_zeros(b, 20);
+}
+
+static void
+build_icmp(struct ofpbuf *b)
+{
+    struct icmp_header *icmp;
+
+    put_eth(b, ETH_TYPE_IP);
+    put_ip(b, IP_TYPE_ICMP, 64);
+    icmp = ofpbuf_put_zeros(b, sizeof *icmp);
+    icmp->icmp_type = 8;
+    ofpbuf_put_zeros(b, 60);
+}
+
+static void
+build_fragment(struct ofpbuf *b)
+{
+    struct ip_header *ip;
+
+    put_eth(b, ETH_TYPE_IP);
+    put_ip(b, IP_TYPE_UDP, 100);
+    ip = ofpbuf_at_assert(b, ETH_HEADER_LEN, sizeof *ip);
+    ip->ip_frag_off = htons(IP_MORE_FRAGMENTS | 185);
+    ofpbuf_put_zeros(b, 100);
+}
+
+static void
+build_arp(struct ofpbuf *b)
+{
+    struct arp_eth_header *arp;
+
+    put_eth(b, ETH_TYPE_ARP);
+    arp = ofpbuf_put_zeros(b, sizeof *arp);
+    arp->ar_hrd = htons(ARP_HRD_ETHERNET);
+    arp->ar_pro = htons(ARP_PRO_IP);
+    arp->ar_hln = ETH_ADDR_LEN;
+    arp->ar_pln = IP_ADDR_LEN;
+    arp->ar_op = htons(ARP_OP_REQUEST);
+    memcpy(arp->ar_sha, mac_a, ETH_ADDR_LEN);
+    arp->ar_spa = htonl(0x0a000001);
+    arp->ar_tpa = htonl(0x0a000002);
+}
+
+static void
+build_bpdu(struct ofpbuf *b)
+{
+    static const uint8_t bpdu[35] = {
+        0x00, 0x00, 0x00, 0x00, 0x81,
+        0x80, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, /* Root ID. */
+        0x00, 0x00, 0x00, 0x04,                         /* Root path cost. */
+        0x80, 0x00, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, /* Bridge ID. */
+        0x80, 0x02,                                     /* Port ID. */
+        0x01, 0x00, 0x14, 0x00, 0x02, 0x00, 0x0f, 0x00,
+    };
+    struct llc_header *llc;
+
+    put_eth(b, LLC_HEADER_LEN + sizeof bpdu);
+    llc = ofpbuf_put_zeros(b, sizeof *llc);
+    llc->llc_dsap = 0x42;
+    llc->llc_ssap = 0x42;
+    llc->llc_cntl = 0x03;
+    ofpbuf_put(b, bpdu, sizeof bpdu);
+}
+
+static void
+build_truncated_tcp(struct ofpbuf *b)
+{
+    build_tcp(b);
+    b->size = ETH_HEADER_LEN + IP_HEADER_LEN + 8;
+}
+
+struct test_case {
+    const char *name;
+    void (*build)(struct ofpbuf *);
+    const char *expected;
+};
+
+static const struct test_case tests[] = {
+    { "tcp", build_tcp,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype IPv4 (0x0800), "
+      "length 64: 10.0.0.1.1234 > 10.0.0.2.80: Flags [P.], seq 1000, "
+      "ack 2000, win 512, length 10\n" },
+    { "vlan-udp", build_vlan_udp,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype 802.1Q (0x8100), "
+      "length 66: vlan 10, p 3, ethertype IPv4, "
+      "10.0.0.1.53 > 10.0.0.2.4000: UDP, length 20\n" },
+    { "icmp", build_icmp,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype IPv4 (0x0800), "
+      "length 98: 10.0.0.1 > 10.0.0.2: ICMP echo request, length 64\n" },
+    { "fragment", build_fragment,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype IPv4 (0x0800), "
+      "length 134: 10.0.0.1 > 10.0.0.2: ip-proto-17 (frag 77:100@1480+)\n" },
+    { "arp", build_arp,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype ARP (0x0806), "
+      "length 42: Request who-has 10.0.0.2 tell 10.0.0.1, length 28\n" },
+    { "bpdu", build_bpdu,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, 802.3, length 52: "
+      "LLC, dsap 0x42, ssap 0x42, ctrl 0x03: STP 802.1d, Config, "
+      "Flags [Topology change, Topology change ACK], "
+      "bridge-id 8000.66:77:88:99:aa:bb.8002, "
+      "root-id 8000.00:11:22:33:44:55, length 35\n" },
+    { "truncated-tcp", build_truncated_tcp,
+      "00:11:22:33:44:55 > 66:77:88:99:aa:bb, ethertype IPv4 (0x0800), "
+      "length 42: 10.0.0.1 > 10.0.0.2: [|tcp]\n" },
+};
+
+int
+main(int argc UNUSED, char *argv[])
+{
+    long long int start;
+    struct ofpbuf b;
+    int n_errors = 0;
+    int n_iterations;
+    size_t i;
+
+    set_program_name(argv[0]);
+    time_init();
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++) {
+        const struct test_case *t = &tests[i];
+        char *s;
+
+        ofpbuf_init(&b, 0);
+        t->build(&b);
+        s = ofp_packet_to_string(b.data, b.size, b.size);
+        if (strcmp(s, t->expected)) {
+            printf("%s: expected\n  %s  but got\n  %s", t->name,
+                   t->expected, s);
+            n_errors++;
+        }
+        free(s);
+        ofpbuf_uninit(&b);
+    }
+
+    ofpbuf_init(&b, 0);
+    build_tcp(&b);
+    n_iterations = 100000;
+    start = time_usec();
+    for (i = 0; i < n_iterations; i++) {
+        free(ofp_packet_to_string(b.data, b.size, b.size));
+    }
+    printf("%.2f us per packet\n",
+           (double) (time_usec() - start) / n_iterations);
+    ofpbuf_uninit(&b);
+
+    return n_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Saves a flow table with a flow whose actions ofdatapath would reject, as a
+ * snapshot from another version of ofdatapath might hold, and checks that
+ * restoring it skips that flow and keeps the others. */
+
+#include <config.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chain.h"
+#include "datapath.h"
+#include "flow.h"
+#include "openflow/openflow.h"
+#include "snapshot.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "timeval.h"
+#include "util.h"
+
+#define GOOD_COOKIE 1
+#define BAD_PORT_COOKIE 2
+#define BAD_TYPE_COOKIE 3
+
+static int n_errors;
+
+#define CHECK(CONDITION)                                        \
+    do {                                                        \
+        if (!(CONDITION)) {                                     \
+            printf("%s:%d: check failed: %s\n",                 \
+                   __FILE__, __LINE__, #CONDITION);             \
+            n_errors++;                                         \
+        }                                                       \
+    } while (0)
+
+/* Validating actions never sends packets anywhere. */
+void
+dp_output_port(struct datapath *dp UNUSED, struct ofpbuf *buffer UNUSED,
+               int in_port UNUSED, int out_port UNUSED,
+               uint32_t queue_id UNUSED, bool ignore_no_fwd UNUSED)
+{
+    NOT_REACHED();
+}
+
+void
+dp_output_control(struct datapath *dp UNUSED, struct ofpbuf *buffer UNUSED,
+                  int in_port UNUSED, size_t max_len UNUSED,
+                  int reason UNUSED)
+{
+    NOT_REACHED();
+}
+
+struct sw_port *
+dp_lookup_port(struct datapath *dp UNUSED, uint16_t port_no UNUSED)
+{
+    NOT_REACHED();
+}
+
+/* Returns a new datapath with an empty chain. */
+static struct datapath *
+make_datapath(void)
+{
+    struct datapath *dp = xcalloc(1, sizeof *dp);
+
+    dp->chain = chain_create(dp);
+    if (!dp->chain) {
+        ofp_fatal(0, "could not create chain");
+    }
+    return dp;
+}
+
+/* Adds a flow with cookie 'cookie' to 'chain' that matches frames received on
+ * 'in_port' and outputs them to 'out_port'.  The action's type is 'type',
+ * which need not be OFPAT_OUTPUT: the flow goes straight into the chain,
+ * without the checks that a flow-mod would get. */
+static void
+add_flow(struct sw_chain *chain, uint64_t cookie, uint16_t in_port,
+         uint16_t type, uint16_t out_port)
+{
+    struct ofp_action_output oao;
+    struct ofp_match match;
+    struct sw_flow *flow;
+
+    memset(&match, 0, sizeof match);
+    match.wildcards = htonl(OFPFW_ALL & ~OFPFW_IN_PORT);
+    match.in_port = htons(in_port);
+
+    memset(&oao, 0, sizeof oao);
+    oao.type = htons(type);
+    oao.len = htons(sizeof oao);
+    oao.port = htons(out_port);
+
+    flow = flow_alloc(sizeof oao);
+    flow_extract_match(&flow->key, &match);
+    flow->priority = OFP_DEFAULT_PRIORITY;
+    flow->cookie = cookie;
+    flow->idle_timeout = OFP_FLOW_PERMANENT;
+    flow->hard_timeout = OFP_FLOW_PERMANENT;
+    flow_setup_actions(flow, (const struct ofp_action_header *) &oao,
+                       sizeof oao);
+    if (chain_insert(chain, flow, 0)) {
+        ofp_fatal(0, "could not add flow");
+    }
+}
+
+static int
+record_cookie(struct sw_flow *flow, void *cookies_)
+{
+    int *cookies = cookies_;
+
+    if (flow->cookie < 32) {
+        *cookies |= 1 << flow->cookie;
+    }
+    return 0;
+}
+
+/* Returns a bitmap of the cookies of the flows in 'chain'. */
+static int
+chain_cookies(struct sw_chain *chain)
+{
+    struct sw_flow_key key;
+    int cookies = 0;
+    int i;
+
+    memset(&key, 0, sizeof key);
+    key.wildcards = OFPFW_ALL;
+    for (i = 0; i < chain->n_tables; i++) {
+        struct sw_table *table = chain->tables[i];
+        struct sw_table_position position;
+
+        memset(&position, 0, sizeof position);
+        table->iterate(table, &key, htons(OFPP_NONE), &position,
+                       record_cookie, &cookies);
+    }
+    return cookies;
+}
+
+int
+main(int argc UNUSED, char *argv[])
+{
+    struct datapath *dp, *restored;
+    uint32_t n_flows;
+    FILE *stream;
+    char *error;
+
+    set_program_name(argv[0]);
+    time_init();
+
+    error = chain_set_layout("hash2:1024,linear:100");
+    if (error) {
+        ofp_fatal(0, "%s", error);
+    }
+
+    dp = make_datapath();
+    add_flow(dp->chain, GOOD_COOKIE, 1, OFPAT_OUTPUT, 2);
+    add_flow(dp->chain, BAD_PORT_COOKIE, 2, OFPAT_OUTPUT, OFPP_NONE);
+    add_flow(dp->chain, BAD_TYPE_COOKIE, 3, 0x7ff0, 4);
+    CHECK(chain_cookies(dp->chain) == ((1 << GOOD_COOKIE)
+                                       | (1 << BAD_PORT_COOKIE)
+                                       | (1 << BAD_TYPE_COOKIE)));
+
+    stream = tmpfile();
+    if (!stream) {
+        ofp_fatal(errno, "tmpfile failed");
+    }
+    CHECK(!snapshot_write(dp, stream, &n_flows));
+    CHECK(n_flows == 3);
+
+    /* Only the flow with valid actions comes back. */
+    restored = make_datapath();
+    CHECK(!snapshot_read(restored, fileno(stream), "test snapshot", -1));
+    CHECK(chain_cookies(restored->chain) == 1 << GOOD_COOKIE);
+
+    fclose(stream);
+    return n_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Drives the datapath's standalone MAC learning, which ofdatapath uses while
+ * secchan fails open, through being switched on and off, learning flows,
+ * leaving link-local frames to secchan, and a host moving in the middle of a
+ * batch of packets. */
+
+#include <config.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chain.h"
+#include "datapath.h"
+#include "dp_act.h"
+#include "flow.h"
+#include "ofpbuf.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "packets.h"
+#include "standalone.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "timeval.h"
+#include "util.h"
+
+static const uint8_t host_a[ETH_ADDR_LEN] = { 0x00, 0x0a, 0, 0, 0, 0x0a };
+static const uint8_t host_b[ETH_ADDR_LEN] = { 0x00, 0x0a, 0, 0, 0, 0x0b };
+static const uint8_t host_c[ETH_ADDR_LEN] = { 0x00, 0x0a, 0, 0, 0, 0x0c };
+static const uint8_t stp_addr[ETH_ADDR_LEN] = {
+    0x01, 0x80, 0xc2, 0x00, 0x00, 0x00
+};
+
+#define CONTROLLER_COOKIE 0x1234
+
+/* Output port of the last packet that standalone learning forwarded. */
+static int last_out_port;
+
+static int n_errors;
+
+#define CHECK(CONDITION)                                        \
+    do {                                                        \
+        if (!(CONDITION)) {                                     \
+            printf("%s:%d: check failed: %s\n",                 \
+                   __FILE__, __LINE__, #CONDITION);             \
+            n_errors++;                                         \
+        }                                                       \
+    } while (0)
+
+/* Standalone learning forwards packets through this.  It only ever gives a
+ * single output action. */
+void
+execute_actions(struct datapath *dp UNUSED, struct ofpbuf *buffer,
+                struct sw_flow_key *key UNUSED,
+                const struct ofp_action_header *actions, size_t actions_len,
+                struct sw_meter *meters UNUSED, int ignore_no_fwd UNUSED)
+{
+    const struct ofp_action_output *oao = (const void *) actions;
+
+    assert(actions_len == sizeof *oao);
+    last_out_port = ntohs(oao->port);
+    ofpbuf_delete(buffer);
+}
+
+/* Returns a new Ethernet frame from 'src' to 'dst', and stores its flow key,
+ * as received on 'in_port', in 'key'. */
+static struct ofpbuf *
+make_packet(const uint8_t src[ETH_ADDR_LEN], const uint8_t dst[ETH_ADDR_LEN],
+            uint16_t in_port, struct sw_flow_key *key)
+{
+    struct ofpbuf *buffer = ofpbuf_new(ETH_TOTAL_MIN);
+    struct eth_header *eh = ofpbuf_put_zeros(buffer, ETH_TOTAL_MIN);
+
+    memcpy(eh->eth_src, src, ETH_ADDR_LEN);
+    memcpy(eh->eth_dst, dst, ETH_ADDR_LEN);
+    eh->eth_type = htons(0x88b5);
+
+    memset(key, 0, sizeof *key);
+    flow_extract(buffer, in_port, &key->flow);
+    return buffer;
+}
+
+/* Passes a frame from 'src' to 'dst', received on 'port', to 'sa' as a table
+ * miss.  Returns true if 'sa' handled it, false if it would have gone to the
+ * controller. */
+static bool
+miss(struct standalone *sa, const uint8_t src[ETH_ADDR_LEN],
+     const uint8_t dst[ETH_ADDR_LEN], struct sw_port *port)
+{
+    struct sw_flow_key key;
+    struct ofpbuf *buffer = make_packet(src, dst, port->port_no, &key);
+
+    last_out_port = -1;
+    if (standalone_packet_in(sa, buffer, &key, port)) {
+        return true;
+    }
+    ofpbuf_delete(buffer);
+    return false;
+}
+
+/* Returns the flow in 'chain' that a frame from 'src' to 'dst', received on
+ * 'in_port', would hit, or a null pointer. */
+static struct sw_flow *
+lookup(struct sw_chain *chain, const uint8_t src[ETH_ADDR_LEN],
+       const uint8_t dst[ETH_ADDR_LEN], uint16_t in_port)
+{
+    struct sw_flow_key key;
+    struct ofpbuf *buffer = make_packet(src, dst, in_port, &key);
+    struct sw_flow *flow = chain_lookup(chain, &key, 0);
+
+    ofpbuf_delete(buffer);
+    return flow;
+}
+
+static int
+count_flow(struct sw_flow *flow, void *counts_)
+{
+    int *counts = counts_;
+
+    counts[flow->cookie == OFP_EXT_FAIL_OPEN_COOKIE]++;
+    return 0;
+}
+
+/* Stores the number of flows in 'chain' that standalone learning did not and
+ * did add in 'counts[0]' and 'counts[1]', respectively. */
+static void
+count_flows(struct sw_chain *chain, int counts[2])
+{
+    struct sw_flow_key key;
+    int i;
+
+    memset(&key, 0, sizeof key);
+    key.wildcards = OFPFW_ALL;
+    counts[0] = counts[1] = 0;
+    for (i = 0; i < chain->n_tables; i++) {
+        struct sw_table *table = chain->tables[i];
+        struct sw_table_position position;
+
+        memset(&position, 0, sizeof position);
+        table->iterate(table, &key, htons(OFPP_NONE), &position,
+                       count_flow, counts);
+    }
+}
+
+/* Adds a flow to 'chain' that sends every frame to 'dst' to the controller,
+ * as a controller would. */
+static void
+add_controller_flow(struct sw_chain *chain, const uint8_t dst[ETH_ADDR_LEN])
+{
+    struct ofp_action_output oao;
+    struct ofp_match match;
+    struct sw_flow *flow;
+
+    memset(&match, 0, sizeof match);
+    match.wildcards = htonl(OFPFW_ALL & ~OFPFW_DL_DST);
+    memcpy(match.dl_dst, dst, ETH_ADDR_LEN);
+
+    memset(&oao, 0, sizeof oao);
+    oao.type = htons(OFPAT_OUTPUT);
+    oao.len = htons(sizeof oao);
+    oao.port = htons(OFPP_CONTROLLER);
+
+    flow = flow_alloc(sizeof oao);
+    flow_extract_match(&flow->key, &match);
+    flow->priority = OFP_DEFAULT_PRIORITY;
+    flow->cookie = CONTROLLER_COOKIE;
+    flow->idle_timeout = OFP_FLOW_PERMANENT;
+    flow->hard_timeout = OFP_FLOW_PERMANENT;
+    flow_setup_actions(flow, (const struct ofp_action_header *) &oao,
+                       sizeof oao);
+    if (chain_insert(chain, flow, 0)) {
+        ofp_fatal(0, "could not add controller flow");
+    }
+}
+
+int
+main(int argc UNUSED, char *argv[])
+{
+    struct sw_port ports[4];
+    struct standalone *sa;
+    struct datapath *dp;
+    struct sw_flow *flow;
+    struct sw_flow_key key;
+    struct ofpbuf *buffer;
+    uint64_t n_packets;
+    int counts[2];
+    char *error;
+    int i;
+
+    set_program_name(argv[0]);
+    time_init();
+    memset(ports, 0, sizeof ports);
+    for (i = 0; i < ARRAY_SIZE(ports); i++) {
+        ports[i].port_no = i;
+    }
+
+    error = chain_set_layout("hash2:1024,linear:100");
+    if (error) {
+        ofp_fatal(0, "%s", error);
+    }
+    dp = xcalloc(1, sizeof *dp);
+    dp->chain = chain_create(dp);
+    if (!dp->chain) {
+        ofp_fatal(0, "could not create chain");
+    }
+    sa = standalone_create(dp);
+    add_controller_flow(dp->chain, host_c);
+
+    /* Until OFP_EXT_SET_FAIL_OPEN turns learning on, every miss goes to the
+     * controller. */
+    CHECK(!miss(sa, host_a, host_b, &ports[1]));
+
+    /* Learning floods to unknown hosts and adds flows to known ones. */
+    standalone_set_active(sa, true, 60);
+    CHECK(miss(sa, host_a, host_b, &ports[1]));
+    CHECK(last_out_port == OFPP_FLOOD);
+    CHECK(miss(sa, host_b, host_a, &ports[2]));
+    CHECK(last_out_port == 1);
+    CHECK(miss(sa, host_a, host_b, &ports[1]));
+    CHECK(last_out_port == 2);
+    count_flows(dp->chain, counts);
+    CHECK(counts[0] == 1 && counts[1] == 2);
+    flow = lookup(dp->chain, host_b, host_a, 2);
+    CHECK(flow && flow->cookie == OFP_EXT_FAIL_OPEN_COOKIE);
+
+    /* Link-local frames, such as BPDUs, still go to secchan. */
+    CHECK(!miss(sa, host_a, stp_addr, &ports[1]));
+    count_flows(dp->chain, counts);
+    CHECK(counts[0] == 1 && counts[1] == 2);
+
+    /* Host A moves to port 3 in the middle of a batch of packets, after the
+     * datapath has already looked up a frame from B to A in the same batch.
+     * The flow that it found must survive until the batch is done. */
+    flow = lookup(dp->chain, host_b, host_a, 2);
+    CHECK(flow != NULL);
+    n_packets = flow->packet_count;
+    CHECK(miss(sa, host_a, host_b, &ports[3]));
+    CHECK(last_out_port == 2);
+    CHECK(lookup(dp->chain, host_b, host_a, 2) == flow);
+    buffer = make_packet(host_b, host_a, 2, &key);
+    flow_used(flow, buffer);
+    ofpbuf_delete(buffer);
+    CHECK(flow->packet_count == n_packets + 1);
+
+    /* Once the batch is done, the flow that sends to A's old port goes. */
+    standalone_flush(sa);
+    CHECK(lookup(dp->chain, host_b, host_a, 2) == NULL);
+    CHECK(lookup(dp->chain, host_a, host_b, 3) != NULL);
+    CHECK(miss(sa, host_b, host_a, &ports[2]));
+    CHECK(last_out_port == 3);
+
+    /* Turning learning off deletes the learned flows, and only those. */
+    standalone_set_active(sa, false, 0);
+    count_flows(dp->chain, counts);
+    CHECK(counts[0] == 1 && counts[1] == 0);
+    flow = lookup(dp->chain, host_a, host_c, 1);
+    CHECK(flow && flow->cookie == CONTROLLER_COOKIE);
+    CHECK(!miss(sa, host_a, host_b, &ports[1]));
+
+    standalone_destroy(sa);
+    chain_destroy(dp->chain);
+    free(dp);
+    return n_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
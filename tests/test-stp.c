@@ -57,7 +57,7 @@ struct bridge {
     struct lan *ports[STP_MAX_PORTS];
     int n_ports;
 
-#define RXQ_SIZE 16
+#define RXQ_SIZE 32
     struct bpdu rxq[RXQ_SIZE];
     int rxq_head, rxq_tail;
 };
@@ -153,6 +153,20 @@ new_lan(struct test_case *tc, const char *name)
     return lan;
 }
 
+/* A LAN that connects more than two bridges is shared media, on which RSTP
+ * may not use its proposal/agreement handshake. */
+static void
+update_point_to_point(struct lan *lan)
+{
+    int i;
+
+    for (i = 0; i < lan->n_conns; i++) {
+        struct lan_conn *c = &lan->conns[i];
+        stp_port_set_point_to_point(stp_get_port(c->bridge->stp, c->port_no),
+                                    lan->n_conns <= 2);
+    }
+}
+
 static void
 reconnect_port(struct bridge *b, int port_no, struct lan *new_lan)
 {
@@ -175,6 +189,7 @@ reconnect_port(struct bridge *b, int port_no, struct lan *new_lan)
                 break;
             }
         }
+        update_point_to_point(old_lan);
     }
 
     /* Connect to new_lan. */
@@ -184,6 +199,7 @@ reconnect_port(struct bridge *b, int port_no, struct lan *new_lan)
         assert(conn_no < ARRAY_SIZE(new_lan->conns));
         new_lan->conns[conn_no].bridge = b;
         new_lan->conns[conn_no].port_no = port_no;
+        update_point_to_point(new_lan);
     }
 }
 
@@ -210,6 +226,9 @@ dump(struct test_case *tc)
         int j;
 
         printf("%s:", stp_get_name(stp));
+        if (stp_is_rstp(stp)) {
+            printf(" rstp");
+        }
         if (stp_is_root_bridge(stp)) {
             printf(" root");
         }
@@ -225,6 +244,12 @@ dump(struct test_case *tc)
                 printf(" (disconnected)");
             }
             printf(": %s", stp_state_name(state));
+            if (stp_is_rstp(stp)) {
+                printf(" %s", stp_role_name(stp_port_get_role(p)));
+                if (stp_port_is_edge(p)) {
+                    printf(" edge");
+                }
+            }
             if (p == stp_get_root_port(stp)) {
                 printf(" (root port, root_path_cost=%u)", stp_get_root_path_cost(stp));
             }
@@ -298,12 +323,13 @@ tree(struct test_case *tc)
     }
 }
 
+/* Runs the simulation for 'duration' ms in steps of 'granularity' ms. */
 static void
-simulate(struct test_case *tc, int granularity)
+simulate(struct test_case *tc, int granularity, int duration)
 {
     int time;
 
-    for (time = 0; time < 1000 * 180; time += granularity) {
+    for (time = 0; time < duration; time += granularity) {
         int round_trips;
         int i;
 
@@ -504,6 +530,9 @@ main(int argc, char *argv[])
             if (match("^")) {
                 stp_set_bridge_priority(bridge->stp, must_get_int());
             }
+            if (match("rstp")) {
+                stp_set_rstp(bridge->stp, true);
+            }
 
             if (match("=")) {
                 for (port_no = 0; port_no < STP_MAX_PORTS; port_no++) {
@@ -539,11 +568,15 @@ main(int argc, char *argv[])
                         if (match("^")) {
                             stp_port_set_priority(p, must_get_int());
                         }
+                        if (match("+")) {
+                            stp_port_set_edge(p, true);
+                        }
                     }
                 }
             }
         } else if (match("run")) {
-            simulate(tc, must_get_int());
+            int granularity = must_get_int();
+            simulate(tc, granularity, match("for") ? must_get_int() : 180000);
         } else if (match("dump")) {
             dump(tc);
         } else if (match("tree")) {
@@ -0,0 +1,213 @@
+/* Copyright (c) 2008, 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Connects many simulated switches to a controller at once, the way they
+ * reconnect after the controller restarts, and reports how long it takes for
+ * all of them to complete the OpenFlow handshake and for all of them to be
+ * asked for their features, that is, to become usable by the controller. */
+
+#include <config.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ofpbuf.h"
+#include "openflow/openflow.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "util.h"
+#include "vconn.h"
+#include "vlog.h"
+#include "xtoxll.h"
+
+/* Give up after this many milliseconds. */
+#define TIMEOUT 60000
+
+struct sim_switch {
+    struct vconn *vconn;
+    long long int connected;    /* When handshake completed, or -1. */
+    long long int usable;       /* When features were requested, or -1. */
+};
+
+static void
+send_features_reply(struct sim_switch *sw, uint64_t dpid,
+                    const struct ofp_header *rq)
+{
+    struct ofp_switch_features *osf;
+    struct ofpbuf *b;
+
+    osf = make_openflow_xid(sizeof *osf, OFPT_FEATURES_REPLY, rq->xid, &b);
+    osf->datapath_id = htonll(dpid);
+    osf->n_buffers = htonl(256);
+    osf->n_tables = 1;
+    if (vconn_send(sw->vconn, b)) {
+        ofpbuf_delete(b);
+    }
+}
+
+/* Processes messages received on 'sw'.  Returns false if the connection
+ * failed. */
+static bool
+run_switch(struct sim_switch *sw, uint64_t dpid, long long int start)
+{
+    int i;
+
+    if (sw->connected < 0) {
+        int retval = vconn_connect(sw->vconn);
+        if (retval == EAGAIN) {
+            return true;
+        } else if (retval) {
+            fprintf(stderr, "%s: connection failed (%s)\n",
+                    vconn_get_name(sw->vconn), strerror(retval));
+            return false;
+        }
+        sw->connected = time_msec() - start;
+    }
+
+    for (i = 0; i < 50; i++) {
+        struct ofp_header *oh;
+        struct ofpbuf *msg;
+        int retval;
+
+        retval = vconn_recv(sw->vconn, &msg);
+        if (retval == EAGAIN) {
+            break;
+        } else if (retval) {
+            fprintf(stderr, "%s: receive failed (%s)\n",
+                    vconn_get_name(sw->vconn),
+                    retval == EOF ? "connection closed" : strerror(retval));
+            return false;
+        }
+
+        oh = msg->data;
+        if (oh->type == OFPT_FEATURES_REQUEST) {
+            if (sw->usable < 0) {
+                sw->usable = time_msec() - start;
+            }
+            send_features_reply(sw, dpid, oh);
+        } else if (oh->type == OFPT_ECHO_REQUEST) {
+            struct ofpbuf *reply = make_echo_reply(oh);
+            if (vconn_send(sw->vconn, reply)) {
+                ofpbuf_delete(reply);
+            }
+        }
+        ofpbuf_delete(msg);
+    }
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    long long int start, all_connected, all_usable;
+    struct sim_switch *switches;
+    int n_switches, n_failed;
+    int i;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+    signal(SIGPIPE, SIG_IGN);
+
+    if (argc != 3) {
+        ofp_fatal(0, "usage: %s TARGET N\n"
+                  "where TARGET is an active OpenFlow connection method "
+                  "such as tcp:127.0.0.1\n"
+                  "and N is the number of switches to simulate", argv[0]);
+    }
+    n_switches = atoi(argv[2]);
+    if (n_switches < 1) {
+        ofp_fatal(0, "number of switches must be at least 1");
+    }
+
+    start = time_msec();
+    switches = xmalloc(n_switches * sizeof *switches);
+    for (i = 0; i < n_switches; i++) {
+        struct sim_switch *sw = &switches[i];
+        int retval = vconn_open(argv[1], OFP_VERSION, &sw->vconn);
+        if (retval) {
+            ofp_fatal(retval, "%s: connecting switch %d", argv[1], i);
+        }
+        sw->connected = sw->usable = -1;
+    }
+
+    n_failed = 0;
+    for (;;) {
+        int n_pending = 0;
+
+        for (i = 0; i < n_switches; i++) {
+            struct sim_switch *sw = &switches[i];
+            if (sw->vconn && !run_switch(sw, i + 1, start)) {
+                vconn_close(sw->vconn);
+                sw->vconn = NULL;
+                n_failed++;
+            }
+            if (sw->vconn && sw->usable < 0) {
+                n_pending++;
+            }
+        }
+        if (!n_pending || time_msec() - start > TIMEOUT) {
+            break;
+        }
+
+        for (i = 0; i < n_switches; i++) {
+            struct sim_switch *sw = &switches[i];
+            if (sw->vconn) {
+                vconn_recv_wait(sw->vconn);
+            }
+        }
+        poll_timer_wait(100);
+        poll_block();
+    }
+
+    all_connected = all_usable = 0;
+    for (i = 0; i < n_switches; i++) {
+        struct sim_switch *sw = &switches[i];
+        if (sw->vconn && sw->usable < 0) {
+            n_failed++;
+        } else if (sw->vconn) {
+            all_connected = MAX(all_connected, sw->connected);
+            all_usable = MAX(all_usable, sw->usable);
+        }
+    }
+    printf("%d switches, %d failed or timed out\n", n_switches, n_failed);
+    printf("all connected after %lld ms\n", all_connected);
+    printf("all usable after %lld ms\n", all_usable);
+
+    for (i = 0; i < n_switches; i++) {
+        vconn_close(switches[i].vconn);
+    }
+    free(switches);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -14,19 +14,28 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/datapath.h \
 	udatapath/dp_act.c \
 	udatapath/dp_act.h \
+	udatapath/handoff.c \
+	udatapath/handoff.h \
 	udatapath/of_ext_msg.c \
 	udatapath/of_ext_msg.h \
 	udatapath/udatapath.c \
 	udatapath/private-msg.c \
 	udatapath/private-msg.h \
+	udatapath/snapshot.c \
+	udatapath/snapshot.h \
+	udatapath/standalone.c \
+	udatapath/standalone.h \
 	udatapath/switch-flow.c \
 	udatapath/switch-flow.h \
 	udatapath/table.h \
+	udatapath/table-dtree.c \
 	udatapath/table-hash.c \
 	udatapath/table-linear.c
 
-udatapath_ofdatapath_LDADD = lib/libopenflow.a $(SSL_LIBS) $(FAULT_LIBS)
+udatapath_ofdatapath_LDADD = secchan/libsecchan.a lib/libopenflow.a \
+	$(SSL_LIBS) $(FAULT_LIBS)
 udatapath_ofdatapath_CPPFLAGS = $(AM_CPPFLAGS)
+udatapath_ofdatapath_CPPFLAGS += -I $(top_srcdir)/secchan -DUDATAPATH_SECCHAN
 
 EXTRA_DIST += udatapath/ofdatapath.8.in
 DISTCLEANFILES += udatapath/ofdatapath.8
@@ -58,14 +67,21 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/datapath.h \
 	udatapath/dp_act.c \
 	udatapath/dp_act.h \
+	udatapath/handoff.c \
+	udatapath/handoff.h \
 	udatapath/of_ext_msg.c \
 	udatapath/of_ext_msg.h \
 	udatapath/udatapath.c \
 	udatapath/private-msg.c \
 	udatapath/private-msg.h \
+	udatapath/snapshot.c \
+	udatapath/snapshot.h \
+	udatapath/standalone.c \
+	udatapath/standalone.h \
 	udatapath/switch-flow.c \
 	udatapath/switch-flow.h \
 	udatapath/table.h \
+	udatapath/table-dtree.c \
 	udatapath/table-hash.c \
 	udatapath/table-linear.c
 
@@ -35,10 +35,13 @@
 #include "chain.h"
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include "switch-flow.h"
 #include "table.h"
 #include "datapath.h"
+#include "util.h"
 
 #if defined(OF_HW_PLAT)
 #include <openflow/of_hw_api.h>
@@ -47,53 +50,271 @@
 #define THIS_MODULE VLM_chain
 #include "vlog.h"
 
+/* Kinds of software tables that a layout may name. */
+enum chain_table_type {
+    CHAIN_HASH,                 /* table_hash_create(). */
+    CHAIN_HASH2,                /* table_hash2_create(). */
+    CHAIN_LINEAR,               /* table_linear_create(). */
+    CHAIN_DTREE                 /* table_dtree_create(). */
+};
+
+/* One table in a layout. */
+struct chain_table_spec {
+    enum chain_table_type type;
+    unsigned int max_flows;     /* Flows, or buckets per hash function. */
+    enum chain_placement placement;
+};
+
+/* Maximum number of regular tables in a layout.  Under OF_HW_PLAT,
+ * chain_create() puts the hardware table in front of them, where it takes
+ * one of the chain's CHAIN_MAX_TABLES slots. */
+#if defined(OF_HW_PLAT)
+#define CHAIN_MAX_LAYOUT_TABLES (CHAIN_MAX_TABLES - 1)
+#else
+#define CHAIN_MAX_LAYOUT_TABLES CHAIN_MAX_TABLES
+#endif
+
+/* Layout used by chain_create(), as set by chain_set_layout().  The regular
+ * tables come first, in order, followed by the emergency table. */
+static struct chain_table_spec layout[CHAIN_MAX_TABLES + 1];
+static int n_layout;
+
+/* Parses 'spec' as a chain layout, storing the tables into 'specs', which must
+ * have room for CHAIN_MAX_TABLES + 1 elements, and their number into
+ * '*n_specsp'.  Returns a null pointer if successful, otherwise an error
+ * message that the caller must free. */
+static char *
+parse_layout(const char *spec, struct chain_table_spec specs[], int *n_specsp)
+{
+    struct chain_table_spec emerg;
+    bool have_emerg = false;
+    char *copy, *table, *save_ptr = NULL;
+    char *error = NULL;
+    int n_specs = 0;
+
+    copy = xstrdup(spec);
+    for (table = strtok_r(copy, ",", &save_ptr); table && !error;
+         table = strtok_r(NULL, ",", &save_ptr)) {
+        struct chain_table_spec s;
+        char *field, *save_ptr2 = NULL;
+        const char *name;
+
+        name = strtok_r(table, ":", &save_ptr2);
+        if (!name) {
+            error = xstrdup("table with no type");
+            break;
+        } else if (!strcmp(name, "hash")) {
+            s.type = CHAIN_HASH;
+            s.max_flows = TABLE_HASH_MAX_FLOWS;
+        } else if (!strcmp(name, "hash2")) {
+            s.type = CHAIN_HASH2;
+            s.max_flows = TABLE_HASH_MAX_FLOWS;
+        } else if (!strcmp(name, "linear")) {
+            s.type = CHAIN_LINEAR;
+            s.max_flows = TABLE_LINEAR_MAX_FLOWS;
+        } else if (!strcmp(name, "dtree")) {
+            s.type = CHAIN_DTREE;
+            s.max_flows = TABLE_DTREE_MAX_FLOWS;
+        } else {
+            error = xasprintf("unknown table type \"%s\"", name);
+            break;
+        }
+        s.placement = CHAIN_PLACE_ANY;
+
+        while ((field = strtok_r(NULL, ":", &save_ptr2)) != NULL) {
+            if (!strcmp(field, "any")) {
+                s.placement = CHAIN_PLACE_ANY;
+            } else if (!strcmp(field, "exact")) {
+                s.placement = CHAIN_PLACE_EXACT;
+            } else if (!strcmp(field, "wild")) {
+                s.placement = CHAIN_PLACE_WILD;
+            } else if (!strcmp(field, "emerg")) {
+                s.placement = CHAIN_PLACE_EMERG;
+            } else {
+                char *tail;
+                long int n = strtol(field, &tail, 0);
+                if (*tail || n <= 0 || n > INT_MAX) {
+                    error = xasprintf("%s: invalid size or placement \"%s\"",
+                                      name, field);
+                    break;
+                }
+                s.max_flows = n;
+            }
+        }
+        if (error) {
+            break;
+        }
+
+        if ((s.type == CHAIN_HASH || s.type == CHAIN_HASH2)
+            && s.max_flows & (s.max_flows - 1)) {
+            error = xasprintf("%s: size %u is not a power of 2",
+                              name, s.max_flows);
+        } else if ((s.type == CHAIN_HASH || s.type == CHAIN_HASH2)
+                   && s.placement == CHAIN_PLACE_WILD) {
+            error = xasprintf("%s: table cannot hold wildcarded flows", name);
+        } else if (s.placement == CHAIN_PLACE_EMERG) {
+            if (have_emerg) {
+                error = xstrdup("more than one emergency table");
+            }
+            emerg = s;
+            have_emerg = true;
+        } else if (n_specs >= CHAIN_MAX_LAYOUT_TABLES) {
+#if defined(OF_HW_PLAT)
+            error = xasprintf("more than %d tables (the hardware table "
+                              "takes one of %d places)",
+                              CHAIN_MAX_LAYOUT_TABLES, CHAIN_MAX_TABLES);
+#else
+            error = xasprintf("more than %d tables", CHAIN_MAX_LAYOUT_TABLES);
+#endif
+        } else {
+            specs[n_specs++] = s;
+        }
+    }
+    free(copy);
+
+    if (!error && !n_specs) {
+        error = xstrdup("no tables other than the emergency table");
+    }
+    if (!error) {
+        if (!have_emerg) {
+            emerg.type = CHAIN_LINEAR;
+            emerg.max_flows = TABLE_LINEAR_MAX_FLOWS;
+            emerg.placement = CHAIN_PLACE_EMERG;
+        }
+        specs[n_specs++] = emerg;
+        *n_specsp = n_specs;
+    }
+    return error;
+}
+
+/* Sets the tables that chain_create() will put into new chains to those
+ * described by 'spec', a comma-separated list of tables, each of the form
+ * TYPE[:SIZE][:PLACEMENT]:
+ *
+ *   - TYPE is "hash" (exact-match flows only, in one hash table), "hash2"
+ *     (exact-match flows only, in two hash tables with different hash
+ *     functions), "linear" (a list of flows in priority order) or "dtree" (a
+ *     decision tree over the flows).
+ *
+ *   - SIZE is the maximum number of flows, or for "hash" and "hash2" the
+ *     number of buckets in each hash table, which must be a power of 2.
+ *
+ *   - PLACEMENT is "any" (the default) to let the table hold any flow that it
+ *     supports, "exact" to hold only flows without wildcards, "wild" to hold
+ *     only flows with wildcards, or "emerg" to make it the emergency table.
+ *
+ * chain_insert() tries the regular tables in the order given.  If no table
+ * has "emerg", the emergency table is a "linear" table with the default size.
+ * There may be at most CHAIN_MAX_LAYOUT_TABLES regular tables.
+ *
+ * Returns a null pointer if successful, otherwise an error message that the
+ * caller must free. */
+char *
+chain_set_layout(const char *spec)
+{
+    struct chain_table_spec specs[CHAIN_MAX_TABLES + 1];
+    int n_specs;
+    char *error;
+
+    error = parse_layout(spec, specs, &n_specs);
+    if (!error) {
+        memcpy(layout, specs, n_specs * sizeof *specs);
+        n_layout = n_specs;
+    }
+    return error;
+}
+
+static struct sw_table *
+create_table(const struct chain_table_spec *s)
+{
+    switch (s->type) {
+    case CHAIN_HASH:
+        return table_hash_create(0x1EDC6F41, s->max_flows);
+    case CHAIN_HASH2:
+        return table_hash2_create(0x1EDC6F41, s->max_flows,
+                                  0x741B8CD7, s->max_flows);
+    case CHAIN_LINEAR:
+        return table_linear_create(s->max_flows);
+    case CHAIN_DTREE:
+        return table_dtree_create(s->max_flows);
+    }
+    NOT_REACHED();
+}
+
 /* Attempts to append 'table' to the set of tables in 'chain'.  Returns 0 or
  * negative error.  If 'table' is null it is assumed that table creation failed
  * due to out-of-memory. */
-static int add_table(struct sw_chain *chain, struct sw_table *table, int emerg)
+static int add_table(struct sw_chain *chain, struct sw_table *table,
+                     enum chain_placement placement)
 {
     if (table == NULL)
         return -ENOMEM;
-    if (chain->n_tables >= CHAIN_MAX_TABLES) {
+    if (placement == CHAIN_PLACE_EMERG) {
+        chain->emerg_table = table;
+    } else if (chain->n_tables >= CHAIN_MAX_TABLES) {
         VLOG_ERR("too many tables in chain\n");
         table->destroy(table);
         return -ENOBUFS;
-    }
-    if (emerg)
-        chain->emerg_table = table;
-    else
+    } else {
+        chain->placements[chain->n_tables] = placement;
         chain->tables[chain->n_tables++] = table;
+    }
     return 0;
 }
 
-/* Creates and returns a new chain.  Returns NULL if the chain cannot be
+/* Creates and returns a new chain, with the tables set by chain_set_layout()
+ * or those in CHAIN_DEFAULT_LAYOUT.  Returns NULL if the chain cannot be
  * created. */
 struct sw_chain *chain_create(struct datapath *dp)
 {
-    struct sw_chain *chain = calloc(1, sizeof *chain);
+    struct sw_chain *chain;
+    int i;
+
+    if (!n_layout) {
+        char *error = chain_set_layout(CHAIN_DEFAULT_LAYOUT);
+        assert(!error);
+    }
+
+    chain = calloc(1, sizeof *chain);
     if (chain == NULL)
         return NULL;
 
     chain->dp = dp;
 #if defined(OF_HW_PLAT)
     if (dp && dp->hw_drv) {
-        if (add_table(chain, (struct sw_table *)dp->hw_drv, 0) != 0) {
+        if (add_table(chain, (struct sw_table *)dp->hw_drv,
+                      CHAIN_PLACE_ANY) != 0) {
             VLOG_ERR("Could not attach HW table to chain\n");
         }
     }
 #endif
-    if (add_table(chain, table_hash2_create(0x1EDC6F41, TABLE_HASH_MAX_FLOWS,
-                                            0x741B8CD7, TABLE_HASH_MAX_FLOWS),
-                                            0)
-        || add_table(chain, table_linear_create(TABLE_LINEAR_MAX_FLOWS), 0)
-        || add_table(chain, table_linear_create(TABLE_LINEAR_MAX_FLOWS), 1)) {
-        chain_destroy(chain);
-        return NULL;
+    for (i = 0; i < n_layout; i++) {
+        if (add_table(chain, create_table(&layout[i]), layout[i].placement)) {
+            chain_destroy(chain);
+            return NULL;
+        }
     }
 
     return chain;
 }
 
+/* Returns true if chain_insert() may place 'flow' in the table with the given
+ * 'placement'. */
+static bool
+placement_allows(enum chain_placement placement, const struct sw_flow *flow)
+{
+    switch (placement) {
+    case CHAIN_PLACE_EXACT:
+        return !flow->key.wildcards;
+    case CHAIN_PLACE_WILD:
+        return flow->key.wildcards != 0;
+    case CHAIN_PLACE_ANY:
+    case CHAIN_PLACE_EMERG:
+        return true;
+    }
+    NOT_REACHED();
+}
+
 /* Searches 'chain' for a flow matching 'key', which must not have any wildcard
  * fields.  Returns the flow if successful, otherwise a null pointer. */
 struct sw_flow *
@@ -126,6 +347,63 @@ chain_lookup(struct sw_chain *chain, const struct sw_flow_key *key, int emerg)
     return NULL;
 }
 
+/* Searches 'chain' for a flow matching each of the 'n' keys in 'keys', none of
+ * which may have any wildcard fields, and stores the flow or a null pointer
+ * into the corresponding element of 'flows'.  'n' must not exceed
+ * TABLE_LOOKUP_BATCH_MAX.  Only the regular (not emergency) tables are
+ * searched.
+ *
+ * The results are the same as calling chain_lookup() on each key, but tables
+ * that support batched lookup can hide much of the memory latency of looking
+ * up many keys. */
+void
+chain_lookup_batch(struct sw_chain *chain, const struct sw_flow_key *keys[],
+                   struct sw_flow *flows[], int n)
+{
+    const struct sw_flow_key *miss_keys[TABLE_LOOKUP_BATCH_MAX];
+    struct sw_flow *miss_flows[TABLE_LOOKUP_BATCH_MAX];
+    int miss_idx[TABLE_LOOKUP_BATCH_MAX];
+    int n_miss;
+    int i, j;
+
+    assert(n <= TABLE_LOOKUP_BATCH_MAX);
+    for (i = 0; i < n; i++) {
+        assert(!keys[i]->wildcards);
+        flows[i] = NULL;
+        miss_keys[i] = keys[i];
+        miss_idx[i] = i;
+    }
+    n_miss = n;
+
+    /* Pass the keys that no table has matched so far on to the next table. */
+    for (i = 0; i < chain->n_tables && n_miss > 0; i++) {
+        struct sw_table *t = chain->tables[i];
+        int n_left;
+
+        if (t->lookup_batch) {
+            t->lookup_batch(t, miss_keys, miss_flows, n_miss);
+        } else {
+            for (j = 0; j < n_miss; j++) {
+                miss_flows[j] = t->lookup(t, miss_keys[j]);
+            }
+        }
+        t->n_lookup += n_miss;
+
+        n_left = 0;
+        for (j = 0; j < n_miss; j++) {
+            if (miss_flows[j]) {
+                flows[miss_idx[j]] = miss_flows[j];
+                t->n_matched++;
+            } else {
+                miss_keys[n_left] = miss_keys[j];
+                miss_idx[n_left] = miss_idx[j];
+                n_left++;
+            }
+        }
+        n_miss = n_left;
+    }
+}
+
 /* Inserts 'flow' into 'chain', replacing any duplicate flow.  Returns 0 if
  * successful or a negative error.
  *
@@ -143,7 +421,8 @@ chain_insert(struct sw_chain *chain, struct sw_flow *flow, int emerg)
     } else {
         for (i = 0; i < chain->n_tables; i++) {
             struct sw_table *t = chain->tables[i];
-            if (t->insert(t, flow))
+            if (placement_allows(chain->placements[i], flow)
+                && t->insert(t, flow))
                 return 0;
         }
     }
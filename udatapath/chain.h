@@ -45,22 +45,39 @@ struct datapath;
 
 #define TABLE_LINEAR_MAX_FLOWS  100
 #define TABLE_HASH_MAX_FLOWS    65536
+#define TABLE_DTREE_MAX_FLOWS   4096
 #define TABLE_MAC_MAX_FLOWS      1024
 #define TABLE_MAC_NUM_BUCKETS   1024
 
+/* Tables that chain_create() builds if chain_set_layout() has not been
+ * called.  See chain_set_layout() for the syntax. */
+#define CHAIN_DEFAULT_LAYOUT "hash2:65536,dtree:4096,linear:100:emerg"
+
+/* Which flows chain_insert() may place in a table. */
+enum chain_placement {
+    CHAIN_PLACE_ANY,            /* Any flow that the table accepts. */
+    CHAIN_PLACE_EXACT,          /* Only flows without wildcards. */
+    CHAIN_PLACE_WILD,           /* Only flows with wildcards. */
+    CHAIN_PLACE_EMERG           /* Emergency flows (the emergency table). */
+};
+
 /* Set of tables chained together in sequence from cheap to expensive. */
-#define CHAIN_MAX_TABLES 4
+#define CHAIN_MAX_TABLES 8
 struct sw_chain {
     int n_tables;                /* Number of working tables, not includes
                                   * protection (emergency) table. */
     struct sw_table *tables[CHAIN_MAX_TABLES];
+    enum chain_placement placements[CHAIN_MAX_TABLES];
     struct sw_table *emerg_table;
 
     struct datapath *dp;
 };
 
+char *chain_set_layout(const char *);
 struct sw_chain *chain_create(struct datapath *);
 struct sw_flow *chain_lookup(struct sw_chain *, const struct sw_flow_key *, int);
+void chain_lookup_batch(struct sw_chain *, const struct sw_flow_key *[],
+                        struct sw_flow *[], int n);
 int chain_insert(struct sw_chain *, struct sw_flow *, int);
 int chain_modify(struct sw_chain *, const struct sw_flow_key *,
                  uint16_t, int, const struct ofp_action_header *, size_t, int);
@@ -49,10 +49,14 @@
 #include "openflow/openflow-ext.h"
 #include "packets.h"
 #include "poll-loop.h"
+#include "queue.h"
 #include "rconn.h"
+#include "standalone.h"
 #include "stp.h"
+#include "svec.h"
 #include "switch-flow.h"
 #include "table.h"
+#include "timeval.h"
 #include "vconn.h"
 #include "xtoxll.h"
 #include "private-msg.h"
@@ -161,13 +165,39 @@ struct sender {
     uint32_t xid;               /* The OpenFlow transaction ID. */
 };
 
+/* Messages of one class waiting to be passed to a remote's rconn. */
+struct remote_txq {
+    struct ofp_queue queue;     /* Queued messages. */
+    size_t n_bytes;             /* Sum of the sizes of queued messages. */
+};
+
+/* Byte budget of each class of remote_txq.  A message that would take a queue
+ * over its budget is dropped. */
+static const size_t txq_max_bytes[OFP_EXT_TXQ_N_CLASSES] = {
+    64 * 1024,                  /* OFP_EXT_TXQ_SLOW_PROTO. */
+    1024 * 1024,                /* OFP_EXT_TXQ_REPLY. */
+    64 * 1024,                  /* OFP_EXT_TXQ_PORT_STATUS. */
+    256 * 1024,                 /* OFP_EXT_TXQ_FLOW_REMOVED. */
+    256 * 1024,                 /* OFP_EXT_TXQ_PACKET_IN. */
+};
+
 /* A connection to a secure channel. */
 struct remote {
     struct list node;
     struct rconn *rconn;
-#define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
+#define TXQ_LIMIT 16            /* Max number of packets to queue on rconn. */
     int n_txq;                  /* Number of packets queued for tx on rconn. */
 
+    /* Messages not yet passed to 'rconn', by enum ofp_extension_txq_class.
+     * These drain in strict priority order into 'rconn', which holds at most
+     * TXQ_LIMIT messages, so that a high-priority message never waits behind
+     * more than TXQ_LIMIT low-priority ones. */
+    struct remote_txq txqs[OFP_EXT_TXQ_N_CLASSES];
+
+    /* True if this remote sent OFP_EXT_SLOW_PROTO_SUBSCRIBE.  It then gets
+     * link-local control frames and no other asynchronous messages. */
+    bool slow_proto;
+
     /* Support for reliable, multi-message replies to requests.
      *
      * If an incoming request needs to have a reliable reply that might
@@ -184,9 +214,26 @@ static struct remote *remote_create(struct datapath *, struct rconn *);
 static void remote_run(struct datapath *, struct remote *);
 static void remote_wait(struct remote *);
 static void remote_destroy(struct remote *);
+static void remote_flush_txqs(struct datapath *, struct remote *);
 
 static void update_port_flags(struct datapath *, const struct ofp_port_mod *);
 static void send_port_status(struct sw_port *p, uint8_t status);
+static bool update_port_carrier(struct sw_port *);
+static void run_monitor(struct datapath *);
+static void port_readable(int fd, short int revents, void *port_);
+static void update_port_vectors(struct datapath *);
+static void init_port(struct datapath *, struct sw_port *, uint16_t port_no,
+                      struct netdev *, uint16_t num_queues);
+
+/* Number of bytes that a readable port may receive in each dp_run(), on top of
+ * any budget it has left, for deficit round robin among ports.  A port also
+ * receives at most TABLE_LOOKUP_BATCH_MAX packets per run. */
+#define DP_RX_QUANTUM (16 * ETH_TOTAL_MAX)
+
+/* Maximum number of connections to accept from each listener in each dp_run(),
+ * so that a flood of reconnecting switches or tools drains the backlog
+ * quickly without starving packet processing. */
+#define DP_ACCEPT_BATCH 50
 
 /* Buffers are identified by a 31-bit opaque ID.  We divide the ID
  * into a buffer number (low bits) and a cookie (high bits).  The buffer number
@@ -202,6 +249,8 @@ static void send_port_status(struct sw_port *p, uint8_t status);
 int run_flow_through_tables(struct datapath *, struct ofpbuf *,
                             struct sw_port *);
 void fwd_port_input(struct datapath *, struct ofpbuf *, struct sw_port *);
+static void fwd_port_input_batch(struct datapath *, struct ofpbuf *[], int n,
+                                 struct sw_port *);
 int fwd_control_input(struct datapath *, const struct sender *,
                       const void *, size_t);
 
@@ -212,7 +261,7 @@ static void discard_buffer(uint32_t id);
 struct sw_port *
 dp_lookup_port(struct datapath *dp, uint16_t port_no)
 {
-    return (port_no < DP_MAX_PORTS ? &dp->ports[port_no]
+    return (port_no < DP_MAX_PORTS ? port_array_get(&dp->ports, port_no)
             : port_no == OFPP_LOCAL ? dp->local_port
             : NULL);
 }
@@ -264,12 +313,12 @@ hw_packet_in(of_port_t port_no, of_packet_t *packet, int reason,
 
     VLOG_INFO("dp rcv packet on port %d, size %d\n",
               port_no, packet->length);
-    if ((port_no < 1) || port_no > DP_MAX_PORTS) {
+    if ((port_no < 1) || port_no >= DP_MAX_PORTS) {
         VLOG_ERR("Bad receive port %d\n", port_no);
         /* TODO increment error counter */
         return -1;
     }
-    port = &dp->ports[port_no];
+    port = dp_lookup_port(dp, port_no);
     if (!PORT_IN_USE(port)) {
         VLOG_WARN("Receive port not active: %d\n", port_no);
         return -1;
@@ -351,7 +400,9 @@ dp_new(struct datapath **dp_, uint64_t dpid)
         return ENOMEM;
     }
 
+    port_array_init(&dp->ports);
     list_init(&dp->port_list);
+    netdev_monitor_create(&dp->monitor);
     dp->flags = 0;
     dp->miss_send_len = OFP_DEFAULT_MISS_SEND_LEN;
 
@@ -375,12 +426,15 @@ new_port(struct datapath *dp, struct sw_port *port, uint16_t port_no,
     struct netdev *netdev;
     struct in6_addr in6;
     struct in_addr in4;
+    long long int start, opened, configured;
     int error;
 
+    start = time_usec();
     error = netdev_open(netdev_name, NETDEV_ETH_TYPE_ANY, &netdev);
     if (error) {
         return error;
     }
+    opened = time_usec();
     if (new_mac && !eth_addr_equals(netdev_get_etheraddr(netdev), new_mac)) {
         /* Generally the device has to be down before we change its hardware
          * address.  Don't bother to check for an error because it's really
@@ -409,6 +463,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint16_t port_no,
         VLOG_ERR("%s device has assigned IPv6 address %s",
                  netdev_name, in6_name);
     }
+    configured = time_usec();
 
     if (num_queues > 0) {
         error = netdev_setup_slicing(netdev, num_queues);
@@ -422,6 +477,26 @@ new_port(struct datapath *dp, struct sw_port *port, uint16_t port_no,
         }
     }
 
+    dp->n_ports_added++;
+    dp->port_open_usec += opened - start;
+    dp->port_config_usec += configured - opened;
+    dp->port_slicing_usec += time_usec() - configured;
+
+    init_port(dp, port, port_no, netdev, num_queues);
+    update_port_vectors(dp);
+
+    /* Notify the ctlpath that this port has been added */
+    send_port_status(port, OFPPR_ADD);
+
+    return 0;
+}
+
+/* Initializes 'port' as port 'port_no' of 'dp' for 'netdev' and adds it to
+ * 'dp''s port list.  The caller must update the port vectors. */
+static void
+init_port(struct datapath *dp, struct sw_port *port, uint16_t port_no,
+          struct netdev *netdev, uint16_t num_queues)
+{
     memset(port, '\0', sizeof *port);
 
     list_init(&port->queue_list);
@@ -430,12 +505,42 @@ new_port(struct datapath *dp, struct sw_port *port, uint16_t port_no,
     port->netdev = netdev;
     port->port_no = port_no;
     port->num_queues = num_queues;
+    port->rx_ready = true;
     list_push_back(&dp->port_list, &port->node);
+    update_port_carrier(port);
+    dp->monitor_stale = true;
+}
 
-    /* Notify the ctlpath that this port has been added */
-    send_port_status(port, OFPPR_ADD);
+/* Adds 'netdev', which is already open and configured because another process
+ * handed it off, to 'dp' as port 'port_no' (OFPP_LOCAL for the local port)
+ * with OFPPC_* configuration 'config'.  Unlike dp_add_port(), does not send a
+ * port status message, since the controller already knows about the port.
+ *
+ * Returns the new port, or a null pointer if 'port_no' is invalid or already
+ * in use. */
+struct sw_port *
+dp_take_over_port(struct datapath *dp, uint16_t port_no, struct netdev *netdev,
+                  uint32_t config, uint16_t num_queues)
+{
+    struct sw_port *port;
 
-    return 0;
+    if (port_no == OFPP_LOCAL
+        ? dp->local_port != NULL
+        : (!port_no || port_no >= DP_MAX_PORTS
+           || port_array_get(&dp->ports, port_no))) {
+        return NULL;
+    }
+
+    port = xmalloc(sizeof *port);
+    init_port(dp, port, port_no, netdev, num_queues);
+    port->config = config;
+    if (port_no == OFPP_LOCAL) {
+        dp->local_port = port;
+    } else {
+        port_array_set(&dp->ports, port_no, port);
+    }
+    update_port_vectors(dp);
+    return port;
 }
 
 #if defined(OF_HW_PLAT) && !defined(USE_NETDEV)
@@ -449,9 +554,9 @@ dp_add_port(struct datapath *dp, const char *port_name, uint16_t num_queues)
     fprintf(stderr, "Adding port %s. hw_drv is %p\n", port_name, dp->hw_drv);
     if (dp->hw_drv && dp->hw_drv->port_add) {
         port_no = dp->hw_drv->port_add(dp->hw_drv, -1, port_name);
-        if (port_no >= 0) {
-            port = &dp->ports[port_no];
-            if (port->flags & SWP_USED) {
+        if (port_no > 0 && port_no < DP_MAX_PORTS) {
+            port = dp_lookup_port(dp, port_no);
+            if (port) {
                 VLOG_ERR("HW port %s (%d) already created\n",
                           port_name, port_no);
                 rc = -1;
@@ -459,6 +564,8 @@ dp_add_port(struct datapath *dp, const char *port_name, uint16_t num_queues)
                 fprintf(stderr, "Adding HW port %s as OF port number %d\n",
                        port_name, port_no);
                 /* FIXME: Determine and record HW addr, etc */
+                port = xcalloc(1, sizeof *port);
+                port_array_set(&dp->ports, port_no, port);
                 port->flags |= SWP_USED | SWP_HW_DRV_PORT;
                 port->dp = dp;
                 port->port_no = port_no;
@@ -466,6 +573,7 @@ dp_add_port(struct datapath *dp, const char *port_name, uint16_t num_queues)
                 port->num_queues = num_queues;
                 strncpy(port->hw_name, port_name, sizeof(port->hw_name));
                 list_push_back(&dp->port_list, &port->node);
+                update_port_vectors(dp);
                 send_port_status(port, OFPPR_ADD);
             }
         } else {
@@ -485,9 +593,15 @@ dp_add_port(struct datapath *dp, const char *netdev, uint16_t num_queues)
 {
     int port_no;
     for (port_no = 1; port_no < DP_MAX_PORTS; port_no++) {
-        struct sw_port *port = &dp->ports[port_no];
-        if (!port->netdev) {
-            return new_port(dp, port, port_no, netdev, NULL, num_queues);
+        if (!port_array_get(&dp->ports, port_no)) {
+            struct sw_port *port = xcalloc(1, sizeof *port);
+            int error = new_port(dp, port, port_no, netdev, NULL, num_queues);
+            if (!error) {
+                port_array_set(&dp->ports, port_no, port);
+            } else {
+                free(port);
+            }
+            return error;
         }
     }
     return EXFULL;
@@ -524,6 +638,71 @@ dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn)
     dp->listeners[dp->n_listeners++] = pvconn;
 }
 
+/* Adds 'rconn', an established connection, to 'dp''s remotes. */
+void
+dp_add_remote(struct datapath *dp, struct rconn *rconn)
+{
+    remote_create(dp, rconn);
+}
+
+/* Stores in '*rconnsp' an array of the rconns of all of 'dp''s remotes, which
+ * the caller must free, and returns the number of elements in the array. */
+size_t
+dp_get_remote_rconns(struct datapath *dp, struct rconn ***rconnsp)
+{
+    struct rconn **rconns;
+    struct remote *r;
+    size_t n;
+
+    rconns = xmalloc(list_size(&dp->remotes) * sizeof *rconns);
+    n = 0;
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        rconns[n++] = r->rconn;
+    }
+    *rconnsp = rconns;
+    return n;
+}
+
+/* Sends as much as possible of the messages that 'dp' has queued for its
+ * remotes, and continues any multi-message replies in progress, without
+ * receiving anything.  Returns true if nothing remains to be sent to any
+ * remote. */
+bool
+dp_flush_remotes(struct datapath *dp)
+{
+    struct remote *r;
+    bool flushed = true;
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        int i;
+
+        rconn_run(r->rconn);
+        remote_flush_txqs(dp, r);
+        if (r->cb_dump && r->n_txq < TXQ_LIMIT
+            && !r->txqs[OFP_EXT_TXQ_REPLY].queue.n) {
+            int error = r->cb_dump(dp, r->cb_aux);
+            if (error <= 0) {
+                r->cb_done(r->cb_aux);
+                r->cb_dump = NULL;
+            }
+            remote_flush_txqs(dp, r);
+        }
+
+        if (!rconn_is_connected(r->rconn)) {
+            continue;
+        }
+        if (r->cb_dump || r->n_txq) {
+            flushed = false;
+        }
+        for (i = 0; i < OFP_EXT_TXQ_N_CLASSES; i++) {
+            if (r->txqs[i].queue.n) {
+                flushed = false;
+            }
+        }
+    }
+    return flushed;
+}
+
 void
 dp_run(struct datapath *dp)
 {
@@ -547,6 +726,11 @@ dp_run(struct datapath *dp)
     }
     poll_timer_wait(1000);
 
+    run_monitor(dp);
+    if (dp->standalone) {
+        standalone_run(dp->standalone);
+    }
+
 #if defined(OF_HW_PLAT) && !defined(USE_NETDEV)
     { /* Process packets received from callback thread */
         struct ofpbuf *buffer;
@@ -563,30 +747,61 @@ dp_run(struct datapath *dp)
 #endif
 
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {
-        int error;
+        struct ofpbuf *batch[TABLE_LOOKUP_BATCH_MAX];
+        int n_batch;
 
-        if (IS_HW_PORT(p)) {
+        if (IS_HW_PORT(p) || !p->rx_ready) {
             continue;
         }
-        if (!buffer) {
-            /* Allocate buffer with some headroom to add headers in forwarding
-             * to the controller or adding a vlan tag, plus an extra 2 bytes to
-             * allow IP headers to be aligned on a 4-byte boundary.  */
-            const int headroom = 128 + 2;
-            const int hard_header = VLAN_ETH_HEADER_LEN;
-            const int mtu = netdev_get_mtu(p->netdev);
-            buffer = ofpbuf_new(headroom + hard_header + mtu);
-            buffer->data = (char*)buffer->data + headroom;
-        }
-        error = netdev_recv(p->netdev, buffer);
-        if (!error) {
-            p->rx_packets++;
-            p->rx_bytes += buffer->size;
-            fwd_port_input(dp, buffer, p);
-            buffer = NULL;
-        } else if (error != EAGAIN) {
-            VLOG_ERR_RL(&rl, "error receiving data from %s: %s",
-                        netdev_get_name(p->netdev), strerror(error));
+
+        /* Deficit round robin: each run, a readable port may receive up to
+         * DP_RX_QUANTUM more bytes, or a full batch of packets. */
+        p->rx_services++;
+        p->rx_deficit = MIN(p->rx_deficit + DP_RX_QUANTUM, DP_RX_QUANTUM);
+
+        /* Receive a burst of packets, then push them through the flow table
+         * together. */
+        for (n_batch = 0; n_batch < TABLE_LOOKUP_BATCH_MAX
+                 && p->rx_deficit > 0; ) {
+            int error;
+
+            if (!buffer) {
+                /* Allocate buffer with some headroom to add headers in
+                 * forwarding to the controller or adding a vlan tag, plus an
+                 * extra 2 bytes to allow IP headers to be aligned on a 4-byte
+                 * boundary.  */
+                const int headroom = 128 + 2;
+                const int hard_header = VLAN_ETH_HEADER_LEN;
+                const int mtu = netdev_get_mtu(p->netdev);
+                buffer = ofpbuf_new(headroom + hard_header + mtu);
+                buffer->data = (char*)buffer->data + headroom;
+            }
+            error = netdev_recv(p->netdev, buffer);
+            if (!error) {
+                p->rx_packets++;
+                p->rx_bytes += buffer->size;
+                p->rx_deficit -= buffer->size;
+                batch[n_batch++] = buffer;
+                buffer = NULL;
+            } else {
+                if (error != EAGAIN) {
+                    VLOG_ERR_RL(&rl, "error receiving data from %s: %s",
+                                netdev_get_name(p->netdev), strerror(error));
+                }
+                /* Wait for the port to become readable again.  An idle port
+                 * doesn't get to save up budget. */
+                p->rx_ready = false;
+                p->rx_deficit = 0;
+                break;
+            }
+        }
+        if (!n_batch) {
+            p->rx_empty++;
+        } else if (p->rx_ready) {
+            p->rx_exhausted++;
+        }
+        if (n_batch) {
+            fwd_port_input_batch(dp, batch, n_batch, p);
         }
     }
     ofpbuf_delete(buffer);
@@ -596,13 +811,21 @@ dp_run(struct datapath *dp)
         remote_run(dp, r);
     }
 
+    /* Drain each listener's backlog, up to DP_ACCEPT_BATCH connections. */
     for (i = 0; i < dp->n_listeners; ) {
         struct pvconn *pvconn = dp->listeners[i];
-        struct vconn *new_vconn;
-        int retval = pvconn_accept(pvconn, OFP_VERSION, &new_vconn);
-        if (!retval) {
+        int retval = 0;
+        int j;
+
+        for (j = 0; j < DP_ACCEPT_BATCH; j++) {
+            struct vconn *new_vconn;
+            retval = pvconn_accept(pvconn, OFP_VERSION, &new_vconn);
+            if (retval) {
+                break;
+            }
             remote_create(dp, rconn_new_from_vconn("passive", new_vconn));
-        } else if (retval != EAGAIN) {
+        }
+        if (retval && retval != EAGAIN) {
             VLOG_WARN_RL(&rl, "accept failed (%s)", strerror(retval));
             dp->listeners[i] = dp->listeners[--dp->n_listeners];
             continue;
@@ -617,6 +840,7 @@ remote_run(struct datapath *dp, struct remote *r)
     int i;
 
     rconn_run(r->rconn);
+    remote_flush_txqs(dp, r);
 
     /* Do some remote processing, but cap it at a reasonable amount so that
      * other processing doesn't starve. */
@@ -642,7 +866,8 @@ remote_run(struct datapath *dp, struct remote *r)
             }
             ofpbuf_delete(buffer);
         } else {
-            if (r->n_txq < TXQ_LIMIT) {
+            if (r->n_txq < TXQ_LIMIT
+                && !r->txqs[OFP_EXT_TXQ_REPLY].queue.n) {
                 int error = r->cb_dump(dp, r->cb_aux);
                 if (error <= 0) {
                     if (error) {
@@ -674,9 +899,14 @@ static void
 remote_destroy(struct remote *r)
 {
     if (r) {
+        int i;
+
         if (r->cb_dump && r->cb_done) {
             r->cb_done(r->cb_aux);
         }
+        for (i = 0; i < OFP_EXT_TXQ_N_CLASSES; i++) {
+            queue_destroy(&r->txqs[i].queue);
+        }
         list_remove(&r->node);
         rconn_destroy(r->rconn);
         free(r);
@@ -687,10 +917,17 @@ static struct remote *
 remote_create(struct datapath *dp, struct rconn *rconn)
 {
     struct remote *remote = xmalloc(sizeof *remote);
+    int i;
+
     list_push_back(&dp->remotes, &remote->node);
     remote->rconn = rconn;
     remote->cb_dump = NULL;
     remote->n_txq = 0;
+    remote->slow_proto = false;
+    for (i = 0; i < OFP_EXT_TXQ_N_CLASSES; i++) {
+        queue_init(&remote->txqs[i].queue);
+        remote->txqs[i].n_bytes = 0;
+    }
     return remote;
 }
 
@@ -731,7 +968,11 @@ dp_wait(struct datapath *dp)
         if (IS_HW_PORT(p)) {
             continue;
         }
-        netdev_recv_wait(p->netdev);
+        if (p->rx_ready) {
+            poll_immediate_wake();
+        } else if (!p->rx_waiter) {
+            p->rx_waiter = netdev_recv_callback(p->netdev, port_readable, p);
+        }
     }
     LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
         remote_wait(r);
@@ -739,6 +980,105 @@ dp_wait(struct datapath *dp)
     for (i = 0; i < dp->n_listeners; i++) {
         pvconn_wait(dp->listeners[i]);
     }
+    if (dp->monitor) {
+        netdev_monitor_wait(dp->monitor);
+    }
+    if (dp->standalone) {
+        standalone_wait(dp->standalone);
+    }
+}
+
+/* Sets the OFPPS_LINK_DOWN bit in 'p''s state according to whether its
+ * network device has carrier.  Returns true if the bit changed. */
+static bool
+update_port_carrier(struct sw_port *p)
+{
+    enum netdev_flags flags;
+    uint32_t state;
+
+    if (!p->netdev || netdev_get_flags(p->netdev, &flags)) {
+        return false;
+    }
+    state = (flags & NETDEV_CARRIER ? p->state & ~OFPPS_LINK_DOWN
+             : p->state | OFPPS_LINK_DOWN);
+    if (state == p->state) {
+        return false;
+    }
+    p->state = state;
+    return true;
+}
+
+/* Brings the OFPPS_LINK_DOWN state of 'dp''s ports up to date with the
+ * changes reported by its network device monitor, and tells the controller
+ * about each change. */
+static void
+run_monitor(struct datapath *dp)
+{
+    const char *name;
+
+    if (!dp->monitor) {
+        return;
+    }
+
+    if (dp->monitor_stale) {
+        struct svec names = SVEC_EMPTY_INITIALIZER;
+        struct sw_port *p;
+
+        LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+            if (p->netdev) {
+                svec_add(&names, netdev_get_name(p->netdev));
+            }
+        }
+        netdev_monitor_set_devices(dp->monitor, names.names, names.n);
+        svec_destroy(&names);
+        dp->monitor_stale = false;
+    }
+
+    netdev_monitor_run(dp->monitor);
+    while ((name = netdev_monitor_poll(dp->monitor)) != NULL) {
+        struct sw_port *p;
+
+        LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+            if (p->netdev && !strcmp(netdev_get_name(p->netdev), name)
+                && update_port_carrier(p)) {
+                VLOG_INFO("port %"PRIu16" (%s): link %s", p->port_no, name,
+                          p->state & OFPPS_LINK_DOWN ? "down" : "up");
+                send_port_status(p, OFPPR_MODIFY);
+            }
+        }
+    }
+}
+
+/* Called by poll_block() when 'port_' becomes readable. */
+static void
+port_readable(int fd UNUSED, short int revents UNUSED, void *port_)
+{
+    struct sw_port *p = port_;
+
+    p->rx_waiter = NULL;
+    p->rx_ready = true;
+    p->rx_wakeups++;
+}
+
+/* Rebuilds 'dp''s OFPP_ALL and OFPP_FLOOD output port vectors from its port
+ * list.  Must be called whenever a port is added or removed or a port's
+ * OFPPC_NO_FLOOD bit changes. */
+static void
+update_port_vectors(struct datapath *dp)
+{
+    size_t n_ports = list_size(&dp->port_list);
+    struct sw_port *p;
+
+    dp->all_ports = xrealloc(dp->all_ports, n_ports * sizeof *dp->all_ports);
+    dp->flood_ports = xrealloc(dp->flood_ports,
+                               n_ports * sizeof *dp->flood_ports);
+    dp->n_all_ports = dp->n_flood_ports = 0;
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        dp->all_ports[dp->n_all_ports++] = p->port_no;
+        if (!(p->config & OFPPC_NO_FLOOD)) {
+            dp->flood_ports[dp->n_flood_ports++] = p->port_no;
+        }
+    }
 }
 
 /* Send packets out all the ports except the originating one.  If the
@@ -747,22 +1087,21 @@ dp_wait(struct datapath *dp)
 static int
 output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, int flood)
 {
-    struct sw_port *p;
+    const uint16_t *ports = flood ? dp->flood_ports : dp->all_ports;
+    size_t n_ports = flood ? dp->n_flood_ports : dp->n_all_ports;
     int prev_port; /* Buffer is cloned for multiple transmits */
+    size_t i;
 
     prev_port = -1;
-    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
-        if (p->port_no == in_port) {
-            continue;
-        }
-        if (flood && p->config & OFPPC_NO_FLOOD) {
+    for (i = 0; i < n_ports; i++) {
+        if (ports[i] == in_port) {
             continue;
         }
         if (prev_port != -1) {
             dp_output_port(dp, ofpbuf_clone(buffer), in_port, prev_port,
                            0,false);
         }
-        prev_port = p->port_no;
+        prev_port = ports[i];
     }
     if (prev_port != -1)
         dp_output_port(dp, buffer, in_port, prev_port, 0, false);
@@ -899,16 +1238,89 @@ make_openflow_reply(size_t openflow_len, uint8_t type,
                              bufferp);
 }
 
+/* Returns the transmit queue class of OpenFlow message 'buffer'. */
+static enum ofp_extension_txq_class
+txq_classify(const struct ofpbuf *buffer)
+{
+    const struct ofp_header *oh = buffer->data;
+
+    switch (oh->type) {
+    case OFPT_VENDOR:
+        if (buffer->size >= sizeof(struct ofp_extension_header)) {
+            const struct ofp_extension_header *eh = buffer->data;
+            if (eh->vendor == htonl(OPENFLOW_VENDOR_ID)
+                && eh->subtype == htonl(OFP_EXT_SLOW_PROTO_IN)) {
+                return OFP_EXT_TXQ_SLOW_PROTO;
+            }
+        }
+        return OFP_EXT_TXQ_REPLY;
+    case OFPT_PACKET_IN:
+        return OFP_EXT_TXQ_PACKET_IN;
+    case OFPT_FLOW_REMOVED:
+        return OFP_EXT_TXQ_FLOW_REMOVED;
+    case OFPT_PORT_STATUS:
+        return OFP_EXT_TXQ_PORT_STATUS;
+    default:
+        return OFP_EXT_TXQ_REPLY;
+    }
+}
+
+/* Passes queued messages to 'r''s rconn, highest priority class first, until
+ * the rconn has TXQ_LIMIT messages queued.  A class is not drained while any
+ * higher-priority class still has messages waiting. */
+static void
+remote_flush_txqs(struct datapath *dp, struct remote *r)
+{
+    int i;
+
+    for (i = 0; i < OFP_EXT_TXQ_N_CLASSES; i++) {
+        struct remote_txq *txq = &r->txqs[i];
+
+        while (txq->queue.n) {
+            struct ofpbuf *buffer;
+            int retval;
+
+            if (r->n_txq >= TXQ_LIMIT) {
+                return;
+            }
+            buffer = queue_pop_head(&txq->queue);
+            txq->n_bytes -= buffer->size;
+            retval = rconn_send(r->rconn, buffer, &r->n_txq);
+            if (retval) {
+                VLOG_WARN_RL(&rl, "send to %s failed: %s",
+                             rconn_get_name(r->rconn), strerror(retval));
+                ofpbuf_delete(buffer);
+            } else {
+                dp->txq_sent[i]++;
+            }
+        }
+    }
+}
+
 static int
-send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote)
+send_openflow_buffer_to_remote(struct datapath *dp, struct ofpbuf *buffer,
+                               struct remote *remote)
 {
-    int retval = rconn_send_with_limit(remote->rconn, buffer, &remote->n_txq,
-                                       TXQ_LIMIT);
-    if (retval) {
+    enum ofp_extension_txq_class class = txq_classify(buffer);
+    struct remote_txq *txq = &remote->txqs[class];
+
+    if (!rconn_is_connected(remote->rconn)) {
         VLOG_WARN_RL(&rl, "send to %s failed: %s",
-                     rconn_get_name(remote->rconn), strerror(retval));
+                     rconn_get_name(remote->rconn), strerror(ENOTCONN));
+        ofpbuf_delete(buffer);
+        return ENOTCONN;
+    } else if (txq->n_bytes + buffer->size > txq_max_bytes[class]) {
+        VLOG_WARN_RL(&rl, "%s: transmit queue %d full, dropping message",
+                     rconn_get_name(remote->rconn), class);
+        dp->txq_dropped[class]++;
+        ofpbuf_delete(buffer);
+        return EAGAIN;
     }
-    return retval;
+
+    queue_push_tail(&txq->queue, buffer);
+    txq->n_bytes += buffer->size;
+    remote_flush_txqs(dp, remote);
+    return 0;
 }
 
 static int
@@ -918,18 +1330,22 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
     update_openflow_length(buffer);
     if (sender) {
         /* Send back to the sender. */
-        return send_openflow_buffer_to_remote(buffer, sender->remote);
+        return send_openflow_buffer_to_remote(dp, buffer, sender->remote);
     } else {
-        /* Broadcast to all remotes. */
+        /* Broadcast to all remotes, except slow-protocol channels. */
         struct remote *r, *prev = NULL;
         LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+            if (r->slow_proto) {
+                continue;
+            }
             if (prev) {
-                send_openflow_buffer_to_remote(ofpbuf_clone(buffer), prev);
+                send_openflow_buffer_to_remote(dp, ofpbuf_clone(buffer),
+                                               prev);
             }
             prev = r;
         }
         if (prev) {
-            send_openflow_buffer_to_remote(buffer, prev);
+            send_openflow_buffer_to_remote(dp, buffer, prev);
         } else {
             ofpbuf_delete(buffer);
         }
@@ -937,11 +1353,89 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
     }
 }
 
+/* Takes ownership of 'buffer', an OpenFlow message, and sends it to 'sender',
+ * or to all of 'dp''s remotes if 'sender' is null. */
+int
+dp_send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
+                        const struct sender *sender)
+{
+    return send_openflow_buffer(dp, buffer, sender);
+}
+
+/* Makes the remote that sent 'sender' a slow-protocol channel: from now on it
+ * receives link-local control frames as OFP_EXT_SLOW_PROTO_IN messages and no
+ * other asynchronous messages. */
+void
+dp_subscribe_slow_proto(struct datapath *dp UNUSED,
+                        const struct sender *sender)
+{
+    struct remote *r = sender->remote;
+
+    if (!r->slow_proto) {
+        VLOG_INFO("%s: subscribed to link-local control frames",
+                  rconn_get_name(r->rconn));
+        r->slow_proto = true;
+    }
+}
+
+/* If 'buffer', received on 'in_port', is a link-local control frame and 'dp'
+ * has slow-protocol channels, takes ownership of 'buffer', sends it to each
+ * channel, and returns true.  Otherwise, returns false without doing
+ * anything. */
+static bool
+output_slow_proto(struct datapath *dp, struct ofpbuf *buffer, int in_port)
+{
+    const struct eth_header *eth = buffer->data;
+    struct openflow_ext_slow_proto_in *spi;
+    struct remote *r, *prev;
+    struct sw_port *p;
+
+    if (buffer->size < ETH_HEADER_LEN
+        || !eth_addr_is_reserved(eth->eth_dst)) {
+        return false;
+    }
+    p = dp_lookup_port(dp, in_port);
+    if (!p || p->config & OFPPC_NO_STP) {
+        return false;
+    }
+
+    prev = NULL;
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        if (r->slow_proto) {
+            prev = r;
+        }
+    }
+    if (!prev) {
+        return false;
+    }
+
+    spi = ofpbuf_push_uninit(buffer, sizeof *spi);
+    spi->header.header.version = OFP_VERSION;
+    spi->header.header.type = OFPT_VENDOR;
+    spi->header.header.length = htons(buffer->size);
+    spi->header.header.xid = htonl(0);
+    spi->header.vendor = htonl(OPENFLOW_VENDOR_ID);
+    spi->header.subtype = htonl(OFP_EXT_SLOW_PROTO_IN);
+    spi->in_port = htons(in_port);
+    memset(spi->pad, 0, sizeof spi->pad);
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        if (r->slow_proto && r != prev) {
+            send_openflow_buffer_to_remote(dp, ofpbuf_clone(buffer), r);
+        }
+    }
+    send_openflow_buffer_to_remote(dp, buffer, prev);
+    return true;
+}
+
 /* Takes ownership of 'buffer' and transmits it to 'dp''s controller.  If the
  * packet can be saved in a buffer, then only the first max_len bytes of
  * 'buffer' are sent; otherwise, all of 'buffer' is sent.  'reason' indicates
  * why 'buffer' is being sent. 'max_len' sets the maximum number of bytes that
- * the caller wants to be sent. */
+ * the caller wants to be sent.
+ *
+ * A link-local control frame that missed the flow table goes to the
+ * slow-protocol channels instead, if there are any. */
 void
 dp_output_control(struct datapath *dp, struct ofpbuf *buffer, int in_port,
                   size_t max_len, int reason)
@@ -950,6 +1444,10 @@ dp_output_control(struct datapath *dp, struct ofpbuf *buffer, int in_port,
     size_t total_len;
     uint32_t buffer_id;
 
+    if (reason == OFPR_NO_MATCH && output_slow_proto(dp, buffer, in_port)) {
+        return;
+    }
+
     buffer_id = save_buffer(buffer);
     total_len = buffer->size;
     if (buffer_id != UINT32_MAX && buffer->size > max_len) {
@@ -1046,7 +1544,17 @@ dp_send_features_reply(struct datapath *dp, const struct sender *sender)
     ofr->capabilities = htonl(OFP_SUPPORTED_CAPABILITIES);
     ofr->actions      = htonl(OFP_SUPPORTED_ACTIONS);
     LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
-        struct ofp_phy_port *opp = ofpbuf_put_uninit(buffer, sizeof *opp);
+        struct ofp_phy_port *opp;
+
+        /* The reply's length is only 16 bits wide, so describe only as many
+         * ports as fit.  The controller can learn about the rest from port
+         * status messages and port stats. */
+        if (buffer->size + sizeof *opp > UINT16_MAX) {
+            VLOG_WARN_RL(&rl, "too many ports for features reply, "
+                         "omitting some");
+            break;
+        }
+        opp = ofpbuf_put_uninit(buffer, sizeof *opp);
         memset(opp, 0, sizeof *opp);
         fill_port_desc(p, opp);
     }
@@ -1067,8 +1575,12 @@ update_port_flags(struct datapath *dp, const struct ofp_port_mod *opm)
 
     if (opm->mask) {
         uint32_t config_mask = ntohl(opm->mask);
+        uint32_t old_config = p->config;
         p->config &= ~config_mask;
         p->config |= ntohl(opm->config) & config_mask;
+        if ((p->config ^ old_config) & OFPPC_NO_FLOOD) {
+            update_port_vectors(dp);
+        }
     }
 }
 
@@ -1174,6 +1686,30 @@ fill_flow_stats(struct ofpbuf *buffer, struct sw_flow *flow,
 }
 
 
+/* Extracts into 'key' the flow key for 'buffer', which was received on 'p', a
+ * physical switch port or a null pointer.  Returns false, after destroying
+ * 'buffer', if the packet is to be dropped without a flow table lookup. */
+static bool
+extract_port_input_key(struct datapath *dp, struct ofpbuf *buffer,
+                       struct sw_port *p, struct sw_flow_key *key)
+{
+    key->wildcards = 0;
+    if (flow_extract(buffer, p ? p->port_no : OFPP_NONE, &key->flow)
+        && (dp->flags & OFPC_FRAG_MASK) == OFPC_FRAG_DROP) {
+        /* Drop fragment. */
+        ofpbuf_delete(buffer);
+        return false;
+    }
+
+    if (p && p->config & (OFPPC_NO_RECV | OFPPC_NO_RECV_STP)
+        && p->config & (!eth_addr_equals(key->flow.dl_dst, stp_eth_addr)
+                       ? OFPPC_NO_RECV : OFPPC_NO_RECV_STP)) {
+        ofpbuf_delete(buffer);
+        return false;
+    }
+    return true;
+}
+
 /* 'buffer' was received on 'p', which may be a a physical switch port or a
  * null pointer.  Process it according to 'dp''s flow table.  Returns 0 if
  * successful, in which case 'buffer' is destroyed, or -ESRCH if there is no
@@ -1184,18 +1720,7 @@ int run_flow_through_tables(struct datapath *dp, struct ofpbuf *buffer,
     struct sw_flow_key key;
     struct sw_flow *flow;
 
-    key.wildcards = 0;
-    if (flow_extract(buffer, p ? p->port_no : OFPP_NONE, &key.flow)
-        && (dp->flags & OFPC_FRAG_MASK) == OFPC_FRAG_DROP) {
-        /* Drop fragment. */
-        ofpbuf_delete(buffer);
-        return 0;
-    }
-
-    if (p && p->config & (OFPPC_NO_RECV | OFPPC_NO_RECV_STP)
-        && p->config & (!eth_addr_equals(key.flow.dl_dst, stp_eth_addr)
-                       ? OFPPC_NO_RECV : OFPPC_NO_RECV_STP)) {
-        ofpbuf_delete(buffer);
+    if (!extract_port_input_key(dp, buffer, p, &key)) {
         return 0;
     }
 
@@ -1203,23 +1728,87 @@ int run_flow_through_tables(struct datapath *dp, struct ofpbuf *buffer,
     if (flow != NULL) {
         flow_used(flow, buffer);
         execute_actions(dp, buffer, &key, flow->sf_acts->actions,
-                        flow->sf_acts->actions_len, false);
+                        flow->sf_acts->actions_len, flow->sf_acts->meters,
+                        false);
         return 0;
     } else {
         return -ESRCH;
     }
 }
 
+/* Handles 'buffer', whose flow key is 'key', after it was received on 'p'
+ * and matched no flow: learns from it in the datapath, if secchan has asked
+ * for that, otherwise sends it up to the controller.  Takes ownership of
+ * 'buffer'. */
+static void
+fwd_port_input_miss(struct datapath *dp, struct ofpbuf *buffer,
+                    const struct sw_flow_key *key, struct sw_port *p)
+{
+    if (!dp->standalone
+        || !standalone_packet_in(dp->standalone, buffer, key, p)) {
+        dp_output_control(dp, buffer, p->port_no,
+                          dp->miss_send_len, OFPR_NO_MATCH);
+    }
+}
+
+/* Processes the 'n' packets in 'buffers', all received on 'p', as
+ * fwd_port_input() would process each of them in turn, taking ownership of
+ * them.  'n' must not exceed TABLE_LOOKUP_BATCH_MAX.
+ *
+ * Each stage runs across the whole batch before the next begins: first the
+ * flow keys are extracted, then the flow table lookups are done together so
+ * that their cache misses overlap, and only then are the actions run.  A miss
+ * in the middle of the batch must therefore not delete flows that later
+ * packets in the batch already found, which is why standalone learning
+ * defers its deletions to standalone_flush(). */
+static void
+fwd_port_input_batch(struct datapath *dp, struct ofpbuf *buffers[], int n,
+                     struct sw_port *p)
+{
+    struct sw_flow_key keys[TABLE_LOOKUP_BATCH_MAX];
+    const struct sw_flow_key *keyps[TABLE_LOOKUP_BATCH_MAX];
+    struct sw_flow *flows[TABLE_LOOKUP_BATCH_MAX];
+    int n_keys;
+    int i;
+
+    assert(n <= TABLE_LOOKUP_BATCH_MAX);
+    n_keys = 0;
+    for (i = 0; i < n; i++) {
+        if (extract_port_input_key(dp, buffers[i], p, &keys[n_keys])) {
+            buffers[n_keys] = buffers[i];
+            keyps[n_keys] = &keys[n_keys];
+            n_keys++;
+        }
+    }
+
+    chain_lookup_batch(dp->chain, keyps, flows, n_keys);
+
+    for (i = 0; i < n_keys; i++) {
+        struct ofpbuf *buffer = buffers[i];
+        struct sw_flow *flow = flows[i];
+        if (flow) {
+            flow_used(flow, buffer);
+            execute_actions(dp, buffer, &keys[i], flow->sf_acts->actions,
+                            flow->sf_acts->actions_len,
+                            flow->sf_acts->meters, false);
+        } else {
+            fwd_port_input_miss(dp, buffer, &keys[i], p);
+        }
+    }
+
+    /* Only now that nothing refers to 'flows' may learning remove any. */
+    if (dp->standalone) {
+        standalone_flush(dp->standalone);
+    }
+}
+
 /* 'buffer' was received on 'p', which may be a a physical switch port or a
  * null pointer.  Process it according to 'dp''s flow table, sending it up to
  * the controller if no flow matches.  Takes ownership of 'buffer'. */
 void fwd_port_input(struct datapath *dp, struct ofpbuf *buffer,
                     struct sw_port *p)
 {
-    if (run_flow_through_tables(dp, buffer, p)) {
-        dp_output_control(dp, buffer, p->port_no,
-                          dp->miss_send_len, OFPR_NO_MATCH);
-    }
+    fwd_port_input_batch(dp, &buffer, 1, p);
 }
 
 static struct ofpbuf *
@@ -1281,49 +1870,87 @@ recv_set_config(struct datapath *dp, const struct sender *sender UNUSED,
     return 0;
 }
 
+/* Checks whether 'actions', which are 'actions_len' bytes long, may be
+ * applied to packets sent by the controller as if received on 'in_port'.
+ * Returns ACT_VALIDATION_OK if so, otherwise an OFPET_BAD_ACTION code. */
+uint16_t
+dp_validate_packet_out(struct datapath *dp, uint16_t in_port,
+                       const struct ofp_action_header *actions,
+                       size_t actions_len)
+{
+    struct sw_flow_key key;
+
+    /* Only the input port matters for validating actions. */
+    memset(&key, 0, sizeof key);
+    key.wildcards = OFPFW_ALL & ~OFPFW_IN_PORT;
+    key.flow.in_port = htons(in_port);
+    return validate_actions(dp, &key, actions, actions_len);
+}
+
+/* Applies 'actions', which must have passed dp_validate_packet_out() for
+ * 'in_port', to the packet buffered under 'buffer_id' or, if 'buffer_id' is
+ * UINT32_MAX, to a copy of the 'data_len' bytes at 'data'.  Returns 0 if
+ * successful, -ESRCH if the buffer no longer exists. */
+int
+dp_execute_packet_out(struct datapath *dp, uint16_t in_port,
+                      uint32_t buffer_id, const void *data, size_t data_len,
+                      const struct ofp_action_header *actions,
+                      size_t actions_len)
+{
+    struct sw_flow_key key;
+    struct ofpbuf *buffer;
+
+    if (buffer_id == UINT32_MAX) {
+        /* FIXME: can we avoid copying data here?
+         *
+         * Leave the same headroom as for received packets, so that the
+         * actions can add a VLAN tag or send the packet to the controller. */
+        const int headroom = 128 + 2;
+        buffer = ofpbuf_new(headroom + data_len);
+        ofpbuf_reserve(buffer, headroom);
+        ofpbuf_put(buffer, data, data_len);
+    } else {
+        buffer = retrieve_buffer(buffer_id);
+        if (!buffer) {
+            return -ESRCH;
+        }
+    }
+
+    flow_extract(buffer, in_port, &key.flow);
+    execute_actions(dp, buffer, &key, actions, actions_len, NULL, true);
+    return 0;
+}
+
 static int
 recv_packet_out(struct datapath *dp, const struct sender *sender,
                 const void *msg)
 {
     const struct ofp_packet_out *opo = msg;
-    struct sw_flow_key key;
-    uint16_t v_code;
-    struct ofpbuf *buffer;
     size_t actions_len = ntohs(opo->actions_len);
+    uint16_t v_code;
 
     if (actions_len > (ntohs(opo->header.length) - sizeof *opo)) {
         VLOG_DBG_RL(&rl, "message too short for number of actions");
         return -EINVAL;
     }
 
-    if (ntohl(opo->buffer_id) == (uint32_t) -1) {
-        /* FIXME: can we avoid copying data here? */
-        int data_len = ntohs(opo->header.length) - sizeof *opo - actions_len;
-        buffer = ofpbuf_new(data_len);
-        ofpbuf_put(buffer, (uint8_t *)opo->actions + actions_len, data_len);
-    } else {
-        buffer = retrieve_buffer(ntohl(opo->buffer_id));
-        if (!buffer) {
-            return -ESRCH;
-        }
-    }
-
-    flow_extract(buffer, ntohs(opo->in_port), &key.flow);
-
-    v_code = validate_actions(dp, &key, opo->actions, actions_len);
+    v_code = dp_validate_packet_out(dp, ntohs(opo->in_port),
+                                    opo->actions, actions_len);
     if (v_code != ACT_VALIDATION_OK) {
         dp_send_error_msg(dp, sender, OFPET_BAD_ACTION, v_code,
                   msg, ntohs(opo->header.length));
-        goto error;
+        if (ntohl(opo->buffer_id) != UINT32_MAX) {
+            discard_buffer(ntohl(opo->buffer_id));
+        }
+        return -EINVAL;
     }
 
-    execute_actions(dp, buffer, &key, opo->actions, actions_len, true);
-
-    return 0;
-
-error:
-    ofpbuf_delete(buffer);
-    return -EINVAL;
+    return dp_execute_packet_out(dp, ntohs(opo->in_port),
+                                 ntohl(opo->buffer_id),
+                                 (uint8_t *) opo->actions + actions_len,
+                                 (ntohs(opo->header.length) - sizeof *opo
+                                  - actions_len),
+                                 opo->actions, actions_len);
 }
 
 static int
@@ -1337,168 +1964,183 @@ recv_port_mod(struct datapath *dp, const struct sender *sender UNUSED,
     return 0;
 }
 
-static int
-add_flow(struct datapath *dp, const struct sender *sender,
-        const struct ofp_flow_mod *ofm)
+/* Checks whether flow_mod 'ofm', received from the controller, can be applied
+ * to 'dp', without changing anything.  Returns 0 if so.  Otherwise, stores the
+ * OpenFlow error type and code to report into '*type' and '*code' and returns
+ * a negative errno value.
+ *
+ * The only problem this cannot foresee is running out of room in the flow
+ * table, which dp_apply_flow_mod() reports. */
+int
+dp_check_flow_mod(struct datapath *dp, const struct ofp_flow_mod *ofm,
+                  uint16_t *type, uint16_t *code)
 {
-    int error = -ENOMEM;
-    uint16_t v_code;
-    struct sw_flow *flow;
+    uint16_t command = ntohs(ofm->command);
+    uint16_t flags = ntohs(ofm->flags);
     size_t actions_len = ntohs(ofm->header.length) - sizeof *ofm;
-    int overlap;
-
-    /* Allocate memory. */
-    flow = flow_alloc(actions_len);
-    if (flow == NULL)
-        goto error;
+    struct sw_flow_key key;
+    uint16_t v_code;
 
-    flow_extract_match(&flow->key, &ofm->match);
+    if (command == OFPFC_DELETE || command == OFPFC_DELETE_STRICT) {
+        return 0;
+    } else if (command != OFPFC_ADD && command != OFPFC_MODIFY
+               && command != OFPFC_MODIFY_STRICT) {
+        *type = OFPET_FLOW_MOD_FAILED;
+        *code = OFPFMFC_BAD_COMMAND;
+        return -ENODEV;
+    }
 
-    v_code = validate_actions(dp, &flow->key, ofm->actions, actions_len);
+    flow_extract_match(&key, &ofm->match);
+    v_code = validate_actions(dp, &key, ofm->actions, actions_len);
     if (v_code != ACT_VALIDATION_OK) {
-        dp_send_error_msg(dp, sender, OFPET_BAD_ACTION, v_code,
-                  ofm, ntohs(ofm->header.length));
-        goto error_free_flow;
+        *type = OFPET_BAD_ACTION;
+        *code = v_code;
+        return -EINVAL;
     }
 
-    flow->priority = flow->key.wildcards ? ntohs(ofm->priority) : -1;
+    if (command == OFPFC_ADD) {
+        if (flags & OFPFF_CHECK_OVERLAP) {
+            uint16_t priority = key.wildcards ? ntohs(ofm->priority) : -1;
+            if (chain_has_conflict(dp->chain, &key, priority, false)) {
+                *type = OFPET_FLOW_MOD_FAILED;
+                *code = OFPFMFC_OVERLAP;
+                return -EEXIST;
+            }
+        }
 
-    if (ntohs(ofm->flags) & OFPFF_CHECK_OVERLAP) {
-        /* check whether there is any conflict */
-        overlap = chain_has_conflict(dp->chain, &flow->key, flow->priority,
-                                     false);
-        if (overlap){
-            dp_send_error_msg(dp, sender, OFPET_FLOW_MOD_FAILED,
-                              OFPFMFC_OVERLAP, ofm, ntohs(ofm->header.length));
-            goto error_free_flow;
+        if (flags & OFPFF_EMERG
+            && (ntohs(ofm->idle_timeout) != OFP_FLOW_PERMANENT
+                || ntohs(ofm->hard_timeout) != OFP_FLOW_PERMANENT)) {
+            *type = OFPET_FLOW_MOD_FAILED;
+            *code = OFPFMFC_BAD_EMERG_TIMEOUT;
+            return -EINVAL;
         }
     }
 
-    if (ntohs(ofm->flags) & OFPFF_EMERG) {
-        if (ntohs(ofm->idle_timeout) != OFP_FLOW_PERMANENT
-            || ntohs(ofm->hard_timeout) != OFP_FLOW_PERMANENT) {
-            dp_send_error_msg(dp, sender, OFPET_FLOW_MOD_FAILED,
-                              OFPFMFC_BAD_EMERG_TIMEOUT, ofm,
-                              ntohs(ofm->header.length));
-            goto error_free_flow;
+    return 0;
+}
+
+/* Applies flow_mod 'ofm', which must have passed dp_check_flow_mod(), to
+ * 'dp''s flow table.  If this inserts a flow, stores it into '*flowp',
+ * otherwise stores a null pointer there.  The packet buffer that 'ofm' names,
+ * if any, is left alone: see dp_flow_mod_execute_buffer().
+ *
+ * Returns 0 if successful, -ENOBUFS if there is no room for a new flow,
+ * -ESRCH if 'ofm' deletes flows but none matched, otherwise another negative
+ * errno value. */
+int
+dp_apply_flow_mod(struct datapath *dp, const struct ofp_flow_mod *ofm,
+                  struct sw_flow **flowp)
+{
+    uint16_t command = ntohs(ofm->command);
+    int emerg = (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0;
+    size_t actions_len = ntohs(ofm->header.length) - sizeof *ofm;
+    struct sw_flow *flow;
+    struct sw_flow_key key;
+    uint16_t priority;
+    int error;
+
+    *flowp = NULL;
+    flow_extract_match(&key, &ofm->match);
+    priority = key.wildcards ? ntohs(ofm->priority) : -1;
+
+    switch (command) {
+    case OFPFC_ADD:
+        break;
+
+    case OFPFC_MODIFY:
+    case OFPFC_MODIFY_STRICT:
+        /* First try to modify existing flows if any; if there is no matching
+         * flow, add it. */
+        if (chain_modify(dp->chain, &key, priority,
+                         command == OFPFC_MODIFY_STRICT,
+                         ofm->actions, actions_len, emerg)) {
+            return 0;
         }
+        break;
+
+    case OFPFC_DELETE:
+        return chain_delete(dp->chain, &key, ofm->out_port, 0, 0, emerg)
+               ? 0 : -ESRCH;
+
+    case OFPFC_DELETE_STRICT:
+        return chain_delete(dp->chain, &key, ofm->out_port, priority, 1, emerg)
+               ? 0 : -ESRCH;
+
+    default:
+        return -ENODEV;
+    }
+
+    /* Allocate memory. */
+    flow = flow_alloc(actions_len);
+    if (flow == NULL) {
+        return -ENOMEM;
     }
 
     /* Fill out flow. */
+    flow->key = key;
+    flow->priority = priority;
     flow->cookie = ntohll(ofm->cookie);
     flow->idle_timeout = ntohs(ofm->idle_timeout);
     flow->hard_timeout = ntohs(ofm->hard_timeout);
     flow->send_flow_rem = (ntohs(ofm->flags) & OFPFF_SEND_FLOW_REM) ? 1 : 0;
-    flow->emerg_flow = (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0;
+    flow->emerg_flow = emerg;
     flow_setup_actions(flow, ofm->actions, actions_len);
 
     /* Act. */
-    error = chain_insert(dp->chain, flow,
-                         (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0);
-    if (error == -ENOBUFS) {
-        dp_send_error_msg(dp, sender, OFPET_FLOW_MOD_FAILED,
-                OFPFMFC_ALL_TABLES_FULL, ofm, ntohs(ofm->header.length));
-        goto error_free_flow;
-    } else if (error) {
-        goto error_free_flow;
-    }
-
-    error = 0;
-    if (ntohl(ofm->buffer_id) != UINT32_MAX) {
-        struct ofpbuf *buffer = retrieve_buffer(ntohl(ofm->buffer_id));
-        if (buffer) {
-            struct sw_flow_key key;
-            uint16_t in_port = ntohs(ofm->match.in_port);
-            flow_extract(buffer, in_port, &key.flow);
-            flow_used(flow, buffer);
-            execute_actions(dp, buffer, &key,
-                    ofm->actions, actions_len, false);
-        } else {
-            error = -ESRCH;
-        }
+    error = chain_insert(dp->chain, flow, emerg);
+    if (error) {
+        flow_free(flow);
+        return error;
     }
-    return error;
-
-error_free_flow:
-    flow_free(flow);
-error:
-    if (ntohl(ofm->buffer_id) != (uint32_t) -1)
-        discard_buffer(ntohl(ofm->buffer_id));
-    return error;
+    *flowp = flow;
+    return 0;
 }
 
-static int
-mod_flow(struct datapath *dp, const struct sender *sender,
-        const struct ofp_flow_mod *ofm)
+/* Runs the packet buffered under 'ofm''s buffer_id, if it names one, through
+ * 'ofm''s actions.  If 'flow' is nonnull, the packet is counted against it.
+ * Returns 0 if successful or if 'ofm' does not name a buffer, -ESRCH if the
+ * buffer no longer exists. */
+int
+dp_flow_mod_execute_buffer(struct datapath *dp, const struct ofp_flow_mod *ofm,
+                           struct sw_flow *flow)
 {
-    int error = -ENOMEM;
-    uint16_t v_code;
     size_t actions_len = ntohs(ofm->header.length) - sizeof *ofm;
-    struct sw_flow *flow;
-    int strict;
-
-    /* Allocate memory. */
-    flow = flow_alloc(actions_len);
-    if (flow == NULL)
-        goto error;
-
-    flow_extract_match(&flow->key, &ofm->match);
+    struct ofpbuf *buffer;
+    struct sw_flow_key key;
 
-    v_code = validate_actions(dp, &flow->key, ofm->actions, actions_len);
-    if (v_code != ACT_VALIDATION_OK) {
-        dp_send_error_msg(dp, sender, OFPET_BAD_ACTION, v_code,
-                          ofm, ntohs(ofm->header.length));
-        goto error_free_flow;
-    }
-
-    flow->priority = flow->key.wildcards ? ntohs(ofm->priority) : -1;
-    strict = (ofm->command == htons(OFPFC_MODIFY_STRICT)) ? 1 : 0;
-
-    /* First try to modify existing flows if any */
-    /* if there is no matching flow, add it */
-    if (!chain_modify(dp->chain, &flow->key, flow->priority,
-                      strict, ofm->actions, actions_len,
-                      (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0)) {
-        /* Fill out flow. */
-        flow->cookie = ntohll(ofm->cookie);
-        flow->idle_timeout = ntohs(ofm->idle_timeout);
-        flow->hard_timeout = ntohs(ofm->hard_timeout);
-        flow->send_flow_rem = (ntohs(ofm->flags) & OFPFF_SEND_FLOW_REM) ? 1 : 0;
-        flow->emerg_flow = (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0;
-        flow_setup_actions(flow, ofm->actions, actions_len);
-        error = chain_insert(dp->chain, flow,
-                             (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0);
-        if (error == -ENOBUFS) {
-            dp_send_error_msg(dp, sender, OFPET_FLOW_MOD_FAILED,
-                              OFPFMFC_ALL_TABLES_FULL, ofm,
-                              ntohs(ofm->header.length));
-            goto error_free_flow;
-        } else if (error) {
-            goto error_free_flow;
-        }
+    if (ntohl(ofm->buffer_id) == UINT32_MAX) {
+        return 0;
     }
 
-    error = 0;
-    if (ntohl(ofm->buffer_id) != UINT32_MAX) {
-      struct ofpbuf *buffer = retrieve_buffer(ntohl(ofm->buffer_id));
-      if (buffer) {
-            struct sw_flow_key skb_key;
-            uint16_t in_port = ntohs(ofm->match.in_port);
-            flow_extract(buffer, in_port, &skb_key.flow);
-            execute_actions(dp, buffer, &skb_key,
-                            ofm->actions, actions_len, false);
-        } else {
-            error = -ESRCH;
-        }
+    buffer = retrieve_buffer(ntohl(ofm->buffer_id));
+    if (!buffer) {
+        return -ESRCH;
     }
-    return error;
+    flow_extract(buffer, ntohs(ofm->match.in_port), &key.flow);
+    if (flow) {
+        flow_used(flow, buffer);
+    }
+    execute_actions(dp, buffer, &key, ofm->actions, actions_len, NULL,
+                    false);
+    return 0;
+}
 
-error_free_flow:
-    flow_free(flow);
-error:
-    if (ntohl(ofm->buffer_id) != (uint32_t) -1)
+/* Drops the packet buffered under 'id', if it still exists. */
+void
+dp_discard_buffer(uint32_t id)
+{
+    discard_buffer(id);
+}
+
+/* Drops the packet buffered under 'ofm''s buffer_id, if it names one, because
+ * 'ofm' was not applied. */
+void
+dp_flow_mod_discard_buffer(const struct ofp_flow_mod *ofm)
+{
+    if (ntohl(ofm->buffer_id) != UINT32_MAX) {
         discard_buffer(ntohl(ofm->buffer_id));
-    return error;
+    }
 }
 
 static int
@@ -1507,28 +2149,31 @@ recv_flow(struct datapath *dp, const struct sender *sender,
 {
     const struct ofp_flow_mod *ofm = msg;
     uint16_t command = ntohs(ofm->command);
+    struct sw_flow *flow;
+    uint16_t type, code;
+    int error;
 
-    if (command == OFPFC_ADD) {
-        return add_flow(dp, sender, ofm);
-    } else if ((command == OFPFC_MODIFY) || (command == OFPFC_MODIFY_STRICT)) {
-        return mod_flow(dp, sender, ofm);
-    }  else if (command == OFPFC_DELETE) {
-        struct sw_flow_key key;
-        flow_extract_match(&key, &ofm->match);
-        return chain_delete(dp->chain, &key, ofm->out_port, 0, 0,
-                            (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0)
-                            ? 0 : -ESRCH;
-    } else if (command == OFPFC_DELETE_STRICT) {
-        struct sw_flow_key key;
-        uint16_t priority;
-        flow_extract_match(&key, &ofm->match);
-        priority = key.wildcards ? ntohs(ofm->priority) : -1;
-        return chain_delete(dp->chain, &key, ofm->out_port, priority, 1,
-                            (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0)
-                            ? 0 : -ESRCH;
-    } else {
-        return -ENODEV;
+    if (command == OFPFC_DELETE || command == OFPFC_DELETE_STRICT) {
+        return dp_apply_flow_mod(dp, ofm, &flow);
+    }
+
+    error = dp_check_flow_mod(dp, ofm, &type, &code);
+    if (!error) {
+        error = dp_apply_flow_mod(dp, ofm, &flow);
+        if (error == -ENOBUFS) {
+            type = OFPET_FLOW_MOD_FAILED;
+            code = OFPFMFC_ALL_TABLES_FULL;
+        } else if (!error) {
+            return dp_flow_mod_execute_buffer(dp, ofm, flow);
+        }
+    }
+
+    if (error != -ENOMEM) {
+        dp_send_error_msg(dp, sender, type, code,
+                          ofm, ntohs(ofm->header.length));
     }
+    dp_flow_mod_discard_buffer(ofm);
+    return error;
 }
 
 static int
@@ -1697,6 +2342,7 @@ table_stats_dump(struct datapath *dp, void *state UNUSED,
     for (i = 0; i < dp->chain->n_tables; i++) {
         struct ofp_table_stats *ots = ofpbuf_put_uninit(buffer, sizeof *ots);
         struct sw_table_stats stats;
+        memset(&stats, 0, sizeof stats);
         dp->chain->tables[i]->stats(dp->chain->tables[i], &stats);
         strncpy(ots->name, stats.name, sizeof ots->name);
         ots->table_id = i;
@@ -1715,6 +2361,8 @@ struct port_stats_state {
     int port_no;	/* from ofp_stats_request */
 };
 
+#define MAX_PORT_STATS_BYTES 4096
+
 struct queue_stats_state {
     uint16_t port;
     uint32_t queue_id;
@@ -1780,23 +2428,27 @@ dump_port_stats(struct datapath *dp, struct sw_port *port,
     }
 }
 
-/* Although this makes some of the motions of being called
- * multiple times preserving state, it doesn't actually support
- * that process; the for loop can never break early.
- */
+/* Dumps port statistics into 'buffer', stopping once it holds
+ * MAX_PORT_STATS_BYTES so that the reply's 16-bit length cannot overflow on
+ * switches with many ports.  Returns 1 if more ports remain, in which case
+ * 's->start_port' records where to resume, otherwise 0. */
 static int port_stats_dump(struct datapath *dp, void *state,
                            struct ofpbuf *buffer)
 {
     struct port_stats_state *s = state;
     struct sw_port *p = NULL;
-    int i = 0;
+    unsigned int i;
 
     if (s->port_no == OFPP_NONE) {
         /* Dump statistics for all ports */
-        for (i = s->start_port; i < DP_MAX_PORTS; i++) {
-            p = dp_lookup_port(dp, i);
-            if (p && PORT_IN_USE(p)) {
+        for (p = port_array_first(&dp->ports, &i); p;
+             p = port_array_next(&dp->ports, &i)) {
+            if ((int) i >= s->start_port && PORT_IN_USE(p)) {
                 dump_port_stats(dp, p, buffer);
+                if (buffer->size >= MAX_PORT_STATS_BYTES) {
+                    s->start_port = i + 1;
+                    return 1;
+                }
             }
         }
         if (dp->local_port) {
@@ -1904,15 +2556,317 @@ queue_stats_done(void *state)
  * <...>                                  // Other stuff.
  * };
  */
+
+/* Appends the OFP_EXT_STATS_TXQ statistics for 'dp' to 'buffer'. */
 static int
-vendor_stats_init(const void *body, int body_len UNUSED,
-                  void **state UNUSED)
+txq_stats_dump(struct datapath *dp, const struct openflow_ext_stats_header *rq,
+               struct ofpbuf *buffer)
+{
+        int i;
+
+        ofpbuf_put(buffer, rq, sizeof *rq);
+        for (i = 0; i < OFP_EXT_TXQ_N_CLASSES; i++) {
+                struct openflow_ext_txq_stats *ts;
+                uint32_t n_queued = 0, n_bytes = 0;
+                struct remote *r;
+
+                LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+                        n_queued += r->txqs[i].queue.n;
+                        n_bytes += r->txqs[i].n_bytes;
+                }
+
+                ts = ofpbuf_put_zeros(buffer, sizeof *ts);
+                ts->txq_class = htonl(i);
+                ts->max_bytes = htonl(txq_max_bytes[i]);
+                ts->n_queued = htonl(n_queued);
+                ts->n_bytes = htonl(n_bytes);
+                ts->n_sent = htonll(dp->txq_sent[i]);
+                ts->n_dropped = htonll(dp->txq_dropped[i]);
+        }
+        return 0;
+}
+
+struct port_rx_stats_state {
+        struct openflow_ext_stats_header esh; /* Vendor in host byte order. */
+        int start_port;
+};
+
+static void
+dump_port_rx_stats(const struct sw_port *p, struct ofpbuf *buffer)
+{
+        struct openflow_ext_port_rx_stats *ps;
+
+        ps = ofpbuf_put_zeros(buffer, sizeof *ps);
+        ps->port_no = htons(p->port_no);
+        ps->ready = p->rx_ready;
+        ps->n_wakeups = htonll(p->rx_wakeups);
+        ps->n_services = htonll(p->rx_services);
+        ps->n_empty = htonll(p->rx_empty);
+        ps->n_exhausted = htonll(p->rx_exhausted);
+}
+
+/* Appends the OFP_EXT_STATS_PORT_RX statistics for 'dp' to 'buffer', stopping
+ * once it holds MAX_PORT_STATS_BYTES.  Returns 1 if more ports remain, in
+ * which case 's->start_port' records where to resume, otherwise 0. */
+static int
+port_rx_stats_dump(struct datapath *dp, struct port_rx_stats_state *s,
+                   const struct openflow_ext_stats_header *rq,
+                   struct ofpbuf *buffer)
+{
+        struct sw_port *p;
+        unsigned int i;
+
+        ofpbuf_put(buffer, rq, sizeof *rq);
+        for (p = port_array_first(&dp->ports, &i); p;
+             p = port_array_next(&dp->ports, &i)) {
+                if ((int) i >= s->start_port && PORT_IN_USE(p)) {
+                        dump_port_rx_stats(p, buffer);
+                        if (buffer->size >= MAX_PORT_STATS_BYTES) {
+                                s->start_port = i + 1;
+                                return 1;
+                        }
+                }
+        }
+        if (dp->local_port) {
+                dump_port_rx_stats(dp->local_port, buffer);
+        }
+        return 0;
+}
+
+static void
+put_table_usage(struct ofpbuf *buffer, struct sw_table *table, int table_id,
+                enum chain_placement placement)
+{
+    struct openflow_ext_table_stats *ts;
+    struct sw_table_stats stats;
+
+    memset(&stats, 0, sizeof stats);
+    table->stats(table, &stats);
+
+    ts = ofpbuf_put_zeros(buffer, sizeof *ts);
+    ts->table_id = table_id;
+    ts->placement = (placement == CHAIN_PLACE_EXACT ? OFP_EXT_TABLE_EXACT
+                     : placement == CHAIN_PLACE_WILD ? OFP_EXT_TABLE_WILD
+                     : placement == CHAIN_PLACE_EMERG ? OFP_EXT_TABLE_EMERG
+                     : OFP_EXT_TABLE_ANY);
+    strncpy(ts->name, stats.name, sizeof ts->name - 1);
+    ts->max_entries = htonl(stats.max_flows);
+    ts->active_count = htonl(stats.n_flows);
+    ts->lookup_count = htonll(stats.n_lookup);
+    ts->matched_count = htonll(stats.n_matched);
+    ts->n_bytes = htonll(stats.n_bytes);
+}
+
+/* Appends the OFP_EXT_STATS_TABLE statistics for 'dp' to 'buffer'. */
+static int
+table_usage_stats_dump(struct datapath *dp,
+                       const struct openflow_ext_stats_header *rq,
+                       struct ofpbuf *buffer)
+{
+        struct sw_chain *chain = dp->chain;
+        int i;
+
+        ofpbuf_put(buffer, rq, sizeof *rq);
+        for (i = 0; i < chain->n_tables; i++) {
+                put_table_usage(buffer, chain->tables[i], i,
+                                chain->placements[i]);
+        }
+        put_table_usage(buffer, chain->emerg_table, EMERG_TABLE_ID_FOR_STATS,
+                        CHAIN_PLACE_EMERG);
+        return 0;
+}
+
+static void
+put_table_diag(struct ofpbuf *buffer, struct sw_table *table, int table_id)
+{
+    struct openflow_ext_table_diag *td;
+    struct sw_table_stats stats;
+    int i, j;
+
+    memset(&stats, 0, sizeof stats);
+    table->stats(table, &stats);
+
+    td = ofpbuf_put_zeros(buffer, sizeof *td);
+    td->table_id = table_id;
+    td->n_hashes = MIN(stats.n_hashes, ARRAY_SIZE(td->hashes));
+    strncpy(td->name, stats.name, sizeof td->name - 1);
+    td->max_entries = htonl(stats.max_flows);
+    td->active_count = htonl(stats.n_flows);
+    td->lookup_count = htonll(stats.n_lookup);
+    td->matched_count = htonll(stats.n_matched);
+    for (i = 0; i < OFP_EXT_HIST_BINS && i < TABLE_HIST_BINS; i++) {
+        td->depth[i] = htonll(stats.depth_hist[i]);
+    }
+    for (i = 0; i < td->n_hashes; i++) {
+        const struct sw_table_hash_stats *hs = &stats.hashes[i];
+        struct openflow_ext_hash_diag *hd = &td->hashes[i];
+
+        hd->polynomial = htonl(hs->polynomial);
+        hd->n_buckets = htonl(hs->n_buckets);
+        hd->n_flows = htonl(hs->n_flows);
+        hd->n_collisions = htonll(hs->n_collisions);
+        for (j = 0; j < OFP_EXT_HIST_BINS && j < TABLE_HIST_BINS; j++) {
+            hd->occupancy[j] = htonl(hs->occupancy[j]);
+        }
+    }
+}
+
+/* Appends the OFP_EXT_STATS_TABLE_DIAG statistics for 'dp' to 'buffer'. */
+static int
+table_diag_stats_dump(struct datapath *dp,
+                      const struct openflow_ext_stats_header *rq,
+                      struct ofpbuf *buffer)
+{
+        struct sw_chain *chain = dp->chain;
+        int i;
+
+        ofpbuf_put(buffer, rq, sizeof *rq);
+        for (i = 0; i < chain->n_tables; i++) {
+                put_table_diag(buffer, chain->tables[i], i);
+        }
+        put_table_diag(buffer, chain->emerg_table, EMERG_TABLE_ID_FOR_STATS);
+        return 0;
+}
+
+/* State for dumping OFP_EXT_STATS_METER statistics, which may take several
+ * replies, like flow_stats_state. */
+struct meter_stats_state {
+    struct openflow_ext_stats_header esh; /* Vendor in host byte order. */
+    int table_idx;
+    struct sw_table_position position;
+    struct ofp_flow_stats_request rq;
+
+    struct ofpbuf *buffer;
+};
+
+static struct meter_stats_state *
+meter_stats_init(const struct openflow_ext_stats_header *esh, int body_len)
+{
+    const struct ofp_flow_stats_request *fsr;
+    struct meter_stats_state *s;
+
+    if (body_len != sizeof *esh + sizeof *fsr) {
+        return NULL;
+    }
+    fsr = (const struct ofp_flow_stats_request *) (esh + 1);
+
+    s = xmalloc(sizeof *s);
+    s->esh = *esh;
+    s->table_idx = fsr->table_id == 0xff ? 0 : fsr->table_id;
+    memset(&s->position, 0, sizeof s->position);
+    s->rq = *fsr;
+    return s;
+}
+
+static int
+meter_stats_dump_callback(struct sw_flow *flow, void *private)
+{
+    struct meter_stats_state *s = private;
+    const struct sw_flow_actions *sfa = flow->sf_acts;
+    size_t i;
+
+    for (i = 0; i < sfa->n_meters; i++) {
+        const struct sw_meter *m = &sfa->meters[i];
+        struct openflow_ext_meter_stats *ms;
+
+        ms = ofpbuf_put_zeros(s->buffer, sizeof *ms);
+        flow_fill_match(&ms->match, &flow->key.flow, flow->key.wildcards);
+        ms->cookie = htonll(flow->cookie);
+        ms->priority = htons(flow->priority);
+        ms->table_id = s->table_idx;
+        ms->meter_idx = i;
+        ms->rate = htonl(m->rate);
+        ms->burst = htonl(m->burst / 1000);
+        ms->policy = m->policy;
+        ms->dscp = m->dscp;
+        ms->conform_packets = htonll(m->conform_packets);
+        ms->conform_bytes = htonll(m->conform_bytes);
+        ms->exceed_packets = htonll(m->exceed_packets);
+        ms->exceed_bytes = htonll(m->exceed_bytes);
+    }
+    return s->buffer->size >= MAX_FLOW_STATS_BYTES;
+}
+
+/* Appends the OFP_EXT_STATS_METER statistics for 'dp' to 'buffer', continuing
+ * where the previous reply for 's' left off.  Returns nonzero if there are
+ * more to send. */
+static int
+meter_stats_dump(struct datapath *dp, struct meter_stats_state *s,
+                 const struct openflow_ext_stats_header *rq,
+                 struct ofpbuf *buffer)
+{
+    struct sw_flow_key match_key;
+
+    ofpbuf_put(buffer, rq, sizeof *rq);
+    flow_extract_match(&match_key, &s->rq.match);
+    s->buffer = buffer;
+
+    if (s->rq.table_id == EMERG_TABLE_ID_FOR_STATS) {
+        struct sw_table *table = dp->chain->emerg_table;
+
+        table->iterate(table, &match_key, s->rq.out_port,
+                       &s->position, meter_stats_dump_callback, s);
+    } else {
+        while (s->table_idx < dp->chain->n_tables
+               && (s->rq.table_id == 0xff || s->rq.table_id == s->table_idx))
+        {
+            struct sw_table *table = dp->chain->tables[s->table_idx];
+
+            if (table->iterate(table, &match_key, s->rq.out_port,
+                               &s->position, meter_stats_dump_callback, s))
+                break;
+
+            s->table_idx++;
+            memset(&s->position, 0, sizeof s->position);
+        }
+    }
+    return s->buffer->size >= MAX_FLOW_STATS_BYTES;
+}
+
+static int
+vendor_stats_init(const void *body, int body_len,
+                  void **state)
 {
         /* min_body was checked, this should be safe */
         const uint32_t vendor = ntohl(*((uint32_t *)body));
+        const struct openflow_ext_stats_header *esh = body;
         int err;
 
         switch (vendor) {
+        case OPENFLOW_VENDOR_ID:
+                if (ntohl(esh->subtype) == OFP_EXT_STATS_TXQ
+                    || ntohl(esh->subtype) == OFP_EXT_STATS_TABLE
+                    || ntohl(esh->subtype) == OFP_EXT_STATS_TABLE_DIAG) {
+                        struct openflow_ext_stats_header *copy;
+
+                        copy = xmemdup(esh, sizeof *esh);
+                        copy->vendor = vendor;
+                        *state = copy;
+                        err = 0;
+                } else if (ntohl(esh->subtype) == OFP_EXT_STATS_PORT_RX) {
+                        struct port_rx_stats_state *s;
+
+                        s = xmalloc(sizeof *s);
+                        s->esh = *esh;
+                        s->esh.vendor = vendor;
+                        s->start_port = 1;
+                        *state = s;
+                        err = 0;
+                } else if (ntohl(esh->subtype) == OFP_EXT_STATS_METER) {
+                        struct meter_stats_state *s;
+
+                        s = meter_stats_init(esh, body_len);
+                        if (s) {
+                                s->esh.vendor = vendor;
+                                *state = s;
+                                err = 0;
+                        } else {
+                                err = -EINVAL;
+                        }
+                } else {
+                        err = -EINVAL;
+                }
+                break;
         default:
                 err = -EINVAL;
         }
@@ -1921,13 +2875,38 @@ vendor_stats_init(const void *body, int body_len UNUSED,
 }
 
 static int
-vendor_stats_dump(struct datapath *dp UNUSED, void *state,
-                  struct ofpbuf *buffer UNUSED)
+vendor_stats_dump(struct datapath *dp, void *state,
+                  struct ofpbuf *buffer)
 {
         const uint32_t vendor = *((uint32_t *)state);
         int err;
 
         switch (vendor) {
+        case OPENFLOW_VENDOR_ID: {
+                const struct openflow_ext_stats_header *esh = state;
+                struct openflow_ext_stats_header rq;
+
+                rq.vendor = htonl(vendor);
+                rq.subtype = esh->subtype;
+                switch (ntohl(rq.subtype)) {
+                case OFP_EXT_STATS_TXQ:
+                        err = txq_stats_dump(dp, &rq, buffer);
+                        break;
+                case OFP_EXT_STATS_PORT_RX:
+                        err = port_rx_stats_dump(dp, state, &rq, buffer);
+                        break;
+                case OFP_EXT_STATS_TABLE:
+                        err = table_usage_stats_dump(dp, &rq, buffer);
+                        break;
+                case OFP_EXT_STATS_TABLE_DIAG:
+                        err = table_diag_stats_dump(dp, &rq, buffer);
+                        break;
+                default:
+                        err = meter_stats_dump(dp, state, &rq, buffer);
+                        break;
+                }
+                break;
+        }
         default:
                 /* Should never happen */
                 err = 0;
@@ -1942,6 +2921,9 @@ vendor_stats_done(void *state)
         const uint32_t vendor = *((uint32_t *) state);
 
         switch (vendor) {
+        case OPENFLOW_VENDOR_ID:
+                free(state);
+                break;
         default:
                 /* Should never happen */
                 free(state);
@@ -2028,7 +3010,7 @@ static const struct stats_type stats[] = {
     {
         OFPST_VENDOR,
         8,             /* vendor + subtype */
-        32,            /* whatever */
+        8 + sizeof(struct ofp_flow_stats_request), /* OFP_EXT_STATS_METER */
         vendor_stats_init,
         vendor_stats_dump,
         vendor_stats_done
@@ -39,10 +39,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "openflow/nicira-ext.h"
+#include "openflow/openflow-ext.h"
 #include "ofpbuf.h"
 #include "timeval.h"
 #include "list.h"
 #include "netdev.h"
+#include "port-array.h"
 
 /* FIXME:  Can declare struct of_hw_driver instead */
 #if defined(OF_HW_PLAT)
@@ -53,6 +55,8 @@ struct rconn;
 struct pvconn;
 struct sw_flow;
 struct sender;
+struct ofp_flow_mod;
+struct ofp_action_header;
 
 struct sw_queue {
     struct list node; /* element in port.queues */
@@ -92,6 +96,14 @@ struct sw_port {
     unsigned long long int rx_bytes, tx_bytes;
     unsigned long long int tx_dropped;
     uint16_t port_no;
+    /* Receive servicing.  dp_run() only receives on a port that poll_block()
+     * has reported readable, and then only up to a deficit round-robin byte
+     * budget per run, until the port runs dry. */
+    struct poll_waiter *rx_waiter; /* Pending readability callback, if any. */
+    bool rx_ready;              /* Packets may be waiting? */
+    int rx_deficit;             /* Bytes the port may still receive. */
+    unsigned long long int rx_wakeups, rx_services;
+    unsigned long long int rx_empty, rx_exhausted;
     /* port queues */
     uint16_t num_queues;
     struct sw_queue queues[NETDEV_MAX_QUEUES];
@@ -107,7 +119,9 @@ struct hw_pkt_q_entry {
 };
 #endif
 
-#define DP_MAX_PORTS 255
+/* Port numbers 1...DP_MAX_PORTS - 1 are available for switch ports.  Ports
+ * are allocated only as they are added, so a large limit costs nothing. */
+#define DP_MAX_PORTS OFPP_MAX
 BUILD_ASSERT_DECL(DP_MAX_PORTS <= OFPP_MAX);
 
 struct datapath {
@@ -131,10 +145,38 @@ struct datapath {
     uint16_t miss_send_len;
 
     /* Switch ports. */
-    struct sw_port ports[DP_MAX_PORTS];
+    struct port_array ports;     /* Maps port number to "struct sw_port *". */
     struct sw_port *local_port;  /* OFPP_LOCAL port, if any. */
     struct list port_list; /* All ports, including local_port. */
 
+    /* Output port vectors, rebuilt by update_port_vectors() whenever a
+     * port is added or its configuration changes, so that OFPP_ALL and
+     * OFPP_FLOOD do not have to examine every port for every packet. */
+    uint16_t *all_ports;        /* Every port, in port_list order. */
+    size_t n_all_ports;
+    uint16_t *flood_ports;      /* Ports without OFPPC_NO_FLOOD. */
+    size_t n_flood_ports;
+
+    /* Keeps each port's OFPPS_LINK_DOWN state in step with its carrier. */
+    struct netdev_monitor *monitor; /* Null if rtnetlink is unavailable. */
+    bool monitor_stale;         /* Ports added since monitor was updated? */
+
+    /* Learns MAC addresses on table misses while secchan fails open.  Null
+     * unless ofdatapath was started with --fail-open-learning. */
+    struct standalone *standalone;
+
+    /* Controller transmit queue counters, summed over all remotes, indexed
+     * by enum ofp_extension_txq_class. */
+    uint64_t txq_sent[OFP_EXT_TXQ_N_CLASSES];
+    uint64_t txq_dropped[OFP_EXT_TXQ_N_CLASSES];
+
+    /* Time spent in new_port(), by phase, summed over all ports added, in
+     * microseconds.  Reported at startup. */
+    unsigned int n_ports_added;
+    long long int port_open_usec;      /* Opening the network device. */
+    long long int port_config_usec;    /* Setting MAC and flags, checking IPs. */
+    long long int port_slicing_usec;   /* Setting up queues with tc. */
+
 #if defined(OF_HW_PLAT)
     /* Although the chain maintains the pointer to the HW driver
      * for flow operations, the datapath needs the port functions
@@ -149,12 +191,34 @@ int dp_new(struct datapath **, uint64_t dpid);
 int dp_add_port(struct datapath *, const char *netdev, uint16_t);
 int dp_add_local_port(struct datapath *, const char *netdev, uint16_t);
 void dp_add_pvconn(struct datapath *, struct pvconn *);
+void dp_add_remote(struct datapath *, struct rconn *);
+size_t dp_get_remote_rconns(struct datapath *, struct rconn ***);
+bool dp_flush_remotes(struct datapath *);
+struct sw_port *dp_take_over_port(struct datapath *, uint16_t port_no,
+                                  struct netdev *, uint32_t config,
+                                  uint16_t num_queues);
 void dp_run(struct datapath *);
 void dp_wait(struct datapath *);
 void dp_send_error_msg(struct datapath *, const struct sender *,
                   uint16_t, uint16_t, const void *, size_t);
+int dp_send_openflow_buffer(struct datapath *, struct ofpbuf *,
+                            const struct sender *);
+void dp_subscribe_slow_proto(struct datapath *, const struct sender *);
 void dp_send_flow_end(struct datapath *, struct sw_flow *,
                       enum ofp_flow_removed_reason);
+int dp_check_flow_mod(struct datapath *, const struct ofp_flow_mod *,
+                      uint16_t *type, uint16_t *code);
+int dp_apply_flow_mod(struct datapath *, const struct ofp_flow_mod *,
+                      struct sw_flow **);
+int dp_flow_mod_execute_buffer(struct datapath *, const struct ofp_flow_mod *,
+                               struct sw_flow *);
+void dp_flow_mod_discard_buffer(const struct ofp_flow_mod *);
+void dp_discard_buffer(uint32_t id);
+uint16_t dp_validate_packet_out(struct datapath *, uint16_t in_port,
+                                const struct ofp_action_header *, size_t);
+int dp_execute_packet_out(struct datapath *, uint16_t in_port,
+                          uint32_t buffer_id, const void *data, size_t,
+                          const struct ofp_action_header *, size_t);
 void dp_output_port(struct datapath *, struct ofpbuf *, int in_port, 
                     int out_port, uint32_t queue_id, bool ignore_no_fwd);
 void dp_output_control(struct datapath *, struct ofpbuf *, int in_port,
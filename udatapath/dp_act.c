@@ -35,9 +35,12 @@
 
 #include <arpa/inet.h>
 #include "csum.h"
+#include "hash.h"
 #include "packets.h"
 #include "dp_act.h"
 #include "openflow/nicira-ext.h"
+#include "openflow/openflow-ext.h"
+#include "timeval.h"
 
 static uint16_t
 validate_output(struct datapath *dp UNUSED, const struct sw_flow_key *key, 
@@ -369,6 +372,55 @@ validate_ofpat(struct datapath *dp, const struct sw_flow_key *key,
     return ret;
 }
 
+/* Validate an OFP_EXT_ACTION_POLICE action.  Either returns
+ * ACT_VALIDATION_OK or an OFPET_BAD_ACTION error code. */
+static uint16_t
+validate_police(const struct ofp_action_header *ah, uint16_t len)
+{
+    const struct openflow_ext_action_police *ap;
+
+    if (len != sizeof *ap) {
+        return OFPBAC_BAD_LEN;
+    }
+    ap = (const struct openflow_ext_action_police *)ah;
+    if (!ap->rate || !ap->burst || ap->dscp > 63
+        || (ap->policy != OFP_EXT_POLICE_DROP
+            && ap->policy != OFP_EXT_POLICE_REMARK)) {
+        return OFPBAC_BAD_ARGUMENT;
+    }
+    return ACT_VALIDATION_OK;
+}
+
+/* Validate an OFP_EXT_ACTION_MULTIPATH action.  Either returns
+ * ACT_VALIDATION_OK or an OFPET_BAD_ACTION error code. */
+static uint16_t
+validate_multipath(const struct ofp_action_header *ah, uint16_t len)
+{
+    const struct openflow_ext_action_multipath *am;
+    int i;
+
+    if (len < sizeof *am) {
+        return OFPBAC_BAD_LEN;
+    }
+    am = (const struct openflow_ext_action_multipath *)ah;
+    if (len != ROUND_UP(sizeof *am + am->n_ports * sizeof am->ports[0], 8)) {
+        return OFPBAC_BAD_LEN;
+    }
+    if (!am->n_ports || !am->fields
+        || ntohs(am->fields) & ~OFP_EXT_MP_ALL
+        || (am->algorithm != OFP_EXT_MP_MODULO
+            && am->algorithm != OFP_EXT_MP_HRW)) {
+        return OFPBAC_BAD_ARGUMENT;
+    }
+    for (i = 0; i < am->n_ports; i++) {
+        uint16_t port = ntohs(am->ports[i]);
+        if (!port || port > OFPP_MAX) {
+            return OFPBAC_BAD_OUT_PORT;
+        }
+    }
+    return ACT_VALIDATION_OK;
+}
+
 /* Validate vendor-defined actions.  Either returns ACT_VALIDATION_OK
  * or an OFPET_BAD_ACTION error code. */
 static uint16_t 
@@ -385,6 +437,24 @@ validate_vendor(struct datapath *dp UNUSED, const struct sw_flow_key *key UNUSED
     avh = (struct ofp_action_vendor_header *)ah;
 
     switch(ntohl(avh->vendor)) {
+    case OPENFLOW_VENDOR_ID: {
+        const struct openflow_ext_action_police *ap;
+
+        if (len < sizeof ap->type + sizeof ap->len + sizeof ap->vendor
+                  + sizeof ap->subtype) {
+            return OFPBAC_BAD_LEN;
+        }
+        ap = (const struct openflow_ext_action_police *)ah;
+        switch (ntohs(ap->subtype)) {
+        case OFP_EXT_ACTION_POLICE:
+            return validate_police(ah, len);
+        case OFP_EXT_ACTION_MULTIPATH:
+            return validate_multipath(ah, len);
+        default:
+            return OFPBAC_BAD_VENDOR_TYPE;
+        }
+    }
+
     default:
         return OFPBAC_BAD_VENDOR;
     }
@@ -452,28 +522,195 @@ execute_ofpat(struct ofpbuf *buffer, struct sw_flow_key *key,
     }
 }
 
-/* Execute a vendor-defined action against 'buffer'. */
+/* Sets the DSCP of the IP packet in 'buffer' to 'dscp'. */
 static void
-execute_vendor(struct ofpbuf *buffer UNUSED, const struct sw_flow_key *key UNUSED, 
-        const struct ofp_action_header *ah)
+remark_dscp(struct ofpbuf *buffer, const struct sw_flow_key *key, uint8_t dscp)
+{
+    if (key->flow.dl_type == htons(ETH_TYPE_IP)) {
+        struct ip_header *nh = buffer->l3;
+        uint8_t new = (dscp << 2) | (nh->ip_tos & 0x03);
+
+        nh->ip_csum = recalc_csum32(nh->ip_csum, htons((uint16_t)nh->ip_tos),
+                                    htons((uint16_t)new));
+        nh->ip_tos = new;
+    }
+}
+
+/* Charges 'buffer' against the token bucket in 'm', refilling the bucket
+ * first for the time since it was last refilled, according to the clock
+ * cached by the poll loop.  Returns false if 'buffer' exceeds the rate. */
+static bool
+meter_conforms(struct sw_meter *m, const struct ofpbuf *buffer)
+{
+    uint64_t now = time_msec();
+    uint64_t bits = buffer->size * 8;
+
+    if (now != m->last_fill) {
+        uint64_t elapsed = now - m->last_fill;
+        m->tokens = (elapsed >= m->burst / m->rate ? m->burst
+                     : MIN(m->burst, m->tokens + elapsed * m->rate));
+        m->last_fill = now;
+    }
+    if (m->tokens >= bits) {
+        m->tokens -= bits;
+        m->conform_packets++;
+        m->conform_bytes += buffer->size;
+        return true;
+    } else {
+        m->exceed_packets++;
+        m->exceed_bytes += buffer->size;
+        return false;
+    }
+}
+
+/* Executes OFP_EXT_ACTION_POLICE action 'ap' against 'buffer', with token
+ * bucket 'm', or lets every packet conform if 'm' is null.  Returns false if
+ * 'buffer' should be dropped. */
+static bool
+execute_police(struct ofpbuf *buffer, const struct sw_flow_key *key,
+               const struct openflow_ext_action_police *ap, struct sw_meter *m)
+{
+    if (!m || meter_conforms(m, buffer)) {
+        return true;
+    } else if (ap->policy == OFP_EXT_POLICE_REMARK) {
+        remark_dscp(buffer, key, ap->dscp);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/* Execute a vendor-defined action against 'buffer'.  '*meters' is the token
+ * bucket for the next OFP_EXT_ACTION_POLICE action, or null; it is advanced
+ * past any bucket that the action uses.  Returns false if 'buffer' should be
+ * dropped. */
+static bool
+execute_vendor(struct ofpbuf *buffer, const struct sw_flow_key *key,
+        const struct ofp_action_header *ah, struct sw_meter **meters)
 {
     struct ofp_action_vendor_header *avh 
             = (struct ofp_action_vendor_header *)ah;
 
     switch(ntohl(avh->vendor)) {
+    case OPENFLOW_VENDOR_ID: {
+        const struct openflow_ext_action_police *ap
+                = (const struct openflow_ext_action_police *)ah;
+        struct sw_meter *m = *meters;
+
+        if (ap->subtype != htons(OFP_EXT_ACTION_POLICE)) {
+            /* OFP_EXT_ACTION_MULTIPATH is executed like an output action. */
+            break;
+        }
+        if (m) {
+            (*meters)++;
+        }
+        return execute_police(buffer, key, ap, m);
+    }
+
     default:
         /* This should not be possible due to prior validation. */
         printf("attempt to execute action with unknown vendor: %#x\n", 
                 ntohl(avh->vendor));
         break;
     }
+    return true;
+}
+
+/* Returns 'ah' as an OFP_EXT_ACTION_MULTIPATH action, or a null pointer if it
+ * is some other kind of action. */
+static const struct openflow_ext_action_multipath *
+multipath_action(const struct ofp_action_header *ah)
+{
+    const struct openflow_ext_action_multipath *am = (const void *) ah;
+
+    return (ah->type == htons(OFPAT_VENDOR)
+            && am->vendor == htonl(OPENFLOW_VENDOR_ID)
+            && am->subtype == htons(OFP_EXT_ACTION_MULTIPATH)
+            ? am : NULL);
+}
+
+/* Hashes the OFP_EXT_MP_* 'fields' of 'flow' with 'basis'. */
+static uint32_t
+hash_flow_fields(const struct flow *flow, uint16_t fields, uint32_t basis)
+{
+    uint8_t data[sizeof *flow];
+    size_t n = 0;
+
+#define HASH_FIELD(BIT, MEMBER)                                         \
+    if (fields & (BIT)) {                                               \
+        memcpy(&data[n], &flow->MEMBER, sizeof flow->MEMBER);           \
+        n += sizeof flow->MEMBER;                                       \
+    }
+    HASH_FIELD(OFP_EXT_MP_IN_PORT, in_port);
+    HASH_FIELD(OFP_EXT_MP_DL_SRC, dl_src);
+    HASH_FIELD(OFP_EXT_MP_DL_DST, dl_dst);
+    HASH_FIELD(OFP_EXT_MP_DL_VLAN, dl_vlan);
+    HASH_FIELD(OFP_EXT_MP_DL_TYPE, dl_type);
+    HASH_FIELD(OFP_EXT_MP_NW_SRC, nw_src);
+    HASH_FIELD(OFP_EXT_MP_NW_DST, nw_dst);
+    HASH_FIELD(OFP_EXT_MP_NW_PROTO, nw_proto);
+    HASH_FIELD(OFP_EXT_MP_TP_SRC, tp_src);
+    HASH_FIELD(OFP_EXT_MP_TP_DST, tp_dst);
+#undef HASH_FIELD
+
+    return hash_bytes(data, n, basis);
+}
+
+/* Returns true if 'dp' may output a packet received on 'in_port' to
+ * 'port_no' as a member of a multipath action. */
+static bool
+multipath_port_is_live(struct datapath *dp, uint16_t port_no, uint16_t in_port)
+{
+    const struct sw_port *p = dp_lookup_port(dp, port_no);
+
+    return (p && port_no != in_port
+            && !(p->config & (OFPPC_PORT_DOWN | OFPPC_NO_FWD))
+            && !(p->state & OFPPS_LINK_DOWN));
+}
+
+/* Returns the port to which multipath action 'am' outputs the packet with
+ * flow 'key', or -1 if none of its ports is live. */
+static int
+select_multipath(struct datapath *dp, const struct sw_flow_key *key,
+                 const struct openflow_ext_action_multipath *am)
+{
+    uint16_t in_port = ntohs(key->flow.in_port);
+    uint32_t hash = hash_flow_fields(&key->flow, ntohs(am->fields),
+                                     ntohs(am->basis));
+    uint16_t live[UINT8_MAX];
+    uint32_t best_score = 0;
+    int best_port = -1;
+    size_t n_live = 0;
+    int i;
+
+    for (i = 0; i < am->n_ports; i++) {
+        uint16_t port_no = ntohs(am->ports[i]);
+
+        if (!multipath_port_is_live(dp, port_no, in_port)) {
+            continue;
+        }
+        if (am->algorithm == OFP_EXT_MP_HRW) {
+            uint32_t score = hash_words(&hash, 1, port_no);
+            if (best_port < 0 || score > best_score) {
+                best_score = score;
+                best_port = port_no;
+            }
+        } else {
+            live[n_live++] = port_no;
+        }
+    }
+    return (am->algorithm == OFP_EXT_MP_HRW ? best_port
+            : n_live ? live[hash % n_live]
+            : -1);
 }
 
-/* Execute a list of actions against 'buffer'. */
+/* Execute a list of actions against 'buffer'.  'meters' holds the token
+ * buckets for the OFP_EXT_ACTION_POLICE actions in 'actions', in order, or is
+ * null to let every packet through the policers. */
 void execute_actions(struct datapath *dp, struct ofpbuf *buffer,
              struct sw_flow_key *key,
              const struct ofp_action_header *actions, size_t actions_len,
-             int ignore_no_fwd)
+             struct sw_meter *meters, int ignore_no_fwd)
 {
     /* Every output action needs a separate clone of 'buffer', but the common
      * case is just a single output action, so that doing a clone and then
@@ -510,13 +747,19 @@ void execute_actions(struct datapath *dp, struct ofpbuf *buffer,
             prev_port = ntohs(ea->port);
             prev_queue = ntohl(ea->queue_id);
             max_len = 0; /* we will not send to the controller anyways - useless */
+        } else if (multipath_action(ah)) {
+            prev_port = select_multipath(dp, key, multipath_action(ah));
+            prev_queue = 0;
+            max_len = 0;
         } else {
             uint16_t type = ntohs(ah->type);
 
             if (type < ARRAY_SIZE(of_actions)) {
                 execute_ofpat(buffer, key, ah, type);
-            } else if (type == OFPAT_VENDOR) {
-                execute_vendor(buffer, key, ah);
+            } else if (type == OFPAT_VENDOR
+                       && !execute_vendor(buffer, key, ah, &meters)) {
+                ofpbuf_delete(buffer);
+                return;
             }
         }
 
@@ -44,6 +44,6 @@ uint16_t validate_actions(struct datapath *, const struct sw_flow_key *,
 		const struct ofp_action_header *, size_t);
 void execute_actions(struct datapath *, struct ofpbuf *,
 		struct sw_flow_key *, const struct ofp_action_header *, 
-		size_t action_len, int ignore_no_fwd);
+		size_t action_len, struct sw_meter *meters, int ignore_no_fwd);
 
 #endif /* dp_act.h */
@@ -0,0 +1,883 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "handoff.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "daemon.h"
+#include "datapath.h"
+#include "fatal-signal.h"
+#include "netdev.h"
+#include "ofpbuf.h"
+#include "poll-loop.h"
+#include "rconn.h"
+#include "snapshot.h"
+#include "socket-util.h"
+#include "timeval.h"
+#include "util.h"
+#include "vconn.h"
+
+#define THIS_MODULE VLM_handoff
+#include "vlog.h"
+
+/* Handoff protocol.
+ *
+ * The new process connects to the old one over a SOCK_SEQPACKET socket.  The
+ * old process sends one HANDOFF_DATAPATH message, one HANDOFF_FLOWS message,
+ * any number of HANDOFF_PORT, HANDOFF_LISTENER, and HANDOFF_REMOTE messages,
+ * and finally HANDOFF_END.  File descriptors travel with the messages as
+ * SCM_RIGHTS.  Once the new process is running, it sends HANDOFF_READY, and
+ * the old process exits.  If the old process does not receive HANDOFF_READY
+ * in time, it closes its copies of the file descriptors that it sent, and
+ * carries on as if nothing had happened.
+ *
+ * Both processes run on the same host, so the messages are in host byte
+ * order. */
+#define HANDOFF_VERSION 1
+
+enum handoff_type {
+    HANDOFF_DATAPATH,           /* struct handoff_datapath. */
+    HANDOFF_FLOWS,              /* struct handoff_flows + snapshot fd. */
+    HANDOFF_PORT,               /* struct handoff_port + netdev fds. */
+    HANDOFF_LISTENER,           /* struct handoff_listener + socket fd. */
+    HANDOFF_REMOTE,             /* struct handoff_remote + rx data + fd. */
+    HANDOFF_END,                /* struct handoff_header. */
+    HANDOFF_READY               /* struct handoff_header. */
+};
+
+struct handoff_header {
+    uint32_t type;              /* One of HANDOFF_*. */
+    uint32_t pad;
+};
+
+struct handoff_datapath {
+    struct handoff_header header;
+    uint32_t version;           /* HANDOFF_VERSION. */
+    uint16_t flags;             /* OFPC_* flags set by the controller. */
+    uint16_t miss_send_len;
+    uint64_t dpid;
+};
+
+struct handoff_flows {
+    struct handoff_header header;
+    uint32_t n_flows;           /* Number of flows in the snapshot. */
+    uint32_t pad;
+};
+
+struct handoff_queue {
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_errors;
+    uint32_t queue_id;
+    uint16_t class_id;
+    uint16_t property;
+    uint16_t min_rate;
+    uint8_t pad[6];
+};
+
+/* The file descriptors are the netdev's raw socket, its TAP device if
+ * 'has_tap' is nonzero, then one socket per netdev queue. */
+struct handoff_port {
+    struct handoff_header header;
+    char name[OFP_MAX_PORT_NAME_LEN];
+    uint16_t port_no;
+    uint16_t num_queues;        /* Number of sw_port queues. */
+    uint16_t n_queues;          /* Number of queues in use. */
+    uint16_t netdev_num_queues; /* Number of netdev queue sockets. */
+    uint32_t config;
+    uint8_t has_tap;
+    uint8_t pad[3];
+    int32_t save_flags;
+    int32_t changed_flags;
+    uint64_t rx_packets, tx_packets;
+    uint64_t rx_bytes, tx_bytes;
+    uint64_t tx_dropped;
+    struct handoff_queue queues[NETDEV_MAX_QUEUES];
+};
+
+struct handoff_listener {
+    struct handoff_header header;
+    char name[256];
+};
+
+struct handoff_remote {
+    struct handoff_header header;
+    int32_t version;            /* Negotiated OpenFlow version. */
+    uint32_t ip;
+    uint32_t rx_len;            /* Bytes of received data that follow. */
+    uint32_t pad;
+    char name[256];
+    /* Followed by 'rx_len' bytes already read from the connection. */
+};
+
+/* Most file descriptors carried by one message. */
+#define HANDOFF_MAX_FDS (2 + NETDEV_MAX_QUEUES)
+
+/* Largest message: a remote with a full OpenFlow message's worth of data. */
+#define HANDOFF_MAX_LEN (sizeof(struct handoff_remote) + 65536)
+
+/* How long to wait for a peer to respond, in seconds. */
+#define HANDOFF_TIMEOUT 10
+
+/* How long the old process may spend sending its queued messages to the
+ * controller before handing off, in milliseconds. */
+#define HANDOFF_FLUSH_MSEC 1000
+
+struct handoff {
+    char *file_name;            /* Name of Unix domain socket. */
+    char *pidfile;              /* Name of pidfile, or NULL. */
+    int listen_fd;              /* Listening socket, or -1. */
+    int fd;                     /* Connection to the old process, or -1. */
+};
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+/* Creates and returns a new handoff for the Unix domain socket named
+ * 'file_name'.  Must be called before daemonize(), which forgets the name of
+ * the pidfile. */
+struct handoff *
+handoff_create(const char *file_name)
+{
+    const char *pidfile = get_pidfile();
+    struct handoff *h = xmalloc(sizeof *h);
+    h->file_name = xstrdup(file_name);
+    h->pidfile = pidfile ? xstrdup(pidfile) : NULL;
+    h->listen_fd = -1;
+    h->fd = -1;
+    return h;
+}
+
+/* Makes 'fd' blocking, with a timeout of HANDOFF_TIMEOUT seconds on sending
+ * and receiving.  Returns 0 if successful, otherwise a positive errno
+ * value. */
+static int
+set_handoff_timeouts(int fd)
+{
+    struct timeval tv;
+    int flags;
+
+    flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        return errno;
+    }
+    tv.tv_sec = HANDOFF_TIMEOUT;
+    tv.tv_usec = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) < 0
+        || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/* Sends the 'size' bytes in 'data', followed by the 'extra_len' bytes in
+ * 'extra', as one message on 'fd', together with the 'n_fds' file
+ * descriptors in 'fds'.  Returns 0 if successful, otherwise a positive errno
+ * value. */
+static int
+send_msg(int fd, const void *data, size_t size,
+         const void *extra, size_t extra_len, const int fds[], size_t n_fds)
+{
+    union {
+        struct cmsghdr cm;
+        char buf[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    } cmsg;
+    struct msghdr msg;
+    struct iovec iov[2];
+
+    assert(n_fds <= HANDOFF_MAX_FDS);
+    iov[0].iov_base = (void *) data;
+    iov[0].iov_len = size;
+    iov[1].iov_base = (void *) extra;
+    iov[1].iov_len = extra_len;
+
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = extra_len ? 2 : 1;
+    if (n_fds) {
+        memset(&cmsg, 0, sizeof cmsg);
+        cmsg.cm.cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+        cmsg.cm.cmsg_level = SOL_SOCKET;
+        cmsg.cm.cmsg_type = SCM_RIGHTS;
+        memcpy(CMSG_DATA(&cmsg.cm), fds, sizeof(int) * n_fds);
+        msg.msg_control = &cmsg;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+    }
+    return sendmsg(fd, &msg, 0) < 0 ? errno : 0;
+}
+
+static int
+send_header(int fd, enum handoff_type type)
+{
+    struct handoff_header hdr;
+
+    memset(&hdr, 0, sizeof hdr);
+    hdr.type = type;
+    return send_msg(fd, &hdr, sizeof hdr, NULL, 0, NULL, 0);
+}
+
+/* Receives a message from 'fd' into 'buf', which is replaced.  Stores the file
+ * descriptors that came with the message in 'fds' and their number in
+ * '*n_fdsp'.  Returns 0 if successful, EOF if the peer closed the connection,
+ * otherwise a positive errno value. */
+static int
+recv_msg(int fd, struct ofpbuf *buf, int fds[], size_t *n_fdsp)
+{
+    union {
+        struct cmsghdr cm;
+        char buf[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    } cmsg;
+    struct cmsghdr *p;
+    struct msghdr msg;
+    struct iovec iov;
+    ssize_t retval;
+
+    *n_fdsp = 0;
+    ofpbuf_clear(buf);
+    ofpbuf_prealloc_tailroom(buf, HANDOFF_MAX_LEN);
+    iov.iov_base = buf->data;
+    iov.iov_len = HANDOFF_MAX_LEN;
+
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &cmsg;
+    msg.msg_controllen = sizeof cmsg;
+    do {
+        retval = recvmsg(fd, &msg, 0);
+    } while (retval < 0 && errno == EINTR);
+    if (retval < 0) {
+        return errno;
+    } else if (!retval) {
+        return EOF;
+    }
+    buf->size = retval;
+
+    for (p = CMSG_FIRSTHDR(&msg); p; p = CMSG_NXTHDR(&msg, p)) {
+        if (p->cmsg_level == SOL_SOCKET && p->cmsg_type == SCM_RIGHTS) {
+            size_t n = (p->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(p), n * sizeof(int));
+            *n_fdsp = n;
+        }
+    }
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        return EMSGSIZE;
+    }
+    return buf->size >= sizeof(struct handoff_header) ? 0 : EPROTO;
+}
+
+static void
+close_fds(const int fds[], size_t n_fds)
+{
+    size_t i;
+
+    for (i = 0; i < n_fds; i++) {
+        close(fds[i]);
+    }
+}
+
+/* The old process's side. */
+
+static int
+send_datapath(int fd, struct datapath *dp)
+{
+    struct handoff_datapath hd;
+
+    memset(&hd, 0, sizeof hd);
+    hd.header.type = HANDOFF_DATAPATH;
+    hd.version = HANDOFF_VERSION;
+    hd.flags = dp->flags;
+    hd.miss_send_len = dp->miss_send_len;
+    hd.dpid = dp->id;
+    return send_msg(fd, &hd, sizeof hd, NULL, 0, NULL, 0);
+}
+
+static int
+send_flows(int fd, struct datapath *dp)
+{
+    struct handoff_flows hf;
+    FILE *stream;
+    int snapshot_fd;
+    int error;
+
+    stream = tmpfile();
+    if (!stream) {
+        return errno;
+    }
+    memset(&hf, 0, sizeof hf);
+    hf.header.type = HANDOFF_FLOWS;
+    error = snapshot_write(dp, stream, &hf.n_flows);
+    if (!error) {
+        snapshot_fd = fileno(stream);
+        error = send_msg(fd, &hf, sizeof hf, NULL, 0, &snapshot_fd, 1);
+    }
+    fclose(stream);
+    return error;
+}
+
+static int
+send_port(int fd, struct sw_port *p)
+{
+    struct netdev_handoff nh;
+    struct handoff_port hp;
+    int fds[HANDOFF_MAX_FDS];
+    struct sw_queue *q;
+    size_t n_fds;
+    int i;
+
+    netdev_get_handoff(p->netdev, &nh);
+
+    memset(&hp, 0, sizeof hp);
+    hp.header.type = HANDOFF_PORT;
+    strncpy(hp.name, netdev_get_name(p->netdev), sizeof hp.name - 1);
+    hp.port_no = p->port_no;
+    hp.num_queues = p->num_queues;
+    hp.config = p->config;
+    hp.has_tap = nh.tap_fd >= 0;
+    hp.netdev_num_queues = nh.num_queues;
+    hp.save_flags = nh.save_flags;
+    hp.changed_flags = nh.changed_flags;
+    hp.rx_packets = p->rx_packets;
+    hp.tx_packets = p->tx_packets;
+    hp.rx_bytes = p->rx_bytes;
+    hp.tx_bytes = p->tx_bytes;
+    hp.tx_dropped = p->tx_dropped;
+    LIST_FOR_EACH (q, struct sw_queue, node, &p->queue_list) {
+        struct handoff_queue *hq = &hp.queues[hp.n_queues++];
+        hq->tx_packets = q->tx_packets;
+        hq->tx_bytes = q->tx_bytes;
+        hq->tx_errors = q->tx_errors;
+        hq->queue_id = q->queue_id;
+        hq->class_id = q->class_id;
+        hq->property = q->property;
+        hq->min_rate = q->min_rate;
+    }
+
+    n_fds = 0;
+    fds[n_fds++] = nh.netdev_fd;
+    if (hp.has_tap) {
+        fds[n_fds++] = nh.tap_fd;
+    }
+    for (i = 0; i < nh.num_queues; i++) {
+        fds[n_fds++] = nh.queue_fds[i];
+    }
+    return send_msg(fd, &hp, sizeof hp, NULL, 0, fds, n_fds);
+}
+
+static int
+send_listener(int fd, struct pvconn *pvconn)
+{
+    struct handoff_listener hl;
+    int listen_fd;
+
+    if (pvconn_hand_off(pvconn, &listen_fd)) {
+        VLOG_WARN("%s: cannot hand off this kind of listener",
+                  pvconn_get_name(pvconn));
+        return 0;
+    }
+    memset(&hl, 0, sizeof hl);
+    hl.header.type = HANDOFF_LISTENER;
+    strncpy(hl.name, pvconn_get_name(pvconn), sizeof hl.name - 1);
+    return send_msg(fd, &hl, sizeof hl, NULL, 0, &listen_fd, 1);
+}
+
+/* Sends the connection underlying 'rconn', if it can be handed off.  Returns
+ * 0 if successful or if the connection cannot be handed off, in which case
+ * the peer will have to reconnect to the new process. */
+static int
+send_remote(int fd, struct rconn *rconn, int *n_remotes)
+{
+    struct vconn *vconn = rconn_get_vconn(rconn);
+    const struct ofpbuf *rxbuf = NULL;
+    struct handoff_remote hr;
+    int vconn_fd, version;
+    int error;
+
+    error = vconn ? vconn_hand_off(vconn, &vconn_fd, &version, &rxbuf) : EAGAIN;
+    if (!error && rxbuf && rxbuf->size > HANDOFF_MAX_LEN - sizeof hr) {
+        error = EMSGSIZE;
+    }
+    if (error) {
+        VLOG_WARN("%s: cannot hand off connection (%s), peer must reconnect",
+                  rconn_get_name(rconn), strerror(error));
+        return 0;
+    }
+
+    memset(&hr, 0, sizeof hr);
+    hr.header.type = HANDOFF_REMOTE;
+    hr.version = version;
+    hr.ip = vconn_get_ip(vconn);
+    hr.rx_len = rxbuf ? rxbuf->size : 0;
+    strncpy(hr.name, vconn_get_name(vconn), sizeof hr.name - 1);
+    (*n_remotes)++;
+    return send_msg(fd, &hr, sizeof hr, rxbuf ? rxbuf->data : NULL, hr.rx_len,
+                    &vconn_fd, 1);
+}
+
+/* Gives up every resource that the new process took over, so that exiting
+ * does not disturb them. */
+static void
+release_all(struct handoff *h, struct datapath *dp)
+{
+    struct sw_port *p;
+    size_t i;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (p->netdev) {
+            netdev_release(p->netdev);
+        }
+    }
+    for (i = 0; i < dp->n_listeners; i++) {
+        const char *name = pvconn_get_name(dp->listeners[i]);
+        if (!strncmp(name, "punix:", 6)) {
+            fatal_signal_remove_file_to_unlink(name + 6);
+        }
+    }
+    fatal_signal_remove_file_to_unlink(h->file_name);
+    if (h->pidfile) {
+        fatal_signal_remove_file_to_unlink(h->pidfile);
+    }
+}
+
+/* Hands 'dp' off to the new process connected on 'fd'.  Does not return if
+ * successful. */
+static void
+hand_off(struct handoff *h, struct datapath *dp, int fd)
+{
+    long long int start = time_usec();
+    long long int deadline;
+    struct handoff_header *hdr;
+    struct rconn **rconns;
+    size_t n_rconns;
+    int n_ports, n_listeners, n_remotes;
+    struct sw_port *p;
+    struct ofpbuf buf;
+    int fds[HANDOFF_MAX_FDS];
+    size_t n_fds;
+    size_t i;
+    int error;
+
+    VLOG_INFO("new process connected, handing off");
+    error = set_handoff_timeouts(fd);
+    if (error) {
+        VLOG_WARN("%s: setting timeouts failed (%s)",
+                  h->file_name, strerror(error));
+        return;
+    }
+
+    /* Let the controllers have what we owe them, so that nothing is lost
+     * with our transmit queues. */
+    deadline = time_msec() + HANDOFF_FLUSH_MSEC;
+    while (!dp_flush_remotes(dp) && time_msec() < deadline) {
+        poll_timer_wait(10);
+        poll_block();
+    }
+
+    error = send_datapath(fd, dp);
+    if (!error) {
+        error = send_flows(fd, dp);
+    }
+    n_ports = 0;
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (!error && !IS_HW_PORT(p) && p->netdev) {
+            error = send_port(fd, p);
+            n_ports++;
+        }
+    }
+    n_listeners = 0;
+    for (i = 0; !error && i < dp->n_listeners; i++) {
+        error = send_listener(fd, dp->listeners[i]);
+        n_listeners++;
+    }
+    n_remotes = 0;
+    n_rconns = dp_get_remote_rconns(dp, &rconns);
+    for (i = 0; !error && i < n_rconns; i++) {
+        error = send_remote(fd, rconns[i], &n_remotes);
+    }
+    free(rconns);
+    if (!error) {
+        error = send_header(fd, HANDOFF_END);
+    }
+    if (error) {
+        VLOG_WARN("%s: sending state failed (%s)",
+                  h->file_name, strerror(error));
+        return;
+    }
+
+    ofpbuf_init(&buf, HANDOFF_MAX_LEN);
+    error = recv_msg(fd, &buf, fds, &n_fds);
+    close_fds(fds, n_fds);
+    hdr = buf.data;
+    if (!error && hdr->type != HANDOFF_READY) {
+        error = EPROTO;
+    }
+    ofpbuf_uninit(&buf);
+    if (error) {
+        VLOG_WARN("%s: new process did not take over (%s), resuming",
+                  h->file_name,
+                  error == EOF ? "connection closed" : strerror(error));
+        return;
+    }
+
+    release_all(h, dp);
+    VLOG_INFO("handed off %d ports, %d listeners, and %d connections "
+              "in %lld ms, exiting", n_ports, n_listeners, n_remotes,
+              (time_usec() - start) / 1000);
+    exit(EXIT_SUCCESS);
+}
+
+/* Listens on 'h''s socket for a new process that wants to take over.
+ * Returns 0 if successful, otherwise a positive errno value. */
+int
+handoff_listen(struct handoff *h)
+{
+    int fd;
+
+    fd = make_unix_socket(SOCK_SEQPACKET, true, false, h->file_name, NULL);
+    if (fd < 0) {
+        VLOG_ERR("%s: binding failed: %s", h->file_name, strerror(-fd));
+        return -fd;
+    }
+    if (listen(fd, 1) < 0) {
+        int error = errno;
+        VLOG_ERR("%s: listen failed: %s", h->file_name, strerror(error));
+        close(fd);
+        return error;
+    }
+    h->listen_fd = fd;
+    return 0;
+}
+
+/* Hands 'dp' off to a new process, if one has connected to 'h'.  Exits if the
+ * new process takes over. */
+void
+handoff_run(struct handoff *h, struct datapath *dp)
+{
+    int fd;
+
+    if (h->listen_fd < 0) {
+        return;
+    }
+    fd = accept(h->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        if (errno != EAGAIN) {
+            VLOG_WARN_RL(&rl, "%s: accept failed: %s",
+                         h->file_name, strerror(errno));
+        }
+        return;
+    }
+    hand_off(h, dp, fd);
+    close(fd);
+}
+
+void
+handoff_wait(struct handoff *h)
+{
+    if (h->listen_fd >= 0) {
+        poll_fd_wait(h->listen_fd, POLLIN);
+    }
+}
+
+/* The new process's side. */
+
+static int
+take_over_datapath(struct datapath *dp, const struct ofpbuf *buf)
+{
+    const struct handoff_datapath *hd = buf->data;
+
+    if (buf->size != sizeof *hd || hd->version != HANDOFF_VERSION) {
+        VLOG_ERR("old process uses an incompatible handoff protocol");
+        return EPROTO;
+    }
+    dp->id = hd->dpid;
+    dp->flags = hd->flags;
+    dp->miss_send_len = hd->miss_send_len;
+    return 0;
+}
+
+static int
+take_over_flows(struct datapath *dp, const struct ofpbuf *buf,
+                const int fds[], size_t n_fds)
+{
+    if (buf->size != sizeof(struct handoff_flows) || n_fds != 1) {
+        return EPROTO;
+    }
+    return snapshot_read(dp, fds[0], "old process's flow table", -1);
+}
+
+static int
+take_over_port(struct datapath *dp, const struct ofpbuf *buf,
+               const int fds[], size_t n_fds)
+{
+    const struct handoff_port *hp = buf->data;
+    struct netdev_handoff nh;
+    struct netdev *netdev;
+    struct sw_port *p;
+    char name[sizeof hp->name + 1];
+    size_t n;
+    int error;
+    int i;
+
+    if (buf->size != sizeof *hp
+        || hp->netdev_num_queues > NETDEV_MAX_QUEUES
+        || hp->n_queues > NETDEV_MAX_QUEUES
+        || n_fds != 1 + !!hp->has_tap + hp->netdev_num_queues) {
+        return EPROTO;
+    }
+    memcpy(name, hp->name, sizeof hp->name);
+    name[sizeof hp->name] = '\0';
+
+    n = 0;
+    nh.netdev_fd = fds[n++];
+    nh.tap_fd = hp->has_tap ? fds[n++] : -1;
+    nh.num_queues = hp->netdev_num_queues;
+    for (i = 0; i < nh.num_queues; i++) {
+        nh.queue_fds[i] = fds[n++];
+    }
+    nh.save_flags = hp->save_flags;
+    nh.changed_flags = hp->changed_flags;
+
+    error = netdev_take_over(name, &nh, &netdev);
+    if (error) {
+        VLOG_ERR("%s: taking over device failed (%s)", name, strerror(error));
+        return error;
+    }
+    p = dp_take_over_port(dp, hp->port_no, netdev, hp->config,
+                          hp->num_queues);
+    if (!p) {
+        VLOG_ERR("%s: port %"PRIu16" is already in use", name, hp->port_no);
+        netdev_release(netdev);
+        netdev_close(netdev);
+        return EEXIST;
+    }
+
+    p->rx_packets = hp->rx_packets;
+    p->tx_packets = hp->tx_packets;
+    p->rx_bytes = hp->rx_bytes;
+    p->tx_bytes = hp->tx_bytes;
+    p->tx_dropped = hp->tx_dropped;
+    for (i = 0; i < hp->n_queues; i++) {
+        const struct handoff_queue *hq = &hp->queues[i];
+        struct sw_queue *q;
+
+        if (hq->class_id >= NETDEV_MAX_QUEUES) {
+            continue;
+        }
+        q = &p->queues[hq->class_id];
+        q->port = p;
+        q->tx_packets = hq->tx_packets;
+        q->tx_bytes = hq->tx_bytes;
+        q->tx_errors = hq->tx_errors;
+        q->queue_id = hq->queue_id;
+        q->class_id = hq->class_id;
+        q->property = hq->property;
+        q->min_rate = hq->min_rate;
+        list_push_back(&p->queue_list, &q->node);
+    }
+    return 0;
+}
+
+static int
+take_over_listener(struct datapath *dp, const struct ofpbuf *buf,
+                   const int fds[], size_t n_fds)
+{
+    const struct handoff_listener *hl = buf->data;
+    char name[sizeof hl->name + 1];
+    struct pvconn *pvconn;
+    int error;
+
+    if (buf->size != sizeof *hl || n_fds != 1) {
+        return EPROTO;
+    }
+    memcpy(name, hl->name, sizeof hl->name);
+    name[sizeof hl->name] = '\0';
+
+    error = pvconn_take_over(name, fds[0], &pvconn);
+    if (error) {
+        VLOG_ERR("%s: taking over listener failed (%s)",
+                 name, strerror(error));
+        return error;
+    }
+    dp_add_pvconn(dp, pvconn);
+    return 0;
+}
+
+static int
+take_over_remote(struct datapath *dp, const struct ofpbuf *buf,
+                 const int fds[], size_t n_fds)
+{
+    const struct handoff_remote *hr = buf->data;
+    char name[sizeof hr->name + 1];
+    struct vconn *vconn;
+    int error;
+
+    if (buf->size < sizeof *hr || buf->size - sizeof *hr != hr->rx_len
+        || n_fds != 1) {
+        return EPROTO;
+    }
+    memcpy(name, hr->name, sizeof hr->name);
+    name[sizeof hr->name] = '\0';
+
+    error = vconn_take_over(name, fds[0], hr->version, hr->ip, hr + 1,
+                            hr->rx_len, &vconn);
+    if (error) {
+        VLOG_ERR("%s: taking over connection failed (%s)",
+                 name, strerror(error));
+        return error;
+    }
+    dp_add_remote(dp, rconn_new_from_vconn("passive", vconn));
+    return 0;
+}
+
+/* Connects to the old process listening on 'h''s socket, if there is one, and
+ * takes over its flow table, ports, listeners, and controller connections
+ * into 'dp', which should be newly created.  Afterward, the caller should run
+ * 'dp' once and then call handoff_ready().
+ *
+ * Returns 0 if successful, ENOENT or ECONNREFUSED if no old process is
+ * listening, otherwise a positive errno value.  After a failure other than
+ * ENOENT or ECONNREFUSED, 'dp' may have taken over part of the old process's
+ * state, and the old process resumes, so the caller should exit. */
+int
+handoff_take_over(struct handoff *h, struct datapath *dp)
+{
+    long long int start = time_usec();
+    int n_ports, n_listeners, n_remotes;
+    struct ofpbuf buf;
+    int error;
+    int fd;
+
+    fd = make_unix_socket(SOCK_SEQPACKET, false, false, NULL, h->file_name);
+    if (fd < 0) {
+        return -fd;
+    }
+    error = set_handoff_timeouts(fd);
+    if (error) {
+        close(fd);
+        return error;
+    }
+    VLOG_INFO("%s: taking over from old process", h->file_name);
+
+    n_ports = n_listeners = n_remotes = 0;
+    ofpbuf_init(&buf, HANDOFF_MAX_LEN);
+    for (;;) {
+        const struct handoff_header *hdr;
+        int fds[HANDOFF_MAX_FDS];
+        size_t n_fds;
+
+        error = recv_msg(fd, &buf, fds, &n_fds);
+        if (error) {
+            close_fds(fds, n_fds);
+            break;
+        }
+
+        hdr = buf.data;
+        switch (hdr->type) {
+        case HANDOFF_DATAPATH:
+            error = take_over_datapath(dp, &buf);
+            break;
+        case HANDOFF_FLOWS:
+            error = take_over_flows(dp, &buf, fds, n_fds);
+            close_fds(fds, n_fds);
+            break;
+        case HANDOFF_PORT:
+            error = take_over_port(dp, &buf, fds, n_fds);
+            n_ports++;
+            break;
+        case HANDOFF_LISTENER:
+            error = take_over_listener(dp, &buf, fds, n_fds);
+            n_listeners++;
+            break;
+        case HANDOFF_REMOTE:
+            error = take_over_remote(dp, &buf, fds, n_fds);
+            n_remotes++;
+            break;
+        case HANDOFF_END:
+            goto done;
+        default:
+            error = EPROTO;
+            break;
+        }
+        if (error == EPROTO) {
+            close_fds(fds, n_fds);
+        }
+        if (error) {
+            break;
+        }
+    }
+
+    VLOG_ERR("%s: taking over from old process failed (%s)", h->file_name,
+             error == EOF ? "connection closed" : strerror(error));
+    ofpbuf_uninit(&buf);
+    close(fd);
+    return error == EOF ? EPROTO : error;
+
+done:
+    ofpbuf_uninit(&buf);
+    h->fd = fd;
+    VLOG_INFO("took over %d ports, %d listeners, and %d connections "
+              "in %lld ms", n_ports, n_listeners, n_remotes,
+              (time_usec() - start) / 1000);
+    return 0;
+}
+
+/* Tells the old process that this one has taken over, following a successful
+ * call to handoff_take_over(), and waits for it to exit. */
+void
+handoff_ready(struct handoff *h)
+{
+    if (h->fd >= 0) {
+        int error = send_header(h->fd, HANDOFF_READY);
+        if (!error) {
+            char c;
+
+            /* The old process closes the connection when it exits. */
+            while (read(h->fd, &c, 1) > 0) {
+                continue;
+            }
+        } else {
+            VLOG_WARN("%s: sending ready failed (%s)",
+                      h->file_name, strerror(error));
+        }
+        close(h->fd);
+        h->fd = -1;
+    }
+}
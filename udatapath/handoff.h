@@ -0,0 +1,56 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Hitless restarts of ofdatapath.
+ *
+ * A running ofdatapath started with --handoff=FILE listens for a successor on
+ * the Unix domain socket FILE.  A new ofdatapath started with the same option
+ * connects to FILE and takes over the old one's flow table, ports, listeners,
+ * and controller connections, by passing their file descriptors across the
+ * socket, so that forwarding and the controller connections continue across
+ * an upgrade.  Once the new process is running it tells the old one, which
+ * then exits without disturbing anything it handed off. */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H 1
+
+struct datapath;
+
+struct handoff *handoff_create(const char *file_name);
+int handoff_take_over(struct handoff *, struct datapath *);
+void handoff_ready(struct handoff *);
+int handoff_listen(struct handoff *);
+void handoff_run(struct handoff *, struct datapath *);
+void handoff_wait(struct handoff *);
+
+#endif /* handoff.h */
@@ -32,11 +32,20 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
 #include <arpa/inet.h>
 #include "openflow/openflow-ext.h"
 #include "of_ext_msg.h"
+#include "chain.h"
+#include "dp_act.h"
 #include "netdev.h"
 #include "datapath.h"
+#include "standalone.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "util.h"
 
 #define THIS_MODULE VLM_experimental
 #include "vlog.h"
@@ -104,7 +113,7 @@ recv_of_exp_queue_delete(struct datapath *dp,
     queue_id = ntohl(opq->queue_id);
 
     p = dp_lookup_port(dp,port_no);
-    if (p->netdev) {
+    if (p && p->netdev) {
         q = dp_lookup_queue(p,queue_id);
         if (q) {
             netdev_delete_class(p->netdev,q->class_id);
@@ -236,6 +245,473 @@ recv_of_set_dp_desc(struct datapath *dp,
     dp->dp_desc[DESC_STR_LEN-1] = 0;        // force null for safety
 }
 
+/* Most flow-mods that fit in one OFP_EXT_FLOW_MOD_BUNDLE message. */
+#define BUNDLE_MAX_FLOW_MODS \
+    ((UINT16_MAX - sizeof(struct openflow_ext_flow_mod_bundle)) \
+     / sizeof(struct ofp_flow_mod))
+
+/* Most bytes of a malformed request to echo in an OFPT_ERROR.  The OpenFlow
+ * specification asks for at least 64, and a whole request might not fit. */
+#define ERROR_DATA_MAX 64
+
+/* How to take back one change that a bundle made to the flow table. */
+enum bundle_undo_type {
+    BUNDLE_UNDO_ADDED,          /* Delete 'flow', which the bundle added. */
+    BUNDLE_UNDO_MODIFIED,       /* Put back 'flow''s actions. */
+    BUNDLE_UNDO_REPLACED,       /* Reinsert 'flow', replaced by an add. */
+    BUNDLE_UNDO_DELETED         /* Reinsert 'flow', deleted by the bundle. */
+};
+
+/* One change that a bundle made to the flow table.  'flow' is a private copy
+ * of the flow as it was before the change (or after, for an addition). */
+struct bundle_undo {
+    enum bundle_undo_type type;
+    struct sw_flow *flow;
+    int emerg;
+};
+
+/* The changes made so far by a bundle, in the order made. */
+struct bundle_log {
+    struct bundle_undo *undo;
+    size_t n, allocated;
+};
+
+/* Returns a copy of 'flow' that is not in any table. */
+static struct sw_flow *
+copy_flow(const struct sw_flow *flow)
+{
+    const struct sw_flow_actions *sfa = flow->sf_acts;
+    struct sw_flow *copy = flow_alloc(sfa->actions_len);
+
+    if (copy) {
+        flow_setup_actions(copy, sfa->actions, sfa->actions_len);
+        copy->key = flow->key;
+        copy->cookie = flow->cookie;
+        copy->priority = flow->priority;
+        copy->idle_timeout = flow->idle_timeout;
+        copy->hard_timeout = flow->hard_timeout;
+        copy->used = flow->used;
+        copy->created = flow->created;
+        copy->packet_count = flow->packet_count;
+        copy->byte_count = flow->byte_count;
+        copy->send_flow_rem = flow->send_flow_rem;
+        copy->emerg_flow = flow->emerg_flow;
+        copy->stale_until = flow->stale_until;
+    }
+    return copy;
+}
+
+static void
+bundle_log_push(struct bundle_log *log, enum bundle_undo_type type,
+                struct sw_flow *flow, int emerg)
+{
+    struct bundle_undo *u;
+
+    if (log->n >= log->allocated) {
+        log->allocated = log->allocated ? log->allocated * 2 : 16;
+        log->undo = xrealloc(log->undo, log->allocated * sizeof *log->undo);
+    }
+    u = &log->undo[log->n++];
+    u->type = type;
+    u->flow = flow;
+    u->emerg = emerg;
+}
+
+/* Flows that a flow-mod is about to change, for find_flows(). */
+struct find_flows_aux {
+    const struct sw_flow_key *key;
+    uint16_t priority;
+    int strict;
+    struct bundle_log *log;     /* Where to log copies, if nonnull. */
+    enum bundle_undo_type type; /* Type of each logged copy. */
+    int emerg;
+    bool silence;               /* Stop each flow sending flow-removed? */
+    bool found;                 /* Set to true if any flow matched. */
+    int error;                  /* -ENOMEM if a copy could not be logged. */
+};
+
+static int
+find_flows_cb(struct sw_flow *flow, void *aux_)
+{
+    struct find_flows_aux *aux = aux_;
+
+    if (flow_matches_desc(&flow->key, aux->key, aux->strict)
+        && (!aux->strict || flow->priority == aux->priority)) {
+        if (aux->log) {
+            struct sw_flow *copy = copy_flow(flow);
+            if (!copy) {
+                /* Without a copy the change could not be undone. */
+                aux->error = -ENOMEM;
+                return 1;
+            }
+            bundle_log_push(aux->log, aux->type, copy, aux->emerg);
+        }
+        if (aux->silence) {
+            flow->send_flow_rem = 0;
+        }
+        aux->found = true;
+    }
+    return 0;
+}
+
+static int
+find_flows_in_table(struct sw_table *table, uint16_t out_port,
+                    struct find_flows_aux *aux)
+{
+    struct sw_table_position position;
+
+    memset(&position, 0, sizeof position);
+    return table->iterate(table, aux->key, out_port, &position,
+                          find_flows_cb, aux);
+}
+
+/* Visits each flow in 'dp' that a flow-mod for 'key', 'priority', 'strict',
+ * 'out_port' (in network byte order), and 'emerg' would modify or delete:
+ * logs a copy of each one in 'log' as 'type', if 'log' is nonnull, and makes
+ * it send no flow-removed message, if 'silence' is true.  Sets '*found' to
+ * whether any flow matched, if 'found' is nonnull.
+ *
+ * Returns 0 if successful, or -ENOMEM if a copy could not be made, in which
+ * case some flows may not have been visited. */
+static int
+find_flows(struct datapath *dp, const struct sw_flow_key *key,
+           uint16_t priority, int strict, uint16_t out_port, int emerg,
+           struct bundle_log *log, enum bundle_undo_type type, bool silence,
+           bool *found)
+{
+    struct sw_chain *chain = dp->chain;
+    struct find_flows_aux aux;
+    int i;
+
+    aux.key = key;
+    aux.priority = priority;
+    aux.strict = strict;
+    aux.log = log;
+    aux.type = type;
+    aux.emerg = emerg;
+    aux.silence = silence;
+    aux.found = false;
+    aux.error = 0;
+
+    if (emerg) {
+        find_flows_in_table(chain->emerg_table, out_port, &aux);
+    } else {
+        for (i = 0; i < chain->n_tables && !aux.error; i++) {
+            find_flows_in_table(chain->tables[i], out_port, &aux);
+        }
+    }
+    if (found) {
+        *found = aux.found;
+    }
+    return aux.error;
+}
+
+/* Deletes the flow with exactly 'key' and 'priority' from 'dp', without
+ * sending a flow-removed message for it.  'key' must not belong to a flow in
+ * the flow table, since deleting that flow would free it. */
+static void
+delete_flow_silently(struct datapath *dp, const struct sw_flow_key *key,
+                     uint16_t priority, int emerg)
+{
+    find_flows(dp, key, priority, 1, htons(OFPP_NONE), emerg,
+               NULL, 0, true, NULL);
+    chain_delete(dp->chain, key, htons(OFPP_NONE), priority, 1, emerg);
+}
+
+/* Applies 'ofm' to 'dp' like dp_apply_flow_mod(), first logging in 'log'
+ * how to undo it.  Flows that 'ofm' deletes send no flow-removed messages
+ * yet; bundle_commit() sends them once the whole bundle has been applied. */
+static int
+bundle_apply(struct datapath *dp, const struct ofp_flow_mod *ofm,
+             struct bundle_log *log)
+{
+    uint16_t command = ntohs(ofm->command);
+    int emerg = (ntohs(ofm->flags) & OFPFF_EMERG) ? 1 : 0;
+    struct sw_flow_key key;
+    struct sw_flow *flow;
+    uint16_t priority;
+    bool found;
+    int error;
+
+    flow_extract_match(&key, &ofm->match);
+    priority = key.wildcards ? ntohs(ofm->priority) : -1;
+
+    switch (command) {
+    case OFPFC_ADD:
+        error = find_flows(dp, &key, priority, 1, htons(OFPP_NONE), emerg,
+                           log, BUNDLE_UNDO_REPLACED, false, &found);
+        break;
+
+    case OFPFC_MODIFY:
+    case OFPFC_MODIFY_STRICT:
+        error = find_flows(dp, &key, priority,
+                           command == OFPFC_MODIFY_STRICT, htons(OFPP_NONE),
+                           emerg, log, BUNDLE_UNDO_MODIFIED, false, &found);
+        break;
+
+    case OFPFC_DELETE:
+    case OFPFC_DELETE_STRICT:
+        error = find_flows(dp, &key, priority, command == OFPFC_DELETE_STRICT,
+                           ofm->out_port, emerg, log, BUNDLE_UNDO_DELETED,
+                           true, NULL);
+        found = true;
+        break;
+
+    default:
+        return -ENODEV;
+    }
+    if (error) {
+        /* The rollback puts back the flows already logged, which also undoes
+         * any silencing. */
+        return error;
+    }
+
+    error = dp_apply_flow_mod(dp, ofm, &flow);
+    if (!error && flow && !found) {
+        /* A new flow, not a replacement. */
+        struct sw_flow *copy = copy_flow(flow);
+        if (!copy) {
+            struct sw_flow_key flow_key = flow->key;
+            delete_flow_silently(dp, &flow_key, flow->priority, emerg);
+            return -ENOMEM;
+        }
+        bundle_log_push(log, BUNDLE_UNDO_ADDED, copy, emerg);
+    }
+    return error == -ESRCH ? 0 : error;
+}
+
+/* Takes back every change in 'log', newest first, without sending any
+ * flow-removed messages, and frees 'log''s contents. */
+static void
+bundle_rollback(struct datapath *dp, struct bundle_log *log)
+{
+    while (log->n > 0) {
+        struct bundle_undo *u = &log->undo[--log->n];
+        struct sw_flow *flow = u->flow;
+
+        switch (u->type) {
+        case BUNDLE_UNDO_ADDED:
+            delete_flow_silently(dp, &flow->key, flow->priority, u->emerg);
+            break;
+
+        case BUNDLE_UNDO_MODIFIED:
+            chain_modify(dp->chain, &flow->key, flow->priority, 1,
+                         flow->sf_acts->actions, flow->sf_acts->actions_len,
+                         u->emerg);
+            break;
+
+        case BUNDLE_UNDO_REPLACED:
+        case BUNDLE_UNDO_DELETED:
+            if (!chain_insert(dp->chain, flow, u->emerg)) {
+                flow = NULL;
+            } else {
+                VLOG_ERR("could not restore flow after failed bundle");
+            }
+            break;
+        }
+        flow_free(flow);
+    }
+    free(log->undo);
+}
+
+/* Sends the flow-removed messages that the flows that the bundle deleted
+ * held back, and frees 'log''s contents. */
+static void
+bundle_commit(struct datapath *dp, struct bundle_log *log)
+{
+    size_t i;
+
+    for (i = 0; i < log->n; i++) {
+        struct bundle_undo *u = &log->undo[i];
+        if (u->type == BUNDLE_UNDO_DELETED) {
+            dp_send_flow_end(dp, u->flow, OFPRR_DELETE);
+        }
+        flow_free(u->flow);
+    }
+    free(log->undo);
+}
+
+/* Applies the flow-mods in bundle 'oh' all-or-nothing: every flow-mod is
+ * checked before any is applied, and one reply covers the whole bundle.
+ *
+ * Running out of flow table space or memory are the only failures that show
+ * up while applying.  In that case every change that the bundle made so far,
+ * whether an addition, modification, or deletion, is taken back before
+ * reporting the error, so that the flow table is as it was. */
+static void
+recv_of_ext_flow_mod_bundle(struct datapath *dp, const struct sender *sender,
+                            const void *oh)
+{
+    const struct openflow_ext_flow_mod_bundle *bundle = oh;
+    size_t length = ntohs(bundle->header.header.length);
+    const struct ofp_flow_mod *ofms[BUNDLE_MAX_FLOW_MODS];
+    struct bundle_log log;
+    const uint8_t *p, *end;
+    struct ofp_extension_header *reply;
+    struct ofpbuf *buffer;
+    size_t n_ofms;
+    uint16_t type, code;
+    size_t i;
+
+    if (length < sizeof *bundle) {
+        dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN,
+                          oh, MIN(length, ERROR_DATA_MAX));
+        return;
+    }
+
+    /* Parse and check every flow-mod before touching the flow table. */
+    n_ofms = 0;
+    end = (const uint8_t *) oh + length;
+    for (p = bundle->body; p < end; ) {
+        const struct ofp_flow_mod *ofm = (const struct ofp_flow_mod *) p;
+        size_t ofm_len;
+
+        if ((size_t) (end - p) < sizeof *ofm
+            || (ofm_len = ntohs(ofm->header.length)) < sizeof *ofm
+            || ofm_len > (size_t) (end - p)
+            || ofm_len % 8
+            || ofm->header.version != OFP_VERSION
+            || ofm->header.type != OFPT_FLOW_MOD
+            || n_ofms >= BUNDLE_MAX_FLOW_MODS) {
+            VLOG_WARN("malformed flow-mod bundle");
+            dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN,
+                              oh, MIN(length, ERROR_DATA_MAX));
+            goto discard;
+        }
+
+        ofms[n_ofms++] = ofm;
+        if (dp_check_flow_mod(dp, ofm, &type, &code)) {
+            dp_send_error_msg(dp, sender, type, code,
+                              ofm, MIN(ofm_len, ERROR_DATA_MAX));
+            goto discard;
+        }
+        p += ofm_len;
+    }
+    if (n_ofms != ntohl(bundle->n_flow_mods)) {
+        VLOG_WARN("flow-mod bundle claims %"PRIu32" flow-mods but has %zu",
+                  ntohl(bundle->n_flow_mods), n_ofms);
+        dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN,
+                          oh, MIN(length, ERROR_DATA_MAX));
+        goto discard;
+    }
+
+    /* Apply them. */
+    memset(&log, 0, sizeof log);
+    for (i = 0; i < n_ofms; i++) {
+        const struct ofp_flow_mod *ofm = ofms[i];
+        int error = bundle_apply(dp, ofm, &log);
+        if (error) {
+            bundle_rollback(dp, &log);
+            code = (error == -ENOBUFS ? OFPFMFC_ALL_TABLES_FULL
+                    : error == -ENODEV ? OFPFMFC_BAD_COMMAND
+                    : OFPFMFC_EPERM);
+            dp_send_error_msg(dp, sender, OFPET_FLOW_MOD_FAILED, code,
+                              ofm, MIN(ntohs(ofm->header.length),
+                                       ERROR_DATA_MAX));
+            goto discard;
+        }
+    }
+    bundle_commit(dp, &log);
+
+    /* Release any buffered packets into the new flow table. */
+    for (i = 0; i < n_ofms; i++) {
+        uint16_t command = ntohs(ofms[i]->command);
+        if (command != OFPFC_DELETE && command != OFPFC_DELETE_STRICT) {
+            dp_flow_mod_execute_buffer(dp, ofms[i], NULL);
+        }
+    }
+
+    buffer = ofpbuf_new(sizeof *bundle);
+    reply = ofpbuf_put(buffer, oh, sizeof *bundle);
+    reply->header.length = htons(sizeof *bundle);
+    reply->subtype = htonl(OFP_EXT_FLOW_MOD_BUNDLE_REPLY);
+    dp_send_openflow_buffer(dp, buffer, sender);
+    return;
+
+discard:
+    for (i = 0; i < n_ofms; i++) {
+        dp_flow_mod_discard_buffer(ofms[i]);
+    }
+}
+
+/* Sends each of the packets in 'oh' through its single action list, which is
+ * validated only once for the whole batch. */
+static void
+recv_of_ext_packet_out_multi(struct datapath *dp, const struct sender *sender,
+                             const void *oh)
+{
+    const struct openflow_ext_packet_out_multi *opom = oh;
+    size_t length = ntohs(opom->header.header.length);
+    size_t actions_len = ntohs(opom->actions_len);
+    uint16_t in_port = ntohs(opom->in_port);
+    uint32_t n_packets = ntohl(opom->n_packets);
+    const uint8_t *p, *end;
+    uint16_t v_code;
+    uint32_t i;
+
+    if (length < sizeof *opom || actions_len % 8
+        || actions_len > length - sizeof *opom) {
+        dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN,
+                          oh, MIN(length, ERROR_DATA_MAX));
+        return;
+    }
+
+    v_code = dp_validate_packet_out(dp, in_port, opom->actions, actions_len);
+    if (v_code != ACT_VALIDATION_OK) {
+        dp_send_error_msg(dp, sender, OFPET_BAD_ACTION, v_code,
+                          oh, MIN(length, ERROR_DATA_MAX));
+    }
+
+    end = (const uint8_t *) oh + length;
+    p = (const uint8_t *) opom->actions + actions_len;
+    for (i = 0; i < n_packets; i++) {
+        const struct openflow_ext_packet_out_entry *e = (const void *) p;
+        uint32_t buffer_id;
+        size_t e_len;
+
+        if ((size_t) (end - p) < sizeof *e
+            || (e_len = ntohs(e->len)) < sizeof *e + ntohs(e->data_len)
+            || e_len > (size_t) (end - p)
+            || e_len % 8) {
+            VLOG_WARN("malformed packet entry %"PRIu32" of %"PRIu32
+                      " in multi-packet output", i, n_packets);
+            break;
+        }
+        p += e_len;
+
+        buffer_id = ntohl(e->buffer_id);
+        if (v_code != ACT_VALIDATION_OK) {
+            if (buffer_id != UINT32_MAX) {
+                dp_discard_buffer(buffer_id);
+            }
+        } else {
+            dp_execute_packet_out(dp, in_port, buffer_id,
+                                  e->data, ntohs(e->data_len),
+                                  opom->actions, actions_len);
+        }
+    }
+}
+
+static void
+recv_of_ext_set_fail_open(struct datapath *dp, const struct sender *sender,
+                          const void *oh)
+{
+    const struct openflow_ext_set_fail_open *sfo = oh;
+    size_t length = ntohs(sfo->header.header.length);
+
+    if (length < sizeof *sfo) {
+        dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN,
+                          oh, length);
+    } else if (!dp->standalone) {
+        /* Learning must be allowed with --fail-open-learning. */
+        dp_send_error_msg(dp, sender, OFPET_BAD_REQUEST, OFPBRC_EPERM,
+                          oh, length);
+    } else {
+        standalone_set_active(dp->standalone, sfo->enable != 0,
+                              ntohs(sfo->max_idle));
+    }
+}
+
 /**
  * Receives an experimental message and pass it
  * to the appropriate handler
@@ -257,6 +733,18 @@ int of_ext_recv_msg(struct datapath *dp, const struct sender *sender,
     case OFP_EXT_SET_DESC:
         recv_of_set_dp_desc(dp,sender,ofexth);
         return 0;
+    case OFP_EXT_FLOW_MOD_BUNDLE:
+        recv_of_ext_flow_mod_bundle(dp, sender, oh);
+        return 0;
+    case OFP_EXT_PACKET_OUT_MULTI:
+        recv_of_ext_packet_out_multi(dp, sender, oh);
+        return 0;
+    case OFP_EXT_SLOW_PROTO_SUBSCRIBE:
+        dp_subscribe_slow_proto(dp, sender);
+        return 0;
+    case OFP_EXT_SET_FAIL_OPEN:
+        recv_of_ext_set_fail_open(dp, sender, oh);
+        return 0;
     default:
         VLOG_ERR("Received unknown command of type %d",
                  ntohl(ofexth->subtype));
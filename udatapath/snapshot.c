@@ -0,0 +1,385 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+#include <config.h>
+#include "snapshot.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "chain.h"
+#include "datapath.h"
+#include "dp_act.h"
+#include "flow.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "timeval.h"
+#include "util.h"
+
+#define THIS_MODULE VLM_snapshot
+#include "vlog.h"
+
+/* Snapshot file format.
+ *
+ * A snapshot is a struct snapshot_header followed by 'n_flows' flow records.
+ * Each record is a struct snapshot_flow followed by the flow's actions, in
+ * OpenFlow format, padded to a multiple of 8 bytes.  The flow match and the
+ * actions are in network byte order, as in OpenFlow; everything else is in
+ * host byte order, since a snapshot is only meant to be read back on the
+ * host that wrote it.  A snapshot with an unknown magic number or version is
+ * ignored. */
+#define SNAPSHOT_MAGIC 0x4f464453       /* "OFDS". */
+#define SNAPSHOT_VERSION 1
+
+struct snapshot_header {
+    uint32_t magic;             /* SNAPSHOT_MAGIC. */
+    uint32_t version;           /* SNAPSHOT_VERSION. */
+    uint32_t n_flows;           /* Number of flow records that follow. */
+    uint32_t pad;
+};
+BUILD_ASSERT_DECL(sizeof(struct snapshot_header) == 16);
+
+struct snapshot_flow {
+    struct ofp_match match;     /* Flow match, in network byte order. */
+    uint64_t cookie;
+    uint64_t packet_count;
+    uint64_t byte_count;
+    uint64_t created_age;       /* Milliseconds since the flow was added. */
+    uint64_t used_age;          /* Milliseconds since the flow was used. */
+    uint16_t priority;
+    uint16_t idle_timeout;
+    uint16_t hard_timeout;
+    uint16_t actions_len;       /* Length of actions that follow, in bytes. */
+    uint8_t send_flow_rem;
+    uint8_t emerg_flow;
+    uint8_t pad[6];
+    /* Followed by 'actions_len' bytes of actions, padded to 8 bytes. */
+};
+BUILD_ASSERT_DECL(sizeof(struct snapshot_flow) == 96);
+
+struct snapshot_save_context {
+    FILE *stream;
+    uint64_t now;
+    uint32_t n_flows;
+};
+
+static int
+save_flow(struct sw_flow *flow, void *ctx_)
+{
+    static const uint8_t zeros[8];
+    struct snapshot_save_context *ctx = ctx_;
+    struct sw_flow_actions *sf_acts = flow->sf_acts;
+    struct snapshot_flow sf;
+
+    memset(&sf, 0, sizeof sf);
+    flow_fill_match(&sf.match, &flow->key.flow, flow->key.wildcards);
+    sf.cookie = flow->cookie;
+    sf.packet_count = flow->packet_count;
+    sf.byte_count = flow->byte_count;
+    sf.created_age = ctx->now - flow->created;
+    sf.used_age = ctx->now - flow->used;
+    sf.priority = flow->priority;
+    sf.idle_timeout = flow->idle_timeout;
+    sf.hard_timeout = flow->hard_timeout;
+    sf.actions_len = sf_acts->actions_len;
+    sf.send_flow_rem = flow->send_flow_rem;
+    sf.emerg_flow = flow->emerg_flow;
+
+    if (fwrite(&sf, sizeof sf, 1, ctx->stream) != 1
+        || fwrite(sf_acts->actions, 1, sf_acts->actions_len, ctx->stream)
+           != sf_acts->actions_len
+        || fwrite(zeros, 1, ROUND_UP(sf.actions_len, 8) - sf.actions_len,
+                  ctx->stream)
+           != ROUND_UP(sf.actions_len, 8) - sf.actions_len) {
+        return errno ? errno : EIO;
+    }
+    ctx->n_flows++;
+    return 0;
+}
+
+static int
+save_table(struct sw_table *table, struct snapshot_save_context *ctx)
+{
+    struct sw_table_position position;
+    struct sw_flow_key key;
+
+    memset(&key, 0, sizeof key);
+    key.wildcards = OFPFW_ALL;
+    memset(&position, 0, sizeof position);
+    return table->iterate(table, &key, OFPP_NONE, &position, save_flow, ctx);
+}
+
+/* Writes every flow in 'dp''s chain, including its emergency flows, to
+ * 'stream', which must be seekable, as a snapshot starting at the beginning of
+ * 'stream'.  Stores the number of flows written in '*n_flowsp'.  Returns 0 if
+ * successful, otherwise a positive errno value. */
+int
+snapshot_write(struct datapath *dp, FILE *stream, uint32_t *n_flowsp)
+{
+    struct snapshot_save_context ctx;
+    struct snapshot_header hdr;
+    int error;
+    int i;
+
+    ctx.stream = stream;
+    ctx.now = time_msec();
+    ctx.n_flows = 0;
+
+    /* Write the header last, once the number of flows is known. */
+    error = fseek(stream, sizeof hdr, SEEK_SET) ? errno : 0;
+    for (i = 0; !error && i < dp->chain->n_tables; i++) {
+        error = save_table(dp->chain->tables[i], &ctx);
+    }
+    if (!error) {
+        error = save_table(dp->chain->emerg_table, &ctx);
+    }
+    if (!error) {
+        memset(&hdr, 0, sizeof hdr);
+        hdr.magic = SNAPSHOT_MAGIC;
+        hdr.version = SNAPSHOT_VERSION;
+        hdr.n_flows = ctx.n_flows;
+        if (fseek(stream, 0, SEEK_SET)
+            || fwrite(&hdr, sizeof hdr, 1, stream) != 1
+            || fflush(stream)) {
+            error = errno ? errno : EIO;
+        }
+    }
+    *n_flowsp = ctx.n_flows;
+    return error;
+}
+
+/* Writes every flow in 'dp''s chain, including its emergency flows, to a
+ * snapshot named 'file_name'.  The snapshot is written to a temporary file
+ * that then replaces 'file_name', so that a crash while saving leaves the
+ * previous snapshot intact.  Returns 0 if successful, otherwise a positive
+ * errno value. */
+int
+snapshot_save(struct datapath *dp, const char *file_name)
+{
+    long long int start = time_usec();
+    uint32_t n_flows;
+    char *tmp_name;
+    FILE *stream;
+    int error;
+
+    tmp_name = xasprintf("%s.tmp", file_name);
+    stream = fopen(tmp_name, "wb");
+    if (!stream) {
+        error = errno;
+        VLOG_WARN("%s: create failed (%s)", tmp_name, strerror(error));
+        free(tmp_name);
+        return error;
+    }
+
+    error = snapshot_write(dp, stream, &n_flows);
+    if (!error && fsync(fileno(stream))) {
+        error = errno;
+    }
+    if (fclose(stream) && !error) {
+        error = errno;
+    }
+    if (!error && rename(tmp_name, file_name)) {
+        error = errno;
+    }
+
+    if (error) {
+        VLOG_WARN("%s: saving snapshot failed (%s)",
+                  file_name, strerror(error));
+        unlink(tmp_name);
+    } else {
+        VLOG_INFO("saved %"PRIu32" flows to %s in %lld ms",
+                  n_flows, file_name, (time_usec() - start) / 1000);
+    }
+    free(tmp_name);
+    return error;
+}
+
+/* Inserts the flow described by 'sf', with actions 'actions', into 'dp''s
+ * chain.  Unless 'stale_secs' is negative, the flow is marked stale, to be
+ * removed 'stale_secs' seconds from now unless the controller modifies or
+ * replaces it first. */
+static int
+restore_flow(struct datapath *dp, const struct snapshot_flow *sf,
+             const struct ofp_action_header *actions, uint64_t now,
+             int stale_secs)
+{
+    struct sw_flow *flow;
+    int error;
+
+    flow = flow_alloc(sf->actions_len);
+    if (!flow) {
+        return ENOMEM;
+    }
+    flow_extract_match(&flow->key, &sf->match);
+    flow->priority = sf->priority;
+    flow->cookie = sf->cookie;
+    flow->idle_timeout = sf->idle_timeout;
+    flow->hard_timeout = sf->hard_timeout;
+    flow->send_flow_rem = sf->send_flow_rem;
+    flow->emerg_flow = sf->emerg_flow;
+    flow_setup_actions(flow, actions, sf->actions_len);
+    flow->created = now - MIN(sf->created_age, now);
+    flow->used = now - MIN(sf->used_age, now);
+    flow->packet_count = sf->packet_count;
+    flow->byte_count = sf->byte_count;
+    if (stale_secs >= 0) {
+        flow->stale_until = now + stale_secs * 1000ULL;
+    }
+
+    error = chain_insert(dp->chain, flow, flow->emerg_flow);
+    if (error) {
+        flow_free(flow);
+        return -error;
+    }
+    return 0;
+}
+
+/* Loads the flows in the snapshot in 'fd', which is named 'file_name' for use
+ * in log messages, into 'dp''s chain, which should be empty.  Unless
+ * 'stale_secs' is negative, the restored flows are marked stale: each one is
+ * removed 'stale_secs' seconds later unless the controller has replaced it
+ * with an identical flow or modified it by then.  Does not close 'fd'.
+ *
+ * Returns 0 if successful, otherwise a positive errno value.  A snapshot that
+ * is truncated is restored only up to the last complete record.  A record
+ * whose actions do not pass validate_actions() for 'dp', for example one
+ * written by a version of ofdatapath that accepted different actions, is
+ * logged and skipped. */
+int
+snapshot_read(struct datapath *dp, int fd, const char *file_name,
+              int stale_secs)
+{
+    const struct snapshot_header *hdr;
+    long long int start = time_usec();
+    uint64_t now = time_msec();
+    unsigned int n_restored, n_failed;
+    const uint8_t *p, *end;
+    struct stat s;
+    void *base;
+    uint32_t i;
+
+    if (fstat(fd, &s) < 0) {
+        int error = errno;
+        VLOG_WARN("%s: stat failed (%s)", file_name, strerror(error));
+        return error;
+    }
+    if (s.st_size < (off_t) sizeof *hdr) {
+        VLOG_WARN("%s: snapshot is truncated", file_name);
+        return EINVAL;
+    }
+    base = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        int error = errno;
+        VLOG_WARN("%s: mmap failed (%s)", file_name, strerror(error));
+        return error;
+    }
+    madvise(base, s.st_size, MADV_SEQUENTIAL);
+
+    hdr = base;
+    if (hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION) {
+        VLOG_WARN("%s: not a version %d snapshot", file_name,
+                  SNAPSHOT_VERSION);
+        munmap(base, s.st_size);
+        return EINVAL;
+    }
+
+    n_restored = n_failed = 0;
+    p = (const uint8_t *) (hdr + 1);
+    end = (const uint8_t *) base + s.st_size;
+    for (i = 0; i < hdr->n_flows; i++) {
+        const struct snapshot_flow *sf = (const struct snapshot_flow *) p;
+        const struct ofp_action_header *actions;
+        struct sw_flow_key key;
+        uint16_t v_code;
+        size_t len;
+
+        if (end - p < sizeof *sf
+            || end - p < sizeof *sf + ROUND_UP(sf->actions_len, 8)) {
+            VLOG_WARN("%s: snapshot is truncated after %"PRIu32" flows",
+                      file_name, i);
+            break;
+        }
+        len = sizeof *sf + ROUND_UP(sf->actions_len, 8);
+        actions = (const struct ofp_action_header *) (sf + 1);
+        flow_extract_match(&key, &sf->match);
+        v_code = validate_actions(dp, &key, actions, sf->actions_len);
+        if (v_code != ACT_VALIDATION_OK) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+            VLOG_WARN_RL(&rl, "%s: skipping flow %"PRIu32" with invalid "
+                         "actions (error code %"PRIu16")",
+                         file_name, i, v_code);
+            n_failed++;
+        } else if (!restore_flow(dp, sf, actions, now, stale_secs)) {
+            n_restored++;
+        } else {
+            n_failed++;
+        }
+        p += len;
+    }
+    munmap(base, s.st_size);
+
+    if (n_failed) {
+        VLOG_WARN("%s: %u flows could not be restored", file_name, n_failed);
+    }
+    VLOG_INFO("restored %u flows from %s in %lld ms",
+              n_restored, file_name, (time_usec() - start) / 1000);
+    return 0;
+}
+
+/* Loads the flows in the snapshot named 'file_name' into 'dp''s chain, which
+ * should be empty, marking them stale as described for snapshot_read().
+ *
+ * Returns 0 if successful, ENOENT if there is no snapshot, otherwise a
+ * positive errno value. */
+int
+snapshot_restore(struct datapath *dp, const char *file_name, int stale_secs)
+{
+    int error;
+    int fd;
+
+    fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            VLOG_WARN("%s: open failed (%s)", file_name, strerror(errno));
+        }
+        return errno;
+    }
+    error = snapshot_read(dp, fd, file_name, stale_secs);
+    close(fd);
+    return error;
+}
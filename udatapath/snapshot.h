@@ -0,0 +1,56 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* Flow table snapshots, for warm restarts of ofdatapath.
+ *
+ * A snapshot is a file that holds every flow in a datapath's chain, so that
+ * a restarted ofdatapath can resume forwarding with its old flow table
+ * before the controller reconnects and pushes the table again. */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct datapath;
+
+int snapshot_save(struct datapath *, const char *file_name);
+int snapshot_restore(struct datapath *, const char *file_name,
+                     int stale_secs);
+
+int snapshot_write(struct datapath *, FILE *, uint32_t *n_flowsp);
+int snapshot_read(struct datapath *, int fd, const char *file_name,
+                  int stale_secs);
+
+#endif /* snapshot.h */
@@ -0,0 +1,320 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+
+#include <config.h>
+#include "standalone.h"
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chain.h"
+#include "datapath.h"
+#include "dp_act.h"
+#include "flow.h"
+#include "mac-learning.h"
+#include "ofpbuf.h"
+#include "openflow/openflow-ext.h"
+#include "packets.h"
+#include "switch-flow.h"
+#include "table.h"
+#include "util.h"
+
+#define THIS_MODULE VLM_standalone
+#include "vlog.h"
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+struct standalone {
+    struct datapath *dp;
+    struct mac_learning *ml;    /* Null while inactive. */
+    uint16_t max_idle;          /* Idle timeout for learned flows. */
+
+    /* Hosts seen to move since the last standalone_flush(), whose learned
+     * flows are now stale. */
+    uint8_t (*moved)[ETH_ADDR_LEN];
+    size_t n_moved, allocated_moved;
+
+    /* Statistics for the current period of activity. */
+    unsigned long long int n_flows;     /* Flows added. */
+    unsigned long long int n_flooded;   /* Packets flooded without a flow. */
+    unsigned long long int n_dropped;   /* Packets dropped. */
+};
+
+static void delete_learned_flows(struct standalone *,
+                                 const uint8_t dl_dst[ETH_ADDR_LEN]);
+
+struct standalone *
+standalone_create(struct datapath *dp)
+{
+    struct standalone *sa = xcalloc(1, sizeof *sa);
+    sa->dp = dp;
+    return sa;
+}
+
+void
+standalone_destroy(struct standalone *sa)
+{
+    if (sa) {
+        mac_learning_destroy(sa->ml);
+        free(sa->moved);
+        free(sa);
+    }
+}
+
+/* Starts or stops 'sa' handling table misses, according to 'active'.  Flows
+ * added while active expire after 'max_idle' seconds idle.
+ *
+ * Stopping deletes every flow that 'sa' added before returning, so that the
+ * very next miss goes to the controller against a flow table that holds only
+ * the controller's own flows. */
+void
+standalone_set_active(struct standalone *sa, bool active, uint16_t max_idle)
+{
+    sa->max_idle = max_idle;
+    if (active == (sa->ml != NULL)) {
+        return;
+    }
+
+    if (active) {
+        VLOG_WARN("learning MAC addresses in the datapath");
+        sa->ml = mac_learning_create();
+        sa->n_flows = sa->n_flooded = sa->n_dropped = 0;
+    } else {
+        mac_learning_destroy(sa->ml);
+        sa->ml = NULL;
+        sa->n_moved = 0;
+        delete_learned_flows(sa, NULL);
+        VLOG_WARN("no longer learning MAC addresses in the datapath "
+                  "(added %llu flows, flooded %llu packets, dropped %llu)",
+                  sa->n_flows, sa->n_flooded, sa->n_dropped);
+    }
+}
+
+/* Adds to 'sa''s datapath an exact-match flow for 'key' with the 'actions_len'
+ * bytes of actions in 'actions', and counts 'buffer' against it. */
+static void
+add_flow(struct standalone *sa, const struct sw_flow_key *key,
+         const struct ofp_action_header *actions, size_t actions_len,
+         struct ofpbuf *buffer)
+{
+    struct ofp_match match;
+    struct sw_flow *flow;
+
+    flow = flow_alloc(actions_len);
+    if (!flow) {
+        return;
+    }
+    flow_fill_match(&match, &key->flow, 0);
+    flow_extract_match(&flow->key, &match);
+    flow->priority = -1;
+    flow->cookie = OFP_EXT_FAIL_OPEN_COOKIE;
+    flow->idle_timeout = sa->max_idle;
+    flow->hard_timeout = OFP_FLOW_PERMANENT;
+    flow_setup_actions(flow, actions, actions_len);
+
+    if (chain_insert(sa->dp->chain, flow, 0)) {
+        VLOG_WARN_RL(&rl, "flow table full, forwarding without a flow");
+        flow_free(flow);
+        return;
+    }
+    flow_used(flow, buffer);
+    sa->n_flows++;
+}
+
+/* Handles 'buffer', which was received on 'p' and missed the flow table, and
+ * whose flow key is 'key', the way secchan's learning switch would, but
+ * without leaving the datapath.  Returns true if it took ownership of
+ * 'buffer', false if 'sa' is inactive or the packet should instead be sent to
+ * the controller as usual.
+ *
+ * This never removes flows from the flow table, because the caller may still
+ * hold flows that it looked up for other packets.  Flows made stale by a host
+ * moving are removed by the next standalone_flush(). */
+bool
+standalone_packet_in(struct standalone *sa, struct ofpbuf *buffer,
+                     const struct sw_flow_key *key, struct sw_port *p)
+{
+    struct sw_flow_key pkt_key = *key;
+    const uint8_t *dl_src = key->flow.dl_src;
+    const uint8_t *dl_dst = key->flow.dl_dst;
+    struct ofp_action_output oao;
+    uint16_t in_port, out_port;
+
+    /* Link-local control frames belong to secchan, e.g. its STP. */
+    if (!sa->ml || !p || eth_addr_is_reserved(dl_dst)) {
+        return false;
+    }
+    in_port = p->port_no;
+
+    if (!eth_addr_is_multicast(dl_src)) {
+        uint16_t old_port = mac_learning_lookup(sa->ml, dl_src, 0);
+        if (mac_learning_learn(sa->ml, dl_src, 0, in_port)
+            && old_port != OFPP_FLOOD && old_port != in_port) {
+            /* The host moved, so the flows that send to it are stale. */
+            VLOG_DBG_RL(&rl, ETH_ADDR_FMT" moved from port %"PRIu16
+                        " to port %"PRIu16, ETH_ADDR_ARGS(dl_src),
+                        old_port, in_port);
+            if (sa->n_moved >= sa->allocated_moved) {
+                sa->allocated_moved = MAX(8, sa->allocated_moved * 2);
+                sa->moved = xrealloc(sa->moved, (sa->allocated_moved
+                                                 * sizeof *sa->moved));
+            }
+            memcpy(sa->moved[sa->n_moved++], dl_src, ETH_ADDR_LEN);
+        }
+    }
+
+    out_port = (eth_addr_is_reserved(dl_src) ? in_port
+                : mac_learning_lookup(sa->ml, dl_dst, 0));
+    if (out_port == in_port) {
+        /* Don't send out packets on their input ports, or at all if they
+         * claim to come from a reserved address. */
+        add_flow(sa, &pkt_key, NULL, 0, buffer);
+        sa->n_dropped++;
+        ofpbuf_delete(buffer);
+        return true;
+    }
+
+    memset(&oao, 0, sizeof oao);
+    oao.type = htons(OFPAT_OUTPUT);
+    oao.len = htons(sizeof oao);
+    oao.port = htons(out_port);
+    if (out_port != OFPP_FLOOD) {
+        add_flow(sa, &pkt_key, (const struct ofp_action_header *) &oao,
+                 sizeof oao, buffer);
+    } else {
+        /* We don't know that MAC yet, so flood without setting up a flow. */
+        sa->n_flooded++;
+    }
+    execute_actions(sa->dp, buffer, &pkt_key,
+                    (const struct ofp_action_header *) &oao, sizeof oao,
+                    NULL, false);
+    return true;
+}
+
+/* Deletes the flows that send to hosts that standalone_packet_in() has seen
+ * move since the last call.  The datapath calls this after each batch of
+ * packets, once it no longer refers to the flows it looked up for them. */
+void
+standalone_flush(struct standalone *sa)
+{
+    size_t i;
+
+    for (i = 0; i < sa->n_moved; i++) {
+        delete_learned_flows(sa, sa->moved[i]);
+    }
+    sa->n_moved = 0;
+}
+
+void
+standalone_run(struct standalone *sa)
+{
+    if (sa->ml) {
+        mac_learning_run(sa->ml, NULL);
+    }
+}
+
+void
+standalone_wait(struct standalone *sa)
+{
+    if (sa->ml) {
+        mac_learning_wait(sa->ml);
+    }
+}
+
+/* Flow keys collected by delete_learned_flows(). */
+struct learned_flows {
+    struct sw_flow_key *keys;
+    size_t n, allocated;
+};
+
+static int
+collect_learned_flow(struct sw_flow *flow, void *lf_)
+{
+    struct learned_flows *lf = lf_;
+
+    if (flow->cookie == OFP_EXT_FAIL_OPEN_COOKIE) {
+        if (lf->n >= lf->allocated) {
+            lf->allocated = lf->allocated ? lf->allocated * 2 : 64;
+            lf->keys = xrealloc(lf->keys, lf->allocated * sizeof *lf->keys);
+        }
+        lf->keys[lf->n++] = flow->key;
+    }
+    return 0;
+}
+
+/* Deletes the flows that 'sa' added to send to 'dl_dst', or all of the flows
+ * that it added if 'dl_dst' is null.  Other flows, such as the controller's,
+ * are left alone. */
+static void
+delete_learned_flows(struct standalone *sa,
+                     const uint8_t dl_dst[ETH_ADDR_LEN])
+{
+    struct sw_chain *chain = sa->dp->chain;
+    struct learned_flows lf;
+    struct sw_flow_key match_key;
+    struct ofp_match match;
+    size_t i;
+    int n_deleted;
+
+    memset(&match, 0, sizeof match);
+    match.wildcards = htonl(OFPFW_ALL);
+    if (dl_dst) {
+        match.wildcards = htonl(OFPFW_ALL & ~OFPFW_DL_DST);
+        memcpy(match.dl_dst, dl_dst, ETH_ADDR_LEN);
+    }
+    flow_extract_match(&match_key, &match);
+
+    /* Deleting a flow in the middle of iteration would upset the table, so
+     * gather the keys first. */
+    memset(&lf, 0, sizeof lf);
+    for (i = 0; i < chain->n_tables; i++) {
+        struct sw_table *table = chain->tables[i];
+        struct sw_table_position position;
+
+        memset(&position, 0, sizeof position);
+        table->iterate(table, &match_key, htons(OFPP_NONE), &position,
+                       collect_learned_flow, &lf);
+    }
+
+    n_deleted = 0;
+    for (i = 0; i < lf.n; i++) {
+        n_deleted += chain_delete(chain, &lf.keys[i], htons(OFPP_NONE),
+                                  -1, 1, 0);
+    }
+    free(lf.keys);
+
+    if (n_deleted) {
+        VLOG_DBG("deleted %d learned flows", n_deleted);
+    }
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+
+/* Standalone MAC learning inside ofdatapath.
+ *
+ * While secchan fails open, it may ask the datapath to handle table misses
+ * itself, as a learning switch, rather than having every miss make a round
+ * trip through secchan's learning switch.  The learned flows go straight into
+ * the flow table and are removed again when the controller comes back. */
+
+#ifndef STANDALONE_H
+#define STANDALONE_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct datapath;
+struct ofpbuf;
+struct sw_flow_key;
+struct sw_port;
+
+struct standalone *standalone_create(struct datapath *);
+void standalone_destroy(struct standalone *);
+
+void standalone_set_active(struct standalone *, bool active,
+                           uint16_t max_idle);
+
+bool standalone_packet_in(struct standalone *, struct ofpbuf *,
+                          const struct sw_flow_key *, struct sw_port *);
+void standalone_flush(struct standalone *);
+
+void standalone_run(struct standalone *);
+void standalone_wait(struct standalone *);
+
+#endif /* standalone.h */
@@ -40,8 +40,10 @@
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
 #include "openflow/nicira-ext.h"
+#include "openflow/openflow-ext.h"
 #include "packets.h"
 #include "timeval.h"
+#include "util.h"
 
 #define THIS_MODULE VLM_chain
 #include "vlog.h"
@@ -123,64 +125,9 @@ flow_matches_2desc(const struct sw_flow_key *t, const struct sw_flow_key *d,
 void
 flow_extract_match(struct sw_flow_key* to, const struct ofp_match* from)
 {
-    to->wildcards = ntohl(from->wildcards) & OFPFW_ALL;
-    to->flow.dl_vlan_pcp = from->dl_vlan_pcp;
-    to->flow.in_port = from->in_port;
-    to->flow.dl_vlan = from->dl_vlan;
-    memcpy(to->flow.dl_src, from->dl_src, ETH_ADDR_LEN);
-    memcpy(to->flow.dl_dst, from->dl_dst, ETH_ADDR_LEN);
-    to->flow.dl_type = from->dl_type;
-
-    to->flow.nw_tos = to->flow.nw_proto = to->flow.nw_src = to->flow.nw_dst = 0;
-    to->flow.tp_src = to->flow.tp_dst = 0;
-    memset(to->flow.pad, 0, sizeof(to->flow.pad));
-
-#define OFPFW_TP (OFPFW_TP_SRC | OFPFW_TP_DST)
-#define OFPFW_NW (OFPFW_NW_TOS | OFPFW_NW_PROTO | OFPFW_NW_SRC_MASK | OFPFW_NW_DST_MASK)
-    if (to->wildcards & OFPFW_DL_TYPE) {
-        /* Can't sensibly match on network or transport headers if the
-         * data link type is unknown. */
-        to->wildcards |= OFPFW_NW | OFPFW_TP;
-    } else if (from->dl_type == htons(ETH_TYPE_IP)) {
-        to->flow.nw_tos   = from->nw_tos & 0xfc;
-        to->flow.nw_proto = from->nw_proto;
-        to->flow.nw_src   = from->nw_src;
-        to->flow.nw_dst   = from->nw_dst;
-
-        if (to->wildcards & OFPFW_NW_PROTO) {
-            /* Can't sensibly match on transport headers if the network
-             * protocol is unknown. */
-            to->wildcards |= OFPFW_TP;
-        } else if (from->nw_proto == IPPROTO_TCP 
-                || from->nw_proto == IPPROTO_UDP
-                || from->nw_proto == IPPROTO_ICMP) {
-            to->flow.tp_src = from->tp_src;
-            to->flow.tp_dst = from->tp_dst;
-        } else {
-            /* Transport layer fields are undefined.  Mark them as
-             * exact-match to allow such flows to reside in table-hash,
-             * instead of falling into table-linear. */
-            to->wildcards &= ~OFPFW_TP;
-        }
-    } else if (from->dl_type == htons(ETH_TYPE_ARP)) {
-        to->flow.nw_src   = from->nw_src;
-        to->flow.nw_dst   = from->nw_dst;
-        to->flow.nw_proto = from->nw_proto;
-
-        /* Transport layer fields are undefined.  Mark them as
-         * exact-match to allow such flows to reside in table-hash,
-         * instead of falling into table-linear. */
-        to->wildcards &= ~OFPFW_TP;
-    } else {
-        /* Network and transport layer fields are undefined.  Mark them
-         * as exact-match to allow such flows to reside in table-hash,
-         * instead of falling into table-linear. */
-        to->wildcards &= ~(OFPFW_NW | OFPFW_TP);
-    }
-
-	/* We set these late because code above adjusts to->wildcards. */
-	to->nw_src_mask = make_nw_mask(to->wildcards >> OFPFW_NW_SRC_SHIFT);
-	to->nw_dst_mask = make_nw_mask(to->wildcards >> OFPFW_NW_DST_SHIFT);
+    flow_from_match(&to->flow, &to->wildcards, from);
+    to->nw_src_mask = make_nw_mask(to->wildcards >> OFPFW_NW_SRC_SHIFT);
+    to->nw_dst_mask = make_nw_mask(to->wildcards >> OFPFW_NW_DST_SHIFT);
 }
 
 /* Allocates and returns a new flow with room for 'actions_len' actions. 
@@ -204,6 +151,62 @@ flow_alloc(size_t actions_len)
     return flow;
 }
 
+/* Returns 'ah' as an OFP_EXT_ACTION_POLICE action, or a null pointer if it is
+ * some other kind of action. */
+static const struct openflow_ext_action_police *
+police_action(const struct ofp_action_header *ah)
+{
+    const struct openflow_ext_action_police *ap = (const void *) ah;
+
+    return (ap->type == htons(OFPAT_VENDOR)
+            && ap->len == htons(sizeof *ap)
+            && ap->vendor == htonl(OPENFLOW_VENDOR_ID)
+            && ap->subtype == htons(OFP_EXT_ACTION_POLICE)
+            ? ap : NULL);
+}
+
+/* Gives each OFP_EXT_ACTION_POLICE action in 'sfa''s actions, which must
+ * already be validated, a token bucket that starts out full. */
+static void
+setup_meters(struct sw_flow_actions *sfa)
+{
+    const uint8_t *start = (const uint8_t *) sfa->actions;
+    const uint8_t *end = start + sfa->actions_len;
+    uint64_t now = time_msec();
+    const struct ofp_action_header *ah;
+    const uint8_t *p;
+    size_t n;
+
+    sfa->meters = NULL;
+    sfa->n_meters = 0;
+
+    n = 0;
+    for (p = start; p < end; p += ntohs(ah->len)) {
+        ah = (const struct ofp_action_header *) p;
+        n += police_action(ah) != NULL;
+    }
+    if (!n) {
+        return;
+    }
+
+    sfa->meters = xcalloc(n, sizeof *sfa->meters);
+    for (p = start; p < end; p += ntohs(ah->len)) {
+        const struct openflow_ext_action_police *ap;
+
+        ah = (const struct ofp_action_header *) p;
+        ap = police_action(ah);
+        if (ap) {
+            struct sw_meter *m = &sfa->meters[sfa->n_meters++];
+            m->rate = ntohl(ap->rate);
+            m->burst = ntohl(ap->burst) * 1000ULL;
+            m->tokens = m->burst;
+            m->last_fill = now;
+            m->policy = ap->policy;
+            m->dscp = ap->dscp;
+        }
+    }
+}
+
 /* Setup the action on the flow, just after it was created with flow_alloc().
  * Jean II */
 void
@@ -222,6 +225,7 @@ flow_setup_actions(struct sw_flow *                    flow,
 	flow->byte_count = 0;
 	flow->packet_count = 0;
 	memcpy(flow->sf_acts->actions, actions, actions_len);
+	setup_meters(flow->sf_acts);
 }
 
 /* Frees 'flow' immediately. */
@@ -231,10 +235,21 @@ flow_free(struct sw_flow *flow)
     if (!flow) {
         return; 
     }
+    free(flow->sf_acts->meters);
     free(flow->sf_acts);
     free(flow);
 }
 
+/* Returns the number of bytes of memory allocated for 'flow' and its
+ * actions. */
+size_t
+flow_memory_size(const struct sw_flow *flow)
+{
+    const struct sw_flow_actions *sfa = flow->sf_acts;
+    return (sizeof *flow + sizeof *sfa + sfa->actions_len
+            + sfa->n_meters * sizeof *sfa->meters);
+}
+
 /* Copies 'actions' into a newly allocated structure for use by 'flow'
  * and frees the structure that defined the previous actions. */
 void flow_replace_acts(struct sw_flow *flow, 
@@ -249,9 +264,12 @@ void flow_replace_acts(struct sw_flow *flow,
 
     sfa->actions_len = actions_len;
     memcpy(sfa->actions, actions, actions_len);
+    setup_meters(sfa);
 
+    free(flow->sf_acts->meters);
     free(flow->sf_acts);
     flow->sf_acts = sfa;
+    flow->stale_until = 0;
 
     return;
 }
@@ -291,7 +309,10 @@ print_flow(const struct sw_flow_key *key)
 bool flow_timeout(struct sw_flow *flow)
 {
     uint64_t now = time_msec();
-    if (flow->idle_timeout != OFP_FLOW_PERMANENT
+    if (flow->stale_until && now > flow->stale_until) {
+        flow->reason = OFPRR_DELETE;
+        return true;
+    } else if (flow->idle_timeout != OFP_FLOW_PERMANENT
             && now > flow->used + flow->idle_timeout * 1000) {
         flow->reason = OFPRR_IDLE_TIMEOUT;
         return true;
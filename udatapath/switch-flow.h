@@ -49,8 +49,22 @@ struct sw_flow_key {
     uint32_t nw_dst_mask;       /* 1-bit in each significant nw_dst bit. */
 };
 
+/* Token bucket for one OFP_EXT_ACTION_POLICE action in a flow's actions. */
+struct sw_meter {
+    uint64_t rate;              /* Fill rate, in bits per millisecond. */
+    uint64_t burst;             /* Bucket size, in bits. */
+    uint64_t tokens;            /* Bits that may pass now. */
+    uint64_t last_fill;         /* time_msec() when 'tokens' was refilled. */
+    uint8_t policy;             /* One of OFP_EXT_POLICE_*. */
+    uint8_t dscp;               /* DSCP for OFP_EXT_POLICE_REMARK. */
+    uint64_t conform_packets, conform_bytes;
+    uint64_t exceed_packets, exceed_bytes;
+};
+
 struct sw_flow_actions {
     size_t actions_len;
+    struct sw_meter *meters;    /* One per police action, or NULL if none. */
+    size_t n_meters;
     struct ofp_action_header actions[0];
 };
 
@@ -68,6 +82,9 @@ struct sw_flow {
     uint8_t reason;             /* Reason flow removed (one of OFPRR_*). */
     uint8_t send_flow_rem;      /* Send a flow removed to the controller */
     uint8_t emerg_flow;         /* Emergency flow indicator */
+    uint64_t stale_until;       /* If nonzero, restored from a snapshot and
+                                 * removed at this time unless replaced or
+                                 * modified by the controller first. */
 
     struct sw_flow_actions *sf_acts;
 
@@ -89,6 +106,7 @@ int flow_has_out_port(struct sw_flow *flow, uint16_t out_port);
 struct sw_flow *flow_alloc(size_t);
 void flow_setup_actions(struct sw_flow *, const struct ofp_action_header *, int);
 void flow_free(struct sw_flow *);
+size_t flow_memory_size(const struct sw_flow *);
 void flow_replace_acts(struct sw_flow *, const struct ofp_action_header *, 
         size_t);
 void flow_extract_match(struct sw_flow_key* to, const struct ofp_match* from);
@@ -0,0 +1,705 @@
+/* Copyright (c) 2009 The Board of Trustees of The Leland Stanford
+ * Junior University
+ *
+ * We are making the OpenFlow specification and associated documentation
+ * (Software) available for public use and benefit with the expectation
+ * that others will use, modify and enhance the Software and contribute
+ * those enhancements back to the community. However, since we would
+ * like to make the Software available for broadest use, with as few
+ * restrictions as possible permission is hereby granted, free of
+ * charge, to any person obtaining a copy of this Software to deal in
+ * the Software under the copyrights without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The name and trademarks of copyright holder(s) may NOT be used in
+ * advertising or publicity pertaining to the Software or any
+ * derivatives without specific, written prior permission.
+ */
+
+/* A table of wildcarded flows that compiles them into a decision tree, in the
+ * style of HyperSplit: each interior node splits one dimension (input port,
+ * Ethernet type, IP protocol, IP source or destination, or transport source
+ * or destination port) at a threshold chosen to divide its flows as evenly as
+ * possible, and each leaf holds a handful of candidate flows in priority
+ * order.  A flow whose range spans a threshold appears on both sides.
+ *
+ * The tree only narrows the search: a lookup still checks the candidates in
+ * its leaf with flow_matches_1wild(), so it gives the same answer as
+ * table-linear for every flow, including those that match on fields that the
+ * tree does not split on.
+ *
+ * Building the tree costs much more than adding a flow, so flows added since
+ * the tree was built wait on a short "pending" list, which lookups search
+ * after the tree, and deleted flows are just cleared out of the tree.  The
+ * tree is rebuilt during the table's once-per-second timeout processing, or
+ * sooner if the pending list grows long, so that bursts of flow table changes
+ * do not rebuild it over and over.  Until then, lookups use the previous
+ * tree. */
+
+#include <config.h>
+#include "table.h"
+#include <arpa/inet.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flow.h"
+#include "list.h"
+#include "openflow/openflow.h"
+#include "openflow/nicira-ext.h"
+#include "switch-flow.h"
+#include "datapath.h"
+#include "timeval.h"
+#include "util.h"
+
+#define THIS_MODULE VLM_chain
+#include "vlog.h"
+
+/* Dimensions that the tree may split. */
+enum dtree_dim {
+    DT_IN_PORT,
+    DT_DL_TYPE,
+    DT_NW_PROTO,
+    DT_NW_SRC,
+    DT_NW_DST,
+    DT_TP_SRC,
+    DT_TP_DST,
+    DT_N_DIMS
+};
+
+/* Leaves hold at most this many flows, unless no split helps. */
+#define DTREE_LEAF_FLOWS 8
+
+/* The tree is never deeper than this. */
+#define DTREE_MAX_DEPTH 32
+
+/* Splitting stops once the leaves hold, in total, this many times as many
+ * flows as the tree. */
+#define DTREE_MAX_COPIES 8
+
+/* Number of thresholds per dimension considered for each split. */
+#define DTREE_SPLIT_CANDIDATES 32
+
+/* The tree is rebuilt right away once more than this many flows, or a quarter
+ * of the flows in the tree if that is more, are pending. */
+#define DTREE_MAX_PENDING 64
+
+/* A flow as the tree sees it: the range of values it accepts in each
+ * dimension. */
+struct dtree_rule {
+    struct sw_flow *flow;       /* Null if deleted since the tree was built. */
+    uint32_t lo[DT_N_DIMS];
+    uint32_t hi[DT_N_DIMS];
+};
+
+struct dtree_node {
+    int dim;                    /* Dimension split, or DT_N_DIMS in a leaf. */
+    uint32_t threshold;         /* Values <= threshold go to children[0]. */
+    struct dtree_node *children[2];
+    unsigned int *rules;        /* In a leaf, indexes into 'rules'. */
+    unsigned int n_rules;
+};
+
+struct sw_table_dtree {
+    struct sw_table swt;
+
+    unsigned int max_flows;
+    unsigned int n_flows;
+    struct list flows;          /* All flows, in priority order. */
+    struct list iter_flows;
+    unsigned long int next_serial;
+    size_t flow_bytes;          /* flow_memory_size() summed over flows. */
+
+    /* The tree, built from the flows in 'flows' at some point in the past.
+     * Each flow in the tree points to its rule through its 'private'
+     * member. */
+    struct dtree_node *root;    /* Null if no tree has been built. */
+    struct dtree_rule *rules;   /* In priority order. */
+    unsigned int n_rules;
+    unsigned int n_dead;        /* Rules whose flows were deleted. */
+    size_t tree_bytes;          /* node_memory_size() of 'root'. */
+
+    /* Flows added since the tree was built, in priority order.  Their
+     * 'private' members are null. */
+    struct sw_flow **pending;
+    unsigned int n_pending, allocated_pending;
+
+    unsigned long int n_builds; /* Number of times the tree was built. */
+
+    /* Lookups by number of flows examined, by table_hist_bin(). */
+    unsigned long int depth_hist[TABLE_HIST_BINS];
+};
+
+static void
+flow_to_values(const struct flow *flow, uint32_t values[DT_N_DIMS])
+{
+    values[DT_IN_PORT] = ntohs(flow->in_port);
+    values[DT_DL_TYPE] = ntohs(flow->dl_type);
+    values[DT_NW_PROTO] = flow->nw_proto;
+    values[DT_NW_SRC] = ntohl(flow->nw_src);
+    values[DT_NW_DST] = ntohl(flow->nw_dst);
+    values[DT_TP_SRC] = ntohs(flow->tp_src);
+    values[DT_TP_DST] = ntohs(flow->tp_dst);
+}
+
+/* Sets 'rule' to the ranges of values accepted by 'flow'. */
+static void
+rule_init(struct dtree_rule *rule, struct sw_flow *flow)
+{
+    static const uint32_t wildcard_bits[DT_N_DIMS] = {
+        OFPFW_IN_PORT, OFPFW_DL_TYPE, OFPFW_NW_PROTO, 0, 0,
+        OFPFW_TP_SRC, OFPFW_TP_DST
+    };
+    static const uint32_t max_values[DT_N_DIMS] = {
+        UINT16_MAX, UINT16_MAX, UINT8_MAX, UINT32_MAX, UINT32_MAX,
+        UINT16_MAX, UINT16_MAX
+    };
+    const struct sw_flow_key *key = &flow->key;
+    uint32_t src_mask = ntohl(key->nw_src_mask);
+    uint32_t dst_mask = ntohl(key->nw_dst_mask);
+    int d;
+
+    rule->flow = flow;
+    flow_to_values(&key->flow, rule->lo);
+    for (d = 0; d < DT_N_DIMS; d++) {
+        if (key->wildcards & wildcard_bits[d]) {
+            rule->lo[d] = 0;
+            rule->hi[d] = max_values[d];
+        } else {
+            rule->hi[d] = rule->lo[d];
+        }
+    }
+    rule->lo[DT_NW_SRC] &= src_mask;
+    rule->hi[DT_NW_SRC] = rule->lo[DT_NW_SRC] | ~src_mask;
+    rule->lo[DT_NW_DST] &= dst_mask;
+    rule->hi[DT_NW_DST] = rule->lo[DT_NW_DST] | ~dst_mask;
+}
+
+static int
+compare_uint32(const void *a_, const void *b_)
+{
+    uint32_t a = *(const uint32_t *) a_;
+    uint32_t b = *(const uint32_t *) b_;
+    return a < b ? -1 : a > b;
+}
+
+/* Finds the best threshold in dimension 'd' for splitting the 'n' rules in
+ * 'idx' within the region bounded by 'lo' and 'hi'.  The cost of a split is
+ * the number of rules in the bigger half.  Splits that would copy more than
+ * a quarter of the rules into both halves are not considered, because wide
+ * rules would otherwise be copied into most of the leaves.  Returns the cost
+ * and stores the threshold in '*thresholdp', or returns UINT_MAX if 'd'
+ * cannot be split. */
+static unsigned int
+choose_threshold(const struct sw_table_dtree *td, const unsigned int *idx,
+                 unsigned int n, int d, const uint32_t lo[DT_N_DIMS],
+                 const uint32_t hi[DT_N_DIMS], uint32_t *thresholdp)
+{
+    unsigned int best_cost = UINT_MAX;
+    uint32_t *points;
+    unsigned int n_points, i, step;
+
+    /* Every rule boundary inside the region is a possible threshold. */
+    points = xmalloc(2 * n * sizeof *points);
+    n_points = 0;
+    for (i = 0; i < n; i++) {
+        const struct dtree_rule *r = &td->rules[idx[i]];
+        if (r->lo[d] > lo[d]) {
+            points[n_points++] = r->lo[d] - 1;
+        }
+        if (r->hi[d] < hi[d]) {
+            points[n_points++] = r->hi[d];
+        }
+    }
+    qsort(points, n_points, sizeof *points, compare_uint32);
+
+    step = MAX(1, n_points / DTREE_SPLIT_CANDIDATES);
+    for (i = step / 2; i < n_points; i += step) {
+        uint32_t t = points[i];
+        unsigned int n_left = 0, n_right = 0, cost, j;
+
+        for (j = 0; j < n; j++) {
+            const struct dtree_rule *r = &td->rules[idx[j]];
+            n_left += MAX(r->lo[d], lo[d]) <= t;
+            n_right += MIN(r->hi[d], hi[d]) > t;
+        }
+        cost = MAX(n_left, n_right);
+        if (n_left + n_right <= n + n / 4 && cost < best_cost) {
+            best_cost = cost;
+            *thresholdp = t;
+        }
+    }
+    free(points);
+    return best_cost;
+}
+
+/* Builds a subtree for the 'n' rules in 'idx', which are in priority order
+ * and are all within the region bounded by 'lo' and 'hi'.  Takes ownership
+ * of 'idx'.  '*budget' is the number of additional copies of rules that the
+ * subtree may add to the tree; it is reduced by the number actually added. */
+static struct dtree_node *
+build_node(const struct sw_table_dtree *td, unsigned int *idx, unsigned int n,
+           const uint32_t lo[DT_N_DIMS], const uint32_t hi[DT_N_DIMS],
+           int depth, unsigned int *budget)
+{
+    struct dtree_node *node = xcalloc(1, sizeof *node);
+    unsigned int best_cost = n;
+    uint32_t threshold = 0;
+    int best_dim = DT_N_DIMS;
+    int d;
+
+    if (n > DTREE_LEAF_FLOWS && depth < DTREE_MAX_DEPTH && *budget >= n / 4) {
+        for (d = 0; d < DT_N_DIMS; d++) {
+            uint32_t t = 0;
+            unsigned int cost = choose_threshold(td, idx, n, d, lo, hi, &t);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_dim = d;
+                threshold = t;
+            }
+        }
+    }
+
+    node->dim = best_dim;
+    if (best_dim == DT_N_DIMS) {
+        node->rules = idx;
+        node->n_rules = n;
+    } else {
+        uint32_t child_lo[DT_N_DIMS], child_hi[DT_N_DIMS];
+        unsigned int *left = xmalloc(n * sizeof *left);
+        unsigned int *right = xmalloc(n * sizeof *right);
+        unsigned int n_left = 0, n_right = 0, i;
+
+        for (i = 0; i < n; i++) {
+            const struct dtree_rule *r = &td->rules[idx[i]];
+            if (r->lo[best_dim] <= threshold) {
+                left[n_left++] = idx[i];
+            }
+            if (r->hi[best_dim] > threshold) {
+                right[n_right++] = idx[i];
+            }
+        }
+        free(idx);
+        *budget -= n_left + n_right - n;
+
+        node->threshold = threshold;
+        memcpy(child_lo, lo, sizeof child_lo);
+        memcpy(child_hi, hi, sizeof child_hi);
+        child_hi[best_dim] = threshold;
+        node->children[0] = build_node(td, left, n_left, child_lo, child_hi,
+                                       depth + 1, budget);
+        child_hi[best_dim] = hi[best_dim];
+        child_lo[best_dim] = threshold + 1;
+        node->children[1] = build_node(td, right, n_right, child_lo, child_hi,
+                                       depth + 1, budget);
+    }
+    return node;
+}
+
+/* Returns the number of bytes of memory used by 'node' and its children. */
+static size_t
+node_memory_size(const struct dtree_node *node)
+{
+    if (!node) {
+        return 0;
+    }
+    return (sizeof *node + node->n_rules * sizeof *node->rules
+            + node_memory_size(node->children[0])
+            + node_memory_size(node->children[1]));
+}
+
+static void
+destroy_node(struct dtree_node *node)
+{
+    if (node) {
+        destroy_node(node->children[0]);
+        destroy_node(node->children[1]);
+        free(node->rules);
+        free(node);
+    }
+}
+
+/* Throws away 'td''s tree and builds a new one from all of its flows, which
+ * empties the pending list. */
+static void
+rebuild_tree(struct sw_table_dtree *td)
+{
+    static const uint32_t lo[DT_N_DIMS];
+    static const uint32_t hi[DT_N_DIMS] = {
+        UINT16_MAX, UINT16_MAX, UINT8_MAX, UINT32_MAX, UINT32_MAX,
+        UINT16_MAX, UINT16_MAX
+    };
+    long long int start = time_usec();
+    struct sw_flow *flow;
+    unsigned int *idx;
+    unsigned int budget;
+    unsigned int i;
+
+    destroy_node(td->root);
+    free(td->rules);
+
+    td->rules = xmalloc(MAX(td->n_flows, 1) * sizeof *td->rules);
+    idx = xmalloc(MAX(td->n_flows, 1) * sizeof *idx);
+    i = 0;
+    LIST_FOR_EACH (flow, struct sw_flow, node, &td->flows) {
+        rule_init(&td->rules[i], flow);
+        flow->private = &td->rules[i];
+        idx[i] = i;
+        i++;
+    }
+    td->n_rules = i;
+    td->n_dead = 0;
+    td->n_pending = 0;
+    budget = td->n_rules * (DTREE_MAX_COPIES - 1);
+    td->root = build_node(td, idx, td->n_rules, lo, hi, 0, &budget);
+    td->tree_bytes = node_memory_size(td->root);
+    td->n_builds++;
+
+    VLOG_DBG("built decision tree for %u flows in %lld us",
+             td->n_rules, time_usec() - start);
+}
+
+/* Looks up 'key' in 'td''s tree, adding the number of flows examined to
+ * '*depth'. */
+static struct sw_flow *
+lookup_tree(const struct sw_table_dtree *td, const struct sw_flow_key *key,
+            unsigned int *depth)
+{
+    const struct dtree_node *node = td->root;
+    uint32_t values[DT_N_DIMS];
+    unsigned int i;
+
+    if (!node) {
+        return NULL;
+    }
+
+    flow_to_values(&key->flow, values);
+    while (node->dim != DT_N_DIMS) {
+        node = node->children[values[node->dim] > node->threshold];
+    }
+    for (i = 0; i < node->n_rules; i++) {
+        struct sw_flow *flow = td->rules[node->rules[i]].flow;
+        if (flow && flow_matches_1wild(key, &flow->key)) {
+            *depth += i + 1;
+            return flow;
+        }
+    }
+    *depth += node->n_rules;
+    return NULL;
+}
+
+static struct sw_flow *table_dtree_lookup(struct sw_table *swt,
+                                          const struct sw_flow_key *key)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    unsigned int depth = 0;
+    struct sw_flow *best = lookup_tree(td, key, &depth);
+    unsigned int i;
+
+    /* A pending flow was added after every flow in the tree, so it wins only
+     * with a higher priority. */
+    for (i = 0; i < td->n_pending; i++) {
+        struct sw_flow *flow = td->pending[i];
+        if (best && flow->priority <= best->priority) {
+            break;
+        }
+        depth++;
+        if (flow_matches_1wild(key, &flow->key)) {
+            best = flow;
+            break;
+        }
+    }
+    td->depth_hist[table_hist_bin(depth)]++;
+    return best;
+}
+
+/* Adds 'flow' to 'td''s pending list, behind any flows of equal or higher
+ * priority. */
+static void
+add_pending(struct sw_table_dtree *td, struct sw_flow *flow)
+{
+    unsigned int i;
+
+    if (td->n_pending >= td->allocated_pending) {
+        td->allocated_pending = MAX(16, td->allocated_pending * 2);
+        td->pending = xrealloc(td->pending,
+                               td->allocated_pending * sizeof *td->pending);
+    }
+    for (i = td->n_pending; i > 0; i--) {
+        if (td->pending[i - 1]->priority >= flow->priority) {
+            break;
+        }
+        td->pending[i] = td->pending[i - 1];
+    }
+    td->pending[i] = flow;
+    td->n_pending++;
+    flow->private = NULL;
+}
+
+/* Replaces 'old' by 'new' in the tree or the pending list of 'td'. */
+static void
+replace_flow(struct sw_table_dtree *td, struct sw_flow *old,
+             struct sw_flow *new)
+{
+    struct dtree_rule *rule = old->private;
+
+    new->private = rule;
+    if (rule) {
+        rule->flow = new;
+    } else {
+        unsigned int i;
+
+        for (i = 0; i < td->n_pending; i++) {
+            if (td->pending[i] == old) {
+                td->pending[i] = new;
+                break;
+            }
+        }
+    }
+}
+
+/* Removes 'flow' from the tree or the pending list of 'td', and from its flow
+ * lists. */
+static void
+remove_flow(struct sw_table_dtree *td, struct sw_flow *flow)
+{
+    struct dtree_rule *rule = flow->private;
+
+    if (rule) {
+        rule->flow = NULL;
+        td->n_dead++;
+    } else {
+        unsigned int i;
+
+        for (i = 0; i < td->n_pending; i++) {
+            if (td->pending[i] == flow) {
+                memmove(&td->pending[i], &td->pending[i + 1],
+                        (td->n_pending - i - 1) * sizeof *td->pending);
+                td->n_pending--;
+                break;
+            }
+        }
+    }
+    list_remove(&flow->node);
+    list_remove(&flow->iter_node);
+    td->n_flows--;
+    td->flow_bytes -= flow_memory_size(flow);
+}
+
+static int table_dtree_insert(struct sw_table *swt, struct sw_flow *flow)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *f;
+
+    /* Keep the flows in the same order as table-linear, so that ties between
+     * flows of equal priority are broken the same way. */
+    LIST_FOR_EACH (f, struct sw_flow, node, &td->flows) {
+        if (f->priority == flow->priority
+                && f->key.wildcards == flow->key.wildcards
+                && flow_matches_2wild(&f->key, &flow->key)) {
+            flow->serial = f->serial;
+            list_replace(&flow->node, &f->node);
+            list_replace(&flow->iter_node, &f->iter_node);
+            replace_flow(td, f, flow);
+            td->flow_bytes += flow_memory_size(flow) - flow_memory_size(f);
+            flow_free(f);
+            return 1;
+        }
+
+        if (f->priority < flow->priority)
+            break;
+    }
+
+    if (td->n_flows >= td->max_flows) {
+        return 0;
+    }
+    td->n_flows++;
+    td->flow_bytes += flow_memory_size(flow);
+
+    flow->serial = td->next_serial++;
+    list_insert(&f->node, &flow->node);
+    list_push_front(&td->iter_flows, &flow->iter_node);
+    add_pending(td, flow);
+
+    if (td->n_pending > MAX(DTREE_MAX_PENDING, td->n_rules / 4)) {
+        rebuild_tree(td);
+    }
+    return 1;
+}
+
+static int table_dtree_modify(struct sw_table *swt,
+                const struct sw_flow_key *key, uint16_t priority, int strict,
+                const struct ofp_action_header *actions, size_t actions_len)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *flow;
+    unsigned int count = 0;
+
+    LIST_FOR_EACH (flow, struct sw_flow, node, &td->flows) {
+        if (flow_matches_desc(&flow->key, key, strict)
+                && (!strict || (flow->priority == priority))) {
+            td->flow_bytes -= flow_memory_size(flow);
+            flow_replace_acts(flow, actions, actions_len);
+            td->flow_bytes += flow_memory_size(flow);
+            count++;
+        }
+    }
+    return count;
+}
+
+static int table_dtree_has_conflict(struct sw_table *swt,
+                                    const struct sw_flow_key *key,
+                                    uint16_t priority, int strict)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *flow;
+
+    LIST_FOR_EACH (flow, struct sw_flow, node, &td->flows) {
+        if (flow_matches_2desc(&flow->key, key, strict)
+                && (flow->priority == priority)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int table_dtree_delete(struct datapath *dp, struct sw_table *swt,
+                              const struct sw_flow_key *key,
+                              uint16_t out_port,
+                              uint16_t priority, int strict)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *flow, *n;
+    unsigned int count = 0;
+
+    LIST_FOR_EACH_SAFE (flow, n, struct sw_flow, node, &td->flows) {
+        if (flow_matches_desc(&flow->key, key, strict)
+                && flow_has_out_port(flow, out_port)
+                && (!strict || (flow->priority == priority))) {
+            dp_send_flow_end(dp, flow, OFPRR_DELETE);
+            remove_flow(td, flow);
+            flow_free(flow);
+            count++;
+        }
+    }
+    return count;
+}
+
+static void table_dtree_timeout(struct sw_table *swt, struct list *deleted)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *flow, *n;
+
+    LIST_FOR_EACH_SAFE (flow, n, struct sw_flow, node, &td->flows) {
+        if (flow_timeout(flow)) {
+            remove_flow(td, flow);
+            list_push_back(deleted, &flow->node);
+        }
+    }
+
+    /* Catch up with changes since the tree was built. */
+    if (td->n_pending || td->n_dead) {
+        rebuild_tree(td);
+    }
+}
+
+static void table_dtree_destroy(struct sw_table *swt)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+
+    while (!list_is_empty(&td->flows)) {
+        struct sw_flow *flow = CONTAINER_OF(list_front(&td->flows),
+                                            struct sw_flow, node);
+        list_remove(&flow->node);
+        flow_free(flow);
+    }
+    destroy_node(td->root);
+    free(td->rules);
+    free(td->pending);
+    free(td);
+}
+
+static int table_dtree_iterate(struct sw_table *swt,
+                               const struct sw_flow_key *key,
+                               uint16_t out_port,
+                               struct sw_table_position *position,
+                               int (*callback)(struct sw_flow *, void *),
+                               void *private)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+    struct sw_flow *flow;
+    unsigned long start;
+
+    start = ~position->private[0];
+    LIST_FOR_EACH (flow, struct sw_flow, iter_node, &td->iter_flows) {
+        if (flow->serial <= start
+                && flow_matches_2wild(key, &flow->key)
+                && flow_has_out_port(flow, out_port)) {
+            int error = callback(flow, private);
+            if (error) {
+                position->private[0] = ~(flow->serial - 1);
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+static void table_dtree_stats(struct sw_table *swt,
+                              struct sw_table_stats *stats)
+{
+    struct sw_table_dtree *td = (struct sw_table_dtree *) swt;
+
+    stats->name = "dtree";
+    stats->wildcards = OFPFW_ALL;
+    stats->n_flows   = td->n_flows;
+    stats->max_flows = td->max_flows;
+    stats->n_lookup  = swt->n_lookup;
+    stats->n_matched = swt->n_matched;
+    memcpy(stats->depth_hist, td->depth_hist, sizeof stats->depth_hist);
+    stats->n_bytes   = (sizeof *td + td->flow_bytes
+                        + td->n_rules * sizeof *td->rules
+                        + td->allocated_pending * sizeof *td->pending
+                        + td->tree_bytes);
+}
+
+struct sw_table *table_dtree_create(unsigned int max_flows)
+{
+    struct sw_table_dtree *td;
+    struct sw_table *swt;
+
+    td = calloc(1, sizeof *td);
+    if (td == NULL)
+        return NULL;
+
+    swt = &td->swt;
+    swt->lookup = table_dtree_lookup;
+    swt->insert = table_dtree_insert;
+    swt->modify = table_dtree_modify;
+    swt->has_conflict = table_dtree_has_conflict;
+    swt->delete = table_dtree_delete;
+    swt->timeout = table_dtree_timeout;
+    swt->destroy = table_dtree_destroy;
+    swt->iterate = table_dtree_iterate;
+    swt->stats = table_dtree_stats;
+
+    td->max_flows = max_flows;
+    list_init(&td->flows);
+    list_init(&td->iter_flows);
+
+    return swt;
+}
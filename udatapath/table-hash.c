@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "openflow/nicira-ext.h"
+#include "compiler.h"
 #include "crc32.h"
 #include "datapath.h"
 #include "flow.h"
@@ -45,9 +46,15 @@
 struct sw_table_hash {
     struct sw_table swt;
     struct crc32 crc32;
+    unsigned int polynomial;
     unsigned int n_flows;
     unsigned int bucket_mask; /* Number of buckets minus 1. */
     struct sw_flow **buckets;
+    unsigned long int n_collisions; /* Inserts rejected by a full bucket. */
+    size_t flow_bytes;          /* flow_memory_size() summed over flows. */
+
+    /* Occupied buckets in each 1/TABLE_HIST_BINS of the buckets. */
+    unsigned int occupancy[TABLE_HIST_BINS];
 };
 
 static struct sw_flow **find_bucket(struct sw_table *swt,
@@ -59,6 +66,14 @@ static struct sw_flow **find_bucket(struct sw_table *swt,
     return &th->buckets[crc & th->bucket_mask];
 }
 
+/* Returns the element of 'th->occupancy' that counts 'bucket'. */
+static unsigned int *
+bucket_occupancy(struct sw_table_hash *th, struct sw_flow **bucket)
+{
+    unsigned long long int i = bucket - th->buckets;
+    return &th->occupancy[i * TABLE_HIST_BINS / (th->bucket_mask + 1)];
+}
+
 static struct sw_flow *table_hash_lookup(struct sw_table *swt,
                                          const struct sw_flow_key *key)
 {
@@ -66,6 +81,36 @@ static struct sw_flow *table_hash_lookup(struct sw_table *swt,
     return flow && !flow_compare(&flow->key.flow, &key->flow) ? flow : NULL;
 }
 
+/* Looks up 'n' keys at once.  Computing every bucket and prefetching it
+ * before dereferencing any of them, and then prefetching every flow before
+ * comparing any key, lets the cache misses for different keys overlap instead
+ * of stalling one after another. */
+static void table_hash_lookup_batch(struct sw_table *swt,
+                                    const struct sw_flow_key *keys[],
+                                    struct sw_flow *flows[], int n)
+{
+    struct sw_flow **buckets[TABLE_LOOKUP_BATCH_MAX];
+    int i;
+
+    assert(n <= TABLE_LOOKUP_BATCH_MAX);
+    for (i = 0; i < n; i++) {
+        buckets[i] = find_bucket(swt, keys[i]);
+        prefetch(buckets[i]);
+    }
+    for (i = 0; i < n; i++) {
+        flows[i] = *buckets[i];
+        if (flows[i]) {
+            prefetch(flows[i]);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        struct sw_flow *flow = flows[i];
+        if (flow && flow_compare(&flow->key.flow, &keys[i]->flow)) {
+            flows[i] = NULL;
+        }
+    }
+}
+
 static int table_hash_insert(struct sw_table *swt, struct sw_flow *flow)
 {
     struct sw_table_hash *th = (struct sw_table_hash *) swt;
@@ -78,21 +123,36 @@ static int table_hash_insert(struct sw_table *swt, struct sw_flow *flow)
     bucket = find_bucket(swt, &flow->key);
     if (*bucket == NULL) {
         th->n_flows++;
+        th->flow_bytes += flow_memory_size(flow);
+        (*bucket_occupancy(th, bucket))++;
         *bucket = flow;
         retval = 1;
     } else {
         struct sw_flow *old_flow = *bucket;
         if (!flow_compare(&old_flow->key.flow, &flow->key.flow)) {
             *bucket = flow;
+            th->flow_bytes += (flow_memory_size(flow)
+                               - flow_memory_size(old_flow));
             flow_free(old_flow);
             retval = 1;
         } else {
+            th->n_collisions++;
             retval = 0;
         }
     }
     return retval;
 }
 
+/* Gives 'flow', in 'th', the 'actions_len' bytes of 'actions'. */
+static void
+replace_acts(struct sw_table_hash *th, struct sw_flow *flow,
+             const struct ofp_action_header *actions, size_t actions_len)
+{
+    th->flow_bytes -= flow_memory_size(flow);
+    flow_replace_acts(flow, actions, actions_len);
+    th->flow_bytes += flow_memory_size(flow);
+}
+
 static int table_hash_modify(struct sw_table *swt, 
         const struct sw_flow_key *key, uint16_t priority, int strict,
         const struct ofp_action_header *actions, size_t actions_len) 
@@ -105,7 +165,7 @@ static int table_hash_modify(struct sw_table *swt,
         struct sw_flow *flow = *bucket;
         if (flow && flow_matches_desc(&flow->key, key, strict)
                 && (!strict || (flow->priority == priority))) {
-            flow_replace_acts(flow, actions, actions_len);
+            replace_acts(th, flow, actions, actions_len);
             count = 1;
         }
     } else {
@@ -116,7 +176,7 @@ static int table_hash_modify(struct sw_table *swt,
             struct sw_flow *flow = *bucket;
             if (flow && flow_matches_desc(&flow->key, key, strict)
                     && (!strict || (flow->priority == priority))) {
-                flow_replace_acts(flow, actions, actions_len);
+                replace_acts(th, flow, actions, actions_len);
                 count++;
             }
         }
@@ -154,8 +214,10 @@ static int table_hash_has_conflict(struct sw_table *swt,
 
 /* Caller must update n_flows. */
 static void
-do_delete(struct sw_flow **bucket)
+do_delete(struct sw_table_hash *th, struct sw_flow **bucket)
 {
+    th->flow_bytes -= flow_memory_size(*bucket);
+    (*bucket_occupancy(th, bucket))--;
     flow_free(*bucket);
     *bucket = NULL;
 }
@@ -177,7 +239,7 @@ static int table_hash_delete(struct datapath *dp, struct sw_table *swt,
         if (flow && !flow_compare(&flow->key.flow, &key->flow)
                 && flow_has_out_port(flow, out_port)) {
             dp_send_flow_end(dp, flow, OFPRR_DELETE);
-            do_delete(bucket);
+            do_delete(th, bucket);
             count = 1;
         }
     } else {
@@ -189,7 +251,7 @@ static int table_hash_delete(struct datapath *dp, struct sw_table *swt,
             if (flow && flow_matches_desc(&flow->key, key, strict)
                     && flow_has_out_port(flow, out_port)) {
                 dp_send_flow_end(dp, flow, OFPRR_DELETE);
-                do_delete(bucket);
+                do_delete(th, bucket);
                 count++;
             }
         }
@@ -210,6 +272,8 @@ static void table_hash_timeout(struct sw_table *swt, struct list *deleted)
             list_push_back(deleted, &flow->node);
             *bucket = NULL;
             th->n_flows--;
+            th->flow_bytes -= flow_memory_size(flow);
+            (*bucket_occupancy(th, bucket))--;
         }
     }
 }
@@ -267,12 +331,23 @@ static void table_hash_stats(struct sw_table *swt,
                              struct sw_table_stats *stats) 
 {
     struct sw_table_hash *th = (struct sw_table_hash *) swt;
+    struct sw_table_hash_stats *hs = &stats->hashes[0];
+
     stats->name = "hash";
     stats->wildcards = 0;        /* No wildcards are supported. */
     stats->n_flows   = th->n_flows;
     stats->max_flows = th->bucket_mask + 1;
     stats->n_lookup  = swt->n_lookup;
     stats->n_matched = swt->n_matched;
+    stats->n_bytes   = (sizeof *th + th->flow_bytes
+                        + (th->bucket_mask + 1) * sizeof *th->buckets);
+    stats->n_hashes  = 1;
+
+    hs->polynomial = th->polynomial;
+    hs->n_buckets = th->bucket_mask + 1;
+    hs->n_flows = th->n_flows;
+    hs->n_collisions = th->n_collisions;
+    memcpy(hs->occupancy, th->occupancy, sizeof hs->occupancy);
 }
 
 struct sw_table *table_hash_create(unsigned int polynomial,
@@ -298,6 +373,7 @@ struct sw_table *table_hash_create(unsigned int polynomial,
 
     swt = &th->swt;
     swt->lookup = table_hash_lookup;
+    swt->lookup_batch = table_hash_lookup_batch;
     swt->insert = table_hash_insert;
     swt->modify = table_hash_modify;
     swt->has_conflict = table_hash_has_conflict;
@@ -308,6 +384,7 @@ struct sw_table *table_hash_create(unsigned int polynomial,
     swt->stats = table_hash_stats;
 
     crc32_init(&th->crc32, polynomial);
+    th->polynomial = polynomial;
 
     return swt;
 }
@@ -333,6 +410,43 @@ static struct sw_flow *table_hash2_lookup(struct sw_table *swt,
     return NULL;
 }
 
+/* Like table_hash_lookup_batch(), but looks in both subtables at once. */
+static void table_hash2_lookup_batch(struct sw_table *swt,
+                                     const struct sw_flow_key *keys[],
+                                     struct sw_flow *flows[], int n)
+{
+    struct sw_table_hash2 *t2 = (struct sw_table_hash2 *) swt;
+    struct sw_flow **buckets[2][TABLE_LOOKUP_BATCH_MAX];
+    struct sw_flow *candidates[2][TABLE_LOOKUP_BATCH_MAX];
+    int i, j;
+
+    assert(n <= TABLE_LOOKUP_BATCH_MAX);
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < 2; j++) {
+            buckets[j][i] = find_bucket(t2->subtable[j], keys[i]);
+            prefetch(buckets[j][i]);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < 2; j++) {
+            candidates[j][i] = *buckets[j][i];
+            if (candidates[j][i]) {
+                prefetch(candidates[j][i]);
+            }
+        }
+    }
+    for (i = 0; i < n; i++) {
+        flows[i] = NULL;
+        for (j = 0; j < 2; j++) {
+            struct sw_flow *flow = candidates[j][i];
+            if (flow && !flow_compare(&flow->key.flow, &keys[i]->flow)) {
+                flows[i] = flow;
+                break;
+            }
+        }
+    }
+}
+
 static int table_hash2_insert(struct sw_table *swt, struct sw_flow *flow)
 {
     struct sw_table_hash2 *t2 = (struct sw_table_hash2 *) swt;
@@ -426,6 +540,10 @@ static void table_hash2_stats(struct sw_table *swt,
     stats->max_flows = substats[0].max_flows + substats[1].max_flows;
     stats->n_lookup  = swt->n_lookup;
     stats->n_matched = swt->n_matched;
+    stats->n_bytes   = sizeof *t2 + substats[0].n_bytes + substats[1].n_bytes;
+    stats->n_hashes  = 2;
+    for (i = 0; i < 2; i++)
+        stats->hashes[i] = substats[i].hashes[0];
 }
 
 struct sw_table *table_hash2_create(unsigned int poly0, unsigned int buckets0,
@@ -450,6 +568,7 @@ struct sw_table *table_hash2_create(unsigned int poly0, unsigned int buckets0,
 
     swt = &t2->swt;
     swt->lookup = table_hash2_lookup;
+    swt->lookup_batch = table_hash2_lookup_batch;
     swt->insert = table_hash2_insert;
     swt->modify = table_hash2_modify;
     swt->has_conflict = table_hash2_has_conflict;
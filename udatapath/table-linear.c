@@ -34,6 +34,7 @@
 #include <config.h>
 #include "table.h"
 #include <stdlib.h>
+#include <string.h>
 #include "flow.h"
 #include "list.h"
 #include "openflow/openflow.h"
@@ -49,6 +50,10 @@ struct sw_table_linear {
     struct list flows;
     struct list iter_flows;
     unsigned long int next_serial;
+    size_t flow_bytes;          /* flow_memory_size() summed over flows. */
+
+    /* Lookups by number of flows examined, by table_hist_bin(). */
+    unsigned long int depth_hist[TABLE_HIST_BINS];
 };
 
 static struct sw_flow *table_linear_lookup(struct sw_table *swt,
@@ -56,10 +61,16 @@ static struct sw_flow *table_linear_lookup(struct sw_table *swt,
 {
     struct sw_table_linear *tl = (struct sw_table_linear *) swt;
     struct sw_flow *flow;
+    unsigned int depth = 0;
+
     LIST_FOR_EACH (flow, struct sw_flow, node, &tl->flows) {
-        if (flow_matches_1wild(key, &flow->key))
+        depth++;
+        if (flow_matches_1wild(key, &flow->key)) {
+            tl->depth_hist[table_hist_bin(depth)]++;
             return flow;
+        }
     }
+    tl->depth_hist[table_hist_bin(depth)]++;
     return NULL;
 }
 
@@ -79,6 +90,7 @@ static int table_linear_insert(struct sw_table *swt, struct sw_flow *flow)
             flow->serial = f->serial;
             list_replace(&flow->node, &f->node);
             list_replace(&flow->iter_node, &f->iter_node);
+            tl->flow_bytes += flow_memory_size(flow) - flow_memory_size(f);
             flow_free(f);
             return 1;
         }
@@ -92,6 +104,7 @@ static int table_linear_insert(struct sw_table *swt, struct sw_flow *flow)
         return 0;
     }
     tl->n_flows++;
+    tl->flow_bytes += flow_memory_size(flow);
 
     /* Insert the entry immediately in front of where we're pointing. */
     flow->serial = tl->next_serial++;
@@ -112,7 +125,9 @@ static int table_linear_modify(struct sw_table *swt,
     LIST_FOR_EACH (flow, struct sw_flow, node, &tl->flows) {
         if (flow_matches_desc(&flow->key, key, strict)
                 && (!strict || (flow->priority == priority))) {
+            tl->flow_bytes -= flow_memory_size(flow);
             flow_replace_acts(flow, actions, actions_len);
+            tl->flow_bytes += flow_memory_size(flow);
             count++;
         }
     }
@@ -136,8 +151,9 @@ static int table_linear_has_conflict(struct sw_table *swt,
 }
 
 static void
-do_delete(struct sw_flow *flow) 
+do_delete(struct sw_table_linear *tl, struct sw_flow *flow)
 {
+    tl->flow_bytes -= flow_memory_size(flow);
     list_remove(&flow->node);
     list_remove(&flow->iter_node);
     flow_free(flow);
@@ -157,7 +173,7 @@ static int table_linear_delete(struct datapath *dp, struct sw_table *swt,
                 && flow_has_out_port(flow, out_port)
                 && (!strict || (flow->priority == priority))) {
             dp_send_flow_end(dp, flow, OFPRR_DELETE);
-            do_delete(flow);
+            do_delete(tl, flow);
             count++;
         }
     }
@@ -176,6 +192,7 @@ static void table_linear_timeout(struct sw_table *swt, struct list *deleted)
             list_remove(&flow->iter_node);
             list_push_back(deleted, &flow->node);
             tl->n_flows--;
+            tl->flow_bytes -= flow_memory_size(flow);
         }
     }
 }
@@ -223,12 +240,15 @@ static void table_linear_stats(struct sw_table *swt,
                                struct sw_table_stats *stats)
 {
     struct sw_table_linear *tl = (struct sw_table_linear *) swt;
+
     stats->name = "linear";
     stats->wildcards = OFPFW_ALL;
     stats->n_flows   = tl->n_flows;
     stats->max_flows = tl->max_flows;
     stats->n_lookup  = swt->n_lookup;
     stats->n_matched = swt->n_matched;
+    stats->n_bytes   = sizeof *tl + tl->flow_bytes;
+    memcpy(stats->depth_hist, tl->depth_hist, sizeof stats->depth_hist);
 }
 
 
@@ -46,6 +46,34 @@ struct sw_flow_key;
 struct ofp_action_header;
 struct list;
 
+/* Number of bins in the histograms in struct sw_table_stats. */
+#define TABLE_HIST_BINS 16
+
+/* Returns the histogram bin for 'n': bin 0 for 0, bin i for 2**(i-1) <= n <
+ * 2**i, except that the last bin also counts everything bigger. */
+static inline int
+table_hist_bin(unsigned int n)
+{
+    int bin = 0;
+    while (n && bin < TABLE_HIST_BINS - 1) {
+        n >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+/* Diagnostics for one hash function of a hash table. */
+struct sw_table_hash_stats {
+    unsigned int polynomial;     /* CRC-32 polynomial. */
+    unsigned int n_buckets;      /* Number of buckets, a power of 2. */
+    unsigned int n_flows;        /* Number of occupied buckets. */
+    unsigned long int n_collisions; /* Inserts rejected because the bucket
+                                       held a different flow. */
+    unsigned int occupancy[TABLE_HIST_BINS]; /* Occupied buckets in each
+                                                1/TABLE_HIST_BINS of the
+                                                buckets, in order. */
+};
+
 /* Table statistics. */
 struct sw_table_stats {
     const char *name;            /* Human-readable name. */
@@ -55,8 +83,21 @@ struct sw_table_stats {
     unsigned int max_flows;      /* Flow capacity. */
     unsigned long int n_lookup;  /* Number of packets looked up. */
     unsigned long int n_matched; /* Number of packets that have hit. */
+    size_t n_bytes;              /* Approximate memory in use, in bytes. */
+
+    /* Diagnostics.  Tables fill in only those that apply, so callers must
+     * zero these first. */
+    unsigned long int depth_hist[TABLE_HIST_BINS]; /* Lookups by number of
+                                                      flows examined, by
+                                                      table_hist_bin(). */
+    int n_hashes;                /* Number of hash functions used. */
+    struct sw_table_hash_stats hashes[2];
 };
 
+/* Maximum number of keys passed to a single call to sw_table's lookup_batch
+ * member function. */
+#define TABLE_LOOKUP_BATCH_MAX 32
+
 /* Position within an iteration of a sw_table.
  *
  * The contents are private to the table implementation, except that a position
@@ -79,6 +120,19 @@ struct sw_table {
     struct sw_flow *(*lookup)(struct sw_table *table,
                               const struct sw_flow_key *key);
 
+    /* Searches 'table' for each of the 'n' keys in 'keys', none of which may
+     * have any wildcard fields, and stores the matching flow, or a null
+     * pointer, into the corresponding element of 'flows'.  'n' is at most
+     * TABLE_LOOKUP_BATCH_MAX.  The result is the same as calling lookup() on
+     * each key, but the table can overlap the memory accesses for different
+     * keys.
+     *
+     * This member function is optional: if it is null, callers fall back to
+     * lookup(). */
+    void (*lookup_batch)(struct sw_table *table,
+                         const struct sw_flow_key *keys[],
+                         struct sw_flow *flows[], int n);
+
     /* Inserts 'flow' into 'table', replacing any duplicate flow.  Returns
      * 0 if successful or a negative error.  Error can be due to an
      * over-capacity table or because the flow is not one of the kind that
@@ -146,5 +200,6 @@ struct sw_table *table_hash_create(unsigned int polynomial,
 struct sw_table *table_hash2_create(unsigned int poly0, unsigned int buckets0,
                                     unsigned int poly1, unsigned int buckets1);
 struct sw_table *table_linear_create(unsigned int max_flows);
+struct sw_table *table_dtree_create(unsigned int max_flows);
 
 #endif /* table.h */
@@ -40,15 +40,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "chain.h"
 #include "command-line.h"
 #include "daemon.h"
 #include "datapath.h"
 #include "fault.h"
+#include "handoff.h"
+#include "netdev.h"
 #include "openflow/openflow.h"
 #include "poll-loop.h"
 #include "queue.h"
 #include "util.h"
 #include "rconn.h"
+#include "signals.h"
+#include "snapshot.h"
+#include "standalone.h"
+#include "svec.h"
 #include "timeval.h"
 #include "vconn.h"
 #include "dirs.h"
@@ -59,6 +66,10 @@
 #include <openflow/of_hw_api.h>
 #endif
 
+#if defined(UDATAPATH_SECCHAN)
+#include "secchan.h"
+#endif
+
 #define THIS_MODULE VLM_udatapath
 #include "vlog.h"
 
@@ -81,6 +92,35 @@ static uint16_t num_queues = NETDEV_MAX_QUEUES;
 
 static void add_ports(struct datapath *dp, char *port_list);
 
+/* Flow table snapshot for warm restarts, if any.  See snapshot.h. */
+static char *snapshot_file;     /* --snapshot: file name, or NULL. */
+static int snapshot_interval = 60; /* --snapshot-interval: seconds. */
+static int snapshot_grace = 60; /* --snapshot-grace: seconds. */
+
+/* Socket for handing off to a new ofdatapath, if any.  See handoff.h. */
+static char *handoff_file;      /* --handoff: file name, or NULL. */
+
+/* Allow secchan to have the datapath learn MAC addresses itself while failing
+ * open?  See standalone.h. */
+static bool fail_open_learning; /* --fail-open-learning. */
+
+static bool has_listener(const struct datapath *, const char *name);
+static bool has_port(const struct datapath *, const char *netdev);
+
+#if defined(UDATAPATH_SECCHAN)
+/* In-process secure channel.
+ *
+ * With --secchan, ofdatapath runs the secure channel in its own process
+ * instead of relying on a separate ofprotocol.  The secure channel connects
+ * to the datapath over the "mem:" vconn, which hands messages across as
+ * ofpbufs, so packet-ins and flow-mods no longer cross the kernel twice. */
+#define SECCHAN_VCONN_NAME "ofdatapath"
+
+static char *secchan_args;      /* Secure channel command line, if any. */
+
+static struct secchan *start_secchan(const char *args);
+#endif
+
 /* Need to treat this more generically */
 #if defined(UDATAPATH_AS_LIB)
 #define OFP_FATAL(_er, _str, args...) do {                \
@@ -102,6 +142,13 @@ main(int argc, char *argv[])
 int
 udatapath_cmd(int argc, char *argv[])
 {
+#if defined(UDATAPATH_SECCHAN)
+    struct secchan *secchan = NULL;
+#endif
+    struct signal *sigterm = NULL;
+    struct handoff *handoff = NULL;
+    bool taken_over = false;
+    long long int next_snapshot = LLONG_MAX;
     int n_listeners;
     int error;
     int i;
@@ -113,19 +160,49 @@ udatapath_cmd(int argc, char *argv[])
     parse_options(argc, argv);
     signal(SIGPIPE, SIG_IGN);
 
-    if (argc - optind < 1) {
+    if (argc - optind < 1
+#if defined(UDATAPATH_SECCHAN)
+        && !secchan_args
+#endif
+        ) {
         OFP_FATAL(0, "at least one listener argument is required; "
           "use --help for usage");
     }
 
+    /* Catch SIGTERM before anything else asks for it, so that we can save
+     * a final snapshot before exiting. */
+    if (snapshot_file) {
+        sigterm = signal_register(SIGTERM);
+    }
+
     error = dp_new(&dp, dpid);
+    if (fail_open_learning) {
+        dp->standalone = standalone_create(dp);
+    }
+
+    /* Take over from an ofdatapath that is already running, if any, before
+     * opening anything that it might hand off to us. */
+    if (handoff_file) {
+        handoff = handoff_create(handoff_file);
+        error = handoff_take_over(handoff, dp);
+        if (!error) {
+            taken_over = true;
+            ignore_existing_pidfile();
+        } else if (error != ENOENT && error != ECONNREFUSED) {
+            OFP_FATAL(error, "%s: taking over from old process failed",
+                      handoff_file);
+        }
+    }
 
-    n_listeners = 0;
+    n_listeners = dp->n_listeners;
     for (i = optind; i < argc; i++) {
         const char *pvconn_name = argv[i];
         struct pvconn *pvconn;
         int retval;
 
+        if (has_listener(dp, pvconn_name)) {
+            continue;
+        }
         retval = pvconn_open(pvconn_name, &pvconn);
         if (!retval || retval == EAGAIN) {
             dp_add_pvconn(dp, pvconn);
@@ -134,6 +211,18 @@ udatapath_cmd(int argc, char *argv[])
             ofp_error(retval, "opening %s", pvconn_name);
         }
     }
+#if defined(UDATAPATH_SECCHAN)
+    if (secchan_args) {
+        struct pvconn *pvconn;
+
+        error = pvconn_open("pmem:" SECCHAN_VCONN_NAME, &pvconn);
+        if (error) {
+            OFP_FATAL(error, "could not listen for secure channel");
+        }
+        dp_add_pvconn(dp, pvconn);
+        n_listeners++;
+    }
+#endif
     if (!n_listeners) {
         OFP_FATAL(0, "could not listen for any connections");
     }
@@ -141,13 +230,22 @@ udatapath_cmd(int argc, char *argv[])
     if (port_list) {
         add_ports(dp, port_list);
     }
-    if (local_port) {
+    if (local_port && !dp->local_port) {
         error = dp_add_local_port(dp, local_port, 0);
         if (error) {
             OFP_FATAL(error, "failed to add local port %s", local_port);
         }
     }
 
+    /* Restore the flow table before any controller can connect, so that
+     * forwarding resumes immediately. */
+    if (snapshot_file) {
+        if (!taken_over) {
+            snapshot_restore(dp, snapshot_file, snapshot_grace);
+        }
+        next_snapshot = time_msec() + snapshot_interval * 1000LL;
+    }
+
     error = vlog_server_listen(NULL, NULL);
     if (error) {
         OFP_FATAL(error, "could not listen for vlog connections");
@@ -156,9 +254,62 @@ udatapath_cmd(int argc, char *argv[])
     die_if_already_running();
     daemonize();
 
+#if defined(UDATAPATH_SECCHAN)
+    if (secchan_args) {
+        secchan = start_secchan(secchan_args);
+    }
+#endif
+
+    if (handoff && !taken_over) {
+        error = handoff_listen(handoff);
+        if (error) {
+            OFP_FATAL(error, "%s: could not listen for handoff",
+                      handoff_file);
+        }
+    }
+
     for (;;) {
+        if (sigterm && signal_poll(sigterm)) {
+            snapshot_save(dp, snapshot_file);
+            exit(EXIT_SUCCESS);
+        }
+        if (time_msec() >= next_snapshot) {
+            snapshot_save(dp, snapshot_file);
+            next_snapshot = time_msec() + snapshot_interval * 1000LL;
+        }
+
         dp_run(dp);
+        if (taken_over) {
+            /* Now that we are forwarding, the old process can go. */
+            handoff_ready(handoff);
+            error = handoff_listen(handoff);
+            if (error) {
+                OFP_FATAL(error, "%s: could not listen for handoff",
+                          handoff_file);
+            }
+            taken_over = false;
+        }
+        if (handoff) {
+            handoff_run(handoff, dp);
+        }
+#if defined(UDATAPATH_SECCHAN)
+        if (secchan && !secchan_run(secchan)) {
+            OFP_FATAL(0, "secure channel exited");
+        }
+#endif
         dp_wait(dp);
+        if (handoff) {
+            handoff_wait(handoff);
+        }
+#if defined(UDATAPATH_SECCHAN)
+        if (secchan) {
+            secchan_wait(secchan);
+        }
+#endif
+        if (sigterm) {
+            signal_wait(sigterm);
+            poll_timer_wait(MAX(0, next_snapshot - time_msec()));
+        }
         poll_block();
     }
 
@@ -168,21 +319,97 @@ udatapath_cmd(int argc, char *argv[])
 static void
 add_ports(struct datapath *dp, char *port_list)
 {
+    long long int start, cached, added;
     char *port, *save_ptr;
 
+    /* Fetch information about all the network devices at once, instead of
+     * one ioctl at a time as each port is opened. */
+    start = time_usec();
+    netdev_cache_links();
+    cached = time_usec();
+
     /* Glibc 2.7 has a bug in strtok_r when compiling with optimization that
      * can cause segfaults here:
      * http://sources.redhat.com/bugzilla/show_bug.cgi?id=5614.
      * Using ",," instead of the obvious "," works around it. */
     for (port = strtok_r(port_list, ",,", &save_ptr); port;
          port = strtok_r(NULL, ",,", &save_ptr)) {
-        int error = dp_add_port(dp, port, num_queues);
+        int error;
+
+        if (has_port(dp, port)) {
+            continue;
+        }
+        error = dp_add_port(dp, port, num_queues);
         if (error) {
             ofp_fatal(error, "failed to add port %s", port);
         }
     }
+    added = time_usec();
+    netdev_uncache_links();
+
+    VLOG_INFO("added %u ports in %lld ms (link dump %lld us, open %lld us, "
+              "configure %lld us, slicing %lld us)",
+              dp->n_ports_added, (added - start) / 1000, cached - start,
+              dp->port_open_usec, dp->port_config_usec,
+              dp->port_slicing_usec);
+}
+
+/* Returns true if 'dp' already listens on 'name', because it took the
+ * listener over from an old process. */
+static bool
+has_listener(const struct datapath *dp, const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < dp->n_listeners; i++) {
+        if (!strcmp(pvconn_get_name(dp->listeners[i]), name)) {
+            return true;
+        }
+    }
+    return false;
 }
 
+/* Returns true if 'dp' already has a port for network device 'netdev',
+ * because it took the port over from an old process. */
+static bool
+has_port(const struct datapath *dp, const char *netdev)
+{
+    const struct sw_port *p;
+
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (p->netdev && !strcmp(netdev_get_name(p->netdev), netdev)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(UDATAPATH_SECCHAN)
+/* Creates and starts a secure channel configured by 'args', a string of
+ * ofprotocol command-line options and arguments without the datapath, which
+ * is always this process's own datapath. */
+static struct secchan *
+start_secchan(const char *args)
+{
+    struct secchan *secchan;
+    struct svec argv;
+
+    /* The secure channel keeps pointers into 'argv', so it is never freed. */
+    svec_init(&argv);
+    svec_add(&argv, program_name);
+    svec_add(&argv, "mem:" SECCHAN_VCONN_NAME);
+    svec_parse_words(&argv, args);
+    svec_terminate(&argv);
+
+    /* Make getopt start over, since it has already parsed our own command
+     * line. */
+    optind = 0;
+    secchan = secchan_create(argv.n, argv.names);
+    secchan_start(secchan);
+    return secchan;
+}
+#endif
+
 static void
 parse_options(int argc, char *argv[])
 {
@@ -194,7 +421,15 @@ parse_options(int argc, char *argv[])
         OPT_SERIAL_NUM,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_NO_LOCAL_PORT,
-        OPT_NO_SLICING
+        OPT_NO_SLICING,
+        OPT_SECCHAN,
+        OPT_SNAPSHOT,
+        OPT_SNAPSHOT_INTERVAL,
+        OPT_SNAPSHOT_GRACE,
+        OPT_HANDOFF,
+        OPT_FAIL_OPEN_LEARNING,
+        OPT_TABLES,
+        VCONN_LOG_OPTION_ENUMS
     };
 
     static struct option long_options[] = {
@@ -206,12 +441,22 @@ parse_options(int argc, char *argv[])
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
         {"no-slicing",  no_argument, 0, OPT_NO_SLICING},
+        {"snapshot",    required_argument, 0, OPT_SNAPSHOT},
+        {"snapshot-interval", required_argument, 0, OPT_SNAPSHOT_INTERVAL},
+        {"snapshot-grace", required_argument, 0, OPT_SNAPSHOT_GRACE},
+        {"handoff",     required_argument, 0, OPT_HANDOFF},
+        {"fail-open-learning", no_argument, 0, OPT_FAIL_OPEN_LEARNING},
+        {"tables",      required_argument, 0, OPT_TABLES},
+#if defined(UDATAPATH_SECCHAN)
+        {"secchan",     required_argument, 0, OPT_SECCHAN},
+#endif
         {"mfr-desc",    required_argument, 0, OPT_MFR_DESC},
         {"hw-desc",     required_argument, 0, OPT_HW_DESC},
         {"sw-desc",     required_argument, 0, OPT_SW_DESC},
         {"dp_desc",  required_argument, 0, OPT_DP_DESC},
         {"serial_num",  required_argument, 0, OPT_SERIAL_NUM},
         DAEMON_LONG_OPTIONS,
+        VCONN_LOG_LONG_OPTIONS,
 #ifdef HAVE_OPENSSL
         VCONN_SSL_LONG_OPTIONS
         {"bootstrap-ca-cert", required_argument, 0, OPT_BOOTSTRAP_CA_CERT},
@@ -295,8 +540,52 @@ parse_options(int argc, char *argv[])
             num_queues = 0;
             break;
 
+        case OPT_SNAPSHOT:
+            snapshot_file = optarg;
+            break;
+
+        case OPT_SNAPSHOT_INTERVAL:
+            snapshot_interval = atoi(optarg);
+            if (snapshot_interval < 1) {
+                ofp_fatal(0, "--snapshot-interval argument must be at "
+                          "least 1");
+            }
+            break;
+
+        case OPT_SNAPSHOT_GRACE:
+            snapshot_grace = atoi(optarg);
+            if (snapshot_grace < 0) {
+                ofp_fatal(0, "--snapshot-grace argument must be "
+                          "nonnegative");
+            }
+            break;
+
+        case OPT_HANDOFF:
+            handoff_file = optarg;
+            break;
+
+        case OPT_FAIL_OPEN_LEARNING:
+            fail_open_learning = true;
+            break;
+
+        case OPT_TABLES: {
+            char *error = chain_set_layout(optarg);
+            if (error) {
+                ofp_fatal(0, "--tables: %s", error);
+            }
+            break;
+        }
+
+#if defined(UDATAPATH_SECCHAN)
+        case OPT_SECCHAN:
+            secchan_args = optarg;
+            break;
+#endif
+
         DAEMON_OPTION_HANDLERS
 
+        VCONN_LOG_OPTION_HANDLERS
+
 #ifdef HAVE_OPENSSL
         VCONN_SSL_OPTION_HANDLERS
 
@@ -332,14 +621,30 @@ usage(void)
            "  -d, --datapath-id=ID    Use ID as the OpenFlow switch ID\n"
            "                          (ID must consist of 12 hex digits)\n"
            "  --no-slicing            disable slicing\n"
+           "  --snapshot=FILE         save flow table to FILE periodically\n"
+           "                          and on SIGTERM, restore it at startup\n"
+           "  --snapshot-interval=SECS  save snapshot every SECS (default: 60)\n"
+           "  --snapshot-grace=SECS   keep restored flows SECS (default: 60)\n"
+           "  --handoff=FILE          take over from, and hand off to, other\n"
+           "                          ofdatapath processes via socket FILE\n"
+           "  --fail-open-learning    learn MAC addresses in the datapath\n"
+           "                          while the secure channel fails open\n"
+           "  --tables=TABLE[,TABLE]...\n"
+           "                          set flow tables (default:\n"
+           "                          %s)\n"
+#if defined(UDATAPATH_SECCHAN)
+           "  --secchan=\"[OPTIONS] [CONTROLLER]\"\n"
+           "                          run the secure channel in-process\n"
+#endif
            "\nOther options:\n"
            "  -D, --detach            run in background as daemon\n"
            "  -P, --pidfile[=FILE]    create pidfile (default: %s/ofdatapath.pid)\n"
            "  -f, --force             with -P, start even if already running\n"
            "  -v, --verbose=MODULE[:FACILITY[:LEVEL]]  set logging levels\n"
-           "  -v, --verbose           set maximum verbosity level\n"
-           "  -h, --help              display this help message\n"
-           "  -V, --version           display version information\n",
-        ofp_rundir);
+           "  -v, --verbose           set maximum verbosity level\n",
+        CHAIN_DEFAULT_LAYOUT, ofp_rundir);
+    vconn_log_usage();
+    printf("  -h, --help              display this help message\n"
+           "  -V, --version           display version information\n");
     exit(EXIT_SUCCESS);
 }
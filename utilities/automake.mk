@@ -32,7 +32,8 @@ man_MANS += \
 	utilities/ofp-pki.8 \
 	utilities/vlogconf.8
 
-utilities_dpctl_SOURCES = utilities/dpctl.c
+utilities_dpctl_SOURCES = utilities/dpctl.c udatapath/crc32.c
+utilities_dpctl_CPPFLAGS = $(AM_CPPFLAGS) -I $(top_srcdir)/udatapath
 utilities_dpctl_LDADD = lib/libopenflow.a $(FAULT_LIBS) $(SSL_LIBS)
 
 utilities_vlogconf_SOURCES = utilities/vlogconf.c
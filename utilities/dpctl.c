@@ -52,7 +52,9 @@
 
 #include "command-line.h"
 #include "compiler.h"
+#include "crc32.h"
 #include "dpif.h"
+#include "flow.h"
 #include "openflow/nicira-ext.h"
 #include "openflow/openflow-ext.h"
 #include "ofp-print.h"
@@ -87,6 +89,7 @@
 /* Settings that may be configured by the user. */
 struct settings {
     bool strict;        /* Use strict matching for flow mod commands */
+    bool bundle;        /* Send add-flows as flow-mod bundles */
 };
 
 struct command {
@@ -147,14 +150,18 @@ static void
 parse_options(int argc, char *argv[], struct settings *s)
 {
     enum {
-        OPT_STRICT = UCHAR_MAX + 1
+        OPT_STRICT = UCHAR_MAX + 1,
+        OPT_BUNDLE,
+        VCONN_LOG_OPTION_ENUMS
     };
     static struct option long_options[] = {
         {"timeout", required_argument, 0, 't'},
         {"verbose", optional_argument, 0, 'v'},
         {"strict", no_argument, 0, OPT_STRICT},
+        {"bundle", no_argument, 0, OPT_BUNDLE},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'V'},
+        VCONN_LOG_LONG_OPTIONS,
         VCONN_SSL_LONG_OPTIONS
         {0, 0, 0, 0},
     };
@@ -162,6 +169,7 @@ parse_options(int argc, char *argv[], struct settings *s)
 
     /* Set defaults that we can figure out before parsing options. */
     s->strict = false;
+    s->bundle = false;
 
     for (;;) {
         unsigned long int timeout;
@@ -199,6 +207,12 @@ parse_options(int argc, char *argv[], struct settings *s)
             s->strict = true;
             break;
 
+        case OPT_BUNDLE:
+            s->bundle = true;
+            break;
+
+        VCONN_LOG_OPTION_HANDLERS
+
         VCONN_SSL_OPTION_HANDLERS
 
         case '?':
@@ -228,8 +242,13 @@ usage(void)
            "  show SWITCH                 show basic information\n"
            "  status SWITCH [KEY]         report statistics (about KEY)\n"
            "  show-protostat SWITCH       report protocol statistics\n"
+           "  dump-txq SWITCH             print controller transmit queues\n"
+           "  dump-port-rx SWITCH         print port receive servicing\n"
+           "  dump-meters SWITCH [FLOW]   print policer statistics\n"
            "  dump-desc SWITCH            print switch description\n"
            "  dump-tables SWITCH          print table stats\n"
+           "  dump-table-usage SWITCH     print table memory and hit rates\n"
+           "  dump-table-diag SWITCH      print table diagnostics\n"
            "  mod-port SWITCH IFACE ACT   modify port behavior\n"
            "  dump-ports SWITCH [PORT]    print port statistics\n"
            "  desc SWITCH STRING          set switch description\n"
@@ -239,6 +258,7 @@ usage(void)
            "  dump-aggregate SWITCH FLOW  print aggregate stats for FLOWs\n"
            "  add-flow SWITCH FLOW        add flow described by FLOW\n"
            "  add-flows SWITCH FILE       add flows from FILE\n"
+           "  simulate-hash SWITCH FILE   simulate hashing flows from FILE\n"
            "  mod-flows SWITCH FLOW       modify actions of matching FLOWs\n"
            "  del-flows SWITCH [FLOW]     delete matching FLOWs\n"
            "  monitor SWITCH              print packets received from SWITCH\n"
@@ -256,8 +276,10 @@ usage(void)
            program_name, program_name);
     vconn_usage(true, false, false);
     vlog_usage();
+    vconn_log_usage();
     printf("\nOther options:\n"
            "  --strict                    use strict match for flow commands\n"
+           "  --bundle                    add-flows in bundles of many flows\n"
            "  -t, --timeout=SECS          give up after SECS seconds\n"
            "  -h, --help                  display this help message\n"
            "  -V, --version               display version information\n");
@@ -440,7 +462,16 @@ dump_trivial_transaction(const char *vconn_name, uint8_t request_type)
 }
 
 static void
-dump_stats_transaction(const char *vconn_name, struct ofpbuf *request)
+print_stats_reply(const struct ofpbuf *reply)
+{
+    ofp_print(stdout, reply->data, reply->size, 1);
+}
+
+/* Sends stats 'request' to 'vconn_name' and passes each reply to 'print',
+ * until the switch sends one without OFPSF_REPLY_MORE. */
+static void
+dump_stats_transaction__(const char *vconn_name, struct ofpbuf *request,
+                         void (*print)(const struct ofpbuf *reply))
 {
     uint32_t send_xid = ((struct ofp_header *) request->data)->xid;
     struct vconn *vconn;
@@ -458,7 +489,7 @@ dump_stats_transaction(const char *vconn_name, struct ofpbuf *request)
         if (send_xid == recv_xid) {
             struct ofp_stats_reply *osr;
           
-            ofp_print(stdout, reply->data, reply->size, 1);
+            print(reply);
 
             osr = ofpbuf_at(reply, 0, sizeof *osr);
             done = !osr || !(ntohs(osr->flags) & OFPSF_REPLY_MORE);
@@ -471,6 +502,12 @@ dump_stats_transaction(const char *vconn_name, struct ofpbuf *request)
     vconn_close(vconn);
 }
 
+static void
+dump_stats_transaction(const char *vconn_name, struct ofpbuf *request)
+{
+    dump_stats_transaction__(vconn_name, request, print_stats_reply);
+}
+
 static void
 dump_trivial_stats_transaction(const char *vconn_name, uint8_t stats_type)
 {
@@ -520,6 +557,7 @@ do_status(const struct settings *s UNUSED, int argc, char *argv[])
     request->subtype = htonl(NXT_STATUS_REQUEST);
     if (argc > 2) {
         ofpbuf_put(b, argv[2], strlen(argv[2]));
+        update_openflow_length(b);
     }
     open_vconn(argv[1], &vconn);
     run(vconn_transact(vconn, b, &b), "talking to %s", argv[1]);
@@ -536,7 +574,7 @@ do_status(const struct settings *s UNUSED, int argc, char *argv[])
         ofp_fatal(0, "bad reply");
     }
 
-    fwrite(reply + 1, b->size, 1, stdout);
+    fwrite(reply + 1, b->size - sizeof *reply, 1, stdout);
 }
 
 static void
@@ -720,6 +758,142 @@ do_protostat(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
     print_protocol_stat(ofps, ofps + 1);
 }
 
+static void
+do_dump_txq(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
+{
+    static const char *class_names[OFP_EXT_TXQ_N_CLASSES] = {
+        "slow-proto", "reply", "port-status", "flow-removed", "packet-in"
+    };
+    struct openflow_ext_stats_header *esh;
+    struct openflow_ext_txq_stats *ts;
+    struct ofp_stats_reply *osr;
+    struct ofpbuf *buf;
+    struct vconn *vconn;
+    size_t n, i;
+
+    esh = alloc_stats_request(sizeof *esh, OFPST_VENDOR, &buf);
+    esh->vendor = htonl(OPENFLOW_VENDOR_ID);
+    esh->subtype = htonl(OFP_EXT_STATS_TXQ);
+
+    open_vconn(argv[1], &vconn);
+    run(vconn_transact(vconn, buf, &buf), "talking to %s", argv[1]);
+    vconn_close(vconn);
+
+    osr = buf->data;
+    if (buf->size < sizeof *osr + sizeof *esh
+        || osr->header.type != OFPT_STATS_REPLY
+        || osr->type != htons(OFPST_VENDOR)) {
+        ofp_print(stderr, buf->data, buf->size, 2);
+        ofp_fatal(0, "bad reply");
+    }
+    esh = (struct openflow_ext_stats_header *) osr->body;
+    ts = (struct openflow_ext_txq_stats *) (esh + 1);
+    n = (buf->size - sizeof *osr - sizeof *esh) / sizeof *ts;
+    for (i = 0; i < n; i++, ts++) {
+        uint32_t class = ntohl(ts->txq_class);
+        printf("%-13s queued=%"PRIu32" (%"PRIu32"/%"PRIu32" bytes), "
+               "sent=%"PRIu64", dropped=%"PRIu64"\n",
+               class < OFP_EXT_TXQ_N_CLASSES ? class_names[class] : "unknown",
+               ntohl(ts->n_queued), ntohl(ts->n_bytes), ntohl(ts->max_bytes),
+               ntohll(ts->n_sent), ntohll(ts->n_dropped));
+    }
+    ofpbuf_delete(buf);
+}
+
+static void
+do_dump_port_rx(const struct settings *s UNUSED, int argc UNUSED,
+                char *argv[])
+{
+    struct openflow_ext_stats_header *esh;
+    struct openflow_ext_port_rx_stats *ps;
+    struct ofp_stats_reply *osr;
+    struct ofpbuf *buf;
+    struct vconn *vconn;
+    size_t n, i;
+
+    esh = alloc_stats_request(sizeof *esh, OFPST_VENDOR, &buf);
+    esh->vendor = htonl(OPENFLOW_VENDOR_ID);
+    esh->subtype = htonl(OFP_EXT_STATS_PORT_RX);
+
+    open_vconn(argv[1], &vconn);
+    run(vconn_transact(vconn, buf, &buf), "talking to %s", argv[1]);
+    vconn_close(vconn);
+
+    osr = buf->data;
+    if (buf->size < sizeof *osr + sizeof *esh
+        || osr->header.type != OFPT_STATS_REPLY
+        || osr->type != htons(OFPST_VENDOR)) {
+        ofp_print(stderr, buf->data, buf->size, 2);
+        ofp_fatal(0, "bad reply");
+    }
+    esh = (struct openflow_ext_stats_header *) osr->body;
+    ps = (struct openflow_ext_port_rx_stats *) (esh + 1);
+    n = (buf->size - sizeof *osr - sizeof *esh) / sizeof *ps;
+    for (i = 0; i < n; i++, ps++) {
+        printf("port %3"PRIu16": %s wakeups=%"PRIu64", services=%"PRIu64", "
+               "empty=%"PRIu64", exhausted=%"PRIu64"\n",
+               ntohs(ps->port_no), ps->ready ? "ready" : "idle ",
+               ntohll(ps->n_wakeups), ntohll(ps->n_services),
+               ntohll(ps->n_empty), ntohll(ps->n_exhausted));
+    }
+    ofpbuf_delete(buf);
+}
+
+static void
+do_dump_table_usage(const struct settings *s UNUSED, int argc UNUSED,
+                    char *argv[])
+{
+    static const char *placement_names[] = { "any", "exact", "wild", "emerg" };
+    struct openflow_ext_stats_header *esh;
+    struct openflow_ext_table_stats *ts;
+    struct ofp_stats_reply *osr;
+    struct ofpbuf *buf;
+    struct vconn *vconn;
+    size_t n, i;
+
+    esh = alloc_stats_request(sizeof *esh, OFPST_VENDOR, &buf);
+    esh->vendor = htonl(OPENFLOW_VENDOR_ID);
+    esh->subtype = htonl(OFP_EXT_STATS_TABLE);
+
+    open_vconn(argv[1], &vconn);
+    run(vconn_transact(vconn, buf, &buf), "talking to %s", argv[1]);
+    vconn_close(vconn);
+
+    osr = buf->data;
+    if (buf->size < sizeof *osr + sizeof *esh
+        || osr->header.type != OFPT_STATS_REPLY
+        || osr->type != htons(OFPST_VENDOR)) {
+        ofp_print(stderr, buf->data, buf->size, 2);
+        ofp_fatal(0, "bad reply");
+    }
+    esh = (struct openflow_ext_stats_header *) osr->body;
+    ts = (struct openflow_ext_table_stats *) (esh + 1);
+    n = (buf->size - sizeof *osr - sizeof *esh) / sizeof *ts;
+    for (i = 0; i < n; i++, ts++) {
+        uint64_t lookups = ntohll(ts->lookup_count);
+        uint64_t matches = ntohll(ts->matched_count);
+        char name[OFP_MAX_TABLE_NAME_LEN + 1];
+
+        memcpy(name, ts->name, sizeof ts->name);
+        name[sizeof ts->name] = '\0';
+        if (ts->table_id == 0xfe) {
+            printf("emerg: ");
+        } else {
+            printf("%5"PRIu8": ", ts->table_id);
+        }
+        printf("%-7s placement=%s, flows=%"PRIu32"/%"PRIu32", "
+               "memory=%"PRIu64" kB\n"
+               "       lookups=%"PRIu64", matched=%"PRIu64" (%.1f%%)\n",
+               name,
+               (ts->placement < ARRAY_SIZE(placement_names)
+                ? placement_names[ts->placement] : "unknown"),
+               ntohl(ts->active_count), ntohl(ts->max_entries),
+               (ntohll(ts->n_bytes) + 1023) / 1024,
+               lookups, matches, lookups ? 100.0 * matches / lookups : 0.0);
+    }
+    ofpbuf_delete(buf);
+}
+
 static void
 do_dump_desc(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
 {
@@ -839,6 +1013,81 @@ put_enqueue_action(struct ofpbuf *b, uint16_t port, uint32_t queue)
     return oao;
 }
 
+/* Names of the OFP_EXT_MP_* fields, indexed by bit number. */
+static const char *multipath_fields[] = {
+    "in_port", "dl_src", "dl_dst", "dl_vlan", "dl_type",
+    "nw_src", "nw_dst", "nw_proto", "tp_src", "tp_dst"
+};
+
+/* Parses 'arg', which has the form ALGORITHM:FIELDS:PORTS[:BASIS], where
+ * FIELDS and PORTS are lists separated by '+', into a multipath action
+ * appended to 'b'. */
+static void
+put_multipath_action(struct ofpbuf *b, char *arg)
+{
+    struct openflow_ext_action_multipath *am;
+    char *algorithm, *fields, *ports, *basis, *field, *port;
+    char *save_ptr = NULL;
+    uint16_t port_nos[UINT8_MAX];
+    size_t n_ports, len;
+    uint16_t field_bits;
+
+    algorithm = arg ? strtok_r(arg, ":", &save_ptr) : NULL;
+    fields = algorithm ? strtok_r(NULL, ":", &save_ptr) : NULL;
+    ports = fields ? strtok_r(NULL, ":", &save_ptr) : NULL;
+    basis = ports ? strtok_r(NULL, ":", &save_ptr) : NULL;
+    if (!ports) {
+        ofp_fatal(0, "multipath requires ALGORITHM:FIELDS:PORTS arguments");
+    }
+
+    field_bits = 0;
+    for (field = strtok_r(fields, "+", &save_ptr); field;
+         field = strtok_r(NULL, "+", &save_ptr)) {
+        size_t i;
+
+        if (!strcasecmp(field, "all")) {
+            field_bits |= OFP_EXT_MP_ALL;
+            continue;
+        }
+        for (i = 0; i < ARRAY_SIZE(multipath_fields); i++) {
+            if (!strcasecmp(field, multipath_fields[i])) {
+                field_bits |= 1u << i;
+                break;
+            }
+        }
+        if (i >= ARRAY_SIZE(multipath_fields)) {
+            ofp_fatal(0, "unknown multipath field %s", field);
+        }
+    }
+
+    n_ports = 0;
+    for (port = strtok_r(ports, "+", &save_ptr); port;
+         port = strtok_r(NULL, "+", &save_ptr)) {
+        if (n_ports >= ARRAY_SIZE(port_nos)) {
+            ofp_fatal(0, "too many multipath ports");
+        }
+        port_nos[n_ports++] = str_to_u32(port);
+    }
+
+    len = ROUND_UP(sizeof *am + n_ports * sizeof am->ports[0], 8);
+    am = put_action(b, len, OFPAT_VENDOR);
+    am->vendor = htonl(OPENFLOW_VENDOR_ID);
+    am->subtype = htons(OFP_EXT_ACTION_MULTIPATH);
+    if (!strcasecmp(algorithm, "modulo")) {
+        am->algorithm = OFP_EXT_MP_MODULO;
+    } else if (!strcasecmp(algorithm, "hrw")) {
+        am->algorithm = OFP_EXT_MP_HRW;
+    } else {
+        ofp_fatal(0, "unknown multipath algorithm %s", algorithm);
+    }
+    am->n_ports = n_ports;
+    am->fields = htons(field_bits);
+    am->basis = htons(basis ? str_to_u32(basis) : 0);
+    while (n_ports-- > 0) {
+        am->ports[n_ports] = htons(port_nos[n_ports]);
+    }
+}
+
 static void
 str_to_action(char *str, struct ofpbuf *b)
 {
@@ -886,6 +1135,33 @@ str_to_action(char *str, struct ofpbuf *b)
                 arg2++;
             }
             put_enqueue_action(b, str_to_u32(arg), str_to_u32(arg2));
+        } else if (!strcasecmp(act, "police")) {
+            struct openflow_ext_action_police *ap;
+            char *arg3;
+
+            arg2 = arg ? strchr(arg, ':') : NULL;
+            if (!arg2) {
+                ofp_fatal(0, "police requires RATE:BURST arguments");
+            }
+            *arg2++ = '\0';
+            arg3 = strchr(arg2, ':');
+            if (arg3) {
+                *arg3++ = '\0';
+            }
+
+            ap = put_action(b, sizeof *ap, OFPAT_VENDOR);
+            ap->vendor = htonl(OPENFLOW_VENDOR_ID);
+            ap->subtype = htons(OFP_EXT_ACTION_POLICE);
+            ap->rate = htonl(str_to_u32(arg));
+            ap->burst = htonl(str_to_u32(arg2));
+            if (arg3) {
+                ap->policy = OFP_EXT_POLICE_REMARK;
+                ap->dscp = str_to_u32(arg3);
+            } else {
+                ap->policy = OFP_EXT_POLICE_DROP;
+            }
+        } else if (!strcasecmp(act, "multipath")) {
+            put_multipath_action(b, arg);
         } else if (!strcasecmp(act, "output")) {
             put_output_action(b, str_to_u32(arg));
         } else if (!strcasecmp(act, "TABLE")) {
@@ -1144,6 +1420,65 @@ do_dump_aggregate(const struct settings *s UNUSED, int argc, char *argv[])
 
 #define EMERG_TABLE_ID 0xfe
 
+static void
+print_meter_stats(const struct ofpbuf *reply)
+{
+    const struct openflow_ext_stats_header *esh;
+    const struct openflow_ext_meter_stats *ms;
+    const struct ofp_stats_reply *osr;
+    size_t n, i;
+
+    osr = reply->data;
+    if (reply->size < sizeof *osr + sizeof *esh
+        || osr->header.type != OFPT_STATS_REPLY
+        || osr->type != htons(OFPST_VENDOR)) {
+        ofp_print(stderr, reply->data, reply->size, 2);
+        ofp_fatal(0, "bad reply");
+    }
+    esh = (const struct openflow_ext_stats_header *) osr->body;
+    ms = (const struct openflow_ext_meter_stats *) (esh + 1);
+    n = (reply->size - sizeof *osr - sizeof *esh) / sizeof *ms;
+    for (i = 0; i < n; i++, ms++) {
+        char *match = ofp_match_to_string(&ms->match, 1);
+
+        printf("table=%"PRIu8", priority=%"PRIu16", meter=%"PRIu8", %s\n"
+               "  rate=%"PRIu32"kbps, burst=%"PRIu32"kb, exceed=",
+               ms->table_id, ntohs(ms->priority), ms->meter_idx, match,
+               ntohl(ms->rate), ntohl(ms->burst));
+        if (ms->policy == OFP_EXT_POLICE_REMARK) {
+            printf("dscp:%"PRIu8, ms->dscp);
+        } else {
+            printf("drop");
+        }
+        printf(", conformed=%"PRIu64"/%"PRIu64" pkts/bytes, "
+               "exceeded=%"PRIu64"/%"PRIu64" pkts/bytes\n",
+               ntohll(ms->conform_packets), ntohll(ms->conform_bytes),
+               ntohll(ms->exceed_packets), ntohll(ms->exceed_bytes));
+        free(match);
+    }
+}
+
+static void
+do_dump_meters(const struct settings *s UNUSED, int argc, char *argv[])
+{
+    struct openflow_ext_stats_header *esh;
+    struct ofp_flow_stats_request *req;
+    struct ofpbuf *request;
+    uint16_t out_port;
+
+    esh = alloc_stats_request(sizeof *esh + sizeof *req, OFPST_VENDOR,
+                              &request);
+    esh->vendor = htonl(OPENFLOW_VENDOR_ID);
+    esh->subtype = htonl(OFP_EXT_STATS_METER);
+    req = (struct ofp_flow_stats_request *) (esh + 1);
+    str_to_flow(argc > 2 ? argv[2] : "", &req->match, NULL,
+                &req->table_id, &out_port, NULL, NULL, NULL, NULL);
+    memset(&req->pad, 0, sizeof req->pad);
+    req->out_port = htons(out_port);
+
+    dump_stats_transaction__(argv[1], request, print_meter_stats);
+}
+
 static void
 do_add_flow(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
 {
@@ -1178,10 +1513,27 @@ do_add_flow(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
     vconn_close(vconn);
 }
 
+/* Sends 'bundle', an OFP_EXT_FLOW_MOD_BUNDLE, on 'vconn' and waits for the
+ * switch to apply it.  Exits with an error if the switch rejects it. */
+static void
+transact_flow_mod_bundle(struct vconn *vconn, struct ofpbuf *bundle)
+{
+    struct ofpbuf *reply;
+
+    run(vconn_transact(vconn, bundle, &reply), "talking to %s",
+        vconn_get_name(vconn));
+    if (((struct ofp_header *) reply->data)->type == OFPT_ERROR) {
+        ofp_print(stderr, reply->data, reply->size, 1);
+        ofp_fatal(0, "%s: switch rejected flow bundle", vconn_get_name(vconn));
+    }
+    ofpbuf_delete(reply);
+}
+
 static void
-do_add_flows(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
+do_add_flows(const struct settings *s, int argc UNUSED, char *argv[])
 {
     struct vconn *vconn;
+    struct ofpbuf *bundle;
     FILE *file;
     char line[1024];
 
@@ -1191,6 +1543,7 @@ do_add_flows(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
     }
 
     open_vconn(argv[1], &vconn);
+    bundle = s->bundle ? make_flow_mod_bundle() : NULL;
     while (fgets(line, sizeof line, file)) {
         struct ofpbuf *buffer;
         struct ofp_flow_mod *ofm;
@@ -1231,10 +1584,292 @@ do_add_flows(const struct settings *s UNUSED, int argc UNUSED, char *argv[])
         if (table_id == EMERG_TABLE_ID)
             ofm->flags |= htons(OFPFF_EMERG);
 
-        send_openflow_buffer(vconn, buffer);
+        if (!bundle) {
+            send_openflow_buffer(vconn, buffer);
+            continue;
+        }
+
+        update_openflow_length(buffer);
+        if (!flow_mod_bundle_append(bundle, buffer->data)) {
+            transact_flow_mod_bundle(vconn, bundle);
+            bundle = make_flow_mod_bundle();
+            flow_mod_bundle_append(bundle, buffer->data);
+        }
+        ofpbuf_delete(buffer);
     }
+    if (bundle) {
+        transact_flow_mod_bundle(vconn, bundle);
+    }
+    vconn_close(vconn);
+    fclose(file);
+}
+
+/* Fetches OFP_EXT_STATS_TABLE_DIAG statistics from 'vconn_name'.  Returns
+ * the reply, which the caller must free, and stores the tables' diagnostics
+ * and their number into '*tdsp' and '*n_tdsp'. */
+static struct ofpbuf *
+fetch_table_diag(const char *vconn_name,
+                 struct openflow_ext_table_diag **tdsp, size_t *n_tdsp)
+{
+    struct openflow_ext_stats_header *esh;
+    struct ofp_stats_reply *osr;
+    struct ofpbuf *buf;
+    struct vconn *vconn;
+
+    esh = alloc_stats_request(sizeof *esh, OFPST_VENDOR, &buf);
+    esh->vendor = htonl(OPENFLOW_VENDOR_ID);
+    esh->subtype = htonl(OFP_EXT_STATS_TABLE_DIAG);
+
+    open_vconn(vconn_name, &vconn);
+    run(vconn_transact(vconn, buf, &buf), "talking to %s", vconn_name);
     vconn_close(vconn);
+
+    osr = buf->data;
+    if (buf->size < sizeof *osr + sizeof *esh
+        || osr->header.type != OFPT_STATS_REPLY
+        || osr->type != htons(OFPST_VENDOR)) {
+        ofp_print(stderr, buf->data, buf->size, 2);
+        ofp_fatal(0, "bad reply");
+    }
+    esh = (struct openflow_ext_stats_header *) osr->body;
+    *tdsp = (struct openflow_ext_table_diag *) (esh + 1);
+    *n_tdsp = (buf->size - sizeof *osr - sizeof *esh) / sizeof **tdsp;
+    return buf;
+}
+
+static void
+print_table_name(const struct openflow_ext_table_diag *td)
+{
+    char name[OFP_MAX_TABLE_NAME_LEN + 1];
+
+    memcpy(name, td->name, sizeof td->name);
+    name[sizeof td->name] = '\0';
+    if (td->table_id == EMERG_TABLE_ID) {
+        printf("emerg: %s", name);
+    } else {
+        printf("%5"PRIu8": %s", td->table_id, name);
+    }
+}
+
+/* Prints the nonzero bins of 'hist', which has OFP_EXT_HIST_BINS bins. */
+static void
+print_histogram(const uint64_t hist[])
+{
+    int i;
+
+    for (i = 0; i < OFP_EXT_HIST_BINS; i++) {
+        uint64_t n = ntohll(hist[i]);
+        if (!n) {
+            continue;
+        }
+        if (i < 2) {
+            printf(" %d:%"PRIu64, i, n);
+        } else if (i < OFP_EXT_HIST_BINS - 1) {
+            printf(" %u-%u:%"PRIu64, 1u << (i - 1), (1u << i) - 1, n);
+        } else {
+            printf(" %u+:%"PRIu64, 1u << (i - 1), n);
+        }
+    }
+}
+
+static void
+do_dump_table_diag(const struct settings *s UNUSED, int argc UNUSED,
+                   char *argv[])
+{
+    struct openflow_ext_table_diag *tds;
+    uint64_t total_lookups;
+    struct ofpbuf *buf;
+    size_t n, i;
+    int j, k;
+
+    buf = fetch_table_diag(argv[1], &tds, &n);
+
+    /* Every packet is looked up in the first table. */
+    total_lookups = n ? ntohll(tds[0].lookup_count) : 0;
+
+    for (i = 0; i < n; i++) {
+        const struct openflow_ext_table_diag *td = &tds[i];
+        uint32_t n_flows = ntohl(td->active_count);
+        uint32_t max_flows = ntohl(td->max_entries);
+        uint64_t matches = ntohll(td->matched_count);
+
+        print_table_name(td);
+        printf(": flows=%"PRIu32"/%"PRIu32" (load %.1f%%), "
+               "lookups=%"PRIu64", matched=%"PRIu64,
+               n_flows, max_flows,
+               max_flows ? 100.0 * n_flows / max_flows : 0.0,
+               ntohll(td->lookup_count), matches);
+        if (td->table_id != EMERG_TABLE_ID) {
+            printf(" (%.1f%% of packets)",
+                   total_lookups ? 100.0 * matches / total_lookups : 0.0);
+        }
+        putchar('\n');
+
+        for (j = 0; j < OFP_EXT_HIST_BINS; j++) {
+            if (td->depth[j]) {
+                printf("       flows examined per lookup:");
+                print_histogram(td->depth);
+                putchar('\n');
+                break;
+            }
+        }
+
+        for (j = 0; j < td->n_hashes && j < ARRAY_SIZE(td->hashes); j++) {
+            const struct openflow_ext_hash_diag *hd = &td->hashes[j];
+            uint32_t n_buckets = ntohl(hd->n_buckets);
+            uint32_t hash_flows = ntohl(hd->n_flows);
+
+            printf("       hash %d: polynomial=%#"PRIx32", "
+                   "flows=%"PRIu32"/%"PRIu32" (load %.1f%%), "
+                   "collisions=%"PRIu64"\n"
+                   "               occupancy by sixteenths:",
+                   j, ntohl(hd->polynomial), hash_flows, n_buckets,
+                   n_buckets ? 100.0 * hash_flows / n_buckets : 0.0,
+                   ntohll(hd->n_collisions));
+            for (k = 0; k < OFP_EXT_HIST_BINS; k++) {
+                printf(" %"PRIu32, ntohl(hd->occupancy[k]));
+            }
+            putchar('\n');
+        }
+    }
+    ofpbuf_delete(buf);
+}
+
+/* One hash function of a hash table, for do_simulate_hash(). */
+struct sim_hash {
+    int table_id;
+    int hash_idx;
+    struct crc32 crc32;
+    uint32_t polynomial;
+    uint32_t n_buckets;
+    struct flow *buckets;       /* Flows, in bucket order. */
+    uint8_t *occupied;          /* Nonzero for each occupied bucket. */
+    unsigned int n_flows;
+    unsigned int n_collisions;
+};
+
+static void
+do_simulate_hash(const struct settings *s UNUSED, int argc UNUSED,
+                 char *argv[])
+{
+    struct openflow_ext_table_diag *tds;
+    struct sim_hash *hashes;
+    unsigned int n_exact, n_wild, n_dups, n_overflow;
+    size_t n_tds, n_hashes, i;
+    struct ofpbuf *buf;
+    char line[1024];
+    FILE *file;
+
+    file = fopen(argv[2], "r");
+    if (file == NULL) {
+        ofp_fatal(errno, "%s: open", argv[2]);
+    }
+
+    /* Set up empty hash tables with the switch's parameters, in the order
+     * that the switch tries them. */
+    buf = fetch_table_diag(argv[1], &tds, &n_tds);
+    hashes = xmalloc(n_tds * ARRAY_SIZE(tds->hashes) * sizeof *hashes);
+    n_hashes = 0;
+    for (i = 0; i < n_tds; i++) {
+        const struct openflow_ext_table_diag *td = &tds[i];
+        int j;
+
+        if (td->table_id == EMERG_TABLE_ID) {
+            continue;
+        }
+        for (j = 0; j < td->n_hashes && j < ARRAY_SIZE(td->hashes); j++) {
+            struct sim_hash *h = &hashes[n_hashes++];
+
+            h->table_id = td->table_id;
+            h->hash_idx = j;
+            h->polynomial = ntohl(td->hashes[j].polynomial);
+            h->n_buckets = ntohl(td->hashes[j].n_buckets);
+            if (!h->n_buckets || h->n_buckets & (h->n_buckets - 1)) {
+                ofp_fatal(0, "table %d has bad bucket count %"PRIu32,
+                          td->table_id, h->n_buckets);
+            }
+            crc32_init(&h->crc32, h->polynomial);
+            h->buckets = xmalloc(h->n_buckets * sizeof *h->buckets);
+            h->occupied = xcalloc(h->n_buckets, 1);
+            h->n_flows = h->n_collisions = 0;
+        }
+    }
+    ofpbuf_delete(buf);
+    if (!n_hashes) {
+        ofp_fatal(0, "%s has no hash tables", argv[1]);
+    }
+
+    n_exact = n_wild = n_dups = n_overflow = 0;
+    while (fgets(line, sizeof line, file)) {
+        struct ofp_match match;
+        struct ofpbuf *actions;
+        struct flow flow;
+        uint32_t wildcards;
+        uint8_t table_id;
+        char *comment;
+
+        comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        if (line[strspn(line, " \t\n")] == '\0') {
+            continue;
+        }
+
+        actions = ofpbuf_new(0);
+        str_to_flow(line, &match, actions, &table_id, NULL, NULL, NULL, NULL,
+                    NULL);
+        ofpbuf_delete(actions);
+        if (table_id == EMERG_TABLE_ID) {
+            continue;
+        }
+        flow_from_match(&flow, &wildcards, &match);
+        if (wildcards) {
+            n_wild++;
+            continue;
+        }
+
+        /* Place the flow the way table-hash does: in the first hash function
+         * whose bucket is empty or already holds the same flow. */
+        n_exact++;
+        for (i = 0; i < n_hashes; i++) {
+            struct sim_hash *h = &hashes[i];
+            uint32_t idx = (crc32_calculate(&h->crc32, &flow, sizeof flow)
+                            & (h->n_buckets - 1));
+
+            if (!h->occupied[idx]) {
+                h->occupied[idx] = 1;
+                h->buckets[idx] = flow;
+                h->n_flows++;
+                break;
+            } else if (flow_equal(&h->buckets[idx], &flow)) {
+                n_dups++;
+                break;
+            }
+            h->n_collisions++;
+        }
+        if (i >= n_hashes) {
+            n_overflow++;
+        }
+    }
     fclose(file);
+
+    printf("%u exact-match flows (%u duplicates), %u wildcarded flows\n",
+           n_exact, n_dups, n_wild);
+    for (i = 0; i < n_hashes; i++) {
+        struct sim_hash *h = &hashes[i];
+
+        printf("table %d hash %d: polynomial=%#"PRIx32", "
+               "flows=%u/%"PRIu32" (load %.1f%%), collisions=%u\n",
+               h->table_id, h->hash_idx, h->polynomial,
+               h->n_flows, h->n_buckets, 100.0 * h->n_flows / h->n_buckets,
+               h->n_collisions);
+        free(h->buckets);
+        free(h->occupied);
+    }
+    printf("%u exact-match flows would not fit in any hash table\n",
+           n_overflow);
+    free(hashes);
 }
 
 static void
@@ -1747,6 +2382,12 @@ static struct command all_commands[] = {
     { "status", 1, 2, do_status },
 
     { "show-protostat", 1, 1, do_protostat },
+    { "dump-txq", 1, 1, do_dump_txq },
+    { "dump-port-rx", 1, 1, do_dump_port_rx },
+    { "dump-table-usage", 1, 1, do_dump_table_usage },
+    { "dump-table-diag", 1, 1, do_dump_table_diag },
+    { "simulate-hash", 2, 2, do_simulate_hash },
+    { "dump-meters", 1, 2, do_dump_meters },
 
     { "help", 0, INT_MAX, do_help },
     { "monitor", 1, 1, do_monitor },